@@ -0,0 +1,319 @@
+/*
+ *  aot.c
+ *  Contains the ahead-of-time translation of APEX programs to native code
+ *
+ *  Every instruction becomes a few lines of C on locals r0-r15 and z,
+ *  labelled by its index so BZ/BNZ jump straight to their target. JUMP
+ *  and JAL go through a switch on the target PC. Signed arithmetic is
+ *  done on unsigned ints so overflow wraps like the pipeline's. The
+ *  instruction limit is checked at control transfers only.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <dlfcn.h>
+
+#include "cpu.h"
+
+extern int benchOutput;
+
+int aotEnabled=0;
+const char* aotDir=NULL;		// keep the generated C and shared object here
+const char* aotCompiler="gcc";
+
+static const char* exitNames[AOT_EXITS]={"HALT","limit","bad target","bad address","end of code"};
+
+int aotParseOption(const char* arg)
+{
+	const char* value;
+
+	if(matchOption(arg,"--aot",&value))
+		aotEnabled=atoi(value);
+	else if(matchOption(arg,"--aot-dir",&value))
+		aotDir=value;
+	else if(matchOption(arg,"--aot-cc",&value))
+		aotCompiler=value;
+	else
+		return 0;
+
+	return 1;
+}
+
+static int pcOfIndex(int index)
+{
+	return 4000+index*4;
+}
+
+static int indexOfPc(APEX_CPU* cpu,int pc)
+{
+	if(pc<4000 || (pc-4000)%4!=0 || (pc-4000)/4>=cpu->thread->code_memory_size)
+		return -1;
+	return (pc-4000)/4;
+}
+
+static int isBranch(const char* opcode)
+{
+	return strcmp(opcode,"BZ")==0 || strcmp(opcode,"BNZ")==0;
+}
+
+static int isJump(const char* opcode)
+{
+	return strcmp(opcode,"JUMP")==0 || strcmp(opcode,"JAL")==0;
+}
+
+/* Taken control transfer to a PC known at translation time */
+static void emitGoto(FILE* fp,APEX_CPU* cpu,int target)
+{
+	int index=indexOfPc(cpu,target);
+
+	fprintf(fp,"{ pc=%d; if(n>=limit) { status=%d; goto out; } ",target,AOT_EXIT_LIMIT);
+	if(index>-1)
+		fprintf(fp,"goto I%d; }",index);
+	else
+		fprintf(fp,"status=%d; goto out; }",AOT_EXIT_BAD_TARGET);
+}
+
+static void emitMemCheck(FILE* fp,int pc,int memSize)
+{
+	fprintf(fp,"if((u32)a>=%du) { pc=%d; status=%d; goto out; } ",memSize,pc,AOT_EXIT_BAD_ADDRESS);
+}
+
+/*
+ * Writes the translation of code memory to path as one C function,
+ * apex_native_run. Returns -1 for opcodes or registers it cannot translate.
+ */
+int aotTranslate(APEX_CPU* cpu,const char* path)
+{
+	int size=cpu->thread->code_memory_size;
+	int memSize=sizeof(cpu->data_memory)/sizeof(cpu->data_memory[0]);
+	char* leader=calloc(size+1,1);
+	FILE* fp;
+
+	if(!leader)
+		return -1;
+
+	// block starts: entry, branch targets and whatever follows a control transfer
+	leader[0]=1;
+	for(int i=0;i<size;i++)
+	{
+		APEX_Instruction* ins=&cpu->thread->code_memory[i];
+		int target=isBranch(ins->opcode) ? indexOfPc(cpu,pcOfIndex(i)+ins->imm) : -1;
+
+		if(target>-1)
+			leader[target]=1;
+		if(isBranch(ins->opcode) || isJump(ins->opcode))
+			leader[i+1]=1;
+	}
+
+	fp=fopen(path,"w");
+	if(!fp)
+	{
+		fprintf(cpu->err,"APEX_Error : Cannot open %s\n",path);
+		free(leader);
+		return -1;
+	}
+
+	fprintf(fp,"/* Generated by apex_sim --aot=1 from %d instructions */\n",size);
+	fprintf(fp,"typedef unsigned int u32;\n\n");
+	fprintf(fp,"int apex_native_run(int* state,int* mem,long long limit,long long* executed)\n{\n");
+	for(int r=0;r<ARCH_REGS;r++)
+		fprintf(fp,"\tint r%d=state[%d];\n",r,r);
+	fprintf(fp,"\tint z=state[%d];\n\tint pc=state[%d];\n",AOT_STATE_ZFLAG,AOT_STATE_PC);
+	fprintf(fp,"\tint a;\n\tint status=%d;\n\tlong long n=0;\n\n",AOT_EXIT_END);
+
+	fprintf(fp,"dispatch:\n\tswitch(pc)\n\t{\n");
+	for(int i=0;i<size;i++)
+		fprintf(fp,"\tcase %d: goto I%d;\n",pcOfIndex(i),i);
+	fprintf(fp,"\tdefault: status=%d; goto out;\n\t}\n",AOT_EXIT_BAD_TARGET);
+
+	int result=0;
+	for(int i=0;i<size && result==0;i++)
+	{
+		APEX_Instruction* ins=&cpu->thread->code_memory[i];
+		const char* op=ins->opcode;
+		int pc=pcOfIndex(i);
+		int rd=ins->rd,rs1=ins->rs1,rs2=ins->rs2,imm=ins->imm;
+
+		if(rd<0 || rd>=ARCH_REGS || rs1<0 || rs1>=ARCH_REGS || rs2<0 || rs2>=ARCH_REGS)
+		{
+			fprintf(cpu->err,"APEX_Error : --aot cannot translate register of %s at pc %d\n",op,pc);
+			result=-1;
+			break;
+		}
+
+		if(leader[i])
+			fprintf(fp,"\n\t/* block at pc %d */\n",pc);
+		fprintf(fp,"I%d:\tn++; ",i);
+
+		if(strcmp(op,"ADD")==0 || strcmp(op,"SUB")==0 || strcmp(op,"MUL")==0)
+		{
+			const char* sign=op[0]=='A' ? "+" : (op[0]=='S' ? "-" : "*");
+			fprintf(fp,"r%d=(int)((u32)r%d%s(u32)r%d); z=r%d==0;",rd,rs1,sign,rs2,rd);
+		}
+		else if(strcmp(op,"AND")==0 || strcmp(op,"OR")==0 || strcmp(op,"EX-OR")==0)
+		{
+			const char* sign=op[0]=='A' ? "&" : (op[0]=='O' ? "|" : "^");
+			fprintf(fp,"r%d=r%d%sr%d; z=r%d==0;",rd,rs1,sign,rs2,rd);
+		}
+		else if(strcmp(op,"ADDL")==0 || strcmp(op,"SUBL")==0)
+			fprintf(fp,"r%d=(int)((u32)r%d%s(u32)%d); z=r%d==0;",rd,rs1,op[0]=='A' ? "+" : "-",imm,rd);
+		else if(strcmp(op,"MOVC")==0)
+			fprintf(fp,"r%d=%d; z=r%d==0;",rd,imm,rd);
+		else if(strcmp(op,"LOAD")==0)
+		{
+			// LOAD leaves the zero flag alone
+			fprintf(fp,"a=(int)((u32)r%d+(u32)%d); ",rs1,imm);
+			emitMemCheck(fp,pc,memSize);
+			fprintf(fp,"r%d=mem[a];",rd);
+		}
+		else if(strcmp(op,"STORE")==0)
+		{
+			fprintf(fp,"a=(int)((u32)r%d+(u32)%d); ",rs2,imm);
+			emitMemCheck(fp,pc,memSize);
+			fprintf(fp,"mem[a]=r%d;",rs1);
+		}
+		else if(isBranch(op))
+		{
+			fprintf(fp,"if(%sz) ",strcmp(op,"BZ")==0 ? "" : "!");
+			emitGoto(fp,cpu,pc+imm);
+		}
+		else if(strcmp(op,"JUMP")==0)
+		{
+			fprintf(fp,"pc=(int)((u32)r%d+(u32)%d); ",rs1,imm);
+			fprintf(fp,"if(n>=limit) { status=%d; goto out; } goto dispatch;",AOT_EXIT_LIMIT);
+		}
+		else if(strcmp(op,"JAL")==0)
+		{
+			// target first, rd may be rs1
+			fprintf(fp,"a=(int)((u32)r%d+(u32)%d); r%d=%d; z=r%d==0; pc=a; ",rs1,imm,rd,pc+4,rd);
+			fprintf(fp,"if(n>=limit) { status=%d; goto out; } goto dispatch;",AOT_EXIT_LIMIT);
+		}
+		else if(strcmp(op,"HALT")==0)
+			fprintf(fp,"pc=%d; status=%d; goto out;",pc,AOT_EXIT_HALT);
+		else
+		{
+			fprintf(cpu->err,"APEX_Error : --aot cannot translate opcode %s at pc %d\n",op,pc);
+			result=-1;
+		}
+		fprintf(fp,"\n");
+	}
+
+	fprintf(fp,"\n\tpc=%d;\n",pcOfIndex(size));
+	fprintf(fp,"out:\n");
+	for(int r=0;r<ARCH_REGS;r++)
+		fprintf(fp,"\tstate[%d]=r%d;\n",r,r);
+	fprintf(fp,"\tstate[%d]=z;\n\tstate[%d]=pc;\n",AOT_STATE_ZFLAG,AOT_STATE_PC);
+	fprintf(fp,"\t*executed=n;\n\treturn status;\n}\n");
+
+	fclose(fp);
+	free(leader);
+	return result;
+}
+
+static double secondsSince(struct timespec* start)
+{
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC,&end);
+	return (end.tv_sec-start->tv_sec)+(end.tv_nsec-start->tv_nsec)/1e9;
+}
+
+/*
+ * Translates, compiles and loads the program, then runs it natively on
+ * the cpu's data memory. The architectural result lands in cpu->thread->regs,
+ * cpu->thread->zeroFlag and cpu->data_memory, the outcome in cpu->aot.
+ */
+int aotRun(APEX_CPU* cpu,long long limit)
+{
+	char dir[256],source[512],object[512],command[1600];
+	struct timespec start;
+	int result=-1;
+
+	clock_gettime(CLOCK_MONOTONIC,&start);
+	if(aotDir)
+		snprintf(dir,sizeof(dir),"%s",aotDir);
+	else
+	{
+		snprintf(dir,sizeof(dir),"/tmp/apex_aot_XXXXXX");
+		if(!mkdtemp(dir))
+		{
+			fprintf(cpu->err,"APEX_Error : Cannot create a directory for --aot\n");
+			return -1;
+		}
+	}
+	snprintf(source,sizeof(source),"%s/apex_aot_%d.c",dir,(int)getpid());
+	snprintf(object,sizeof(object),"%s/apex_aot_%d.so",dir,(int)getpid());
+
+	if(aotTranslate(cpu,source)<0)
+		goto cleanup;
+
+	snprintf(command,sizeof(command),"%s -O2 -w -shared -fPIC -o %s %s",aotCompiler,object,source);
+	if(system(command)!=0)
+	{
+		fprintf(cpu->err,"APEX_Error : --aot compile failed: %s\n",command);
+		goto cleanup;
+	}
+
+	void* handle=dlopen(object,RTLD_NOW|RTLD_LOCAL);
+	if(!handle)
+	{
+		fprintf(cpu->err,"APEX_Error : %s\n",dlerror());
+		goto cleanup;
+	}
+	APEX_Native_Run nativeRun=(APEX_Native_Run)dlsym(handle,"apex_native_run");
+	if(!nativeRun)
+	{
+		fprintf(cpu->err,"APEX_Error : %s\n",dlerror());
+		dlclose(handle);
+		goto cleanup;
+	}
+	cpu->aot.compileSeconds=secondsSince(&start);
+
+	int state[AOT_STATE_SIZE]={0};
+	state[AOT_STATE_PC]=4000;
+
+	clock_gettime(CLOCK_MONOTONIC,&start);
+	cpu->aot.exit=nativeRun(state,cpu->data_memory,limit,&cpu->aot.instructions);
+	cpu->hostSeconds=secondsSince(&start);
+	dlclose(handle);
+
+	memcpy(cpu->thread->regs,state,sizeof(cpu->thread->regs));
+	cpu->thread->zeroFlag=state[AOT_STATE_ZFLAG];
+	cpu->aot.exitPc=state[AOT_STATE_PC];
+	cpu->ins_completed=cpu->aot.instructions;
+	result=0;
+
+cleanup:
+	if(!aotDir)
+	{
+		unlink(source);
+		unlink(object);
+		rmdir(dir);
+	}
+	return result;
+}
+
+int printAotResults(APEX_CPU* cpu)
+{
+	double kips=cpu->hostSeconds>0 ? cpu->aot.instructions/cpu->hostSeconds/1000.0 : 0.0;
+
+	// no cycles in a native run, the CSV row keeps the simulate columns
+	if(benchOutput)
+	{
+		fprintf(cpu->out,"0,%lld,0.0000,%.6f,%.1f\n",cpu->aot.instructions,cpu->hostSeconds,kips);
+		return 0;
+	}
+
+	printArchRegs(cpu);
+	printMemData(cpu);
+
+	fprintf(cpu->out,"\n========== NATIVE RUN STATISTICS ==========\n");
+	fprintf(cpu->out,"|    Exit\t\t|\t%s at pc %d\t|\n",exitNames[cpu->aot.exit],cpu->aot.exitPc);
+	fprintf(cpu->out,"|    Instructions\t|\t%lld\t|\n",cpu->aot.instructions);
+	fprintf(cpu->out,"|    Compile Seconds\t|\t%.6f\t|\n",cpu->aot.compileSeconds);
+	fprintf(cpu->out,"|    Host Seconds\t|\t%.6f\t|\n",cpu->hostSeconds);
+	fprintf(cpu->out,"|    Native KIPS\t\t|\t%.1f\t|\n",kips);
+
+	return 0;
+}
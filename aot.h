@@ -0,0 +1,56 @@
+#ifndef _APEX_AOT_H_
+#define _APEX_AOT_H_
+/**
+ *  aot.h
+ *  Contains the ahead-of-time translation of APEX programs to native code
+ *
+ *  With --aot=1 the simulate operation skips the pipeline: code memory is
+ *  translated to C, compiled into a shared object with the host compiler
+ *  and run natively. Only the architectural state (registers, zero flag,
+ *  data memory) and the instruction count are produced, no timing.
+ */
+
+struct APEX_CPU;
+
+/* How a native run ended */
+enum
+{
+	AOT_EXIT_HALT,
+	AOT_EXIT_LIMIT,			// instruction limit reached at a control transfer
+	AOT_EXIT_BAD_TARGET,	// JUMP/JAL/branch to a PC outside code memory
+	AOT_EXIT_BAD_ADDRESS,	// LOAD/STORE outside data memory
+	AOT_EXIT_END,			// ran past the last instruction
+	AOT_EXITS
+};
+
+/* Translated program state, r0-r15, the zero flag and the PC */
+#define AOT_STATE_ZFLAG 16
+#define AOT_STATE_PC 17
+#define AOT_STATE_SIZE 18
+
+/* Outcome of a native run */
+typedef struct APEX_AOT
+{
+	int exit;
+	int exitPc;
+	long long instructions;		// executed, HALT included like the pipeline counts it
+	double compileSeconds;		// translation and host compiler
+}APEX_AOT;
+
+/* Entry point of the generated code */
+typedef int (*APEX_Native_Run)(int* state,int* mem,long long limit,long long* executed);
+
+/* AOT configuration, set from command line options */
+extern int aotEnabled;
+extern const char* aotDir;
+extern const char* aotCompiler;
+
+int aotParseOption(const char* arg);
+
+int aotTranslate(struct APEX_CPU* cpu,const char* path);
+
+int aotRun(struct APEX_CPU* cpu,long long limit);
+
+int printAotResults(struct APEX_CPU* cpu);
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef _APEX_H_
+#define _APEX_H_
+/**
+ *  apex.h
+ *  Contains the embeddable simulator API of libapex.a
+ *
+ *  A program runs on an APEX_Sim created from the text of an input file
+ *  held in memory. The caller steps it a number of cycles at a time or
+ *  runs it to HALT, then reads the architectural state and counters.
+ *  Nothing is printed to stdout or stderr: error messages and the end of
+ *  run report go to the output callback given at creation, or nowhere
+ *  when it is NULL.
+ *
+ *  Options are the command line --opt=value options of apex_sim, they are
+ *  global and apply to the simulations created after apexSetOption. The
+ *  library keeps global state and must be used from one host thread.
+ */
+
+/* Architectural registers R0-R15, apexReadReg reads the zero flag as register APEX_REGS */
+#define APEX_REGS 16
+
+typedef struct APEX_Sim APEX_Sim;
+
+/* Receives len bytes of output text, not NUL terminated */
+typedef void (*APEX_Output_Fn)(void* ctx,const char* text,int len);
+
+typedef struct APEX_Counters
+{
+	long long cycles;
+	long long instructions;
+	long long dispatchStalls;
+	long long flushes;
+}APEX_Counters;
+
+/* Sets a --opt=value option, -1 when the option is unknown */
+int apexSetOption(const char* option);
+
+/* Parses the len bytes of program text, NULL when it does not load */
+APEX_Sim* apexCreate(const char* program,int len,APEX_Output_Fn output,void* ctx);
+
+/* Steps up to cycles cycles, stops early at HALT. Returns the cycles stepped. */
+long long apexStep(APEX_Sim* sim,long long cycles);
+
+/* Runs to HALT or for at most maxCycles cycles, 1 when the program halted */
+int apexRun(APEX_Sim* sim,long long maxCycles);
+
+/* 1 once every hardware thread committed its HALT */
+int apexHalted(APEX_Sim* sim);
+
+/* Committed value of register reg of a hardware thread, -1 for a bad thread or register */
+int apexReadReg(APEX_Sim* sim,int thread,int reg,int* value);
+
+/* Data memory word at address, -1 when the address is out of range */
+int apexReadMemory(APEX_Sim* sim,int address,int* value);
+
+int apexReadCounters(APEX_Sim* sim,APEX_Counters* counters);
+
+/* Writes the end of run report of the simulate operation to the output callback */
+int apexReport(APEX_Sim* sim);
+
+void apexDestroy(APEX_Sim* sim);
+
+#endif
@@ -0,0 +1,108 @@
+/*
+ *  apex_clog.c
+ *  Prints a commit log written with --commit-log as text
+ *
+ *  One line per committed instruction: its index and PC, the register it
+ *  wrote, the LOAD or STORE address, the STORE data and the zero flag.
+ *  --from seeks through the block index, the blocks before it are never
+ *  read. Two logs of the same program diff line by line.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+static long long from=0;
+static long long count=-1;		// all from there on
+static int summary=0;
+
+static int parseOption(const char* arg)
+{
+	const char* value;
+
+	if(matchOption(arg,"--from",&value))
+		from=atoll(value);
+	else if(matchOption(arg,"--count",&value))
+		count=atoll(value);
+	else if(matchOption(arg,"--summary",&value))
+		summary=atoi(value);
+	else
+		return -1;
+
+	return 0;
+}
+
+static void usage(const char* prog)
+{
+	fprintf(stderr,"APEX_Help : Usage %s <commit_log> [options]\n",prog);
+	fprintf(stderr,"APEX_Help :   --from=N      first instruction printed (0)\n");
+	fprintf(stderr,"APEX_Help :   --count=N     instructions printed (all)\n");
+	fprintf(stderr,"APEX_Help :   --summary=1   print the instruction and block counts only\n");
+}
+
+static void printRecord(const Commit_Record* record)
+{
+	printf("%lld %d",record->index,record->pc);
+	if(record->flags&COMMIT_LOG_DEST)
+		printf(" R%d=%d",record->rd,record->value);
+	if(record->flags&COMMIT_LOG_LOAD)
+		printf(" M[%d]",record->address);
+	if(record->flags&COMMIT_LOG_STORE)
+		printf(" M[%d]=%d",record->address,record->data);
+	printf(" Z=%d\n",(record->flags&COMMIT_LOG_ZERO)!=0);
+}
+
+int main(int argc,char const* argv[])
+{
+	Commit_Log_Reader reader;
+	Commit_Record record;
+	int status=0;
+
+	if(argc<2)
+	{
+		usage(argv[0]);
+		exit(1);
+	}
+	for(int i=2;i<argc;i++)
+	{
+		if(parseOption(argv[i])<0)
+		{
+			fprintf(stderr,"APEX_Error : Invalid option %s\n",argv[i]);
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+
+	if(commitLogOpen(&reader,argv[1])<0)
+	{
+		fprintf(stderr,"APEX_Error : %s is not a complete commit log\n",argv[1]);
+		exit(1);
+	}
+
+	if(summary)
+	{
+		printf("instructions %lld\nblocks %lld\n",reader.trailer.instructions,reader.trailer.blocks);
+		commitLogClose(&reader);
+		return 0;
+	}
+
+	if(from<0 || commitLogSeek(&reader,from)<0)
+		status=-1;
+	for(long long n=0;status==0 && n!=count;n++)
+	{
+		status=commitLogNext(&reader,&record);
+		if(status<=0)
+			break;
+		printRecord(&record);
+		status=0;
+	}
+	commitLogClose(&reader);
+
+	if(status<0)
+	{
+		fprintf(stderr,"APEX_Error : %s is damaged\n",argv[1]);
+		exit(1);
+	}
+	return 0;
+}
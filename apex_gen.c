@@ -0,0 +1,348 @@
+/*
+ *  apex_gen.c
+ *  Generates synthetic APEX programs with a controllable instruction mix,
+ *  register dependency distance, branch taken rate and memory footprint
+ *
+ *  The generated program is a static body of instruction blocks, wrapped
+ *  in a counted loop when the requested length needs more than one pass.
+ *  Every branch outcome is decided at generation time, so the number of
+ *  instructions the program commits is known and printed on stderr.
+ *
+ *  Register usage
+ *    R0-R8   work registers, written round robin
+ *    R9      scratch for instructions a branch or call skips over
+ *    R10     loop counter
+ *    R11     footprint mask
+ *    R12     memory base, advances by the body's stride each iteration
+ *    R13     return address of JAL
+ *    R14     constant 0
+ *    R15     constant 1
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WORK_REGS 9
+#define MAX_FOOTPRINT 2048		// words, base+offset stays inside data memory
+#define MAX_LENGTH 10000000
+
+enum
+{
+	MIX_ALU,
+	MIX_MUL,
+	MIX_LOAD,
+	MIX_STORE,
+	MIX_BRANCH,
+	MIX_CALL,
+	MIX_KINDS
+};
+
+static const char* mixNames[MIX_KINDS]={"alu","mul","load","store","branch","call"};
+static int mixWeight[MIX_KINDS]={50,10,15,10,10,5};
+
+static long long length=1000;	// committed instructions wanted
+static int bodySize=256;		// static instructions in the loop body
+static int depDistance=1;		// 0 for independent instructions
+static int takenRate=50;		// percent of branches taken
+static int footprint=1024;		// words touched by LOAD/STORE
+static int stride=1;			// words between consecutive memory accesses
+static unsigned long long seed=1;
+static const char* outputFile=NULL;
+
+/* Generated program, one line per instruction */
+static char (*code)[32];
+static int codeSize;
+static int codeCapacity;
+
+/* Work register written by each producing instruction, for dependencies */
+static int written;
+
+static unsigned long long nextRandom()
+{
+	// xorshift64, stable across hosts for a given seed
+	seed^=seed<<13;
+	seed^=seed>>7;
+	seed^=seed<<17;
+	return seed;
+}
+
+static int emit(const char* format,int a,int b,int c)
+{
+	if(codeSize==codeCapacity)
+	{
+		codeCapacity=codeCapacity ? codeCapacity*2 : 1024;
+		code=realloc(code,codeCapacity*sizeof(*code));
+		if(!code)
+		{
+			fprintf(stderr,"APEX_Error : Out of memory\n");
+			exit(1);
+		}
+	}
+	snprintf(code[codeSize],sizeof(code[codeSize]),format,a,b,c);
+	return codeSize++;
+}
+
+static int pcOf(int index)
+{
+	return 4000+index*4;
+}
+
+/* Source register reading the result of the instruction depDistance back */
+static int sourceReg()
+{
+	if(depDistance==0 || written<depDistance)
+		return 14;
+	return (written-depDistance)%WORK_REGS;
+}
+
+static int destReg()
+{
+	return (written++)%WORK_REGS;
+}
+
+/*
+ * Emits one block of the given kind and returns the instructions it
+ * commits. memOps counts LOAD/STORE so the next access is stride words on.
+ */
+static int emitBlock(int kind,int* memOps)
+{
+	const char* aluOps[]={"ADD","SUB","AND","OR","EX-OR"};
+	int src=sourceReg();
+	int offset;
+
+	switch(kind)
+	{
+	case MIX_ALU:
+		if(nextRandom()%4==0)
+			emit("ADDL,R%d,R%d,#%d",destReg(),src,1);
+		else
+		{
+			char format[32];
+			snprintf(format,sizeof(format),"%s,R%%d,R%%d,R%%d",aluOps[nextRandom()%5]);
+			emit(format,destReg(),src,15);
+		}
+		return 1;
+	case MIX_MUL:
+		// multiply by one keeps the values from overflowing
+		emit("MUL,R%d,R%d,R%d",destReg(),src,15);
+		return 1;
+	case MIX_LOAD:
+		offset=(int)(((long long)(*memOps)++*stride)%footprint);
+		emit("LOAD,R%d,R%d,#%d",destReg(),12,offset);
+		return 1;
+	case MIX_STORE:
+		offset=(int)(((long long)(*memOps)++*stride)%footprint);
+		emit("STORE,R%d,R%d,#%d",src,12,offset);
+		return 1;
+	case MIX_BRANCH:
+	{
+		int taken=(int)(nextRandom()%100)<takenRate;
+		int bz=nextRandom()%2;
+
+		// SUB of two equal registers sets the zero flag, AND of 1 and 1 clears it
+		if(taken==bz)
+			emit("SUB,R%d,R%d,R%d",destReg(),15,15);
+		else
+			emit("AND,R%d,R%d,R%d",destReg(),15,15);
+		emit(bz ? "BZ,#%d" : "BNZ,#%d",8,0,0);
+		emit("ADDL,R%d,R%d,#%d",9,9,1);
+		return taken ? 2 : 3;
+	}
+	case MIX_CALL:
+	{
+		int call=codeSize;
+		emit("JAL,R%d,R%d,#%d",13,14,pcOf(call+2));
+		emit("JUMP,R%d,#%d",14,pcOf(call+4),0);
+		emit("ADDL,R%d,R%d,#%d",9,9,1);
+		emit("JUMP,R%d,#%d",13,0,0);
+		return 4;
+	}
+	}
+	return 0;
+}
+
+static int pickKind()
+{
+	int total=0;
+	for(int i=0;i<MIX_KINDS;i++)
+		total+=mixWeight[i];
+
+	int r=(int)(nextRandom()%total);
+	for(int i=0;i<MIX_KINDS;i++)
+	{
+		if(r<mixWeight[i])
+			return i;
+		r-=mixWeight[i];
+	}
+	return MIX_ALU;
+}
+
+static int parseMix(const char* value)
+{
+	int weights[MIX_KINDS]={0};
+	char buffer[256];
+
+	snprintf(buffer,sizeof(buffer),"%s",value);
+	for(char* token=strtok(buffer,",");token;token=strtok(NULL,","))
+	{
+		char* colon=strchr(token,':');
+		int kind;
+
+		if(!colon)
+			return -1;
+		*colon='\0';
+		for(kind=0;kind<MIX_KINDS;kind++)
+		{
+			if(strcmp(token,mixNames[kind])==0)
+				break;
+		}
+		if(kind==MIX_KINDS || atoi(colon+1)<0)
+			return -1;
+		weights[kind]=atoi(colon+1);
+	}
+
+	int total=0;
+	for(int i=0;i<MIX_KINDS;i++)
+		total+=weights[i];
+	if(total==0)
+		return -1;
+
+	memcpy(mixWeight,weights,sizeof(mixWeight));
+	return 0;
+}
+
+static int matchOption(const char* arg,const char* name,const char** value)
+{
+	int len=strlen(name);
+
+	if(strncmp(arg,name,len)!=0 || arg[len]!='=')
+		return 0;
+
+	*value=arg+len+1;
+	return 1;
+}
+
+static int parseOption(const char* arg)
+{
+	const char* value;
+
+	if(matchOption(arg,"--length",&value))
+		length=atoll(value);
+	else if(matchOption(arg,"--body",&value))
+		bodySize=atoi(value);
+	else if(matchOption(arg,"--mix",&value))
+		return parseMix(value);
+	else if(matchOption(arg,"--dep-distance",&value))
+		depDistance=atoi(value);
+	else if(matchOption(arg,"--taken-rate",&value))
+		takenRate=atoi(value);
+	else if(matchOption(arg,"--footprint",&value))
+		footprint=atoi(value);
+	else if(matchOption(arg,"--stride",&value))
+		stride=atoi(value);
+	else if(matchOption(arg,"--seed",&value))
+		seed=strtoull(value,NULL,0);
+	else if(matchOption(arg,"--output",&value))
+		outputFile=value;
+	else
+		return -1;
+
+	return 0;
+}
+
+static void usage(const char* prog)
+{
+	fprintf(stderr,"APEX_Help : Usage %s [options]\n",prog);
+	fprintf(stderr,"  --length=N          committed instructions, 10 to %d (default 1000)\n",MAX_LENGTH);
+	fprintf(stderr,"  --body=N            static instructions in the loop body (default 256)\n");
+	fprintf(stderr,"  --mix=kind:w,...    weights for alu,mul,load,store,branch,call\n");
+	fprintf(stderr,"  --dep-distance=N    read the result N producers back, 0 for none, max %d\n",WORK_REGS-1);
+	fprintf(stderr,"  --taken-rate=P      percent of branches taken (default 50)\n");
+	fprintf(stderr,"  --footprint=W       words touched by LOAD/STORE, power of two up to %d\n",MAX_FOOTPRINT);
+	fprintf(stderr,"  --stride=W          words between consecutive accesses (default 1)\n");
+	fprintf(stderr,"  --seed=N            random seed (default 1)\n");
+	fprintf(stderr,"  --output=file       write the program to file instead of stdout\n");
+}
+
+int main(int argc,char const* argv[])
+{
+	for(int i=1;i<argc;i++)
+	{
+		if(parseOption(argv[i])<0)
+		{
+			fprintf(stderr,"APEX_Error : Invalid option %s\n",argv[i]);
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+
+	if(length<10 || length>MAX_LENGTH || bodySize<1 || depDistance<0 || depDistance>=WORK_REGS
+	|| takenRate<0 || takenRate>100 || footprint<1 || footprint>MAX_FOOTPRINT
+	|| (footprint&(footprint-1))!=0 || stride<0 || seed==0)
+	{
+		fprintf(stderr,"APEX_Error : Invalid generator configuration\n");
+		usage(argv[0]);
+		exit(1);
+	}
+
+	// constants first, then the body is placed after the prologue
+	int prologue=0;
+	emit("MOVC,R%d,#%d",15,1,0);
+	emit("MOVC,R%d,#%d",14,0,0);
+	emit("MOVC,R%d,#%d",12,0,0);
+	emit("MOVC,R%d,#%d",11,footprint-1,0);
+	int counterIndex=emit("MOVC,R%d,#%d",10,1,0);
+	prologue=codeSize;
+
+	// body until the static size or the whole length is reached
+	long long budget=length-prologue-1;
+	long long bodyCommitted=0;
+	int memOps=0;
+	int bodyStart=codeSize;
+	while(codeSize-bodyStart<bodySize && bodyCommitted<budget)
+		bodyCommitted+=emitBlock(pickKind(),&memOps);
+
+	// loop back while the counter lasts, advancing the memory base
+	long long iterations=1;
+	int tail=(memOps ? 2 : 0)+2;
+	if(bodyCommitted+tail<budget)
+		iterations=budget/(bodyCommitted+tail);
+
+	if(iterations>1)
+	{
+		if(memOps)
+		{
+			emit("ADDL,R%d,R%d,#%d",12,12,(int)(((long long)memOps*stride)%footprint));
+			emit("AND,R%d,R%d,R%d",12,12,11);
+		}
+		emit("SUBL,R%d,R%d,#%d",10,10,1);
+		emit("BNZ,#%d",pcOf(bodyStart)-pcOf(codeSize),0,0);
+		snprintf(code[counterIndex],sizeof(code[counterIndex]),"MOVC,R10,#%lld",iterations);
+	}
+	else
+		tail=0;
+	emit("HALT",0,0,0);
+
+	FILE* fp=stdout;
+	if(outputFile)
+	{
+		fp=fopen(outputFile,"w");
+		if(!fp)
+		{
+			fprintf(stderr,"APEX_Error : Cannot open %s\n",outputFile);
+			exit(1);
+		}
+	}
+
+	// the parser splits on commas only, so no newline after HALT
+	for(int i=0;i<codeSize;i++)
+		fprintf(fp,i+1<codeSize ? "%s\n" : "%s",code[i]);
+	if(fp!=stdout)
+		fclose(fp);
+
+	fprintf(stderr,"apex_gen : %d static instructions, %lld iterations, %lld committed instructions\n",
+			codeSize,iterations,prologue+iterations*(bodyCommitted+tail)+1);
+
+	free(code);
+	return 0;
+}
@@ -0,0 +1,495 @@
+/*
+ *  apex_ubench.c
+ *  Microbenchmarks for the hot pipeline functions of cpu.c
+ *
+ *  Each benchmark builds a synthetic mid-run pipeline state, the IQ, LSQ
+ *  and ROB filled to the requested occupancy with renamed ADD, MUL, LOAD
+ *  and STORE instructions, some completed and some waiting on operands.
+ *  Functions that change that state get a reset that puts back only what
+ *  they touch. The reset is timed on its own and subtracted, so the
+ *  reported ns per call is the function alone.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "cpu.h"
+
+extern int resultBuses;
+
+static int occupancy=50;		// percent of IQ, LSQ and ROB entries in use
+static long long calls=100000;	// calls per trial
+static int trials=10;
+static int warmups=2;			// trials run first and thrown away
+static int csvOutput=0;
+static const char* onlyName=NULL;
+
+/* Keeps the compiler from dropping calls whose result is unused */
+static volatile long long sink;
+
+/* Pipeline state right after buildState, used by the resets */
+static APEX_CPU* snapshot;
+static int snapRobHead,snapRobTail,snapLsqHead,snapLsqTail,snapCfidTail;
+static int robEntries;
+static int waitingUrf[FWD_BUS_SIZE];		// URF registers the IQ waits on, put on the forward bus
+
+static void buildStage(CPU_Stage* stage,APEX_CPU* cpu,int k)
+{
+	const char* opcode="ADD";
+	if(k==cpu->thread->branchRobIndex)
+		opcode="BNZ";
+	else if(k%5==3)
+		opcode="LOAD";
+	else if(k%5==4)
+		opcode="STORE";
+	else if(k%4==1)
+		opcode="MUL";
+
+	memset(stage,0,sizeof(*stage));
+	strcpy(stage->opcode,opcode);
+	stage->pc=4000+k*4;
+	stage->rd=k%ARCH_REGS;
+	stage->rs1=(k+5)%ARCH_REGS;
+	stage->rs2=(k+9)%ARCH_REGS;
+	stage->last_saved_urf_reg=100;
+	stage->last_saved_flag_reg=100;
+	stage->stalled=1;
+
+	stage->urf_rs1_reg=(&cpu->thread->rat[stage->rs1])->urf_reg;
+	stage->urf_rs2_reg=(&cpu->thread->rat[stage->rs2])->urf_reg;
+	stage->rs1_value_valid=(&cpu->urf_regs[stage->urf_rs1_reg])->valid;
+	stage->rs2_value_valid=strcmp(opcode,"LOAD")==0 || (&cpu->urf_regs[stage->urf_rs2_reg])->valid;
+
+	if(strcmp(opcode,"STORE")==0 || strcmp(opcode,"BNZ")==0)
+		return;
+
+	int urf=-1;
+	for(int i=0;i<URF_SIZE && urf==-1;i++)
+	{
+		if((&cpu->urf_regs[i])->isFree)
+			urf=i;
+	}
+	if(urf==-1)
+	{
+		// out of URF registers, the rest of the window is stores
+		strcpy(stage->opcode,"STORE");
+		return;
+	}
+
+	stage->last_saved_urf_reg=(&cpu->thread->rat[stage->rd])->urf_reg;
+	stage->last_saved_urf_allocated=1;
+	(&cpu->thread->rat[stage->rd])->urf_reg=urf;
+	if(strcmp(opcode,"LOAD")!=0)
+	{
+		stage->flag_renamed=1;
+		stage->last_saved_flag_reg=(&cpu->thread->rat[RAT_ZERO_FLAG])->urf_reg;
+		(&cpu->thread->rat[RAT_ZERO_FLAG])->urf_reg=urf;
+	}
+	(&cpu->urf_regs[urf])->isFree=0;
+	(&cpu->urf_regs[urf])->valid=0;
+	stage->urf_dest_reg=urf;
+	stage->urf_dest_valid=1;
+}
+
+/*
+ * Fills the ROB to occupancy with the older half completed. The younger
+ * half sits in the IQ, and its memory instructions in the LSQ, as far as
+ * occupancy allows. A BNZ a quarter of the way in is the flush point.
+ */
+static void buildState(APEX_CPU* cpu)
+{
+	memset(cpu,0,sizeof(*cpu));
+	cpu->thread=&cpu->threads[0];
+	cpu->threadCount=1;
+	cpu->robPartition=ROB_SIZE;
+	cpu->thread->pc=4000;
+	cpu->clock=1000;
+
+	// architectural registers committed to URF 0-15, zero flag with R15
+	for(int i=0;i<URF_SIZE;i++)
+	{
+		(&cpu->urf_regs[i])->isFree=i>=ARCH_REGS;
+		(&cpu->urf_regs[i])->valid=1;
+		(&cpu->urf_regs[i])->value=i;
+	}
+	for(int i=0;i<RAT_SIZE;i++)
+	{
+		(&cpu->thread->rat[i])->urf_reg=i<ARCH_REGS ? i : ARCH_REGS-1;
+		(&cpu->thread->rat[i])->allocated=1;
+		(&cpu->thread->rRat[i])->urf_reg=(&cpu->thread->rat[i])->urf_reg;
+		(&cpu->thread->rRat[i])->allocated=1;
+	}
+	for(int i=0;i<FWD_BUS_SIZE;i++)
+		(&cpu->fBus[i])->rs=-1;
+	for(int i=0;i<NUM_STAGES;i++)
+		(&cpu->thread->stage[i])->stalled=1;
+
+	robEntries=occupancy*(ROB_SIZE-1)/100;
+	int iqEntries=occupancy*IQ_SIZE/100;
+	int lsqEntries=occupancy*(LSQ_SIZE-1)/100;
+	int iqUsed=0;
+	int lsqUsed=0;
+	int waiting=0;
+
+	cpu->thread->robHead=robEntries ? 0 : -1;
+	cpu->thread->robTail=robEntries-1;
+	cpu->lsqHead=-1;
+	cpu->lsqTail=-1;
+	cpu->thread->cfidTail=0;
+	cpu->thread->crossOver=0;
+	cpu->mulFuBusy=0;
+	cpu->forwardIndex=0;
+	cpu->thread->branchRobIndex=robEntries/4;
+
+	for(int k=0;k<robEntries;k++)
+	{
+		CPU_ROB* rob=&cpu->thread->rob_list[k];
+		buildStage(&rob->stage,cpu,k);
+
+		if(k<robEntries/2)
+		{
+			rob->status=1;
+			(&rob->stage)->buffer=k;
+			continue;
+		}
+
+		int isMem=strcmp((&rob->stage)->opcode,"LOAD")==0 || strcmp((&rob->stage)->opcode,"STORE")==0;
+		if(iqUsed<iqEntries)
+		{
+			CPU_IQ* iq=&cpu->iq_list[iqUsed];
+			iq->allocated=1;
+			iq->clockCycle=cpu->clock-robEntries+k;
+			iq->stage=rob->stage;
+			iq->fuType=getfuType(&rob->stage);
+			iq->src1_valid=(&rob->stage)->rs1_value_valid;
+			iq->src2_valid=(&rob->stage)->rs2_value_valid;
+			iq->robIndex=k;
+			iq->lsqIndex=-1;
+			rob->iqIndex=iqUsed;
+
+			if(!iq->src1_valid && waiting<resultBuses)
+				waitingUrf[waiting++]=(&iq->stage)->urf_rs1_reg;
+			iqUsed++;
+		}
+		if(isMem && lsqUsed<lsqEntries)
+		{
+			CPU_LSQ* lsq=&cpu->lsq_list[lsqUsed];
+			lsq->allocated=1;
+			lsq->clockCycle=cpu->clock-robEntries+k;
+			lsq->stage=rob->stage;
+			lsq->src1_valid=(&rob->stage)->rs1_value_valid;
+			lsq->robIndex=k;
+			lsq->iqIndex=rob->iqIndex;
+			rob->lsqIndex=lsqUsed;
+			cpu->lsqHead=0;
+			cpu->lsqTail=lsqUsed;
+			lsqUsed++;
+		}
+	}
+
+	// results for some of the waiting sources are on the forward bus
+	for(int i=0;i<waiting;i++)
+	{
+		(&cpu->fBus[i])->rs=waitingUrf[i];
+		(&cpu->fBus[i])->rs_value=i;
+		(&cpu->fBus[i])->valid=1;
+	}
+
+	memcpy(snapshot,cpu,sizeof(*cpu));
+	snapRobHead=cpu->thread->robHead;
+	snapRobTail=cpu->thread->robTail;
+	snapLsqHead=cpu->lsqHead;
+	snapLsqTail=cpu->lsqTail;
+	snapCfidTail=cpu->thread->cfidTail;
+}
+
+static void benchRegRename(APEX_CPU* cpu,long long i)
+{
+	sink+=regRename(cpu);
+}
+
+static void resetRegRename(APEX_CPU* cpu,long long i)
+{
+	memcpy(cpu->thread->rat,snapshot->threads[0].rat,sizeof(cpu->thread->rat));
+	memcpy(cpu->urf_regs,snapshot->urf_regs,sizeof(cpu->urf_regs));
+	memcpy(cpu->fBus,snapshot->fBus,sizeof(cpu->fBus));
+}
+
+static void setupRegRename(APEX_CPU* cpu)
+{
+	CPU_Stage* stage=&cpu->thread->stage[DRF];
+	strcpy(stage->opcode,"ADD");
+	stage->rd=3;
+	stage->rs1=1;
+	stage->rs2=2;
+	memcpy(snapshot->threads[0].stage,cpu->thread->stage,sizeof(cpu->thread->stage));
+}
+
+static void benchGetReadyIQIndex(APEX_CPU* cpu,long long i)
+{
+	sink+=getReadyIQIndex(cpu,(i&1) ? FU_MUL : FU_INT,-1);
+}
+
+static void benchFwdToIssueQueue(APEX_CPU* cpu,long long i)
+{
+	sink+=FwdToIssueQueue(cpu);
+}
+
+static void resetFwdToIssueQueue(APEX_CPU* cpu,long long i)
+{
+	for(int j=0;j<IQ_SIZE;j++)
+	{
+		CPU_IQ* iq=&cpu->iq_list[j];
+		CPU_IQ* saved=&snapshot->iq_list[j];
+		(&iq->stage)->rs1_value_valid=(&saved->stage)->rs1_value_valid;
+		(&iq->stage)->rs2_value_valid=(&saved->stage)->rs2_value_valid;
+		iq->src1_valid=saved->src1_valid;
+		iq->src2_valid=saved->src2_valid;
+	}
+}
+
+static void benchFwdToLSQ(APEX_CPU* cpu,long long i)
+{
+	sink+=FwdToLSQ(cpu);
+}
+
+static void resetFwdToLSQ(APEX_CPU* cpu,long long i)
+{
+	for(int j=0;j<LSQ_SIZE;j++)
+	{
+		(&(&cpu->lsq_list[j])->stage)->rs1_value_valid=(&(&snapshot->lsq_list[j])->stage)->rs1_value_valid;
+		(&cpu->lsq_list[j])->src1_valid=(&snapshot->lsq_list[j])->src1_valid;
+	}
+}
+
+static void benchWriteOnFwdBus(APEX_CPU* cpu,long long i)
+{
+	// the stage is passed by value, as the function units do
+	sink+=writeOnFwdBus(cpu,(&cpu->thread->rob_list[i%ROB_SIZE])->stage);
+}
+
+static void benchReadFrmFwdBus(APEX_CPU* cpu,long long i)
+{
+	sink+=readFrmFwdBus(cpu,(int)(i%URF_SIZE)).valid;
+}
+
+static void benchInstAtRobHead(APEX_CPU* cpu,long long i)
+{
+	sink+=instAtRobHead(cpu);
+}
+
+static void resetInstAtRobHead(APEX_CPU* cpu,long long i)
+{
+	cpu->thread->robHead=snapRobHead;
+	cpu->thread->robTail=snapRobTail;
+	(&cpu->thread->rob_list[0])->status=(&snapshot->threads[0].rob_list[0])->status;
+	(&cpu->thread->rob_list[1])->status=(&snapshot->threads[0].rob_list[1])->status;
+	memcpy(cpu->urf_regs,snapshot->urf_regs,sizeof(cpu->urf_regs));
+	cpu->thread->instRetired=0;
+	cpu->thread->instRetired_1=0;
+}
+
+static void benchFlushInstruction(APEX_CPU* cpu,long long i)
+{
+	sink+=flushInstruction(cpu,0,0);
+}
+
+static void resetFlushInstruction(APEX_CPU* cpu,long long i)
+{
+	cpu->thread->robTail=snapRobTail;
+	cpu->lsqHead=snapLsqHead;
+	cpu->lsqTail=snapLsqTail;
+	cpu->thread->cfidTail=snapCfidTail;
+	cpu->thread->crossOver=0;
+	for(int j=0;j<IQ_SIZE;j++)
+		(&cpu->iq_list[j])->allocated=(&snapshot->iq_list[j])->allocated;
+	for(int j=0;j<LSQ_SIZE;j++)
+		(&cpu->lsq_list[j])->allocated=(&snapshot->lsq_list[j])->allocated;
+	for(int j=0;j<ROB_SIZE;j++)
+		(&cpu->thread->rob_list[j])->status=(&snapshot->threads[0].rob_list[j])->status;
+	memcpy(cpu->thread->rat,snapshot->threads[0].rat,sizeof(cpu->thread->rat));
+	memcpy(cpu->urf_regs,snapshot->urf_regs,sizeof(cpu->urf_regs));
+}
+
+typedef struct UBench
+{
+	const char* name;
+	void (*setup)(APEX_CPU* cpu);
+	void (*call)(APEX_CPU* cpu,long long i);
+	void (*reset)(APEX_CPU* cpu,long long i);
+}UBench;
+
+static UBench benches[]=
+{
+	{"regRename",setupRegRename,benchRegRename,resetRegRename},
+	{"getReadyIQIndex",NULL,benchGetReadyIQIndex,NULL},
+	{"FwdToIssueQueue",NULL,benchFwdToIssueQueue,resetFwdToIssueQueue},
+	{"FwdToLSQ",NULL,benchFwdToLSQ,resetFwdToLSQ},
+	{"writeOnFwdBus",NULL,benchWriteOnFwdBus,NULL},
+	{"readFrmFwdBus",NULL,benchReadFrmFwdBus,NULL},
+	{"instAtRobHead",NULL,benchInstAtRobHead,resetInstAtRobHead},
+	{"flushInstruction",NULL,benchFlushInstruction,resetFlushInstruction},
+};
+
+static double nowNs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec*1e9+ts.tv_nsec;
+}
+
+/* ns per call of call+reset minus ns per call of reset alone */
+static double runTrial(APEX_CPU* cpu,UBench* b)
+{
+	double resetNs=0;
+	double start;
+
+	if(b->reset)
+	{
+		start=nowNs();
+		for(long long i=0;i<calls;i++)
+			b->reset(cpu,i);
+		resetNs=nowNs()-start;
+	}
+
+	start=nowNs();
+	if(b->reset)
+	{
+		for(long long i=0;i<calls;i++)
+		{
+			b->call(cpu,i);
+			b->reset(cpu,i);
+		}
+	}
+	else
+	{
+		for(long long i=0;i<calls;i++)
+			b->call(cpu,i);
+	}
+	double totalNs=nowNs()-start;
+
+	return (totalNs-resetNs)/calls;
+}
+
+static int compareDouble(const void* a,const void* b)
+{
+	double x=*(const double*)a;
+	double y=*(const double*)b;
+	return x<y ? -1 : (x>y ? 1 : 0);
+}
+
+static int runBench(APEX_CPU* cpu,UBench* b)
+{
+	double* ns=malloc(trials*sizeof(*ns));
+	if(!ns)
+		return -1;
+
+	buildState(cpu);
+	if(b->setup)
+		b->setup(cpu);
+
+	for(int t=0;t<warmups;t++)
+		runTrial(cpu,b);
+	for(int t=0;t<trials;t++)
+		ns[t]=runTrial(cpu,b);
+
+	double mean=0;
+	for(int t=0;t<trials;t++)
+		mean+=ns[t];
+	mean/=trials;
+
+	double var=0;
+	for(int t=0;t<trials;t++)
+		var+=(ns[t]-mean)*(ns[t]-mean);
+	double stddev=trials>1 ? sqrt(var/(trials-1)) : 0.0;
+
+	qsort(ns,trials,sizeof(*ns),compareDouble);
+	double median=(trials%2) ? ns[trials/2] : (ns[trials/2-1]+ns[trials/2])/2;
+
+	if(csvOutput)
+		printf("%s,%d,%.2f,%.2f,%.2f,%.2f\n",b->name,occupancy,mean,ns[0],median,stddev);
+	else
+		printf("|    %-16s\t|\t%.2f\t|\t%.2f\t|\t%.2f\t|\t%.2f\t|\n",b->name,mean,ns[0],median,stddev);
+
+	free(ns);
+	return 0;
+}
+
+static int parseOption(const char* arg)
+{
+	const char* value;
+
+	if(matchOption(arg,"--occupancy",&value))
+		occupancy=atoi(value);
+	else if(matchOption(arg,"--calls",&value))
+		calls=atoll(value);
+	else if(matchOption(arg,"--trials",&value))
+		trials=atoi(value);
+	else if(matchOption(arg,"--warmup",&value))
+		warmups=atoi(value);
+	else if(matchOption(arg,"--only",&value))
+		onlyName=value;
+	else if(matchOption(arg,"--bench",&value))
+		csvOutput=atoi(value);
+	else
+		return -1;
+
+	return 0;
+}
+
+int main(int argc,char const* argv[])
+{
+	for(int i=1;i<argc;i++)
+	{
+		if(parseOption(argv[i])<0)
+		{
+			fprintf(stderr,"APEX_Error : Unknown option %s\n",argv[i]);
+			fprintf(stderr,"APEX_Help : Usage %s [--occupancy=percent] [--calls=N] [--trials=N] "
+					"[--warmup=N] [--only=function] [--bench=1]\n",argv[0]);
+			exit(1);
+		}
+	}
+	if(occupancy<0 || occupancy>100 || calls<1 || trials<1 || warmups<0)
+	{
+		fprintf(stderr,"APEX_Error : Invalid microbenchmark configuration\n");
+		exit(1);
+	}
+
+	APEX_CPU* cpu=malloc(sizeof(*cpu));
+	snapshot=malloc(sizeof(*snapshot));
+	if(!cpu || !snapshot)
+	{
+		fprintf(stderr,"APEX_Error : Out of memory\n");
+		exit(1);
+	}
+
+	if(csvOutput)
+		printf("function,occupancy,mean_ns,min_ns,median_ns,stddev_ns\n");
+	else
+	{
+		printf("\n========== MICROBENCHMARKS ==========\n");
+		printf("|    Occupancy %d%%, %lld calls x %d trials, %d warm-up trials\t|\n",
+				occupancy,calls,trials,warmups);
+		printf("|    Function\t\t|\tmean ns\t|\tmin ns\t|\tmedian\t|\tstddev\t|\n");
+	}
+
+	int found=0;
+	for(int i=0;i<(int)(sizeof(benches)/sizeof(benches[0]));i++)
+	{
+		if(onlyName && strcmp(onlyName,benches[i].name)!=0)
+			continue;
+		found=1;
+		runBench(cpu,&benches[i]);
+	}
+	if(!found)
+	{
+		fprintf(stderr,"APEX_Error : No microbenchmark named %s\n",onlyName);
+		exit(1);
+	}
+
+	free(snapshot);
+	free(cpu);
+	return 0;
+}
@@ -0,0 +1,13 @@
+MOVC,R1,#20000
+MOVC,R2,#3
+MOVC,R3,#5
+MOVC,R4,#0
+ADD,R4,R4,R2
+SUB,R5,R4,R3
+AND,R6,R5,R4
+OR,R7,R6,R2
+EX-OR,R8,R7,R3
+ADDL,R9,R8,#7
+SUBL,R1,R1,#1
+BNZ,#-28
+HALT
\ No newline at end of file
@@ -0,0 +1,15 @@
+MOVC,R0,#0
+MOVC,R1,#20000
+MOVC,R2,#0
+MOVC,R3,#1
+MOVC,R4,#0
+AND,R4,R1,R3
+BZ,#20
+ADDL,R2,R2,#3
+SUBL,R1,R1,#1
+BNZ,#-16
+JUMP,R0,#4056
+SUBL,R2,R2,#1
+SUBL,R1,R1,#1
+BNZ,#-32
+HALT
\ No newline at end of file
@@ -0,0 +1,13 @@
+MOVC,R0,#0
+MOVC,R1,#10000
+MOVC,R2,#0
+MOVC,R3,#1
+MOVC,R14,#0
+JUMP,R0,#4036
+ADD,R2,R2,R3
+ADDL,R3,R3,#1
+JUMP,R14,#0
+JAL,R14,R0,#4024
+SUBL,R1,R1,#1
+BNZ,#-8
+HALT
\ No newline at end of file
@@ -0,0 +1,42 @@
+#!/bin/sh
+# Runs every program in bench/ on two simulator builds and prints the
+# host time of each and the speedup of the second, best of RUNS runs.
+# Both builds have to simulate the same cycles and instructions.
+#
+#   bench/compare_bench.sh <base_sim> <new_sim> [apex_sim options]
+
+BASE=$1
+NEW=$2
+shift 2
+CYCLES=${CYCLES:-10000000}
+RUNS=${RUNS:-3}
+BENCH_DIR=$(dirname "$0")
+
+# prints cycles,instructions,best host_seconds of RUNS runs
+best_run() {
+	sim=$1
+	prog=$2
+	shift 2
+	for i in $(seq "$RUNS"); do
+		"$sim" "$prog" simulate "$CYCLES" --bench=1 "$@" | tail -n 1
+	done | awk -F, '{ if (NR == 1 || $4 < best) best = $4; sim = $1 "," $2 }
+		END { print sim "," best }'
+}
+
+echo "program,base_seconds,new_seconds,speedup"
+status=0
+rows=""
+for f in "$BENCH_DIR"/*.asm; do
+	name=$(basename "$f" .asm)
+	base=$(best_run "$BASE" "$f" "$@")
+	new=$(best_run "$NEW" "$f" "$@")
+	if [ "${base%,*}" != "${new%,*}" ]; then
+		echo "$name: simulated results differ, $base vs $new" >&2
+		status=1
+	fi
+	rows="$rows$name,${base##*,},${new##*,}
+"
+done
+printf "%s" "$rows" | awk -F, '{ s = $2 / $3; printf "%s,%s,%s,%.2f\n", $1, $2, $3, s; logsum += log(s); n++ }
+	END { if (n) printf "geomean,,,%.2f\n", exp(logsum / n) }'
+exit $status
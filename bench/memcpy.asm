@@ -0,0 +1,19 @@
+MOVC,R0,#0
+MOVC,R1,#0
+MOVC,R2,#2048
+MOVC,R3,#0
+MOVC,R4,#10
+STORE,R1,R1,#0
+ADDL,R1,R1,#1
+SUBL,R2,R2,#1
+BNZ,#-12
+MOVC,R1,#0
+MOVC,R2,#2048
+LOAD,R3,R1,#0
+STORE,R3,R1,#2048
+ADDL,R1,R1,#1
+SUBL,R2,R2,#1
+BNZ,#-16
+SUBL,R4,R4,#1
+BNZ,#-32
+HALT
\ No newline at end of file
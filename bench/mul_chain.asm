@@ -0,0 +1,10 @@
+MOVC,R1,#20000
+MOVC,R2,#1
+MOVC,R3,#3
+MUL,R2,R2,R3
+MUL,R4,R2,R3
+MUL,R5,R4,R3
+MUL,R2,R5,R3
+SUBL,R1,R1,#1
+BNZ,#-20
+HALT
\ No newline at end of file
@@ -0,0 +1,16 @@
+MOVC,R0,#0
+MOVC,R1,#0
+MOVC,R2,#512
+MOVC,R3,#0
+ADDL,R3,R1,#8
+STORE,R3,R1,#0
+ADDL,R1,R1,#8
+SUBL,R2,R2,#1
+BNZ,#-16
+STORE,R0,R1,#-8
+MOVC,R1,#0
+MOVC,R2,#20000
+LOAD,R1,R1,#0
+SUBL,R2,R2,#1
+BNZ,#-8
+HALT
\ No newline at end of file
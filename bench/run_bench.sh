@@ -0,0 +1,16 @@
+#!/bin/sh
+# Runs every program in bench/ and prints one CSV row per program.
+# Extra arguments are passed on to apex_sim, e.g. --dcache=1
+#
+#   bench/run_bench.sh [apex_sim options]
+
+SIM=${SIM:-./apex_sim}
+CYCLES=${CYCLES:-10000000}
+BENCH_DIR=$(dirname "$0")
+
+echo "program,cycles,instructions,ipc,host_seconds,kips"
+for f in "$BENCH_DIR"/*.asm; do
+	name=$(basename "$f" .asm)
+	row=$("$SIM" "$f" simulate "$CYCLES" --bench=1 "$@" | tail -n 1)
+	echo "$name,$row"
+done
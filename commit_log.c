@@ -0,0 +1,534 @@
+/*
+ *  commit_log.c
+ *  Contains the writer and the reader of the committed instruction log
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <zlib.h>
+
+#include "cpu.h"
+
+const char* commitLogFile=NULL;
+int commitLogBlock=COMMIT_LOG_BLOCK_INSTS;
+
+/* Largest record: flags, PC, register, value, address and data */
+#define COMMIT_LOG_MAX_RECORD (1+5+1+5+5+5)
+
+typedef struct Commit_Log_Buffer
+{
+	Commit_Log_Block block;
+	unsigned char* raw;
+}Commit_Log_Buffer;
+
+/*
+ * Buffers head to head+count-1 wait for the writer thread, the cpu fills
+ * buffer head+count. Each side works on its buffers outside the lock.
+ */
+typedef struct Commit_Log_Writer
+{
+	FILE* file;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t queued;
+	pthread_cond_t written;
+	Commit_Log_Buffer buffers[COMMIT_LOG_BUFFERS];
+	int head;
+	int count;
+	int stop;
+	int error;
+
+	/* Encoder state, reset at every block */
+	Commit_Log_Buffer* fill;
+	int pc;
+	int regs[ARCH_REGS];
+	int address;
+	int zeroFlag;				// architectural, kept across blocks
+
+	/* Written by the thread, read once it is joined */
+	Commit_Log_Index* index;
+	long long indexSize;
+	long long indexCapacity;
+	long long offset;
+	unsigned char* compressed;
+}Commit_Log_Writer;
+
+int commitLogParseOption(const char* arg)
+{
+	const char* value;
+
+	if(matchOption(arg,"--commit-log",&value))
+		commitLogFile=value;
+	else if(matchOption(arg,"--commit-log-block",&value))
+		commitLogBlock=atoi(value);
+	else
+		return 0;
+
+	return 1;
+}
+
+static void putVarint(Commit_Log_Buffer* buffer,int delta)
+{
+	// zigzag keeps small negative deltas small
+	unsigned int value=((unsigned int)delta<<1)^(unsigned int)(delta>>31);
+
+	while(value>=0x80)
+	{
+		buffer->raw[buffer->block.rawBytes++]=(value&0x7f)|0x80;
+		value>>=7;
+	}
+	buffer->raw[buffer->block.rawBytes++]=value;
+}
+
+static void resetEncoder(Commit_Log_Writer* writer)
+{
+	writer->pc=4000-4;
+	memset(writer->regs,0,sizeof(writer->regs));
+	writer->address=0;
+}
+
+/* Deflates and appends one block, returns -1 on a write error */
+static int writeBlock(Commit_Log_Writer* writer,Commit_Log_Buffer* buffer)
+{
+	uLongf size=compressBound(COMMIT_LOG_MAX_RECORD*(uLong)commitLogBlock);
+
+	if(compress2(writer->compressed,&size,buffer->raw,buffer->block.rawBytes,Z_BEST_SPEED)!=Z_OK)
+		return -1;
+	buffer->block.compressedBytes=size;
+	buffer->block.checksum=adler32(adler32(0,NULL,0),buffer->raw,buffer->block.rawBytes);
+
+	if(writer->indexSize==writer->indexCapacity)
+	{
+		writer->indexCapacity=writer->indexCapacity ? 2*writer->indexCapacity : 1024;
+		writer->index=realloc(writer->index,writer->indexCapacity*sizeof(*writer->index));
+		if(!writer->index)
+			return -1;
+	}
+	writer->index[writer->indexSize].first=buffer->block.first;
+	writer->index[writer->indexSize].offset=writer->offset;
+	writer->indexSize++;
+
+	if(fwrite(&buffer->block,sizeof(buffer->block),1,writer->file)!=1
+	|| fwrite(writer->compressed,1,size,writer->file)!=size)
+		return -1;
+	writer->offset+=sizeof(buffer->block)+size;
+	return 0;
+}
+
+static void* writerThread(void* arg)
+{
+	Commit_Log_Writer* writer=arg;
+
+	pthread_mutex_lock(&writer->lock);
+	for(;;)
+	{
+		while(!writer->count && !writer->stop)
+			pthread_cond_wait(&writer->queued,&writer->lock);
+		if(!writer->count)
+			break;
+
+		Commit_Log_Buffer* buffer=&writer->buffers[writer->head];
+		pthread_mutex_unlock(&writer->lock);
+		int failed=!writer->error && writeBlock(writer,buffer)<0;
+		pthread_mutex_lock(&writer->lock);
+
+		if(failed)
+			writer->error=1;
+		writer->head=(writer->head+1)%COMMIT_LOG_BUFFERS;
+		writer->count--;
+		pthread_cond_signal(&writer->written);
+	}
+	pthread_mutex_unlock(&writer->lock);
+	return NULL;
+}
+
+/* Hands the filled block to the thread and takes the next free buffer */
+static void submitBlock(APEX_CPU* cpu)
+{
+	Commit_Log_Writer* writer=cpu->commitLog.writer;
+	long long next=writer->fill->block.first+writer->fill->block.instructions;
+
+	cpu->commitLog.rawBytes+=writer->fill->block.rawBytes;
+	cpu->commitLog.blocks++;
+
+	pthread_mutex_lock(&writer->lock);
+	writer->count++;
+	pthread_cond_signal(&writer->queued);
+	if(writer->count==COMMIT_LOG_BUFFERS)
+		cpu->commitLog.writerWaits++;
+	while(writer->count==COMMIT_LOG_BUFFERS)
+		pthread_cond_wait(&writer->written,&writer->lock);
+	writer->fill=&writer->buffers[(writer->head+writer->count)%COMMIT_LOG_BUFFERS];
+	pthread_mutex_unlock(&writer->lock);
+
+	writer->fill->block.first=next;
+	writer->fill->block.instructions=0;
+	writer->fill->block.rawBytes=0;
+	resetEncoder(writer);
+}
+
+static void freeWriter(Commit_Log_Writer* writer)
+{
+	for(int i=0;i<COMMIT_LOG_BUFFERS;i++)
+		free(writer->buffers[i].raw);
+	free(writer->compressed);
+	free(writer->index);
+	free(writer);
+}
+
+int commitLogInit(APEX_CPU* cpu)
+{
+	APEX_Commit_Log* log=&cpu->commitLog;
+	Commit_Log_Writer* writer;
+	int header[2]={commitLogBlock,0};
+
+	memset(log,0,sizeof(*log));
+	if(!commitLogFile)
+		return 0;
+
+	if(smtThreads>1 || multicoreCores>1)
+	{
+		fprintf(cpu->err,"APEX_Error : The commit log records a single thread on a single core, drop --smt-threads or --cores\n");
+		return -1;
+	}
+	if(commitLogBlock<1 || commitLogBlock>(1<<22))
+	{
+		fprintf(cpu->err,"APEX_Error : Invalid commit log block of %d instructions\n",commitLogBlock);
+		return -1;
+	}
+
+	writer=calloc(1,sizeof(*writer));
+	if(!writer)
+		return -1;
+	for(int i=0;i<COMMIT_LOG_BUFFERS;i++)
+	{
+		writer->buffers[i].raw=malloc(COMMIT_LOG_MAX_RECORD*(size_t)commitLogBlock);
+		if(!writer->buffers[i].raw)
+		{
+			freeWriter(writer);
+			return -1;
+		}
+	}
+	writer->compressed=malloc(compressBound(COMMIT_LOG_MAX_RECORD*(uLong)commitLogBlock));
+	writer->file=fopen(commitLogFile,"wb");
+	if(!writer->compressed || !writer->file)
+	{
+		fprintf(cpu->err,"APEX_Error : Cannot write %s\n",commitLogFile);
+		if(writer->file)
+			fclose(writer->file);
+		freeWriter(writer);
+		return -1;
+	}
+
+	fwrite("APEXCLG1",1,8,writer->file);
+	fwrite(header,sizeof(header),1,writer->file);
+	writer->offset=8+sizeof(header);
+
+	pthread_mutex_init(&writer->lock,NULL);
+	pthread_cond_init(&writer->queued,NULL);
+	pthread_cond_init(&writer->written,NULL);
+	if(pthread_create(&writer->thread,NULL,writerThread,writer)!=0)
+	{
+		fprintf(cpu->err,"APEX_Error : Cannot start the commit log writer\n");
+		fclose(writer->file);
+		freeWriter(writer);
+		return -1;
+	}
+
+	writer->fill=&writer->buffers[0];
+	resetEncoder(writer);
+	log->writer=writer;
+	return 0;
+}
+
+/* Value a committed STORE wrote, its producer has committed to the URF by now */
+static int storeData(APEX_CPU* cpu,CPU_Stage* stage)
+{
+	if(stage->rs1_value_valid)
+		return stage->rs1_value;
+	return cpu->urf_regs[stage->urf_rs1_reg].value;
+}
+
+/*
+ * Encodes one committed instruction into the block being filled, the
+ * stage is the ROB entry it left
+ */
+int commitLogRecord(APEX_CPU* cpu,CPU_Stage* stage)
+{
+	Commit_Log_Writer* writer=cpu->commitLog.writer;
+	Commit_Log_Buffer* buffer=writer->fill;
+	int at=buffer->block.rawBytes++;
+	int flags=0;
+
+	if(stage->pc!=writer->pc+4)
+	{
+		flags|=COMMIT_LOG_PC_JUMP;
+		putVarint(buffer,stage->pc-(writer->pc+4));
+	}
+	writer->pc=stage->pc;
+
+	if(strcmp(stage->opcode,"STORE")==0)
+	{
+		flags|=COMMIT_LOG_STORE;
+		putVarint(buffer,stage->mem_address-writer->address);
+		putVarint(buffer,storeData(cpu,stage));
+		writer->address=stage->mem_address;
+	}
+	else if(strcmp(stage->opcode,"JUMP")!=0 && strcmp(stage->opcode,"BZ")!=0
+	&& strcmp(stage->opcode,"BNZ")!=0 && strcmp(stage->opcode,"HALT")!=0 && strcmp(stage->opcode,"")!=0)
+	{
+		flags|=COMMIT_LOG_DEST;
+		buffer->raw[buffer->block.rawBytes++]=stage->rd;
+		putVarint(buffer,stage->buffer-writer->regs[stage->rd]);
+		writer->regs[stage->rd]=stage->buffer;
+
+		if(strcmp(stage->opcode,"LOAD")==0)
+		{
+			flags|=COMMIT_LOG_LOAD;
+			putVarint(buffer,stage->mem_address-writer->address);
+			writer->address=stage->mem_address;
+		}
+		else
+			writer->zeroFlag=stage->buffer==0;
+	}
+	if(writer->zeroFlag)
+		flags|=COMMIT_LOG_ZERO;
+	buffer->raw[at]=flags;
+
+	cpu->commitLog.instructions++;
+	if(++buffer->block.instructions==commitLogBlock)
+		submitBlock(cpu);
+	return 0;
+}
+
+int commitLogFinish(APEX_CPU* cpu)
+{
+	APEX_Commit_Log* log=&cpu->commitLog;
+	Commit_Log_Writer* writer=log->writer;
+	Commit_Log_Trailer trailer;
+
+	if(!writer)
+		return 0;
+
+	if(writer->fill->block.instructions)
+		submitBlock(cpu);
+	pthread_mutex_lock(&writer->lock);
+	writer->stop=1;
+	pthread_cond_signal(&writer->queued);
+	pthread_mutex_unlock(&writer->lock);
+	pthread_join(writer->thread,NULL);
+
+	trailer.indexOffset=writer->offset;
+	trailer.blocks=writer->indexSize;
+	trailer.instructions=log->instructions;
+	memcpy(trailer.magic,"APEXCLGE",8);
+	if(writer->indexSize)
+		fwrite(writer->index,sizeof(*writer->index),writer->indexSize,writer->file);
+	fwrite(&trailer,sizeof(trailer),1,writer->file);
+	log->fileBytes=writer->offset+writer->indexSize*sizeof(*writer->index)+sizeof(trailer);
+	if(fclose(writer->file)!=0 || writer->error)
+		fprintf(cpu->err,"APEX_Error : Writing %s failed\n",commitLogFile);
+
+	pthread_mutex_destroy(&writer->lock);
+	pthread_cond_destroy(&writer->queued);
+	pthread_cond_destroy(&writer->written);
+	freeWriter(writer);
+	log->writer=NULL;
+	return 0;
+}
+
+int printCommitLogStats(APEX_CPU* cpu)
+{
+	APEX_Commit_Log* log=&cpu->commitLog;
+	long long rawBytes;
+
+	if(!log->writer)
+		return 0;
+
+	rawBytes=log->rawBytes+log->writer->fill->block.rawBytes;
+	fprintf(cpu->out,"\n========== COMMIT LOG STATISTICS ==========\n");
+	fprintf(cpu->out,"|    Instructions\t|\t%lld\t|\n",log->instructions);
+	fprintf(cpu->out,"|    Blocks\t\t|\t%lld\t|\n",log->blocks+(log->writer->fill->block.instructions>0));
+	fprintf(cpu->out,"|    Raw Bytes/Inst\t|\t%.3f\t|\n",log->instructions ? (double)rawBytes/log->instructions : 0.0);
+	fprintf(cpu->out,"|    Writer Waits\t|\t%lld\t|\n",log->writerWaits);
+	return 0;
+}
+
+/*
+ * Opens a log for reading, positioned at its first instruction. Returns
+ * -1 when path is not a complete commit log.
+ */
+int commitLogOpen(Commit_Log_Reader* reader,const char* path)
+{
+	char magic[8];
+	int header[2];
+
+	memset(reader,0,sizeof(*reader));
+	reader->block=-1;
+	reader->file=fopen(path,"rb");
+	if(!reader->file)
+		return -1;
+
+	if(fread(magic,1,8,reader->file)!=8 || memcmp(magic,"APEXCLG1",8)!=0
+	|| fread(header,sizeof(header),1,reader->file)!=1 || header[0]<1 || header[0]>(1<<22)
+	|| fseek(reader->file,-(long)sizeof(reader->trailer),SEEK_END)!=0
+	|| fread(&reader->trailer,sizeof(reader->trailer),1,reader->file)!=1
+	|| memcmp(reader->trailer.magic,"APEXCLGE",8)!=0 || reader->trailer.blocks<0)
+	{
+		commitLogClose(reader);
+		return -1;
+	}
+
+	reader->raw=malloc(COMMIT_LOG_MAX_RECORD*(size_t)header[0]);
+	reader->index=malloc((reader->trailer.blocks+1)*sizeof(*reader->index));
+	if(!reader->raw || !reader->index || fseek(reader->file,reader->trailer.indexOffset,SEEK_SET)!=0
+	|| fread(reader->index,sizeof(*reader->index),reader->trailer.blocks,reader->file)!=(size_t)reader->trailer.blocks)
+	{
+		commitLogClose(reader);
+		return -1;
+	}
+	return commitLogSeek(reader,0);
+}
+
+static int loadBlock(Commit_Log_Reader* reader,long long block)
+{
+	Commit_Log_Block header;
+	unsigned char* compressed;
+	uLongf size;
+
+	if(fseek(reader->file,reader->index[block].offset,SEEK_SET)!=0
+	|| fread(&header,sizeof(header),1,reader->file)!=1)
+		return -1;
+	compressed=malloc(header.compressedBytes);
+	if(!compressed)
+		return -1;
+
+	size=COMMIT_LOG_MAX_RECORD*(uLong)header.instructions;
+	if(fread(compressed,1,header.compressedBytes,reader->file)!=(size_t)header.compressedBytes
+	|| uncompress(reader->raw,&size,compressed,header.compressedBytes)!=Z_OK
+	|| size!=(uLongf)header.rawBytes
+	|| adler32(adler32(0,NULL,0),reader->raw,size)!=header.checksum)
+	{
+		free(compressed);
+		return -1;
+	}
+	free(compressed);
+
+	reader->block=block;
+	reader->rawBytes=header.rawBytes;
+	reader->position=0;
+	reader->next=header.first;
+	reader->pc=4000-4;
+	memset(reader->regs,0,sizeof(reader->regs));
+	reader->address=0;
+	return 0;
+}
+
+static int getVarint(Commit_Log_Reader* reader,int* delta)
+{
+	unsigned int value=0;
+
+	for(int shift=0;shift<35;shift+=7)
+	{
+		if(reader->position>=reader->rawBytes)
+			return -1;
+		unsigned char byte=reader->raw[reader->position++];
+		value|=(unsigned int)(byte&0x7f)<<shift;
+		if(!(byte&0x80))
+		{
+			*delta=(int)(value>>1)^-(int)(value&1);
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/*
+ * Reads the next record. Returns 1 with a record, 0 past the last one and
+ * -1 on a damaged log.
+ */
+int commitLogNext(Commit_Log_Reader* reader,Commit_Record* record)
+{
+	int delta=0;
+
+	if(reader->next>=reader->trailer.instructions)
+		return 0;
+	if(reader->block<0 || reader->position>=reader->rawBytes)
+	{
+		if(reader->block+1>=reader->trailer.blocks || loadBlock(reader,reader->block+1)<0)
+			return -1;
+	}
+
+	memset(record,0,sizeof(*record));
+	record->index=reader->next++;
+	record->flags=reader->raw[reader->position++];
+	record->rd=-1;
+
+	if((record->flags&COMMIT_LOG_PC_JUMP) && getVarint(reader,&delta)<0)
+		return -1;
+	reader->pc+=4+delta;
+	record->pc=reader->pc;
+
+	if(record->flags&COMMIT_LOG_DEST)
+	{
+		if(reader->position>=reader->rawBytes || reader->raw[reader->position]>=16)
+			return -1;
+		record->rd=reader->raw[reader->position++];
+		if(getVarint(reader,&delta)<0)
+			return -1;
+		reader->regs[record->rd]+=delta;
+		record->value=reader->regs[record->rd];
+	}
+	if(record->flags&(COMMIT_LOG_LOAD|COMMIT_LOG_STORE))
+	{
+		if(getVarint(reader,&delta)<0)
+			return -1;
+		reader->address+=delta;
+		record->address=reader->address;
+	}
+	if((record->flags&COMMIT_LOG_STORE) && getVarint(reader,&record->data)<0)
+		return -1;
+	return 1;
+}
+
+/* Positions the reader at an instruction, through the block that holds it */
+int commitLogSeek(Commit_Log_Reader* reader,long long instruction)
+{
+	Commit_Record record;
+	long long low=0,high=reader->trailer.blocks-1;
+
+	if(instruction>=reader->trailer.instructions || !reader->trailer.blocks)
+	{
+		reader->next=reader->trailer.instructions;
+		return 0;
+	}
+
+	// last block starting at or before the instruction
+	while(low<high)
+	{
+		long long mid=(low+high+1)/2;
+		if(reader->index[mid].first<=instruction)
+			low=mid;
+		else
+			high=mid-1;
+	}
+	if(loadBlock(reader,low)<0)
+		return -1;
+	while(reader->next<instruction)
+	{
+		if(commitLogNext(reader,&record)<=0)
+			return -1;
+	}
+	return 0;
+}
+
+int commitLogClose(Commit_Log_Reader* reader)
+{
+	if(reader->file)
+		fclose(reader->file);
+	free(reader->raw);
+	free(reader->index);
+	memset(reader,0,sizeof(*reader));
+	return 0;
+}
@@ -0,0 +1,141 @@
+#ifndef _APEX_COMMIT_LOG_H_
+#define _APEX_COMMIT_LOG_H_
+/**
+ *  commit_log.h
+ *  Contains the binary log of committed instructions
+ *
+ *  With --commit-log=path the cpu logs every instruction it commits: its
+ *  PC, the register it writes and the value, the address of a LOAD or
+ *  STORE and the data a STORE writes, and the zero flag after it. The
+ *  records are packed into blocks of --commit-log-block instructions that
+ *  a writer thread deflates and appends, so the cycle loop only encodes.
+ *  apex_clog prints a log as text from any instruction on.
+ *
+ *  A record is a flags byte, then as the flags say, each varint a zigzag
+ *  LEB128: the PC less the PC after the previous record, the register
+ *  byte and its value less the last value logged for that register, the
+ *  address less the previous address, the STORE data. Every block starts
+ *  from PC 4000, zero registers and address 0, it decodes on its own.
+ *
+ *  The file is the 8 bytes "APEXCLG1" and an int32 block size in
+ *  instructions, int32 reserved. Each block is a Commit_Log_Block header
+ *  and the deflated records. An index of the first instruction and file
+ *  offset of every block and a Commit_Log_Trailer end the file. All in
+ *  host byte order.
+ */
+
+#include <stdio.h>
+
+struct APEX_CPU;
+struct CPU_Stage;
+struct Commit_Log_Writer;
+
+/* Instructions per block unless --commit-log-block says otherwise */
+#define COMMIT_LOG_BLOCK_INSTS 65536
+
+/* Blocks encoded ahead of the writer thread before the cpu waits for it */
+#define COMMIT_LOG_BUFFERS 4
+
+/* Flags byte of a record */
+enum
+{
+	COMMIT_LOG_PC_JUMP=1,		// not at the PC after the previous record
+	COMMIT_LOG_DEST=2,			// writes a register
+	COMMIT_LOG_LOAD=4,
+	COMMIT_LOG_STORE=8,
+	COMMIT_LOG_ZERO=16			// zero flag set after the instruction
+};
+
+typedef struct Commit_Log_Block
+{
+	long long first;			// index of its first instruction
+	int instructions;
+	int rawBytes;
+	int compressedBytes;
+	unsigned int checksum;		// adler32 of the raw records
+}Commit_Log_Block;
+
+typedef struct Commit_Log_Index
+{
+	long long first;
+	long long offset;
+}Commit_Log_Index;
+
+typedef struct Commit_Log_Trailer
+{
+	long long indexOffset;
+	long long blocks;
+	long long instructions;
+	char magic[8];				// "APEXCLGE"
+}Commit_Log_Trailer;
+
+/* One committed instruction */
+typedef struct Commit_Record
+{
+	long long index;
+	int pc;
+	int flags;
+	int rd;
+	int value;
+	int address;
+	int data;
+}Commit_Record;
+
+typedef struct APEX_Commit_Log
+{
+	struct Commit_Log_Writer* writer;	// the encoder and writer thread, NULL when off
+
+	/* Some stats */
+	long long instructions;
+	long long rawBytes;
+	long long fileBytes;
+	long long blocks;
+	long long writerWaits;		// blocks the cpu waited on a free buffer for
+}APEX_Commit_Log;
+
+/* Reads a log, see apex_clog.c */
+typedef struct Commit_Log_Reader
+{
+	FILE* file;
+	Commit_Log_Trailer trailer;
+	Commit_Log_Index* index;
+	long long block;			// block in raw, -1 for none
+	unsigned char* raw;
+	int rawBytes;
+	int position;				// next record in raw
+	long long next;				// index of that record
+	int pc;						// decoder state
+	int regs[16];				// last value of R0-R15
+	int address;
+}Commit_Log_Reader;
+
+/* Commit log configuration, set from command line options */
+extern const char* commitLogFile;
+extern int commitLogBlock;
+
+/* At commit, one test unless logging */
+#define COMMIT_LOG_RECORD(cpu,stage) \
+	do { \
+		if((cpu)->commitLog.writer) \
+			commitLogRecord(cpu,stage); \
+	} while(0)
+
+int commitLogParseOption(const char* arg);
+
+int commitLogInit(struct APEX_CPU* cpu);
+
+int commitLogRecord(struct APEX_CPU* cpu,struct CPU_Stage* stage);
+
+int commitLogFinish(struct APEX_CPU* cpu);
+
+int printCommitLogStats(struct APEX_CPU* cpu);
+
+int commitLogOpen(Commit_Log_Reader* reader,const char* path);
+
+int commitLogSeek(Commit_Log_Reader* reader,long long instruction);
+
+int commitLogNext(Commit_Log_Reader* reader,Commit_Record* record);
+
+int commitLogClose(Commit_Log_Reader* reader);
+
+#endif
@@ -1,2221 +1,3198 @@
-/*
- *  cpu.c
- *  Contains APEX cpu pipeline implementation
- *
- *  Author :
- *  Bhargavi Hanumant Alandikar (balandi1@binghamton.edu)
- *  State University of New York, Binghamton
- */
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-
-#include "cpu.h"
-
-/* Set this flag to 1 to enable debug messages */
-int ENABLE_DEBUG_MESSAGES=0;
-
-int inputClockCycles=0;
-int haltExec=0;
-int forwardIndex=0;
-int prevLoad=0;
-int bTaken=0;
-int intFuBusy=0;
-int memFuBusy=0;
-int mulFuBusy=0;
-int mulClock=0;
-int memClock=0;
-
-int robHead=-1;
-int robTail=-1;
-
-int lsqHead=-1;
-int lsqTail=-1;
-
-int cfidHead=-1;
-int cfidTail=-1;
-int ctrlOccur=0;
-
-int haltAtRobHead=0;
-int crossOver=0;
-
-CPU_Stage tempRobStage;
-CPU_Stage tempRobStage_1;
-int instRetired;
-int instRetired_1;
-/*
- * This function creates and initializes APEX cpu.
- */
-APEX_CPU*
-APEX_cpu_init(const char* filename)
-{
-  if (!filename) {
-    return NULL;
-  }
-
-  APEX_CPU* cpu = malloc(sizeof(*cpu));
-  if (!cpu) {
-    return NULL;
-  }
-
-  /* Initialize PC, Registers and all pipeline stages */
-  cpu->pc = 4000;
-  memset(cpu->stage, 0, sizeof(CPU_Stage) * NUM_STAGES);
-  memset(cpu->data_memory, 0, sizeof(int) * 4000);
-  memset(cpu->urf_regs,0,sizeof(CPU_Register) * 40);
-  memset(cpu->rob_list,0,sizeof(CPU_ROB) * 32);
-  memset(cpu->lsq_list,0,sizeof(CPU_LSQ) * 20);
-  memset(cpu->iq_list,0,sizeof(CPU_IQ) * 16);
-  memset(cpu->rat,0,sizeof(front_rename_table) * 17);
-  memset(cpu->rRat,0,sizeof(bak_rename_table) * 17);
-  
-  /* Parse input file and create code memory */
-  cpu->code_memory = create_code_memory(filename, &cpu->code_memory_size);
-
-  if (!cpu->code_memory) {
-    free(cpu);
-    return NULL;
-  }
-
-  if (ENABLE_DEBUG_MESSAGES) {
-    fprintf(stderr,
-            "APEX_CPU : Initialized APEX CPU, loaded %d instructions\n",
-            cpu->code_memory_size);
-    fprintf(stderr, "APEX_CPU : Printing Code Memory\n");
-    printf("%-9s %-9s %-9s %-9s %-9s\n", "opcode", "rd", "rs1", "rs2", "imm");
-
-    for (int i = 0; i < cpu->code_memory_size; ++i) {
-      printf("%-9s %-9d %-9d %-9d %-9d\n",
-             cpu->code_memory[i].opcode,
-             cpu->code_memory[i].rd,
-             cpu->code_memory[i].rs1,
-             cpu->code_memory[i].rs2,
-             cpu->code_memory[i].imm);
-    }
-  }
-
-  /* Make all stages busy except Fetch stage, initally to start the pipeline */
-  for (int i = 1; i < NUM_STAGES; ++i) {
-    cpu->stage[i].busy = 1;
-  }
-  
-  for (int i = 0; i < 40; i++) {
-    cpu->urf_regs[i].isFree = 1;
-	cpu->urf_regs[i].valid=1;
-  }
-
-  for (int i = 0; i < 16; i++) {
-    cpu->rat[i].urf_reg = 100;
-  }
-  
-  cpu->data_memory[37]=0;
-  return cpu;
-}
-
-/*
- * This function de-allocates APEX cpu.
- */
-void
-APEX_cpu_stop(APEX_CPU* cpu)
-{
-  free(cpu->code_memory);
-  free(cpu);
-}
-
-/* Converts the PC(4000 series) into
- * array index for code memory
- */
-int
-get_code_index(int pc)
-{
-  return (pc - 4000) / 4;
-}
-
-static void
-print_instruction(CPU_Stage* stage,APEX_CPU* cpu)
-{
-  if (strcmp(stage->opcode, "STORE") == 0) {
-    printf(
-      "%s,R%d,R%d,#%d ", stage->opcode, stage->rs1, stage->rs2, stage->imm);
-	  printf("\t[%s,U%d,U%d,#%d] ", stage->opcode,stage->urf_rs1_reg,stage->urf_rs2_reg,stage->imm);
-  }
-
-  if (strcmp(stage->opcode, "LOAD") == 0) {
-    printf(
-      "%s,R%d,R%d,#%d ", stage->opcode, stage->rd, stage->rs1, stage->imm);
-	   printf("\t[%s,U%d,U%d,#%d] ",stage->opcode,stage->urf_dest_reg,stage->urf_rs1_reg,stage->imm);
-  }
-  
-  if (strcmp(stage->opcode, "ADDL") == 0 || strcmp(stage->opcode, "SUBL") == 0) {
-    printf(
-      "%s,R%d,R%d,#%d ", stage->opcode, stage->rd, stage->rs1, stage->imm);
-	   printf("\t[%s,U%d,U%d,#%d] ",stage->opcode,stage->urf_dest_reg,stage->urf_rs1_reg,stage->imm);
-  }
-  
-  if (strcmp(stage->opcode, "MOVC") == 0) {
-    printf("%s,R%d,#%d ", stage->opcode, stage->rd, stage->imm);
-	printf("\t[%s,U%d,#%d] ", stage->opcode, stage->urf_dest_reg, stage->imm);
-  }
-  if (strcmp(stage->opcode, "ADD") == 0 || strcmp(stage->opcode, "SUB") == 0
-      || strcmp(stage->opcode, "MUL") == 0 || strcmp(stage->opcode, "AND") == 0
-	  || strcmp(stage->opcode, "OR") == 0 || strcmp(stage->opcode, "EX-OR") == 0) {
-    printf("%s,R%d,R%d,R%d ", stage->opcode, stage->rd, stage->rs1, stage->rs2);
-	printf("\t[%s,U%d,U%d,U%d] ", stage->opcode, stage->urf_dest_reg, stage->urf_rs1_reg,stage->urf_rs2_reg);
-  }
-  if (strcmp(stage->opcode, "BZ") == 0 || strcmp(stage->opcode, "BNZ") == 0) {
-    printf("%s,#%d ", stage->opcode, stage->imm);
-	printf("\t[%s,#%d] ",stage->opcode,stage->imm);
-  }
-  if (strcmp(stage->opcode, "JUMP") == 0) {
-    printf("%s,R%d,#%d ", stage->opcode, stage->rs1, stage->imm);
-	printf("\t[%s,U%d,#%d] ",stage->opcode,stage->urf_rs1_reg,stage->imm);
-  }
-  
-  if (strcmp(stage->opcode, "JAL") == 0) {
-    printf("%s,R%d,R%d,#%d ", stage->opcode, stage->rd ,stage->rs1, stage->imm);
-	printf("\t[%s,U%d,U%d,#%d] ",stage->opcode,stage->urf_dest_reg,stage->urf_rs1_reg,stage->imm);
-  }
-  
-  if (strcmp(stage->opcode, "HALT") == 0) {
-    printf("%s,", stage->opcode);
-  }
-}
-
-
-static void print_fetch(CPU_Stage* stage)
-{
-  if (strcmp(stage->opcode, "STORE") == 0) {
-    printf(
-      "%s,R%d,R%d,#%d ", stage->opcode, stage->rs1, stage->rs2, stage->imm);
-  }
-
-  if (strcmp(stage->opcode, "LOAD") == 0) {
-    printf(
-      "%s,R%d,R%d,#%d ", stage->opcode, stage->rd, stage->rs1, stage->imm);
-  }
-  
-  if (strcmp(stage->opcode, "ADDL") == 0 || strcmp(stage->opcode, "SUBL") == 0) {
-    printf(
-      "%s,R%d,R%d,#%d ", stage->opcode, stage->rd, stage->rs1, stage->imm);
-  }
-  
-  if (strcmp(stage->opcode, "MOVC") == 0) {
-    printf("%s,R%d,#%d ", stage->opcode, stage->rd, stage->imm);
-  }
-  if (strcmp(stage->opcode, "ADD") == 0 || strcmp(stage->opcode, "SUB") == 0
-      || strcmp(stage->opcode, "MUL") == 0 || strcmp(stage->opcode, "AND") == 0
-	  || strcmp(stage->opcode, "OR") == 0 || strcmp(stage->opcode, "EX-OR") == 0) {
-    printf("%s,R%d,R%d,R%d ", stage->opcode, stage->rd, stage->rs1, stage->rs2);
-  }
-  if (strcmp(stage->opcode, "BZ") == 0 || strcmp(stage->opcode, "BNZ") == 0) {
-    printf("%s,#%d ", stage->opcode, stage->imm);
-  }
-  if (strcmp(stage->opcode, "JUMP") == 0) {
-    printf("%s,R%d,#%d ", stage->opcode, stage->rs1, stage->imm);
-  }
-  
-  if (strcmp(stage->opcode, "JAL") == 0) {
-    printf("%s,R%d,R%d,#%d ", stage->opcode, stage->rd ,stage->rs1, stage->imm);
-  }
-  if (strcmp(stage->opcode, "HALT") == 0) {
-    printf("%s,", stage->opcode);
-  }
-}
-/* Debug function which dumps the cpu stage content
- */
-static void
-print_stage_content(char* name, CPU_Stage* stage,APEX_CPU* cpu)
-{
-	if(!stage->stalled)
-	{
-		if(stage->pc==0)
-			printf("%-15s: ", name);
-		else if(strcmp(name,"")!=0)
-			printf("%-15s: pc(%d) ", name, stage->pc);
-		else
-			printf("pc(%d) ",stage->pc);
-		
-		if(strcmp(name,"Fetch")!=0)
-			print_instruction(stage,cpu);
-		else
-			print_fetch(stage);
-	}
-	else if(strcmp(name,"")!=0)
-		printf("%-15s: ", name);
-		
-  printf("\n");
-}
-
-/*
- *  Fetch Stage of APEX Pipeline
- */
-int
-fetch(APEX_CPU* cpu)
-{
-  CPU_Stage* stage = &cpu->stage[F];
-  if (!stage->busy && !stage->stalled) { 
-	stage->busy=1;
-    
-	/* Store current PC in fetch latch , handle the old pc value for branch instruction*/
-	if(cpu->old_pc > 0)
-		stage->pc = cpu->old_pc;
-	else
-		stage->pc=cpu->pc;
-
-    /* Index into code memory using this pc and copy all instruction fields into
-     * fetch latch
-     */
-    APEX_Instruction* current_ins = &cpu->code_memory[get_code_index(stage->pc)];
-    strcpy(stage->opcode, current_ins->opcode);
-    stage->rd = current_ins->rd;
-    stage->rs1 = current_ins->rs1;
-    stage->rs2 = current_ins->rs2;
-    stage->imm = current_ins->imm;
-    
-	/* Update PC for next instruction, if there is not stalling due to mul instruction in EX stage*/
-	if(cpu->old_pc==0)
-		cpu->pc += 4;
-	stage->busy=0;
-		
-	/* Copy data from fetch latch to decode latch*/
-	cpu->stage[DRF] = cpu->stage[F];
-	
-  }
-  else if(cpu->mulClock==0)
-  {
-	  /* Copy data from fetch latch to decode latch*/
-		cpu->stage[DRF] = cpu->stage[F];
-  }
-
-
-  if (ENABLE_DEBUG_MESSAGES) {
-      print_stage_content("Fetch", stage,cpu);
-    }
-  return 0;
-}
-
-/*
- *  Decode Stage of APEX Pipeline
- */
-int
-decode(APEX_CPU* cpu)
-{
-  CPU_Stage* stage = &cpu->stage[DRF];
-  if(stage->pc>0)
-  {  
-		if (!stage->busy && !stage->stalled) {
-		
-			if(strcmp(stage->opcode,"")!=0)
-			{
-				stage->busy=1;
-			
-				// read the source values from urf and rename the destination register
-				readRegValue(cpu);
-				int conditionTrue=regRename(cpu);
-				stage->setIq=conditionTrue;
-				
-				stage->cfidIndex=cfidTail;
-				printf("cfid assigned=%d\n",stage->cfidIndex);
-				
-				if(strcmp(stage->opcode,"JUMP")==0 || strcmp(stage->opcode,"JAL")==0 
-				|| strcmp(stage->opcode,"BZ")==0 || strcmp(stage->opcode,"BNZ")==0)
-				{
-					if(cfidHead==-1 && cfidTail==-1)
-					{
-						cfidHead=0;
-						cfidTail=0;
-					}
-					else if(cfidTail==7)
-						cfidTail=0;
-					else
-						cfidTail++;
-				}
-				
-				stage->busy=0;
-			}
-			cpu->stage[IQ] = cpu->stage[DRF];
-		}
-  }
-	if (ENABLE_DEBUG_MESSAGES) {
-      print_stage_content("Decode", stage,cpu);
-    }
-	return 0;
-}
-
-int iqStage(APEX_CPU* cpu)
-{
-	
-	CPU_Stage* stage = &cpu->stage[IQ];
-	 int lsqIndex,iqIndex,robIndex;
-	 
-	if (stage->stalled) {
-		return 0;
-	}
-	 if(strcmp(stage->opcode,"HALT")==0)
-	 {
-		robIndex=setRobEntry(cpu);
-
-		(&cpu->rob_list[robIndex])->status=1;
-		return 0;
-	 }
-	if(stage->setIq)
-	{
-		if(strcmp(stage->opcode,"")==0)
-			return 0;
-		
-		iqIndex=setIQEntry(cpu);
-		if(iqIndex>-1)
-		{
-			robIndex=setRobEntry(cpu);
-			(&cpu->iq_list[iqIndex])->robIndex=robIndex;
-			(&cpu->rob_list[robIndex])->iqIndex=iqIndex;
-			
-			if(strcmp(stage->opcode,"LOAD")==0 || strcmp(stage->opcode,"STORE")==0)
-			{
-				lsqIndex=setLSQEntry(cpu,iqIndex);
-				(&cpu->lsq_list[lsqIndex])->robIndex=robIndex;
-				(&cpu->iq_list[iqIndex])->lsqIndex=lsqIndex;
-				(&cpu->rob_list[robIndex])->lsqIndex=lsqIndex;
-			}
-		}
-	}
-	
-	return 0;
-}
-
-/* New code */
-int readRegValue(APEX_CPU* cpu)
-{
-	CPU_Stage* decodeStage = &cpu->stage[DRF];
-	
-	int urf_index=(&cpu->rat[decodeStage->rs1])->urf_reg;
-	decodeStage->urf_rs1_reg=urf_index;
-	
-	if((&cpu->urf_regs[urf_index])->valid)
-	{
-		decodeStage->rs1_value=(&cpu->urf_regs[urf_index])->value;
-		decodeStage->rs1_value_valid=1;
-		decodeStage->urf_rs1_reg=urf_index;
-	}
-	else
-	{
-		
-		CPU_Forward_Bus fwdEntry=readFrmFwdBus(cpu,urf_index);
-		if(fwdEntry.valid>0)
-		{
-			decodeStage->rs1_value=fwdEntry.rs_value;
-			decodeStage->rs1_value_valid=1;
-		}
-	}
-	
-	int urf_index_2=(&cpu->rat[decodeStage->rs2])->urf_reg;
-	decodeStage->urf_rs2_reg=urf_index_2;
-	
-	if((&cpu->urf_regs[urf_index_2])->valid)
-	{
-		decodeStage->rs2_value=(&cpu->urf_regs[urf_index_2])->value;
-		decodeStage->rs2_value_valid=1;
-		decodeStage->urf_rs2_reg=urf_index_2;
-	}
-	else
-	{
-		
-		CPU_Forward_Bus fwdEntry=readFrmFwdBus(cpu,urf_index_2);
-		if(fwdEntry.valid>0)
-		{
-			decodeStage->rs2_value=fwdEntry.rs_value;
-			decodeStage->rs2_value_valid=1;
-		}
-		
-	}
-	
-	if(strcmp(decodeStage->opcode,"MOVC")==0 || strcmp(decodeStage->opcode,"BZ")==0 || strcmp(decodeStage->opcode,"BNZ")==0)
-	{
-		decodeStage->rs1_value_valid=1;
-		decodeStage->rs2_value_valid=1;
-	}
-	if(strcmp(decodeStage->opcode,"LOAD")==0 || strcmp(decodeStage->opcode,"ADDL")==0 
-		|| strcmp(decodeStage->opcode,"SUBL")==0 || strcmp(decodeStage->opcode,"JUMP")==0 || strcmp(decodeStage->opcode,"JAL")==0)
-		decodeStage->rs2_value_valid=1;
-	
-	return 0;
-}
-
-int regRename(APEX_CPU* cpu)
-{
-	int freeRegFound=0;
-	CPU_Stage* decodeStage=&cpu->stage[DRF];
-	if(strcmp(decodeStage->opcode,"STORE")!=0 && strcmp(decodeStage->opcode,"")!=0 
-	&& strcmp(decodeStage->opcode,"JUMP")!=0 && strcmp(decodeStage->opcode,"BZ")!=0 
-	&& strcmp(decodeStage->opcode,"BNZ")!=0 && strcmp(decodeStage->opcode,"HALT")!=0)
-	{
-		for(int i=0;i<40;i++)
-		{
-		
-			
-			if((&cpu->urf_regs[i])->isFree)
-			{
-				freeRegFound=1;
-				int archDest=decodeStage->rd;
-				decodeStage->last_saved_urf_reg=(&cpu->rat[archDest])->urf_reg;
-				decodeStage->last_saved_urf_allocated=(&cpu->rat[archDest])->allocated;
-				
-				(&cpu->rat[archDest])->urf_reg=i;
-				(&cpu->rat[archDest])->allocated=1;
-				
-				if(strcmp(decodeStage->opcode,"LOAD")!=0)
-				{
-					if(!(&cpu->rat[16])->branch_available)
-					{
-						(&cpu->rat[16])->urf_reg=i;
-						(&cpu->rat[16])->allocated=1;
-					}
-				}
-				
-				
-				(&cpu->urf_regs[i])->isFree=0;
-				
-				decodeStage->urf_dest_reg=i;
-				(&cpu->urf_regs[i])->valid=0;
-				decodeStage->urf_dest_valid=1;
-				break;
-			}
-		}
-		
-	}
-	else
-	{
-		if(strcmp(decodeStage->opcode,"BZ")==0  || strcmp(decodeStage->opcode,"BNZ")==0)
-		{
-			(&cpu->rat[16])->branch_available=1;
-		}			
-		freeRegFound=1;
-	}
-	
-	
-	return freeRegFound;
-}
-
-int setIQEntry(APEX_CPU* cpu)
-{
-	int iqIndex=-1;
-	CPU_Stage decodeStage=cpu->stage[IQ];
-	for(int i=0;i<16;i++)
-	{
-		if(!(&cpu->iq_list[i])->allocated)
-		{
-			(&cpu->iq_list[i])->allocated=1;
-			(&cpu->iq_list[i])->clockCycle=cpu->clock;
-		
-			
-			(&cpu->iq_list[i])->stage=decodeStage;
-			strcpy((&cpu->iq_list[i])->fuType,getfuType(decodeStage));
-			
-			
-		
-			(&cpu->iq_list[i])->src1_valid=(&decodeStage)->rs1_value_valid;
-			(&cpu->iq_list[i])->src2_valid=(&decodeStage)->rs2_value_valid;
-			iqIndex=i;
-			
-			
-			// set lsq and rob index when implemented
-			break;
-		}
-	}
-	
-	return iqIndex;
-}
-
-int FwdToIssueQueue(APEX_CPU* cpu)
-{
-	for(int i=0;i<16;i++)
-	{
-		if((&cpu->iq_list[i])->allocated)
-		{
-			if(!((&cpu->iq_list[i])->stage.rs1_value_valid))
-			{
-				CPU_Forward_Bus fwdEntry=readFrmFwdBus(cpu,(&cpu->iq_list[i])->stage.urf_rs1_reg);
-				if(fwdEntry.valid>0)
-				{
-					(&cpu->iq_list[i])->stage.rs1_value=fwdEntry.rs_value;
-					(&cpu->iq_list[i])->stage.rs1_value_valid=1;
-					(&cpu->iq_list[i])->src1_valid=1;
-				}
-			}
-			
-			if(!((&cpu->iq_list[i])->stage.rs2_value_valid))
-			{
-				CPU_Forward_Bus fwdEntry_2=readFrmFwdBus(cpu,(&cpu->iq_list[i])->stage.urf_rs2_reg);
-				if(fwdEntry_2.valid>0)
-				{
-					(&cpu->iq_list[i])->stage.rs2_value=fwdEntry_2.rs_value;
-					(&cpu->iq_list[i])->stage.rs2_value_valid=1;
-					(&cpu->iq_list[i])->src2_valid=1;
-				}
-			}
-		}
-	}
-	return 0;
-}
-
-int FwdToLSQ(APEX_CPU* cpu)
-{
-	for(int i=0;i<20;i++)
-	{
-		if((&cpu->lsq_list[i])->allocated)
-		{
-			if(!((&cpu->lsq_list[i])->stage.rs1_value_valid))
-			{
-				CPU_Forward_Bus fwdEntry=readFrmFwdBus(cpu,(&cpu->lsq_list[i])->stage.urf_rs1_reg);
-				if(fwdEntry.valid>0)
-				{
-					(&cpu->lsq_list[i])->stage.rs1_value=fwdEntry.rs_value;
-					(&cpu->lsq_list[i])->stage.rs1_value_valid=1;
-					(&cpu->lsq_list[i])->src1_valid=1;
-				}
-			}
-		}
-	}
-	return 0;
-}
-
-int setLSQEntry(APEX_CPU* cpu,int iqIndex)
-{
-	int lsqIndex=-1;
-	
-	if(lsqHead==-1) 
-	{
-		lsqHead=0;
-	}
-	
-	if(lsqTail==-1)
-	{
-		lsqTail=0;
-	}
-	else if(lsqTail==19)
-		lsqTail=0;
-	else
-		lsqTail++;
-	
-	
-	
-	CPU_Stage decodeStage=cpu->stage[IQ];
-	//for(int i=0;i<20;i++)
-	//{
-		
-		if(!(&cpu->lsq_list[lsqTail])->allocated)
-		{
-			lsqIndex=lsqTail;
-			(&cpu->lsq_list[lsqTail])->allocated=1;
-			(&cpu->lsq_list[lsqTail])->stage=decodeStage;
-			(&cpu->lsq_list[lsqTail])->iqIndex=iqIndex;
-			(&cpu->lsq_list[lsqTail])->address_valid=0;
-			
-			(&cpu->lsq_list[lsqTail])->src1_valid=(&decodeStage)->rs1_value_valid;
-			//(&cpu->lsq_list[lsqTail])->src2_valid=(&decodeStage)->rs2_value_valid;
-			//lsqTail++;
-		}
-	//}
-	
-	return lsqIndex;
-}
-
-
-int setRobEntry(APEX_CPU* cpu)
-{
-	CPU_Stage decodeStage=cpu->stage[IQ];
-	if(robHead==-1)
-		robHead=0;
-	if(robTail==-1)
-		robTail=0;
-	else if(robTail==31)
-		robTail=0;
-	else
-		robTail++;
-	
-	(&cpu->rob_list[robTail])->stage=decodeStage;
-	(&cpu->rob_list[robTail])->status=0;
-	
-	return robTail;
-			
-}
-
-char* getfuType(CPU_Stage decodeStage)
-{
-	if(strcmp((&decodeStage)->opcode,"MUL")!=0)
-	{
-		return "IntFu";
-	}
-	else
-		return "MulFu";
-}
-
-int intFuncUnit(APEX_CPU* cpu)
-{
-	int entrySelected=0;
-	CPU_IQ *iqSelectedEntry;
-	CPU_ROB *robSelectedEntry;
-	CPU_Stage* dummyStage=malloc(sizeof(*dummyStage));
-	dummyStage->stalled=1;
-	CPU_LSQ *lsqEntry;
-	if(!intFuBusy)
-	{
-		
-		int readyIqIndex=getReadyIQIndex(cpu,"IntFu");
-		// select an entry that satisfies all conditions for issue
-		//for(int i=0;i<16;i++)
-		//{
-			if(readyIqIndex>-1)
-			{
-			CPU_IQ *iqEntry=(&cpu->iq_list[readyIqIndex]);
-			//if(strcmp(iqEntry->fuType,"IntFu")==0)
-			//{
-				//if((cpu->clock-iqEntry->clockCycle)>=1)
-				//{
-					if(strcmp((&iqEntry->stage)->opcode,"STORE")==0)
-					{
-						if(iqEntry->allocated && iqEntry->src2_valid)
-						{
-							entrySelected=1;
-							iqSelectedEntry=iqEntry;
-							robSelectedEntry=(&cpu->rob_list[iqSelectedEntry->robIndex]);
-							lsqEntry=(&cpu->lsq_list[iqSelectedEntry->lsqIndex]);
-						}
-					}
-					else if(iqEntry->allocated && iqEntry->src1_valid && iqEntry->src2_valid)
-					{
-						entrySelected=1;
-						iqSelectedEntry=iqEntry;
-						robSelectedEntry=(&cpu->rob_list[iqSelectedEntry->robIndex]);
-						lsqEntry=(&cpu->lsq_list[iqSelectedEntry->lsqIndex]);
-						//break;
-					}
-				}
-				//}
-			//}
-		//}
-		
-
-		// perform the operation for the selected issue queue entry
-		if(entrySelected)
-		{
-			intFuBusy=1;
-			if (strcmp((&iqSelectedEntry->stage)->opcode, "ADD") == 0) {
-				(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->rs1_value + (&iqSelectedEntry->stage)->rs2_value;
-			}
-			else if (strcmp((&iqSelectedEntry->stage)->opcode, "ADDL") == 0) {
-				
-				(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->rs1_value+(&iqSelectedEntry->stage)->imm;
-			}
-			else if (strcmp((&iqSelectedEntry->stage)->opcode, "SUB") == 0) {
-				
-				(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->rs1_value - (&iqSelectedEntry->stage)->rs2_value;
-			}
-			else if (strcmp((&iqSelectedEntry->stage)->opcode, "SUBL") == 0) {
-				
-				(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->rs1_value - (&iqSelectedEntry->stage)->imm;
-			}
-			else if (strcmp((&iqSelectedEntry->stage)->opcode, "EX-OR") == 0) {
-				
-				(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->rs1_value ^ (&iqSelectedEntry->stage)->rs2_value;
-			}
-			else if (strcmp((&iqSelectedEntry->stage)->opcode, "OR") == 0) {
-				
-				(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->rs1_value | (&iqSelectedEntry->stage)->rs2_value;
-			}
-			else if (strcmp((&iqSelectedEntry->stage)->opcode, "AND") == 0) {
-				
-				(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->rs1_value & (&iqSelectedEntry->stage)->rs2_value;
-			}
-			else if (strcmp((&iqSelectedEntry->stage)->opcode, "LOAD") == 0) {
-				
-				(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->rs1_value + (&iqSelectedEntry->stage)->imm;
-				lsqEntry->stage=iqSelectedEntry->stage;
-				lsqEntry->address_valid=1;
-				
-			}
-			else if (strcmp((&iqSelectedEntry->stage)->opcode, "STORE") == 0) {
-				
-				(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->rs2_value + (&iqSelectedEntry->stage)->imm;
-				lsqEntry->stage=iqSelectedEntry->stage;
-				lsqEntry->address_valid=1;
-				//robSelectedEntry->status=1;
-			}
-			else if (strcmp((&iqSelectedEntry->stage)->opcode, "MOVC") == 0) {
-				
-				(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->imm + 0;
-			}
-			
-			else if (strcmp((&iqSelectedEntry->stage)->opcode, "JUMP") == 0) {
-				
-				(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->rs1_value + (&iqSelectedEntry->stage)->imm;
-				cpu->old_pc=cpu->pc;
-				cpu->pc=(&iqSelectedEntry->stage)->buffer;
-				bTaken=1;
-				ctrlOccur=1;
-							
-				
-			}
-			else if (strcmp((&iqSelectedEntry->stage)->opcode, "JAL") == 0) {
-				
-				(&iqSelectedEntry->stage)->mem_address = (&iqSelectedEntry->stage)->rs1_value + (&iqSelectedEntry->stage)->imm;
-				cpu->old_pc=cpu->pc;
-				cpu->pc=(&iqSelectedEntry->stage)->mem_address;
-				(&iqSelectedEntry->stage)->buffer=(&iqSelectedEntry->stage)->pc+4;
-				bTaken=1;
-				ctrlOccur=1;
-							
-				
-			}
-			
-			else if (strcmp((&iqSelectedEntry->stage)->opcode, "BZ") == 0) {
-				
-				// get the latest instance of zero flag from RAT or from forward bus
-				int urf_reg=(&cpu->rat[16])->urf_reg;
-				
-				
-				int zFlag=0;
-				if((&cpu->urf_regs[urf_reg])->valid)
-				{
-					zFlag=(&cpu->urf_regs[urf_reg])->zFlag;
-				
-				}
-				else
-				{
-					CPU_Forward_Bus fwdZFlag=readFrmFwdBus(cpu,urf_reg);
-					if(fwdZFlag.valid)
-						zFlag=fwdZFlag.zFlag;
-				}
-				
-				if(zFlag)
-				{
-					(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->pc + (&iqSelectedEntry->stage)->imm;
-					cpu->old_pc=cpu->pc;
-					cpu->pc=(&iqSelectedEntry->stage)->buffer;
-					bTaken=1;
-					ctrlOccur=1;
-				}
-
-				(&cpu->rat[16])->branch_available=0;
-				
-			}
-			
-			else if (strcmp((&iqSelectedEntry->stage)->opcode, "BNZ") == 0) {
-				
-				// get the latest instance of zero flag from RAT or from forward bus
-				int urf_reg=(&cpu->rat[16])->urf_reg;
-				int zFlag=0;
-				
-				if((&cpu->urf_regs[urf_reg])->valid)
-					zFlag=(&cpu->urf_regs[urf_reg])->zFlag;
-				else
-				{
-					CPU_Forward_Bus fwdZFlag=readFrmFwdBus(cpu,urf_reg);
-					if(fwdZFlag.valid)
-						zFlag=fwdZFlag.zFlag;
-				}
-				
-				if(!zFlag)
-				{
-					(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->pc + (&iqSelectedEntry->stage)->imm;
-					cpu->old_pc=cpu->pc;
-					cpu->pc=(&iqSelectedEntry->stage)->buffer;
-					bTaken=1;
-					ctrlOccur=1;
-					
-				}
-				
-				(&cpu->rat[16])->branch_available=0;
-				
-			}
-			
-			robSelectedEntry->stage=iqSelectedEntry->stage;
-			
-			if (strcmp((&iqSelectedEntry->stage)->opcode, "LOAD") != 0 )
-			//&& strcmp((&iqSelectedEntry->stage)->opcode, "STORE") != 0) 
-			{
-			
-			robSelectedEntry->status=1;
-			
-			if (strcmp((&iqSelectedEntry->stage)->opcode, "JUMP") != 0 && strcmp((&iqSelectedEntry->stage)->opcode, "BZ") != 0 
-			    && strcmp((&iqSelectedEntry->stage)->opcode, "BNZ") != 0 && strcmp((&iqSelectedEntry->stage)->opcode, "STORE") != 0)
-				writeOnFwdBus(cpu,iqSelectedEntry->stage);
-
-			}
-			intFuBusy=0;
-			
-			iqSelectedEntry->allocated=0;
-			
-			
-		}
-			
-	}
-	
-	if (ENABLE_DEBUG_MESSAGES) {
-		print_stage_content("EX_INT_FU",(entrySelected?(&(iqSelectedEntry->stage)):dummyStage),cpu);
-    }
-	return 0;
-}
-
-int getReadyIQIndex(APEX_CPU* cpu,char fuType[10])
-{
-	int minClock=0;
-	int iqIndex=-1;
-	for(int i=0;i<16;i++)
-	{
-		CPU_IQ *iqEntry=(&cpu->iq_list[i]);
-		if(strcmp(iqEntry->fuType,fuType)==0)
-		{
-			if(iqEntry->allocated)
-			{
-				if((cpu->clock-iqEntry->clockCycle)>=1)
-				{
-					if(minClock==0)
-					{
-						minClock=iqEntry->clockCycle;
-						iqIndex=i;
-					}
-					else if(iqEntry->clockCycle < minClock)
-					{
-						minClock=iqEntry->clockCycle;
-						iqIndex=i;
-					}
-				}
-			}
-		}
-	}
-	
-	return iqIndex;
-}
-int mulFuncUnit(APEX_CPU* cpu)
-{
-	int entrySelected=0;
-	CPU_IQ *iqSelectedEntry;
-	CPU_ROB *robSelectedEntry;
-	CPU_Stage* dummyStage=malloc(sizeof(*dummyStage));
-	dummyStage->stalled=1;
-	if(!mulFuBusy)
-	{
-		
-		int readyIqIndex=getReadyIQIndex(cpu,"MulFu");
-		
-		// select an entry that satisfies all conditions for issue
-		//for(int i=0;i<16;i++)
-		//{
-			if(readyIqIndex>-1)
-			{
-			CPU_IQ *iqEntry=(&cpu->iq_list[readyIqIndex]);
-			//if(strcmp(iqEntry->fuType,"MulFu")==0)
-			//{
-			//	if((cpu->clock-iqEntry->clockCycle)>=1)
-			//	{
-					if(iqEntry->allocated && iqEntry->src1_valid && iqEntry->src2_valid)
-					{
-						entrySelected=1;
-						iqSelectedEntry=iqEntry;
-						(&cpu->mulFuncUnit)->robIndex=iqSelectedEntry->robIndex;
-						robSelectedEntry=(&cpu->rob_list[iqSelectedEntry->robIndex]);
-						//break;
-					}
-			}
-				//}
-			//}
-		//}
-		
-		if(entrySelected)
-		{
-			mulFuBusy=1;
-			mulClock++;
-			if (strcmp((&iqSelectedEntry->stage)->opcode, "MUL") == 0) {
-				
-				(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->rs1_value*(&iqSelectedEntry->stage)->rs2_value;
-				robSelectedEntry->stage=iqSelectedEntry->stage;
-				//robSelectedEntry->status=1;
-			}
-			
-			iqSelectedEntry->allocated=0;
-			//writeOnFwdBus(cpu,(&iqSelectedEntry->stage));
-		}
-	}
-	else
-	{
-		//if(mulClock==2)
-		//{
-		//	mulFuBusy=0;
-		//	mulClock=0;
-		//}
-		//else
-		//{
-			entrySelected=1;
-			//mulClock++;
-			mulFuBusy=0;
-			mulClock=0;
-			robSelectedEntry=(&cpu->rob_list[(&cpu->mulFuncUnit)->robIndex]);
-			robSelectedEntry->status=1;
-			writeOnFwdBus(cpu,robSelectedEntry->stage);
-		//}
-			
-		
-	}
-	
-	if (ENABLE_DEBUG_MESSAGES) {
-		print_stage_content("EX_MUL_FU",(entrySelected?(&robSelectedEntry->stage):dummyStage),cpu);
-	}
-	return 0;
-}
-
-int instAtRobHead(APEX_CPU* cpu)
-{
-	CPU_ROB* headRob=(&cpu->rob_list[robHead]);
-	
-	int nextRobIndex=robHead==31 ? 0: robHead+1;
-	
-	CPU_ROB* nextHeadRob=(&cpu->rob_list[nextRobIndex]);
-	
-	if(headRob->status)
-	{
-		if(strcmp((&headRob->stage)->opcode,"HALT")==0)
-		{
-			haltAtRobHead=1;
-			//if(robHead==31)
-			//	robHead=0;
-			//else 
-			//	robHead++;
-		
-			
-			flushInstruction_halt(cpu,(&headRob->stage)->cfidIndex,1);
-			(&cpu->stage[F])->stalled=1;
-			(&cpu->stage[DRF])->stalled=1;
-			(&cpu->stage[IQ])->stalled=1;
-			tempRobStage=headRob->stage;
-			tempRobStage_1.stalled=1;
-			instRetired=1;
-			
-			robHead=-1;
-			robTail=-1;
-			
-			return 0;
-		}
-		
-		if(strcmp((&headRob->stage)->opcode,"STORE")!=0 && strcmp((&headRob->stage)->opcode,"")!=0 
-		&& strcmp((&headRob->stage)->opcode,"JUMP")!=0 && strcmp((&headRob->stage)->opcode,"BZ")!=0 
-		&& strcmp((&headRob->stage)->opcode,"BNZ")!=0 && strcmp((&headRob->stage)->opcode,"HALT")!=0)
-		{
-			(&cpu->urf_regs[(&headRob->stage)->urf_dest_reg])->value=(&headRob->stage)->buffer;
-			
-			
-			if((&headRob->stage)->buffer==0)
-				(&cpu->urf_regs[(&headRob->stage)->urf_dest_reg])->zFlag=1;
-			
-			// deallocate the previous urf instance of the architectural register
-			int oldUrfReg=(&headRob->stage)->last_saved_urf_reg;
-			if(oldUrfReg!=100)
-			//&& (&cpu->urf_regs[oldUrfReg])->valid)
-			{
-				(&cpu->urf_regs[oldUrfReg])->isFree=1;
-				//(&cpu->urf_regs[oldUrfReg])->valid=0;
-			}
-		
-			(&cpu->urf_regs[(&headRob->stage)->urf_dest_reg])->valid=1;
-		}
-		//else
-		//{
-			if(strcmp((&headRob->stage)->opcode,"JUMP")==0 || strcmp((&headRob->stage)->opcode,"BZ")==0 
-			|| strcmp((&headRob->stage)->opcode,"BNZ")==0 || strcmp((&headRob->stage)->opcode,"JAL")==0)
-			{
-				//crossOver=1;
-			}
-		//}
-		
-		tempRobStage=headRob->stage;
-		
-		if(robHead==31)
-			robHead=0;
-		else 
-			robHead++;
-		
-		instRetired=1;
-	}
-	else
-	{
-		tempRobStage.stalled=1;
-		return 0;
-	}
-	
-	
-	
-	// inst commit for head + 1
-	if(nextHeadRob->status)
-	{
-		if(strcmp((&nextHeadRob->stage)->opcode,"HALT")==0)
-		{
-			
-			if(!bTaken)
-			{
-				haltAtRobHead=1;
-				//if(robHead==31)
-				//	robHead=0;
-				//else 
-				//	robHead++;
-			
-				flushInstruction_halt(cpu,(&nextHeadRob->stage)->cfidIndex,1);
-				(&cpu->stage[F])->stalled=1;
-			(&cpu->stage[DRF])->stalled=1;
-			(&cpu->stage[IQ])->stalled=1;
-				
-				tempRobStage_1=nextHeadRob->stage;
-				
-				instRetired_1=1;
-			}
-				return 0;
-			
-		}
-		
-		if(strcmp((&nextHeadRob->stage)->opcode,"STORE")!=0 && strcmp((&nextHeadRob->stage)->opcode,"")!=0 
-		&& strcmp((&nextHeadRob->stage)->opcode,"JUMP")!=0 && strcmp ((&nextHeadRob->stage)->opcode,"BZ")!=0 
-		&& strcmp((&nextHeadRob->stage)->opcode,"BNZ")!=0 && strcmp  ((&nextHeadRob->stage)->opcode,"HALT")!=0)
-		{
-			(&cpu->urf_regs[(&nextHeadRob->stage)->urf_dest_reg])->value=(&nextHeadRob->stage)->buffer;
-			
-			
-			if((&nextHeadRob->stage)->buffer==0)
-				(&cpu->urf_regs[(&nextHeadRob->stage)->urf_dest_reg])->zFlag=1;
-			
-			// deallocate the previous urf instance of the architectural register
-			int oldUrfReg=(&nextHeadRob->stage)->last_saved_urf_reg;
-			if(oldUrfReg!=100)
-			//&& (&cpu->urf_regs[oldUrfReg])->valid)
-			{
-				(&cpu->urf_regs[oldUrfReg])->isFree=1;
-				//(&cpu->urf_regs[oldUrfReg])->valid=0;
-			}
-		
-			(&cpu->urf_regs[(&nextHeadRob->stage)->urf_dest_reg])->valid=1;
-		}
-		
-		tempRobStage_1=nextHeadRob->stage;
-		
-		if(robHead==31)
-			robHead=0;
-		else 
-			robHead++;
-		
-		instRetired_1=1;
-	}
-	else
-		tempRobStage_1.stalled=1;
-	
-	
-	return 0;
-}
-
-int commitToRrat(APEX_CPU* cpu)
-{
-	if(instRetired)
-	{
-		if(strcmp(tempRobStage.opcode,"STORE")!=0 && strcmp(tempRobStage.opcode,"")!=0 
-		&& strcmp(tempRobStage.opcode,"JUMP")!=0 && strcmp(tempRobStage.opcode,"BZ")!=0 
-		&& strcmp(tempRobStage.opcode,"BNZ")!=0 && strcmp(tempRobStage.opcode,"HALT")!=0)
-		{
-			(&cpu->rRat[tempRobStage.rd])->urf_reg=tempRobStage.urf_dest_reg;
-			(&cpu->rRat[tempRobStage.rd])->allocated=1;
-			
-			if(strcmp(tempRobStage.opcode,"LOAD")!=0)
-			{
-				(&cpu->rRat[16])->urf_reg=tempRobStage.urf_dest_reg;
-				(&cpu->rRat[16])->allocated=1;
-			}
-			//instRetired=0;
-		}
-		
-		instRetired=0;
-	}
-	
-	//commitment for inst at rob head + 1
-	if(instRetired_1)
-	{
-		if(strcmp(tempRobStage_1.opcode,"STORE")!=0 && strcmp(tempRobStage_1.opcode,"")!=0 
-		&& strcmp(tempRobStage_1.opcode,"JUMP")!=0 && strcmp (tempRobStage_1.opcode,"BZ")!=0 
-		&& strcmp(tempRobStage_1.opcode,"BNZ")!=0 && strcmp  (tempRobStage_1.opcode,"HALT")!=0)
-		{
-			(&cpu->rRat[tempRobStage_1.rd])->urf_reg=tempRobStage_1.urf_dest_reg;
-			(&cpu->rRat[tempRobStage_1.rd])->allocated=1;
-			
-			if(strcmp(tempRobStage_1.opcode,"LOAD")!=0)
-			{
-				(&cpu->rRat[16])->urf_reg=tempRobStage_1.urf_dest_reg;
-				(&cpu->rRat[16])->allocated=1;
-			}
-			//instRetired=0;
-		}
-		
-		instRetired_1=0;
-	}
-	
-	return 0;
-}
-
-int memFuncUnit(APEX_CPU* cpu)
-{
-	int entrySelected=0;
-	CPU_LSQ *lsqSelectedEntry;
-	CPU_ROB *robSelectedEntry;
-	CPU_Stage* dummyStage=malloc(sizeof(*dummyStage));
-	dummyStage->stalled=1;
-	if(!memFuBusy)
-	{
-		// select an entry that satisfies all conditions for issue
-		CPU_LSQ *lsqEntry=(&cpu->lsq_list[lsqHead]);
-		if(lsqEntry->allocated && lsqEntry->src1_valid && lsqEntry->address_valid)
-		{
-			//entrySelected=1;
-			lsqSelectedEntry=lsqEntry;
-			(&cpu->memFuncUnit)->robIndex=lsqSelectedEntry->robIndex;
-			robSelectedEntry=(&cpu->rob_list[lsqSelectedEntry->robIndex]);
-			
-			//if(lsqSelectedEntry->robIndex==robHead)
-			//{
-				entrySelected=1;
-				
-				if(lsqHead==19)
-					lsqHead=0;
-				else
-					lsqHead++;
-			//}
-			
-			
-		}
-		
-		if(entrySelected)
-		{
-			//if(lsqSelectedEntry->robIndex==robHead)
-			//{
-				
-				memFuBusy=1;
-				memClock++;
-				
-				if (strcmp((&lsqSelectedEntry->stage)->opcode, "STORE") == 0) {
-					
-					cpu->data_memory[(&lsqSelectedEntry->stage)->buffer]=(&lsqSelectedEntry->stage)->rs1_value;
-					
-					robSelectedEntry->stage=lsqSelectedEntry->stage;
-					//robSelectedEntry->status=1;
-					lsqSelectedEntry->allocated=0;
-					
-				}
-			//}
-			if (strcmp((&lsqSelectedEntry->stage)->opcode, "LOAD") == 0) {
-					
-				(&lsqSelectedEntry->stage)->buffer=cpu->data_memory[(&lsqSelectedEntry->stage)->buffer];
-				
-				robSelectedEntry->stage=lsqSelectedEntry->stage;
-				lsqSelectedEntry->allocated=0;
-				//robSelectedEntry->status=1;
-				
-				//writeOnFwdBus(cpu,robSelectedEntry->stage);
-			}
-			
-			
-		}
-	}
-	else
-	{
-		if(memClock==2)
-		{
-			entrySelected=1;
-			memFuBusy=0;
-			memClock=0;
-			robSelectedEntry=(&cpu->rob_list[(&cpu->memFuncUnit)->robIndex]);
-			robSelectedEntry->status=1;
-			if (strcmp((&robSelectedEntry->stage)->opcode, "STORE") != 0)
-			{
-				writeOnFwdBus(cpu,robSelectedEntry->stage);
-			}
-		}
-		else
-		{
-			entrySelected=1;
-			memClock++;
-			robSelectedEntry=(&cpu->rob_list[(&cpu->memFuncUnit)->robIndex]);
-		}
-			
-		
-	}
-	
-	if (ENABLE_DEBUG_MESSAGES) {
-		print_stage_content("MEM_FU",(entrySelected?(&robSelectedEntry->stage):dummyStage),cpu);
-	}
-	return 0;
-}
-
-
-int writeOnFwdBus(APEX_CPU* cpu, CPU_Stage stage)
-{
-	int fIndex=-1;
-	int regExist=checkFReg(cpu,stage.urf_dest_reg);
-	fIndex=regExist>-1?regExist:forwardIndex;
-	
-	
-	(&cpu->fBus[fIndex])->rs=stage.urf_dest_reg;
-	(&cpu->fBus[fIndex])->rs_value=stage.buffer;
-	(&cpu->fBus[fIndex])->valid=1;
-	
-		if(stage.buffer ==0)
-		{
-			(&cpu->fBus[fIndex])->zFlag=1;
-		}
-		else
-			(&cpu->fBus[fIndex])->zFlag=0;
-		
-		
-		forwardIndex= regExist==-1 ? (forwardIndex==2 ? 0 : forwardIndex+1) : (regExist==2 ? 0 : forwardIndex);
-		
-		return 0;
-}
-
-CPU_Forward_Bus readFrmFwdBus(APEX_CPU* cpu,int urf_reg)
-{
-	//int value;
-	CPU_Forward_Bus fwdEntry;
-	fwdEntry.valid=0;
-	
-	for(int i=0;i<3;i++)
-	{
-		if((&cpu->fBus[i])->rs==urf_reg)
-		{
-			//value=(&cpu->fBus[i])->rs_value;
-			fwdEntry=cpu->fBus[i];
-		}
-	}
-	return fwdEntry;
-}
-
-/*
- *  Execute Stage of APEX Pipeline
- */
-int
-execute(APEX_CPU* cpu)
-{
-  CPU_Stage* stage = &cpu->stage[EX];
-  if (!stage->busy && !stage->stalled) {
-
-	stage->busy=1;	
-    /* Store */
-    if (strcmp(stage->opcode, "STORE") == 0) {
-				
-		for(int i=0;i<3;i++)
-			{
-				if((&cpu->fBus[i])->rs==stage->rs2)
-					stage->rs2_value=(&cpu->fBus[i])->rs_value;
-					
-			}
-			
-		stage->buffer = stage->rs2_value+stage->imm;
-		
-    }
-	/* Load */
-    if (strcmp(stage->opcode, "LOAD") == 0) {
-		stage->buffer = stage->rs1_value+stage->imm;
-    }	
-    /* MOVC */
-    if (strcmp(stage->opcode, "MOVC") == 0) {
-		stage->buffer=stage->imm+0;
-    }
-
-	if (strcmp(stage->opcode, "ADD") == 0) {
-		
-		for(int i=0;i<3;i++)
-		{
-			if((&cpu->fBus[i])->rs==stage->rs1)
-			{
-				stage->rs1_value=(&cpu->fBus[i])->rs_value;
-				
-					stage->zFlag=(&cpu->fBus[i])->zFlag;
-				
-			}
-			if((&cpu->fBus[i])->rs==stage->rs2)
-			{
-				stage->rs2_value=(&cpu->fBus[i])->rs_value;
-				
-					stage->zFlag=(&cpu->fBus[i])->zFlag;
-			}
-		}
-		
-		
-		stage->buffer = stage->rs1_value+stage->rs2_value;
-    }
-	
-	if (strcmp(stage->opcode, "SUB") == 0) {
-		
-		for(int i=0;i<3;i++)
-		{
-			if((&cpu->fBus[i])->rs==stage->rs1)
-			{
-				stage->rs1_value=(&cpu->fBus[i])->rs_value;
-				
-					stage->zFlag=(&cpu->fBus[i])->zFlag;
-				
-			}
-			if((&cpu->fBus[i])->rs==stage->rs2)
-			{
-				stage->rs2_value=(&cpu->fBus[i])->rs_value;
-				
-					stage->zFlag=(&cpu->fBus[i])->zFlag;
-			}
-		}
-		
-		stage->buffer = stage->rs1_value - stage->rs2_value;
-    }
-	if (strcmp(stage->opcode, "MUL") == 0) {
-		
-		if(cpu->mulClock==1)
-		{
-			for(int i=0;i<3;i++)
-			{
-				if((&cpu->fBus[i])->rs==stage->rs1)
-				{
-					stage->rs1_value=(&cpu->fBus[i])->rs_value;
-					
-						stage->zFlag=(&cpu->fBus[i])->zFlag;
-					
-				}
-				 if((&cpu->fBus[i])->rs==stage->rs2)
-				{
-					stage->rs2_value=(&cpu->fBus[i])->rs_value;
-					
-						stage->zFlag=(&cpu->fBus[i])->zFlag;
-				}
-			}
-			
-			stage->buffer = stage->rs1_value * stage->rs2_value;
-			
-		}
-		
-		
-    }
-	if (strcmp(stage->opcode, "AND") == 0) {
-		
-		for(int i=0;i<3;i++)
-		{
-			if((&cpu->fBus[i])->rs==stage->rs1)
-			{
-				stage->rs1_value=(&cpu->fBus[i])->rs_value;
-				
-					stage->zFlag=(&cpu->fBus[i])->zFlag;
-				
-			}
-			if((&cpu->fBus[i])->rs==stage->rs2)
-			{
-				stage->rs2_value=(&cpu->fBus[i])->rs_value;
-				
-					stage->zFlag=(&cpu->fBus[i])->zFlag;
-			}
-		}
-		
-		stage->buffer = stage->rs1_value & stage->rs2_value;
-    }
-	if (strcmp(stage->opcode, "OR") == 0) {
-		
-		for(int i=0;i<3;i++)
-		{
-			if((&cpu->fBus[i])->rs==stage->rs1)
-			{
-				stage->rs1_value=(&cpu->fBus[i])->rs_value;
-				
-					stage->zFlag=(&cpu->fBus[i])->zFlag;
-				
-			}
-			if((&cpu->fBus[i])->rs==stage->rs2)
-			{
-				stage->rs2_value=(&cpu->fBus[i])->rs_value;
-				
-					stage->zFlag=(&cpu->fBus[i])->zFlag;
-			}
-		}
-		
-		stage->buffer = stage->rs1_value | stage->rs2_value;
-    }
-	if (strcmp(stage->opcode, "EX-OR") == 0) {
-		
-		for(int i=0;i<3;i++)
-		{
-			if((&cpu->fBus[i])->rs==stage->rs1)
-			{
-				stage->rs1_value=(&cpu->fBus[i])->rs_value;
-				
-					stage->zFlag=(&cpu->fBus[i])->zFlag;
-				
-			}
-			if((&cpu->fBus[i])->rs==stage->rs2)
-			{
-				stage->rs2_value=(&cpu->fBus[i])->rs_value;
-				
-					stage->zFlag=(&cpu->fBus[i])->zFlag;
-			}
-		}
-		
-		int a=stage->rs1_value & stage->rs2_value;
-		int b=~stage->rs1_value & ~stage->rs2_value;
-		stage->buffer=~a & ~b;
-		
-    }
-	
-	// set the zero flag in forward bus if calculated value is zero
-	if(strcmp(stage->opcode, "BNZ") != 0 
-	   && strcmp(stage->opcode, "BZ") != 0 && strcmp(stage->opcode, "JUMP") != 0 
-	   && strcmp(stage->opcode, "LOAD") != 0 && strcmp(stage->opcode, "STORE") != 0)
-	{	
-	
-		int fIndex=-1;
-		int regExist=checkFReg(cpu,stage->rd);
-		fIndex=regExist>-1?regExist:forwardIndex;
-		
-		
-		(&cpu->fBus[fIndex])->rs=stage->rd;
-		(&cpu->fBus[fIndex])->rs_value=stage->buffer;
-		
-			if(stage->buffer ==0)
-			{
-				(&cpu->fBus[fIndex])->zFlag=1;
-			}
-			else
-				(&cpu->fBus[fIndex])->zFlag=0;
-			
-			
-			forwardIndex= regExist==-1 ? (forwardIndex==2 ? 0 : forwardIndex+1) : (regExist==2 ? 0 : forwardIndex);
-			
-		
-		
-	}
-	
-	if (strcmp(stage->opcode, "JUMP") == 0) {
-		stage->buffer = stage->rs1_value + stage->imm;
-		cpu->old_pc=cpu->pc;
-		cpu->pc=stage->buffer;
-		
-	}
-	
-	if (strcmp(stage->opcode, "BZ") == 0) {
-		
-		if(stage->zFlag)
-		{
-			bTaken=1;
-			stage->buffer = stage->pc + stage->imm;
-			cpu->old_pc=cpu->pc;
-			cpu->pc=stage->buffer;
-			
-		}
-	}
-	
-	if (strcmp(stage->opcode, "BNZ") == 0) {
-		if(!stage->zFlag)
-		{
-			bTaken=1;
-			stage->buffer = stage->pc + stage->imm;
-			cpu->old_pc=cpu->pc;
-			cpu->pc=stage->buffer;
-		}
-	}
-	
-	if(cpu->mulClock==0)
-	{	
-			stage->busy=0;    
-					
-			/* Copy data from Execute latch to Memory latch*/
-			cpu->stage[MEM] = cpu->stage[EX];
-			(&cpu->stage[MEM])->stalled=0;
-			(&cpu->stage[MEM])->pc=stage->pc;
-	}
-	else
-		(&cpu->stage[MEM])->stalled=1;
-    	
-  }
-  else
-  {
-	  /* Copy data from Execute latch to Memory latch*/
-			cpu->stage[MEM] = cpu->stage[EX];
-	(&cpu->stage[MEM])->stalled=1;
-  }
-  
-  if (ENABLE_DEBUG_MESSAGES) {
-     // print_stage_content("Execute", stage);
-    }
-  return 0;
-}
-
-
-/*
- *  Writeback Stage of APEX Pipeline
- */
-int
-writeback(APEX_CPU* cpu)
-{
-  CPU_Stage* stage = &cpu->stage[WB];
-  if (!stage->busy && !stage->stalled) {
-
-    /* Update register file */  
-	if (strcmp(stage->opcode, "STORE") != 0 && strcmp(stage->opcode, "BNZ") != 0 
-	    && strcmp(stage->opcode, "BZ") != 0 && strcmp(stage->opcode, "JUMP") != 0 && strcmp(stage->opcode, "HALT") != 0) {
-      cpu->regs[stage->rd] = stage->buffer;
-	  cpu->regs_valid[stage->rd]=1;
-	  	  
-	if(strcmp(stage->opcode, "BNZ") != 0 && strcmp(stage->opcode, "BZ") != 0)
-	{	
-		if(stage->buffer ==0)
-			cpu->zeroFlag=1;
-		else
-			cpu->zeroFlag=0;
-	}
-	
-    }
-	
-    cpu->ins_completed++;
-	   
-  }
-  
-  if (ENABLE_DEBUG_MESSAGES) {
-      //print_stage_content("Writeback", stage);
-    }
-  return 0;
-}
-
-int flushInstruction(APEX_CPU* cpu,int cfidIndex,int isHalt)
-{
-	for(int i=cfidHead;i<=cfidTail;i++)
-	{
-		// flush instructions from iq 
-		for(int j=0;j<16;j++)
-		{
-			if(((&cpu->iq_list[j])->stage).cfidIndex==i)
-				(&cpu->iq_list[j])->allocated=0;
-		}
-		
-		
-	}
-	
-	
-	// flush instructions from lsq
-	for(int m=lsqTail;m>=lsqHead;m--)
-	{
-		if((&cpu->lsq_list[m])->allocated)
-		{
-			if(((&cpu->lsq_list[m])->stage).cfidIndex>=cfidIndex)
-			{
-				
-				lsqTail--;
-				(&cpu->lsq_list[m])->allocated=0;
-			}
-		}
-	}
-	
-	
-	//printf("LSQ flush done\n");
-	int flushDone=0;
-	
-	
-	
-	// flush instructions from rob
-	for(int m=robTail;m>=robHead;m--)
-	{
-		
-		//if(m==robHead && strcmp(((&cpu->rob_list[m])->stage)->opcode,"HALT")==0)
-			
-		
-		if(((&cpu->rob_list[m])->stage).cfidIndex>=cfidIndex)
-		{
-			flushDone=1;
-			(&cpu->rob_list[m])->status=0;
-			
-			if(strcmp(((&cpu->rob_list[m])->stage).opcode,"STORE")!=0 && strcmp(((&cpu->rob_list[m])->stage).opcode,"")!=0 
-			&& strcmp(((&cpu->rob_list[m])->stage).opcode,"JUMP")!=0 && strcmp(((&cpu->rob_list[m])->stage).opcode,"BZ")!=0 
-			&& strcmp(((&cpu->rob_list[m])->stage).opcode,"BNZ")!=0 && strcmp(((&cpu->rob_list[m])->stage).opcode,"HALT")!=0)
-			{
-				(&cpu->rat[((&cpu->rob_list[m])->stage).rd])->urf_reg=((&cpu->rob_list[m])->stage).last_saved_urf_reg;
-				(&cpu->rat[((&cpu->rob_list[m])->stage).rd])->allocated=((&cpu->rob_list[m])->stage).last_saved_urf_allocated;
-				
-				(&cpu->urf_regs[((&cpu->rob_list[m])->stage).last_saved_urf_reg])->isFree=0;
-				//(&cpu->urf_regs[((&cpu->rob_list[m])->stage).last_saved_urf_reg])->valid=1;
-				
-				if(strcmp(((&cpu->rob_list[m])->stage).opcode,"LOAD")!=0)
-				{
-					(&cpu->rat[16])->urf_reg=((&cpu->rob_list[m])->stage).last_saved_urf_reg;
-					(&cpu->rat[16])->allocated=((&cpu->rob_list[m])->stage).last_saved_urf_allocated;
-					(&cpu->rat[16])->branch_available=0;
-				}
-				
-				//if(!isHalt)
-				//	(&cpu->urf_regs[((&cpu->rob_list[m])->stage).urf_dest_reg])->isFree=1;
-			
-				int present=checkInRat(cpu,((&cpu->rob_list[m])->stage).urf_dest_reg);
-				if(!present)
-					(&cpu->urf_regs[((&cpu->rob_list[m])->stage).urf_dest_reg])->isFree=1;
-				
-				(&cpu->urf_regs[((&cpu->rob_list[m])->stage).urf_dest_reg])->valid=1;
-				
-				
-			}
-			
-			robTail--;
-		}
-	}
-	
-	
-	/// new code added
-	if(!flushDone)
-	{
-		if(robTail<robHead)
-		{
-			for(int m=robTail;m!=robHead;)
-			{
-				
-				if(((&cpu->rob_list[m])->stage).cfidIndex>=cfidIndex)
-					
-			{
-			//flushDone=1;
-			(&cpu->rob_list[m])->status=0;
-			
-			if(strcmp(((&cpu->rob_list[m])->stage).opcode,"STORE")!=0 && strcmp(((&cpu->rob_list[m])->stage).opcode,"")!=0 
-			&& strcmp(((&cpu->rob_list[m])->stage).opcode,"JUMP")!=0 && strcmp(((&cpu->rob_list[m])->stage).opcode,"BZ")!=0 
-			&& strcmp(((&cpu->rob_list[m])->stage).opcode,"BNZ")!=0 && strcmp(((&cpu->rob_list[m])->stage).opcode,"HALT")!=0)
-			{
-				(&cpu->rat[((&cpu->rob_list[m])->stage).rd])->urf_reg=((&cpu->rob_list[m])->stage).last_saved_urf_reg;
-				(&cpu->rat[((&cpu->rob_list[m])->stage).rd])->allocated=((&cpu->rob_list[m])->stage).last_saved_urf_allocated;
-				
-				(&cpu->urf_regs[((&cpu->rob_list[m])->stage).last_saved_urf_reg])->isFree=0;
-				//(&cpu->urf_regs[((&cpu->rob_list[m])->stage).last_saved_urf_reg])->valid=1;
-				
-				if(strcmp(((&cpu->rob_list[m])->stage).opcode,"LOAD")!=0)
-				{
-					(&cpu->rat[16])->urf_reg=((&cpu->rob_list[m])->stage).last_saved_urf_reg;
-					(&cpu->rat[16])->allocated=((&cpu->rob_list[m])->stage).last_saved_urf_allocated;
-					(&cpu->rat[16])->branch_available=0;
-				}
-				
-				//if(!isHalt)
-				//	(&cpu->urf_regs[((&cpu->rob_list[m])->stage).urf_dest_reg])->isFree=1;
-			
-				int present=checkInRat(cpu,((&cpu->rob_list[m])->stage).urf_dest_reg);
-				if(!present)
-					(&cpu->urf_regs[((&cpu->rob_list[m])->stage).urf_dest_reg])->isFree=1;
-				
-				(&cpu->urf_regs[((&cpu->rob_list[m])->stage).urf_dest_reg])->valid=1;
-				
-				
-			}
-			
-			if(robTail==0)
-				robTail=31;
-			else
-				robTail--;
-						
-			m=robTail;
-		}
-		else
-			break;
-		
-			}
-		}
-	}
-	
-	//
-	//if(crossOver==1)
-	//{
-		if((robHead-robTail)==1)
-			crossOver=2;
-	//}
-	
-	
-	// new code:  to reset the cfid index when all instruction after a taken branch are flushed
-	if(!isHalt)
-		cfidTail=cfidIndex;
-	
-	
-	// handle renamed registers in previous decode stage
-	if(strcmp((&cpu->stage[IQ])->opcode,"STORE")!=0 && strcmp((&cpu->stage[IQ])->opcode,"")!=0 
-			&& strcmp((&cpu->stage[IQ])->opcode,"JUMP")!=0 && strcmp((&cpu->stage[IQ])->opcode,"BZ")!=0 
-			&& strcmp((&cpu->stage[IQ])->opcode,"BNZ")!=0 && strcmp((&cpu->stage[IQ])->opcode,"HALT")!=0)
-			{
-				
-				(&cpu->rat[(&cpu->stage[IQ])->rd])->urf_reg=(&cpu->stage[IQ])->last_saved_urf_reg;
-				(&cpu->rat[(&cpu->stage[IQ])->rd])->allocated=(&cpu->stage[IQ])->last_saved_urf_allocated;
-				
-				(&cpu->urf_regs[(&cpu->stage[IQ])->last_saved_urf_reg])->isFree=0;
-				//(&cpu->urf_regs[(&cpu->stage[IQ])->last_saved_urf_reg])->valid=1;
-				
-				if(strcmp((&cpu->stage[IQ])->opcode,"LOAD")!=0)
-				{
-					(&cpu->rat[16])->urf_reg=(&cpu->stage[IQ])->last_saved_urf_reg;
-					(&cpu->rat[16])->allocated=(&cpu->stage[IQ])->last_saved_urf_allocated;
-					(&cpu->rat[16])->branch_available=0;
-				}
-				
-				//if(!isHalt)
-				//	(&cpu->urf_regs[(&cpu->stage[IQ])->urf_dest_reg])->isFree=1;
-				
-				int present=checkInRat(cpu,(&cpu->stage[IQ])->urf_dest_reg);
-				if(!present)
-					(&cpu->urf_regs[(&cpu->stage[IQ])->urf_dest_reg])->isFree=1;
-				
-				(&cpu->urf_regs[(&cpu->stage[IQ])->urf_dest_reg])->valid=1;
-				
-			}
-	
-	
-	//intFuBusy=0;
-	//mulFuBusy=0;
-	//memFuBusy=0;
-	
-	return 0;
-}
-
-
-int flushInstruction_halt(APEX_CPU* cpu,int cfidIndex,int isHalt)
-{
-		for(int j=0;j<16;j++)
-		{
-				(&cpu->iq_list[j])->allocated=0;
-		}
-	
-	// flush instructions from lsq
-	lsqHead=-1;
-	lsqTail=-1;
-	
-	int flushDone=0;
-	
-	// flush instructions from rob
-	for(int m=robTail;m>=robHead;m--)
-	{
-		
-		//if(m==robHead && strcmp(((&cpu->rob_list[m])->stage)->opcode,"HALT")==0)
-			
-		
-		//if(((&cpu->rob_list[m])->stage).cfidIndex>=cfidIndex)
-		//{
-			flushDone=1;
-			(&cpu->rob_list[m])->status=0;
-			
-			if(strcmp(((&cpu->rob_list[m])->stage).opcode,"STORE")!=0 && strcmp(((&cpu->rob_list[m])->stage).opcode,"")!=0 
-			&& strcmp(((&cpu->rob_list[m])->stage).opcode,"JUMP")!=0 && strcmp(((&cpu->rob_list[m])->stage).opcode,"BZ")!=0 
-			&& strcmp(((&cpu->rob_list[m])->stage).opcode,"BNZ")!=0 && strcmp(((&cpu->rob_list[m])->stage).opcode,"HALT")!=0)
-			{
-				(&cpu->rat[((&cpu->rob_list[m])->stage).rd])->urf_reg=((&cpu->rob_list[m])->stage).last_saved_urf_reg;
-				(&cpu->rat[((&cpu->rob_list[m])->stage).rd])->allocated=((&cpu->rob_list[m])->stage).last_saved_urf_allocated;
-				
-				(&cpu->urf_regs[((&cpu->rob_list[m])->stage).last_saved_urf_reg])->isFree=0;
-				//(&cpu->urf_regs[((&cpu->rob_list[m])->stage).last_saved_urf_reg])->valid=1;
-				
-				if(strcmp(((&cpu->rob_list[m])->stage).opcode,"LOAD")!=0)
-				{
-					(&cpu->rat[16])->urf_reg=((&cpu->rob_list[m])->stage).last_saved_urf_reg;
-					(&cpu->rat[16])->allocated=((&cpu->rob_list[m])->stage).last_saved_urf_allocated;
-					(&cpu->rat[16])->branch_available=0;
-				}
-				
-				//if(!isHalt)
-				//	(&cpu->urf_regs[((&cpu->rob_list[m])->stage).urf_dest_reg])->isFree=1;
-			
-				int present=checkInRat(cpu,((&cpu->rob_list[m])->stage).urf_dest_reg);
-				if(!present)
-					(&cpu->urf_regs[((&cpu->rob_list[m])->stage).urf_dest_reg])->isFree=1;
-				
-				(&cpu->urf_regs[((&cpu->rob_list[m])->stage).urf_dest_reg])->valid=1;
-				
-				
-			}
-			
-			robTail--;
-		//}
-	}
-	
-	
-	/// new code added
-	if(!flushDone)
-	{
-		if(robTail<robHead)
-		{
-			for(int m=robTail;m!=robHead;)
-			{
-				
-				//if(((&cpu->rob_list[m])->stage).cfidIndex>=cfidIndex)
-					
-			//{
-			//flushDone=1;
-			(&cpu->rob_list[m])->status=0;
-			
-			if(strcmp(((&cpu->rob_list[m])->stage).opcode,"STORE")!=0 && strcmp(((&cpu->rob_list[m])->stage).opcode,"")!=0 
-			&& strcmp(((&cpu->rob_list[m])->stage).opcode,"JUMP")!=0 && strcmp(((&cpu->rob_list[m])->stage).opcode,"BZ")!=0 
-			&& strcmp(((&cpu->rob_list[m])->stage).opcode,"BNZ")!=0 && strcmp(((&cpu->rob_list[m])->stage).opcode,"HALT")!=0)
-			{
-				(&cpu->rat[((&cpu->rob_list[m])->stage).rd])->urf_reg=((&cpu->rob_list[m])->stage).last_saved_urf_reg;
-				(&cpu->rat[((&cpu->rob_list[m])->stage).rd])->allocated=((&cpu->rob_list[m])->stage).last_saved_urf_allocated;
-				
-				(&cpu->urf_regs[((&cpu->rob_list[m])->stage).last_saved_urf_reg])->isFree=0;
-				//(&cpu->urf_regs[((&cpu->rob_list[m])->stage).last_saved_urf_reg])->valid=1;
-				
-				if(strcmp(((&cpu->rob_list[m])->stage).opcode,"LOAD")!=0)
-				{
-					(&cpu->rat[16])->urf_reg=((&cpu->rob_list[m])->stage).last_saved_urf_reg;
-					(&cpu->rat[16])->allocated=((&cpu->rob_list[m])->stage).last_saved_urf_allocated;
-					(&cpu->rat[16])->branch_available=0;
-				}
-				
-				//if(!isHalt)
-				//	(&cpu->urf_regs[((&cpu->rob_list[m])->stage).urf_dest_reg])->isFree=1;
-			
-				int present=checkInRat(cpu,((&cpu->rob_list[m])->stage).urf_dest_reg);
-				if(!present)
-					(&cpu->urf_regs[((&cpu->rob_list[m])->stage).urf_dest_reg])->isFree=1;
-				
-				(&cpu->urf_regs[((&cpu->rob_list[m])->stage).urf_dest_reg])->valid=1;
-				
-				
-			}
-			
-			if(robTail==0)
-				robTail=31;
-			else
-				robTail--;
-						
-			m=robTail;
-		//}
-		
-			}
-		}
-	}
-	
-	//
-	//if(crossOver==1)
-	//{
-		if((robHead-robTail)==1)
-			crossOver=2;
-	//}
-	
-	
-	
-	// handle renamed registers in previous decode stage
-	if(strcmp((&cpu->stage[IQ])->opcode,"STORE")!=0 && strcmp((&cpu->stage[IQ])->opcode,"")!=0 
-			&& strcmp((&cpu->stage[IQ])->opcode,"JUMP")!=0 && strcmp((&cpu->stage[IQ])->opcode,"BZ")!=0 
-			&& strcmp((&cpu->stage[IQ])->opcode,"BNZ")!=0 && strcmp((&cpu->stage[IQ])->opcode,"HALT")!=0)
-			{
-				
-				(&cpu->rat[(&cpu->stage[IQ])->rd])->urf_reg=(&cpu->stage[IQ])->last_saved_urf_reg;
-				(&cpu->rat[(&cpu->stage[IQ])->rd])->allocated=(&cpu->stage[IQ])->last_saved_urf_allocated;
-				
-				(&cpu->urf_regs[(&cpu->stage[IQ])->last_saved_urf_reg])->isFree=0;
-				//(&cpu->urf_regs[(&cpu->stage[IQ])->last_saved_urf_reg])->valid=1;
-				
-				if(strcmp((&cpu->stage[IQ])->opcode,"LOAD")!=0)
-				{
-					(&cpu->rat[16])->urf_reg=(&cpu->stage[IQ])->last_saved_urf_reg;
-					(&cpu->rat[16])->allocated=(&cpu->stage[IQ])->last_saved_urf_allocated;
-					(&cpu->rat[16])->branch_available=0;
-				}
-				
-				//if(!isHalt)
-				//	(&cpu->urf_regs[(&cpu->stage[IQ])->urf_dest_reg])->isFree=1;
-				
-				int present=checkInRat(cpu,(&cpu->stage[IQ])->urf_dest_reg);
-				if(!present)
-					(&cpu->urf_regs[(&cpu->stage[IQ])->urf_dest_reg])->isFree=1;
-				
-				(&cpu->urf_regs[(&cpu->stage[IQ])->urf_dest_reg])->valid=1;
-				
-			}
-	
-	
-	//intFuBusy=0;
-	//mulFuBusy=0;
-	//memFuBusy=0;
-	
-	return 0;
-}
-
-int checkInRat(APEX_CPU* cpu,int urf_dest_reg)
-{
-	int alreadyPresent=0;
-	for(int i=0;i<16;i++)
-	{
-		if((&cpu->rat[i])->urf_reg==urf_dest_reg)
-		{
-			alreadyPresent=1;
-			break;
-		}
-		
-	}
-	
-	return alreadyPresent;
-}
-int
-APEX_cpu_run(APEX_CPU* cpu)
-{
-	
-	while (cpu->clock<inputClockCycles && (!haltAtRobHead || memFuBusy)) {
-		if (ENABLE_DEBUG_MESSAGES) {
-      printf("\n--------------------------------\n");
-      printf("Clock Cycle #: %d\n", cpu->clock+1);
-      printf("--------------------------------\n");
-    }
-	
-	//commitToRrat(cpu);
-	//instAtRobHead(cpu);
-	
-	if(ctrlOccur && bTaken)
-	{
-		bTaken=0;
-		ctrlOccur=0;
-		flushInstruction(cpu,(&cpu->stage[IQ])->cfidIndex,0);
-		cpu->old_pc=0;
-		CPU_Stage dummyStage;
-		dummyStage.stalled=1;
-		cpu->stage[DRF]=dummyStage;
-		cpu->stage[IQ]=dummyStage;
-	}
-	
-	commitToRrat(cpu);
-	instAtRobHead(cpu);
-	
-	memFuncUnit(cpu);
-	intFuncUnit(cpu);
-	mulFuncUnit(cpu);
-
-	
-	iqStage(cpu);
-	
-	FwdToIssueQueue(cpu);
-	FwdToLSQ(cpu);
-	
-	decode(cpu);
-	fetch(cpu);	
-	
-	if (ENABLE_DEBUG_MESSAGES) {
-		printIQ(cpu);
-		printRat(cpu);
-		printrRat(cpu);
-		printLsq(cpu);
-		printRob(cpu);
-		printRetiredInstruction(cpu);
-	}
-	
-	//if(strcmp((&cpu->stage[EX])->opcode,"HALT")==0 && !bTaken)
-	//{
-	//	(&cpu->stage[DRF])->stalled=1;		
-	//	(&cpu->stage[F])->stalled=1;
-	//}
-    cpu->clock++;
-	
-	}
-
-  return 0;
-}
-
-int APEX_cpu_start(const char* filename,const char* operation,const char* cycles)
-{
-	APEX_CPU* cpu;
-	
-	if(strstr(operation, "initialize") != NULL)
-	{
-		 cpu=APEX_cpu_init(filename);
-		 
-		 if (!cpu) {
-			fprintf(stderr, "APEX_Error : Unable to initialize CPU\n");
-			exit(1);
-		}
-	}
-	if(strstr(operation, "display") != NULL)
-	{
-		ENABLE_DEBUG_MESSAGES=1;
-		
-		cpu=APEX_cpu_init(filename);
-		if (!cpu) {
-				fprintf(stderr, "APEX_Error : Unable to initialize CPU\n");
-				exit(1);
-			}
-		
-		inputClockCycles=atoi(cycles);	
-		APEX_cpu_run(cpu);
-		printRegs(cpu);
-		printMemData(cpu);
-	}
-	if (strstr(operation, "simulate") != NULL) 
-	{
-		ENABLE_DEBUG_MESSAGES=0;
-			cpu=APEX_cpu_init(filename);
-			
-			if (!cpu) {
-				fprintf(stderr, "APEX_Error : Unable to initialize CPU\n");
-				exit(1);
-			}
-		
-		inputClockCycles=atoi(cycles);
-		APEX_cpu_run(cpu);
-		printRegs(cpu);
-		printMemData(cpu);
-	}
-	
-	return 0;
-    
-}
-
-int printRegs(APEX_CPU* cpu)
-{
-	printf("\n========== STATE OF ARCHITECTURAL REGISTER FILE ==========\n");
-	for(int i=0;i<40;i++)
-	{
-		if(!(cpu->urf_regs[i]).isFree)
-			printf("|    URF[%d]\t|\tValue=%-9d|    Status=%-9s|\n",i,(cpu->urf_regs[i]).value,((cpu->urf_regs[i]).valid?"VALID":"INVALID"));
-	}
-	
-	return 0;
-}
-
-int printMemData(APEX_CPU* cpu)
-{
-	printf("\n========== STATE OF DATA MEMORY ==========\n");
-	for(int i=0;i<100;i++)
-	{
-		printf("|    MEM[%d]\t|\tData Value=%d\t|\n",i,cpu->data_memory[i]);
-	}
-	
-	return 0;
-}
-
-int checkFReg(APEX_CPU* cpu,int stageRd)
-{
-	for(int i=0;i<3;i++)
-	{
-		if((&cpu->fBus[i])->rs==stageRd)
-			return i;
-	}
-	return -1;
-}
-
-int printIQ(APEX_CPU* cpu)
-{
-	printf("\n========== Details of IQ (Issue Queue) State ==========\n");
-	
-	for(int i=0;i<16;i++)
-	{
-		if((&cpu->iq_list[i])->allocated)
-		{
-			char name[10];
-			sprintf(name,"IQ[%d]",i);
-			print_stage_content(name,(&(&cpu->iq_list[i])->stage),cpu);
-		}
-	}
-	
-	printf("\n=====================================================\n");
-	
-	return 0;
-}
-
-int printRat(APEX_CPU* cpu)
-{
-	printf("\n========== Details of RENAME TABLE (RAT) State ==========\n");
-	for(int i=0;i<16;i++)
-	{
-		if((&cpu->rat[i])->allocated)
-			printf("|    RAT[%d]\t-->\tU%d\t|\n",i,(&cpu->rat[i])->urf_reg);
-	}
-	
-	
-	printf("\n=====================================================\n");
-	return 0;
-}
-
-
-int printrRat(APEX_CPU* cpu)
-{
-	printf("\n========== Details of RENAME TABLE (R-RAT) State ==========\n");
-	for(int i=0;i<16;i++)
-	{
-		if((&cpu->rRat[i])->allocated)
-			printf("|    R-RAT[%d]\t-->\tU%d\t|\n",i,(&cpu->rRat[i])->urf_reg);
-	}
-	
-	
-	printf("\n=====================================================\n");
-	return 0;
-}
-
-
-int printRob(APEX_CPU* cpu)
-{
-	printf("\n========== Details of ROB (Reorder Buffer) State ==========\n");
-	
-	
-	if(robHead<=robTail)
-	{
-		for(int i=robHead;i<=robTail;i++)
-		{
-			if(i!=-1)
-			{
-				char name[10];
-				sprintf(name,"ROB[%d]",i);
-				print_stage_content(name,(&(&cpu->rob_list[i])->stage),cpu);
-			}
-		}
-	}
-	else
-	{
-		if(crossOver==2)
-		{
-			if((robHead-robTail)==1)
-				crossOver=2;
-			else
-				crossOver=0;
-			printf("\n=====================================================\n");
-			return 0;
-		}
-			
-		int i=robHead;
-		for(;i<=31;i++)
-		{
-				char name[10];
-				sprintf(name,"ROB[%d]",i);
-				print_stage_content(name,(&(&cpu->rob_list[i])->stage),cpu);
-		}
-		
-		i--;
-		if(i==31)
-			i=0;
-		for(;i<=robTail;i++)
-		{
-				char name[10];
-				sprintf(name,"ROB[%d]",i);
-				print_stage_content(name,(&(&cpu->rob_list[i])->stage),cpu);
-		}
-	}
-	
-	
-	printf("\n=====================================================\n");
-	
-	return 0;
-}
-
-int printLsq(APEX_CPU* cpu)
-{
-	printf("\n========== Details of LSQ (Load-Store Queue) State ==========\n");
-	for(int i=0;i<20;i++)
-	{
-		if((&cpu->lsq_list[i])->allocated)
-		{
-			char name[10];
-			sprintf(name,"LSQ[%d]",i);
-			print_stage_content(name,(&(&cpu->lsq_list[i])->stage),cpu);
-		}
-	}
-	
-	printf("\n=====================================================\n");
-	
-	return 0;
-}
-
-int printRetiredInstruction(APEX_CPU* cpu)
-{
-	printf("\n========== Details of ROB Retired Instructions ==========\n");
-	print_stage_content("",&tempRobStage,cpu);
-	print_stage_content("",&tempRobStage_1,cpu);
-	printf("\n=====================================================\n");
-	
-	return 0;
+/*
+ *  cpu.c
+ *  Contains APEX cpu pipeline implementation
+ *
+ *  Author :
+ *  Bhargavi Hanumant Alandikar (balandi1@binghamton.edu)
+ *  State University of New York, Binghamton
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cpu.h"
+
+/* Set this flag to 1 to enable debug messages, read through DEBUG_MESSAGES */
+int ENABLE_DEBUG_MESSAGES=0;
+
+long long inputClockCycles=0;
+
+/* display mode prints cycles displayFrom to displayTo, 0 for no bound */
+int displayMode=0;
+long long displayFrom=0;
+long long displayTo=0;
+int displayPc=0;		// window opens no earlier than the first fetch of this PC
+int displayTriggered=0;
+int lsqOooLoads=1;
+int resultBuses=RESULT_BUSES;
+int benchOutput=0;
+
+/*
+ * Resets the state of one hardware thread, it starts at PC 4000 with
+ * nothing renamed
+ */
+static void
+initThread(CPU_Thread* thread,int id)
+{
+  thread->id = id;
+  thread->pc = 4000;
+  thread->robHead = -1;
+  thread->robTail = -1;
+  thread->cfidHead = -1;
+  thread->cfidTail = -1;
+  thread->branchRobIndex = -1;
+  
+  /* Make all stages busy except Fetch stage, initally to start the pipeline */
+  for (int i = 1; i < NUM_STAGES; ++i) {
+    thread->stage[i].busy = 1;
+  }
+  
+  for (int i = 0; i < ARCH_REGS; i++) {
+    thread->rat[i].urf_reg = 100;
+  }
+}
+
+/*
+ * This function creates and initializes APEX cpu.
+ */
+APEX_CPU*
+APEX_cpu_init(const char* filename)
+{
+  int size;
+
+  if (!filename) {
+    return NULL;
+  }
+
+  /* Parse input file and create code memory */
+  APEX_Instruction* code_memory = create_code_memory(filename, &size);
+  if (!code_memory) {
+    return NULL;
+  }
+
+  return APEX_cpu_init_code(code_memory, size, filename, stdout, stderr);
+}
+
+/*
+ * Creates an APEX cpu running code_memory, which the cpu owns from here
+ * on. filename is the program of the other hardware threads that do not
+ * get their own. The cpu prints its output to out and its errors to err.
+ */
+APEX_CPU*
+APEX_cpu_init_code(APEX_Instruction* code_memory, int size, const char* filename,
+                   FILE* out, FILE* err)
+{
+  APEX_CPU* cpu = malloc(sizeof(*cpu));
+  if (!cpu) {
+    free(code_memory);
+    return NULL;
+  }
+
+  /* Initialize PC, Registers and all pipeline stages */
+  memset(cpu, 0, sizeof(*cpu));
+  cpu->out = out;
+  cpu->err = err;
+  for (int i = 0; i < SMT_MAX_THREADS; i++) {
+    initThread(&cpu->threads[i], i);
+  }
+  cpu->thread = &cpu->threads[0];
+  cpu->threadCount = 1;
+  cpu->robPartition = ROB_SIZE;
+  cpu->lsqHead = -1;
+  cpu->lsqTail = -1;
+  memset(cpu->data_memory, 0, sizeof(int) * 4000);
+  memset(cpu->urf_regs,0,sizeof(CPU_Register) * URF_SIZE);
+  memset(cpu->lsq_list,0,sizeof(CPU_LSQ) * LSQ_SIZE);
+  memset(cpu->iq_list,0,sizeof(CPU_IQ) * IQ_SIZE);
+  
+  /* No result is on the forward bus yet, U0 must not match an empty slot */
+  for (int i = 0; i < FWD_BUS_SIZE; i++) {
+    cpu->fBus[i].rs = -1;
+  }
+  
+  if (icacheInit(cpu) < 0 || dcacheInit(cpu) < 0 || prefetchInit(cpu) < 0
+      || stageTimingInit(cpu) < 0 || probeInit(cpu) < 0 || intervalInit(cpu) < 0
+      || fastForwardInit(cpu) < 0 || commitLogInit(cpu) < 0) {
+    free(code_memory);
+    free(cpu);
+    return NULL;
+  }
+  
+  cpu->thread->code_memory = code_memory;
+  cpu->thread->code_memory_size = size;
+
+  if (DEBUG_MESSAGES) {
+    fprintf(cpu->err,
+            "APEX_CPU : Initialized APEX CPU, loaded %d instructions\n",
+            cpu->thread->code_memory_size);
+    fprintf(cpu->err, "APEX_CPU : Printing Code Memory\n");
+    fprintf(cpu->out, "%-9s %-9s %-9s %-9s %-9s\n", "opcode", "rd", "rs1", "rs2", "imm");
+
+    for (int i = 0; i < cpu->thread->code_memory_size; ++i) {
+      fprintf(cpu->out, "%-9s %-9d %-9d %-9d %-9d\n",
+              cpu->thread->code_memory[i].opcode,
+              cpu->thread->code_memory[i].rd,
+              cpu->thread->code_memory[i].rs1,
+              cpu->thread->code_memory[i].rs2,
+              cpu->thread->code_memory[i].imm);
+    }
+  }
+  
+  /* The other hardware threads load their own programs, a trace checks it was taken from this one */
+  if (smtInit(cpu, filename) < 0 || insnTraceInit(cpu) < 0 || stateDigestInit(cpu) < 0) {
+    APEX_cpu_stop(cpu);
+    return NULL;
+  }
+  
+  for (int i = 0; i < URF_SIZE; i++) {
+    cpu->urf_regs[i].isFree = 1;
+	cpu->urf_regs[i].valid=1;
+  }
+  
+  cpu->data_memory[37]=0;
+  return cpu;
+}
+
+/*
+ * This function de-allocates APEX cpu.
+ */
+void
+APEX_cpu_stop(APEX_CPU* cpu)
+{
+  probeFinish(cpu);
+  intervalFinish(cpu);
+  fastForwardFinish(cpu);
+  insnTraceFinish(cpu);
+  commitLogFinish(cpu);
+  stateDigestFinish(cpu);
+  stageTimingFinish(cpu);
+  for (int i = 0; i < cpu->threadCount; i++) {
+    free(cpu->threads[i].code_memory);
+  }
+  free(cpu);
+}
+
+/* Converts the PC(4000 series) into
+ * array index for code memory
+ */
+int
+get_code_index(int pc)
+{
+  return (pc - 4000) / 4;
+}
+
+static void
+print_instruction(CPU_Stage* stage,APEX_CPU* cpu)
+{
+  if (strcmp(stage->opcode, "STORE") == 0) {
+    fprintf(cpu->out,
+      "%s,R%d,R%d,#%d ", stage->opcode, stage->rs1, stage->rs2, stage->imm);
+	  fprintf(cpu->out,"\t[%s,U%d,U%d,#%d] ", stage->opcode,stage->urf_rs1_reg,stage->urf_rs2_reg,stage->imm);
+  }
+
+  if (strcmp(stage->opcode, "LOAD") == 0) {
+    fprintf(cpu->out,
+      "%s,R%d,R%d,#%d ", stage->opcode, stage->rd, stage->rs1, stage->imm);
+	   fprintf(cpu->out,"\t[%s,U%d,U%d,#%d] ",stage->opcode,stage->urf_dest_reg,stage->urf_rs1_reg,stage->imm);
+  }
+  
+  if (strcmp(stage->opcode, "ADDL") == 0 || strcmp(stage->opcode, "SUBL") == 0) {
+    fprintf(cpu->out,
+      "%s,R%d,R%d,#%d ", stage->opcode, stage->rd, stage->rs1, stage->imm);
+	   fprintf(cpu->out,"\t[%s,U%d,U%d,#%d] ",stage->opcode,stage->urf_dest_reg,stage->urf_rs1_reg,stage->imm);
+  }
+  
+  if (strcmp(stage->opcode, "MOVC") == 0) {
+    fprintf(cpu->out,"%s,R%d,#%d ", stage->opcode, stage->rd, stage->imm);
+	fprintf(cpu->out,"\t[%s,U%d,#%d] ", stage->opcode, stage->urf_dest_reg, stage->imm);
+  }
+  if (strcmp(stage->opcode, "ADD") == 0 || strcmp(stage->opcode, "SUB") == 0
+      || strcmp(stage->opcode, "MUL") == 0 || strcmp(stage->opcode, "AND") == 0
+	  || strcmp(stage->opcode, "OR") == 0 || strcmp(stage->opcode, "EX-OR") == 0) {
+    fprintf(cpu->out,"%s,R%d,R%d,R%d ", stage->opcode, stage->rd, stage->rs1, stage->rs2);
+	fprintf(cpu->out,"\t[%s,U%d,U%d,U%d] ", stage->opcode, stage->urf_dest_reg, stage->urf_rs1_reg,stage->urf_rs2_reg);
+  }
+  if (strcmp(stage->opcode, "BZ") == 0 || strcmp(stage->opcode, "BNZ") == 0) {
+    fprintf(cpu->out,"%s,#%d ", stage->opcode, stage->imm);
+	fprintf(cpu->out,"\t[%s,#%d] ",stage->opcode,stage->imm);
+  }
+  if (strcmp(stage->opcode, "JUMP") == 0) {
+    fprintf(cpu->out,"%s,R%d,#%d ", stage->opcode, stage->rs1, stage->imm);
+	fprintf(cpu->out,"\t[%s,U%d,#%d] ",stage->opcode,stage->urf_rs1_reg,stage->imm);
+  }
+  
+  if (strcmp(stage->opcode, "JAL") == 0) {
+    fprintf(cpu->out,"%s,R%d,R%d,#%d ", stage->opcode, stage->rd ,stage->rs1, stage->imm);
+	fprintf(cpu->out,"\t[%s,U%d,U%d,#%d] ",stage->opcode,stage->urf_dest_reg,stage->urf_rs1_reg,stage->imm);
+  }
+  
+  if (strcmp(stage->opcode, "HALT") == 0) {
+    fprintf(cpu->out,"%s,", stage->opcode);
+  }
+}
+
+
+static void print_fetch(CPU_Stage* stage,APEX_CPU* cpu)
+{
+  if (strcmp(stage->opcode, "STORE") == 0) {
+    fprintf(cpu->out,
+      "%s,R%d,R%d,#%d ", stage->opcode, stage->rs1, stage->rs2, stage->imm);
+  }
+
+  if (strcmp(stage->opcode, "LOAD") == 0) {
+    fprintf(cpu->out,
+      "%s,R%d,R%d,#%d ", stage->opcode, stage->rd, stage->rs1, stage->imm);
+  }
+  
+  if (strcmp(stage->opcode, "ADDL") == 0 || strcmp(stage->opcode, "SUBL") == 0) {
+    fprintf(cpu->out,
+      "%s,R%d,R%d,#%d ", stage->opcode, stage->rd, stage->rs1, stage->imm);
+  }
+  
+  if (strcmp(stage->opcode, "MOVC") == 0) {
+    fprintf(cpu->out,"%s,R%d,#%d ", stage->opcode, stage->rd, stage->imm);
+  }
+  if (strcmp(stage->opcode, "ADD") == 0 || strcmp(stage->opcode, "SUB") == 0
+      || strcmp(stage->opcode, "MUL") == 0 || strcmp(stage->opcode, "AND") == 0
+	  || strcmp(stage->opcode, "OR") == 0 || strcmp(stage->opcode, "EX-OR") == 0) {
+    fprintf(cpu->out,"%s,R%d,R%d,R%d ", stage->opcode, stage->rd, stage->rs1, stage->rs2);
+  }
+  if (strcmp(stage->opcode, "BZ") == 0 || strcmp(stage->opcode, "BNZ") == 0) {
+    fprintf(cpu->out,"%s,#%d ", stage->opcode, stage->imm);
+  }
+  if (strcmp(stage->opcode, "JUMP") == 0) {
+    fprintf(cpu->out,"%s,R%d,#%d ", stage->opcode, stage->rs1, stage->imm);
+  }
+  
+  if (strcmp(stage->opcode, "JAL") == 0) {
+    fprintf(cpu->out,"%s,R%d,R%d,#%d ", stage->opcode, stage->rd ,stage->rs1, stage->imm);
+  }
+  if (strcmp(stage->opcode, "HALT") == 0) {
+    fprintf(cpu->out,"%s,", stage->opcode);
+  }
+}
+/* Debug function which dumps the cpu stage content
+ */
+static void
+print_stage_content(char* name, CPU_Stage* stage,APEX_CPU* cpu)
+{
+	if(!stage->stalled)
+	{
+		if(stage->pc==0)
+			fprintf(cpu->out,"%-15s: ", name);
+		else if(strcmp(name,"")!=0)
+			fprintf(cpu->out,"%-15s: pc(%d) ", name, stage->pc);
+		else
+			fprintf(cpu->out,"pc(%d) ",stage->pc);
+		
+		if(strcmp(name,"Fetch")!=0)
+			print_instruction(stage,cpu);
+		else
+			print_fetch(stage,cpu);
+	}
+	else if(strcmp(name,"")!=0)
+		fprintf(cpu->out,"%-15s: ", name);
+		
+  fprintf(cpu->out,"\n");
+}
+
+/* Sends an empty slot to decode when fetch has no instruction this cycle */
+static void
+fetchBubble(APEX_CPU* cpu)
+{
+  CPU_Stage bubble;
+  memset(&bubble, 0, sizeof(bubble));
+  bubble.stalled = 1;
+  cpu->thread->stage[F].busy = 0;
+  cpu->thread->stage[DRF] = bubble;
+}
+
+/*
+ *  Fetch Stage of APEX Pipeline
+ */
+int
+fetch(APEX_CPU* cpu)
+{
+  CPU_Stage* stage = &cpu->thread->stage[F];
+  
+  /* Decode latch is held while dispatch waits for a free IQ, ROB, LSQ or URF entry */
+  if(cpu->thread->dispatchStall)
+  {
+	  if (DEBUG_MESSAGES) {
+		  fprintf(cpu->out,"%-15s: dispatch stall\n", "Fetch");
+	  }
+	  return 0;
+  }
+  
+  if (!stage->busy && !stage->stalled) { 
+	stage->busy=1;
+    
+	/* Store current PC in fetch latch , handle the old pc value for branch instruction*/
+	int fetchPc = cpu->thread->old_pc > 0 ? cpu->thread->old_pc : cpu->thread->pc;
+	
+	/* Nothing to fetch past the end of code memory, wait for a redirect */
+	if(get_code_index(fetchPc)<0 || get_code_index(fetchPc)>=cpu->thread->code_memory_size)
+	{
+		fetchBubble(cpu);
+		if (DEBUG_MESSAGES) {
+			fprintf(cpu->out,"%-15s: \n", "Fetch");
+		}
+		return 0;
+	}
+	
+	/* I-cache miss, send a bubble to decode until the line arrives */
+	if(icacheEnabled && icacheFetchStall(cpu,fetchPc))
+	{
+		fetchBubble(cpu);
+		if (DEBUG_MESSAGES) {
+			fprintf(cpu->out,"%-15s: I-cache miss pc(%d)\n", "Fetch", fetchPc);
+		}
+		return 0;
+	}
+	/* Replaying a trace, the instruction takes its record unless it is on the wrong path */
+	if(cpu->insnTrace.replaying && !insnTraceFetch(cpu,fetchPc,stage))
+	{
+		fetchBubble(cpu);
+		if (DEBUG_MESSAGES) {
+			fprintf(cpu->out,"%-15s: trace drained\n", "Fetch");
+		}
+		return 0;
+	}
+	stage->pc=fetchPc;
+	stage->thread=cpu->thread->id;
+
+    /* Index into code memory using this pc and copy all instruction fields into
+     * fetch latch
+     */
+    APEX_Instruction* current_ins = &cpu->thread->code_memory[get_code_index(stage->pc)];
+    strcpy(stage->opcode, current_ins->opcode);
+    stage->rd = current_ins->rd;
+    stage->rs1 = current_ins->rs1;
+    stage->rs2 = current_ins->rs2;
+    stage->imm = current_ins->imm;
+    
+	/* Update PC for next instruction, if there is not stalling due to mul instruction in EX stage*/
+	if(cpu->thread->old_pc==0)
+		cpu->thread->pc += 4;
+	stage->busy=0;
+		
+	/* Copy data from fetch latch to decode latch*/
+	cpu->thread->stage[DRF] = cpu->thread->stage[F];
+	
+  }
+  else if(cpu->mulClock==0)
+  {
+	  /* Copy data from fetch latch to decode latch*/
+		cpu->thread->stage[DRF] = cpu->thread->stage[F];
+  }
+
+
+  if (DEBUG_MESSAGES) {
+      print_stage_content("Fetch", stage,cpu);
+    }
+  return 0;
+}
+
+/*
+ *  Decode Stage of APEX Pipeline
+ */
+int
+decode(APEX_CPU* cpu)
+{
+  CPU_Stage* stage = &cpu->thread->stage[DRF];
+  
+  if(cpu->thread->dispatchStall)
+  {
+	  if (DEBUG_MESSAGES) {
+		  fprintf(cpu->out,"%-15s: dispatch stall\n", "Decode");
+	  }
+	  return 0;
+  }
+  
+  /* Pass a front end bubble on, so IQ stage does not dispatch its old latch again */
+  if(stage->stalled && !cpu->thread->haltAtRobHead)
+	  (&cpu->thread->stage[IQ])->stalled=1;
+  
+  if(stage->pc>0)
+  {  
+		if (!stage->busy && !stage->stalled) {
+		
+			if(strcmp(stage->opcode,"")!=0)
+			{
+				stage->busy=1;
+			
+				// read the source values from urf and rename the destination register
+				readRegValue(cpu);
+				int conditionTrue=regRename(cpu);
+				stage->setIq=conditionTrue;
+				
+				// no free URF register, hold the instruction in decode and retry next cycle
+				if(!conditionTrue)
+				{
+					stage->busy=0;
+					(&cpu->thread->stage[IQ])->stalled=1;
+					cpu->thread->dispatchStall=1;
+					cpu->dispatchStalls++;
+					return 0;
+				}
+				
+				stage->cfidIndex=cpu->thread->cfidTail;
+				if (DEBUG_MESSAGES) {
+					fprintf(cpu->out,"cfid assigned=%d\n",stage->cfidIndex);
+				}
+				
+				if(strcmp(stage->opcode,"JUMP")==0 || strcmp(stage->opcode,"JAL")==0 
+				|| strcmp(stage->opcode,"BZ")==0 || strcmp(stage->opcode,"BNZ")==0)
+				{
+					if(cpu->thread->cfidHead==-1 && cpu->thread->cfidTail==-1)
+					{
+						cpu->thread->cfidHead=0;
+						cpu->thread->cfidTail=0;
+					}
+					else if(cpu->thread->cfidTail==CFID_SIZE-1)
+						cpu->thread->cfidTail=0;
+					else
+						cpu->thread->cfidTail++;
+				}
+				
+				stage->busy=0;
+			}
+			cpu->thread->stage[IQ] = cpu->thread->stage[DRF];
+		}
+  }
+	if (DEBUG_MESSAGES) {
+      print_stage_content("Decode", stage,cpu);
+    }
+	return 0;
+}
+
+/*
+ * Checks that the instruction in the IQ latch has an IQ entry, a ROB entry
+ * and, for LOAD and STORE, an LSQ entry. One ROB and one LSQ slot are kept
+ * free so a full queue can not be mistaken for an empty one. With SMT a
+ * thread holds at most its partition of the ROB.
+ */
+int dispatchResourcesFree(APEX_CPU* cpu,CPU_Stage* stage)
+{
+	if(cpu->thread->robHead!=-1 && (cpu->thread->robTail-cpu->thread->robHead+ROB_SIZE+1)%ROB_SIZE>=cpu->robPartition-1)
+		return 0;
+	
+	if(strcmp(stage->opcode,"HALT")==0)
+		return 1;
+	
+	int iqFree=0;
+	for(int i=0;i<IQ_SIZE;i++)
+	{
+		if(!(&cpu->iq_list[i])->allocated)
+		{
+			iqFree=1;
+			break;
+		}
+	}
+	if(!iqFree)
+		return 0;
+	
+	if(strcmp(stage->opcode,"LOAD")==0 || strcmp(stage->opcode,"STORE")==0)
+	{
+		if(cpu->lsqHead!=-1 && (cpu->lsqTail-cpu->lsqHead+LSQ_SIZE+1)%LSQ_SIZE>=LSQ_SIZE-1)
+			return 0;
+	}
+	return 1;
+}
+
+int iqStage(APEX_CPU* cpu)
+{
+	
+	CPU_Stage* stage = &cpu->thread->stage[IQ];
+	 int lsqIndex,iqIndex,robIndex;
+	 
+	cpu->thread->dispatchStall=0;
+	if (stage->stalled) {
+		return 0;
+	}
+	
+	// hold the instruction in this latch and stall the front end until it fits
+	if(!dispatchResourcesFree(cpu,stage))
+	{
+		cpu->thread->dispatchStall=1;
+		cpu->dispatchStalls++;
+		return 0;
+	}
+	refreshSourceValues(cpu,stage);
+	stage->seq=++cpu->dispatchSeq;
+	 if(strcmp(stage->opcode,"HALT")==0)
+	 {
+		robIndex=setRobEntry(cpu);
+
+		(&cpu->thread->rob_list[robIndex])->status=1;
+		PROBE_EVENT(cpu,PROBE_DISPATCH,cpu->thread->id,stage->pc,-1,0);
+		return 0;
+	 }
+	if(stage->setIq)
+	{
+		if(strcmp(stage->opcode,"")==0)
+			return 0;
+		
+		iqIndex=setIQEntry(cpu);
+		if(iqIndex>-1)
+		{
+			robIndex=setRobEntry(cpu);
+			(&cpu->iq_list[iqIndex])->robIndex=robIndex;
+			(&cpu->thread->rob_list[robIndex])->iqIndex=iqIndex;
+			PROBE_EVENT(cpu,PROBE_DISPATCH,cpu->thread->id,stage->pc,-1,0);
+			
+			if(strcmp(stage->opcode,"LOAD")==0 || strcmp(stage->opcode,"STORE")==0)
+			{
+				lsqIndex=setLSQEntry(cpu,iqIndex);
+				(&cpu->lsq_list[lsqIndex])->robIndex=robIndex;
+				(&cpu->iq_list[iqIndex])->lsqIndex=lsqIndex;
+				(&cpu->thread->rob_list[robIndex])->lsqIndex=lsqIndex;
+			}
+		}
+	}
+	
+	return 0;
+}
+
+/* New code */
+int readRegValue(APEX_CPU* cpu)
+{
+	CPU_Stage* decodeStage = &cpu->thread->stage[DRF];
+	
+	int urf_index=(&cpu->thread->rat[decodeStage->rs1])->urf_reg;
+	decodeStage->urf_rs1_reg=urf_index;
+	
+	// an architectural register that was never written reads as zero
+	if(urf_index==100)
+	{
+		decodeStage->rs1_value=0;
+		decodeStage->rs1_value_valid=1;
+	}
+	else if((&cpu->urf_regs[urf_index])->valid)
+	{
+		decodeStage->rs1_value=(&cpu->urf_regs[urf_index])->value;
+		decodeStage->rs1_value_valid=1;
+		decodeStage->urf_rs1_reg=urf_index;
+	}
+	else
+	{
+		
+		CPU_Forward_Bus fwdEntry=readFrmFwdBus(cpu,urf_index);
+		if(fwdEntry.valid>0)
+		{
+			decodeStage->rs1_value=fwdEntry.rs_value;
+			decodeStage->rs1_value_valid=1;
+		}
+		else if(readCompletedRob(cpu,urf_index,&decodeStage->rs1_value))
+			decodeStage->rs1_value_valid=1;
+	}
+	
+	int urf_index_2=(&cpu->thread->rat[decodeStage->rs2])->urf_reg;
+	decodeStage->urf_rs2_reg=urf_index_2;
+	
+	if(urf_index_2==100)
+	{
+		decodeStage->rs2_value=0;
+		decodeStage->rs2_value_valid=1;
+	}
+	else if((&cpu->urf_regs[urf_index_2])->valid)
+	{
+		decodeStage->rs2_value=(&cpu->urf_regs[urf_index_2])->value;
+		decodeStage->rs2_value_valid=1;
+		decodeStage->urf_rs2_reg=urf_index_2;
+	}
+	else
+	{
+		
+		CPU_Forward_Bus fwdEntry=readFrmFwdBus(cpu,urf_index_2);
+		if(fwdEntry.valid>0)
+		{
+			decodeStage->rs2_value=fwdEntry.rs_value;
+			decodeStage->rs2_value_valid=1;
+		}
+		else if(readCompletedRob(cpu,urf_index_2,&decodeStage->rs2_value))
+			decodeStage->rs2_value_valid=1;
+	}
+	
+	if(strcmp(decodeStage->opcode,"MOVC")==0)
+	{
+		decodeStage->rs1_value_valid=1;
+		decodeStage->rs2_value_valid=1;
+	}
+	if(strcmp(decodeStage->opcode,"BZ")==0 || strcmp(decodeStage->opcode,"BNZ")==0)
+	{
+		readZeroFlag(cpu);
+		decodeStage->rs2_value_valid=1;
+	}
+	if(strcmp(decodeStage->opcode,"LOAD")==0 || strcmp(decodeStage->opcode,"ADDL")==0 
+		|| strcmp(decodeStage->opcode,"SUBL")==0 || strcmp(decodeStage->opcode,"JUMP")==0 || strcmp(decodeStage->opcode,"JAL")==0)
+		decodeStage->rs2_value_valid=1;
+	
+	return 0;
+}
+
+/*
+ * BZ and BNZ wait on the latest zero flag producer the same way other
+ * instructions wait on rs1, the flag is captured when it is ready
+ */
+int readZeroFlag(APEX_CPU* cpu)
+{
+	CPU_Stage* decodeStage = &cpu->thread->stage[DRF];
+	
+	int urf_index=(&cpu->thread->rat[RAT_ZERO_FLAG])->urf_reg;
+	decodeStage->urf_rs1_reg=urf_index;
+	decodeStage->rs1_value_valid=0;
+	
+	if(urf_index==100)
+	{
+		decodeStage->zFlag=0;
+		decodeStage->rs1_value_valid=1;
+	}
+	else if((&cpu->urf_regs[urf_index])->valid)
+	{
+		decodeStage->zFlag=(&cpu->urf_regs[urf_index])->zFlag;
+		decodeStage->rs1_value_valid=1;
+	}
+	else
+	{
+		int value;
+		CPU_Forward_Bus fwdEntry=readFrmFwdBus(cpu,urf_index);
+		if(fwdEntry.valid>0)
+		{
+			decodeStage->zFlag=fwdEntry.zFlag;
+			decodeStage->rs1_value_valid=1;
+		}
+		else if(readCompletedRob(cpu,urf_index,&value))
+		{
+			decodeStage->zFlag=value==0;
+			decodeStage->rs1_value_valid=1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * A value that left the forward bus before its consumer looked for it is
+ * still in the ROB until commit. Returns 1 and the value if the live ROB
+ * entry writing urf_reg has completed.
+ */
+int readCompletedRob(APEX_CPU* cpu,int urf_reg,int* value)
+{
+	if(cpu->thread->robHead==-1)
+		return 0;
+	
+	int count=(cpu->thread->robTail-cpu->thread->robHead+ROB_SIZE+1)%ROB_SIZE;
+	for(int i=0,m=cpu->thread->robHead;i<count;i++,m=(m==ROB_SIZE-1 ? 0 : m+1))
+	{
+		CPU_ROB *robEntry=(&cpu->thread->rob_list[m]);
+		if(!robEntry->status || (&robEntry->stage)->urf_dest_reg!=urf_reg)
+			continue;
+		
+		if(strcmp((&robEntry->stage)->opcode,"STORE")!=0 && strcmp((&robEntry->stage)->opcode,"JUMP")!=0 
+		&& strcmp((&robEntry->stage)->opcode,"BZ")!=0 && strcmp((&robEntry->stage)->opcode,"BNZ")!=0 
+		&& strcmp((&robEntry->stage)->opcode,"HALT")!=0)
+		{
+			*value=(&robEntry->stage)->buffer;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Operands of an instruction held in the IQ latch by a dispatch stall may
+ * have been broadcast meanwhile, pick them up before it enters the IQ. A
+ * producer that has also committed since (with SMT the latch can wait for
+ * many cycles) left its value in the URF.
+ */
+int refreshSourceValues(APEX_CPU* cpu,CPU_Stage* stage)
+{
+	int value;
+	
+	if(!stage->rs1_value_valid)
+	{
+		CPU_Forward_Bus fwdEntry=readFrmFwdBus(cpu,stage->urf_rs1_reg);
+		if(fwdEntry.valid>0)
+		{
+			stage->rs1_value=fwdEntry.rs_value;
+			stage->zFlag=fwdEntry.zFlag;
+			stage->rs1_value_valid=1;
+		}
+		else if(readCompletedRob(cpu,stage->urf_rs1_reg,&value))
+		{
+			stage->rs1_value=value;
+			stage->zFlag=value==0;
+			stage->rs1_value_valid=1;
+		}
+		else if((&cpu->urf_regs[stage->urf_rs1_reg])->valid)
+		{
+			stage->rs1_value=(&cpu->urf_regs[stage->urf_rs1_reg])->value;
+			stage->zFlag=(&cpu->urf_regs[stage->urf_rs1_reg])->zFlag;
+			stage->rs1_value_valid=1;
+		}
+	}
+	if(!stage->rs2_value_valid)
+	{
+		CPU_Forward_Bus fwdEntry=readFrmFwdBus(cpu,stage->urf_rs2_reg);
+		if(fwdEntry.valid>0)
+		{
+			stage->rs2_value=fwdEntry.rs_value;
+			stage->rs2_value_valid=1;
+		}
+		else if(readCompletedRob(cpu,stage->urf_rs2_reg,&value))
+		{
+			stage->rs2_value=value;
+			stage->rs2_value_valid=1;
+		}
+		else if((&cpu->urf_regs[stage->urf_rs2_reg])->valid)
+		{
+			stage->rs2_value=(&cpu->urf_regs[stage->urf_rs2_reg])->value;
+			stage->rs2_value_valid=1;
+		}
+	}
+	return 0;
+}
+
+int regRename(APEX_CPU* cpu)
+{
+	int freeRegFound=0;
+	int renamedReg=-1;
+	CPU_Stage* decodeStage=&cpu->thread->stage[DRF];
+	if(strcmp(decodeStage->opcode,"STORE")!=0 && strcmp(decodeStage->opcode,"")!=0 
+	&& strcmp(decodeStage->opcode,"JUMP")!=0 && strcmp(decodeStage->opcode,"BZ")!=0 
+	&& strcmp(decodeStage->opcode,"BNZ")!=0 && strcmp(decodeStage->opcode,"HALT")!=0)
+	{
+		for(int i=0;i<URF_SIZE;i++)
+		{
+		
+			
+			if((&cpu->urf_regs[i])->isFree)
+			{
+				freeRegFound=1;
+				int archDest=decodeStage->rd;
+				decodeStage->last_saved_urf_reg=(&cpu->thread->rat[archDest])->urf_reg;
+				decodeStage->last_saved_urf_allocated=(&cpu->thread->rat[archDest])->allocated;
+				
+				(&cpu->thread->rat[archDest])->urf_reg=i;
+				(&cpu->thread->rat[archDest])->allocated=1;
+				
+				// branches read their flag producer at decode, so later producers may rename the flag
+				decodeStage->flag_renamed=0;
+				if(strcmp(decodeStage->opcode,"LOAD")!=0)
+				{
+					decodeStage->flag_renamed=1;
+					decodeStage->last_saved_flag_reg=(&cpu->thread->rat[RAT_ZERO_FLAG])->urf_reg;
+					(&cpu->thread->rat[RAT_ZERO_FLAG])->urf_reg=i;
+					(&cpu->thread->rat[RAT_ZERO_FLAG])->allocated=1;
+				}
+				
+				
+				(&cpu->urf_regs[i])->isFree=0;
+				
+				// drop a value the last instance of this URF register left on the forward bus
+				for(int j=0;j<resultBuses;j++)
+				{
+					if((&cpu->fBus[j])->rs==i)
+					{
+						(&cpu->fBus[j])->rs=-1;
+						(&cpu->fBus[j])->valid=0;
+					}
+				}
+				
+				decodeStage->urf_dest_reg=i;
+				(&cpu->urf_regs[i])->valid=0;
+				decodeStage->urf_dest_valid=1;
+				renamedReg=i;
+				break;
+			}
+		}
+		
+	}
+	else
+	{
+		if(strcmp(decodeStage->opcode,"BZ")==0  || strcmp(decodeStage->opcode,"BNZ")==0)
+		{
+			(&cpu->thread->rat[RAT_ZERO_FLAG])->branch_available=1;
+		}			
+		freeRegFound=1;
+	}
+	
+	if(freeRegFound)
+		PROBE_EVENT(cpu,PROBE_RENAME,cpu->thread->id,decodeStage->pc,renamedReg,0);
+	return freeRegFound;
+}
+
+int setIQEntry(APEX_CPU* cpu)
+{
+	int iqIndex=-1;
+	CPU_Stage decodeStage=cpu->thread->stage[IQ];
+	for(int i=0;i<IQ_SIZE;i++)
+	{
+		if(!(&cpu->iq_list[i])->allocated)
+		{
+			(&cpu->iq_list[i])->allocated=1;
+			(&cpu->iq_list[i])->clockCycle=cpu->clock;
+		
+			
+			(&cpu->iq_list[i])->stage=decodeStage;
+			(&cpu->iq_list[i])->fuType=getfuType(&decodeStage);
+			
+			
+		
+			(&cpu->iq_list[i])->src1_valid=(&decodeStage)->rs1_value_valid;
+			(&cpu->iq_list[i])->src2_valid=(&decodeStage)->rs2_value_valid;
+			iqIndex=i;
+			
+			
+			// set lsq and rob index when implemented
+			break;
+		}
+	}
+	
+	return iqIndex;
+}
+
+int FwdToIssueQueue(APEX_CPU* cpu)
+{
+	for(int i=0;i<IQ_SIZE;i++)
+	{
+		if((&cpu->iq_list[i])->allocated)
+		{
+			if(!((&cpu->iq_list[i])->stage.rs1_value_valid))
+			{
+				CPU_Forward_Bus fwdEntry=readFrmFwdBus(cpu,(&cpu->iq_list[i])->stage.urf_rs1_reg);
+				if(fwdEntry.valid>0)
+				{
+					(&cpu->iq_list[i])->stage.rs1_value=fwdEntry.rs_value;
+					(&cpu->iq_list[i])->stage.zFlag=fwdEntry.zFlag;
+					(&cpu->iq_list[i])->stage.rs1_value_valid=1;
+					(&cpu->iq_list[i])->src1_valid=1;
+				}
+			}
+			
+			if(!((&cpu->iq_list[i])->stage.rs2_value_valid))
+			{
+				CPU_Forward_Bus fwdEntry_2=readFrmFwdBus(cpu,(&cpu->iq_list[i])->stage.urf_rs2_reg);
+				if(fwdEntry_2.valid>0)
+				{
+					(&cpu->iq_list[i])->stage.rs2_value=fwdEntry_2.rs_value;
+					(&cpu->iq_list[i])->stage.rs2_value_valid=1;
+					(&cpu->iq_list[i])->src2_valid=1;
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+int FwdToLSQ(APEX_CPU* cpu)
+{
+	for(int i=0;i<LSQ_SIZE;i++)
+	{
+		if((&cpu->lsq_list[i])->allocated)
+		{
+			if(!((&cpu->lsq_list[i])->stage.rs1_value_valid))
+			{
+				CPU_Forward_Bus fwdEntry=readFrmFwdBus(cpu,(&cpu->lsq_list[i])->stage.urf_rs1_reg);
+				if(fwdEntry.valid>0)
+				{
+					(&cpu->lsq_list[i])->stage.rs1_value=fwdEntry.rs_value;
+					(&cpu->lsq_list[i])->stage.rs1_value_valid=1;
+					(&cpu->lsq_list[i])->src1_valid=1;
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+int setLSQEntry(APEX_CPU* cpu,int iqIndex)
+{
+	int lsqIndex=-1;
+	
+	if(cpu->lsqHead==-1) 
+	{
+		cpu->lsqHead=0;
+	}
+	
+	if(cpu->lsqTail==-1)
+	{
+		cpu->lsqTail=0;
+	}
+	else if(cpu->lsqTail==LSQ_SIZE-1)
+		cpu->lsqTail=0;
+	else
+		cpu->lsqTail++;
+	
+	
+	
+	CPU_Stage decodeStage=cpu->thread->stage[IQ];
+	//for(int i=0;i<20;i++)
+	//{
+		
+		if(!(&cpu->lsq_list[cpu->lsqTail])->allocated)
+		{
+			lsqIndex=cpu->lsqTail;
+			(&cpu->lsq_list[cpu->lsqTail])->allocated=1;
+			(&cpu->lsq_list[cpu->lsqTail])->stage=decodeStage;
+			(&cpu->lsq_list[cpu->lsqTail])->iqIndex=iqIndex;
+			(&cpu->lsq_list[cpu->lsqTail])->address_valid=0;
+			
+			(&cpu->lsq_list[cpu->lsqTail])->src1_valid=(&decodeStage)->rs1_value_valid;
+			//(&cpu->lsq_list[lsqTail])->src2_valid=(&decodeStage)->rs2_value_valid;
+			//lsqTail++;
+		}
+	//}
+	
+	return lsqIndex;
+}
+
+
+int setRobEntry(APEX_CPU* cpu)
+{
+	CPU_Stage decodeStage=cpu->thread->stage[IQ];
+	if(cpu->thread->robHead==-1)
+		cpu->thread->robHead=0;
+	if(cpu->thread->robTail==-1)
+		cpu->thread->robTail=0;
+	else if(cpu->thread->robTail==ROB_SIZE-1)
+		cpu->thread->robTail=0;
+	else
+		cpu->thread->robTail++;
+	
+	(&cpu->thread->rob_list[cpu->thread->robTail])->stage=decodeStage;
+	(&cpu->thread->rob_list[cpu->thread->robTail])->status=0;
+	
+	return cpu->thread->robTail;
+			
+}
+
+int getfuType(CPU_Stage* decodeStage)
+{
+	if(strcmp(decodeStage->opcode,"MUL")!=0)
+	{
+		return FU_INT;
+	}
+	else
+		return FU_MUL;
+}
+
+/* Whether an instruction of the integer unit puts a result on the forward bus */
+static int writesResult(CPU_Stage* stage)
+{
+	return strcmp(stage->opcode,"LOAD")!=0 && strcmp(stage->opcode,"STORE")!=0 && strcmp(stage->opcode,"JUMP")!=0
+		&& strcmp(stage->opcode,"BZ")!=0 && strcmp(stage->opcode,"BNZ")!=0;
+}
+
+int intFuncUnit(APEX_CPU* cpu)
+{
+	int entrySelected=0;
+	CPU_IQ *iqSelectedEntry;
+	CPU_ROB *robSelectedEntry;
+	CPU_Stage idleStage;
+	CPU_Stage* dummyStage=&idleStage;
+	dummyStage->stalled=1;
+	CPU_LSQ *lsqEntry;
+	if(!cpu->intFuBusy)
+	{
+		iqSelectedEntry=selectIQEntry(cpu,FU_INT);
+		
+		// without a result bus this cycle the instruction stays in the IQ
+		if(iqSelectedEntry && !cpu->busGrant[BUS_INT] && writesResult(&iqSelectedEntry->stage))
+			iqSelectedEntry=NULL;
+		if(iqSelectedEntry)
+		{
+			entrySelected=1;
+			cpu->thread=&cpu->threads[(&iqSelectedEntry->stage)->thread];
+			robSelectedEntry=(&cpu->thread->rob_list[iqSelectedEntry->robIndex]);
+			lsqEntry=(&cpu->lsq_list[iqSelectedEntry->lsqIndex]);
+		}
+
+		// perform the operation for the selected issue queue entry
+		if(entrySelected)
+		{
+			PROBE_EVENT(cpu,PROBE_ISSUE,cpu->thread->id,(&iqSelectedEntry->stage)->pc,-1,0);
+			INSN_TRACE_RESOLVE(&iqSelectedEntry->stage);
+			cpu->intFuBusy=1;
+			if (strcmp((&iqSelectedEntry->stage)->opcode, "ADD") == 0) {
+				(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->rs1_value + (&iqSelectedEntry->stage)->rs2_value;
+			}
+			else if (strcmp((&iqSelectedEntry->stage)->opcode, "ADDL") == 0) {
+				
+				(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->rs1_value+(&iqSelectedEntry->stage)->imm;
+			}
+			else if (strcmp((&iqSelectedEntry->stage)->opcode, "SUB") == 0) {
+				
+				(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->rs1_value - (&iqSelectedEntry->stage)->rs2_value;
+			}
+			else if (strcmp((&iqSelectedEntry->stage)->opcode, "SUBL") == 0) {
+				
+				(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->rs1_value - (&iqSelectedEntry->stage)->imm;
+			}
+			else if (strcmp((&iqSelectedEntry->stage)->opcode, "EX-OR") == 0) {
+				
+				(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->rs1_value ^ (&iqSelectedEntry->stage)->rs2_value;
+			}
+			else if (strcmp((&iqSelectedEntry->stage)->opcode, "OR") == 0) {
+				
+				(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->rs1_value | (&iqSelectedEntry->stage)->rs2_value;
+			}
+			else if (strcmp((&iqSelectedEntry->stage)->opcode, "AND") == 0) {
+				
+				(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->rs1_value & (&iqSelectedEntry->stage)->rs2_value;
+			}
+			else if (strcmp((&iqSelectedEntry->stage)->opcode, "LOAD") == 0) {
+				
+				(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->rs1_value + (&iqSelectedEntry->stage)->imm;
+				(&iqSelectedEntry->stage)->mem_address = (&iqSelectedEntry->stage)->buffer;
+				lsqEntry->stage=iqSelectedEntry->stage;
+				lsqEntry->address_valid=1;
+				prefetchObserveLoad(cpu,(&iqSelectedEntry->stage)->pc,(&iqSelectedEntry->stage)->buffer);
+				
+			}
+			else if (strcmp((&iqSelectedEntry->stage)->opcode, "STORE") == 0) {
+				
+				(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->rs2_value + (&iqSelectedEntry->stage)->imm;
+				(&iqSelectedEntry->stage)->mem_address = (&iqSelectedEntry->stage)->buffer;
+				lsqEntry->stage=iqSelectedEntry->stage;
+				lsqEntry->address_valid=1;
+				//robSelectedEntry->status=1;
+			}
+			else if (strcmp((&iqSelectedEntry->stage)->opcode, "MOVC") == 0) {
+				
+				(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->imm + 0;
+			}
+			
+			else if (strcmp((&iqSelectedEntry->stage)->opcode, "JUMP") == 0) {
+				
+				(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->rs1_value + (&iqSelectedEntry->stage)->imm;
+				cpu->thread->old_pc=cpu->thread->pc;
+				cpu->thread->pc=(&iqSelectedEntry->stage)->buffer;
+				cpu->thread->bTaken=1;
+				cpu->thread->ctrlOccur=1;
+							
+				
+			}
+			else if (strcmp((&iqSelectedEntry->stage)->opcode, "JAL") == 0) {
+				
+				(&iqSelectedEntry->stage)->mem_address = (&iqSelectedEntry->stage)->rs1_value + (&iqSelectedEntry->stage)->imm;
+				cpu->thread->old_pc=cpu->thread->pc;
+				cpu->thread->pc=(&iqSelectedEntry->stage)->mem_address;
+				(&iqSelectedEntry->stage)->buffer=(&iqSelectedEntry->stage)->pc+4;
+				cpu->thread->bTaken=1;
+				cpu->thread->ctrlOccur=1;
+							
+				
+			}
+			
+			else if (strcmp((&iqSelectedEntry->stage)->opcode, "BZ") == 0) {
+				
+				// zero flag captured from the URF or the forward bus before issue
+				int zFlag=(&iqSelectedEntry->stage)->zFlag;
+				
+				if(zFlag)
+				{
+					(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->pc + (&iqSelectedEntry->stage)->imm;
+					cpu->thread->old_pc=cpu->thread->pc;
+					cpu->thread->pc=(&iqSelectedEntry->stage)->buffer;
+					cpu->thread->bTaken=1;
+					cpu->thread->ctrlOccur=1;
+				}
+
+				(&cpu->thread->rat[RAT_ZERO_FLAG])->branch_available=0;
+				
+			}
+			
+			else if (strcmp((&iqSelectedEntry->stage)->opcode, "BNZ") == 0) {
+				
+				// zero flag captured from the URF or the forward bus before issue
+				int zFlag=(&iqSelectedEntry->stage)->zFlag;
+				
+				if(!zFlag)
+				{
+					(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->pc + (&iqSelectedEntry->stage)->imm;
+					cpu->thread->old_pc=cpu->thread->pc;
+					cpu->thread->pc=(&iqSelectedEntry->stage)->buffer;
+					cpu->thread->bTaken=1;
+					cpu->thread->ctrlOccur=1;
+					
+				}
+				
+				(&cpu->thread->rat[RAT_ZERO_FLAG])->branch_available=0;
+				
+			}
+			
+			// remember the taken control instruction, the flush keeps everything up to it
+			if(cpu->thread->bTaken && cpu->thread->ctrlOccur)
+				cpu->thread->branchRobIndex=iqSelectedEntry->robIndex;
+			
+			robSelectedEntry->stage=iqSelectedEntry->stage;
+			
+			if (strcmp((&iqSelectedEntry->stage)->opcode, "LOAD") != 0 )
+			//&& strcmp((&iqSelectedEntry->stage)->opcode, "STORE") != 0) 
+			{
+			
+			robSelectedEntry->status=1;
+			
+			if (strcmp((&iqSelectedEntry->stage)->opcode, "JUMP") != 0 && strcmp((&iqSelectedEntry->stage)->opcode, "BZ") != 0 
+			    && strcmp((&iqSelectedEntry->stage)->opcode, "BNZ") != 0 && strcmp((&iqSelectedEntry->stage)->opcode, "STORE") != 0)
+				writeOnFwdBus(cpu,iqSelectedEntry->stage);
+
+			}
+			cpu->intFuBusy=0;
+			
+			iqSelectedEntry->allocated=0;
+			
+			
+		}
+			
+	}
+	
+	if (DEBUG_MESSAGES) {
+		print_stage_content("EX_INT_FU",(entrySelected?(&(iqSelectedEntry->stage)):dummyStage),cpu);
+    }
+	return 0;
+}
+
+int isControlInstruction(CPU_Stage* stage)
+{
+	return strcmp(stage->opcode,"JUMP")==0 || strcmp(stage->opcode,"JAL")==0
+		|| strcmp(stage->opcode,"BZ")==0 || strcmp(stage->opcode,"BNZ")==0;
+}
+
+/*
+ * Branch flush drops every IQ entry of its thread, so a control instruction
+ * may only issue once the entries of that thread dispatched before it (e.g.
+ * waiting MULs) have left
+ */
+int hasOlderIQEntry(APEX_CPU* cpu,long long clockCycle,int thread)
+{
+	for(int i=0;i<IQ_SIZE;i++)
+	{
+		if((&cpu->iq_list[i])->allocated && (&cpu->iq_list[i])->clockCycle<clockCycle
+		&& (&(&cpu->iq_list[i])->stage)->thread==thread)
+			return 1;
+	}
+	return 0;
+}
+
+/* Oldest IQ entry for the function unit, of any thread when thread is -1 */
+int getReadyIQIndex(APEX_CPU* cpu,int fuType,int thread)
+{
+	long long minClock=0;
+	int iqIndex=-1;
+	for(int i=0;i<IQ_SIZE;i++)
+	{
+		CPU_IQ *iqEntry=(&cpu->iq_list[i]);
+		if(iqEntry->allocated)
+		{
+			if(iqEntry->fuType==fuType && (thread<0 || (&iqEntry->stage)->thread==thread))
+			{
+				if((cpu->clock-iqEntry->clockCycle)>=1)
+				{
+					if(minClock==0)
+					{
+						minClock=iqEntry->clockCycle;
+						iqIndex=i;
+					}
+					else if(iqEntry->clockCycle < minClock)
+					{
+						minClock=iqEntry->clockCycle;
+						iqIndex=i;
+					}
+				}
+			}
+		}
+	}
+	
+	return iqIndex;
+}
+
+/* Whether an IQ entry has what it needs to issue this cycle */
+static int iqEntryIssuable(APEX_CPU* cpu,CPU_IQ* iqEntry)
+{
+	if(!iqEntry->allocated)
+		return 0;
+	
+	// a STORE computes its address from rs2, the data in rs1 is picked up in the LSQ
+	if(strcmp((&iqEntry->stage)->opcode,"STORE")==0)
+		return iqEntry->src2_valid;
+	
+	return iqEntry->src1_valid && iqEntry->src2_valid
+		&& !(isControlInstruction(&iqEntry->stage) && hasOlderIQEntry(cpu,iqEntry->clockCycle,(&iqEntry->stage)->thread));
+}
+
+/*
+ * IQ entry the function unit issues this cycle, the oldest one if it is
+ * ready. With SMT the oldest entry of every thread is a candidate, so a
+ * thread waiting on an operand does not hold up the others.
+ */
+CPU_IQ* selectIQEntry(APEX_CPU* cpu,int fuType)
+{
+	CPU_IQ* selected=NULL;
+	
+	for(int t=0;t<cpu->threadCount;t++)
+	{
+		int iqIndex=getReadyIQIndex(cpu,fuType,cpu->threadCount==1 ? -1 : t);
+		if(iqIndex<0)
+			continue;
+		
+		CPU_IQ *iqEntry=(&cpu->iq_list[iqIndex]);
+		if(iqEntryIssuable(cpu,iqEntry) && (!selected || iqEntry->clockCycle<selected->clockCycle))
+			selected=iqEntry;
+	}
+	return selected;
+}
+
+int mulFuncUnit(APEX_CPU* cpu)
+{
+	int entrySelected=0;
+	CPU_IQ *iqSelectedEntry;
+	CPU_ROB *robSelectedEntry;
+	CPU_Stage idleStage;
+	CPU_Stage* dummyStage=&idleStage;
+	dummyStage->stalled=1;
+	if(!cpu->mulFuBusy)
+	{
+		iqSelectedEntry=selectIQEntry(cpu,FU_MUL);
+		if(iqSelectedEntry)
+		{
+			entrySelected=1;
+			cpu->thread=&cpu->threads[(&iqSelectedEntry->stage)->thread];
+			(&cpu->mulFuncUnit)->robIndex=iqSelectedEntry->robIndex;
+			(&cpu->mulFuncUnit)->thread=cpu->thread->id;
+			robSelectedEntry=(&cpu->thread->rob_list[iqSelectedEntry->robIndex]);
+		}
+		
+		if(entrySelected)
+		{
+			PROBE_EVENT(cpu,PROBE_ISSUE,cpu->thread->id,(&iqSelectedEntry->stage)->pc,-1,0);
+			cpu->mulFuBusy=1;
+			cpu->mulFuClock++;
+			if (strcmp((&iqSelectedEntry->stage)->opcode, "MUL") == 0) {
+				
+				(&iqSelectedEntry->stage)->buffer = (&iqSelectedEntry->stage)->rs1_value*(&iqSelectedEntry->stage)->rs2_value;
+				robSelectedEntry->stage=iqSelectedEntry->stage;
+				//robSelectedEntry->status=1;
+			}
+			
+			iqSelectedEntry->allocated=0;
+			//writeOnFwdBus(cpu,(&iqSelectedEntry->stage));
+		}
+	}
+	else
+	{
+		//if(mulClock==2)
+		//{
+		//	mulFuBusy=0;
+		//	mulClock=0;
+		//}
+		//else
+		//{
+			entrySelected=1;
+			//mulClock++;
+			cpu->thread=&cpu->threads[(&cpu->mulFuncUnit)->thread];
+			robSelectedEntry=(&cpu->thread->rob_list[(&cpu->mulFuncUnit)->robIndex]);
+			
+			// the result waits in the unit until it is granted a result bus
+			if(cpu->busGrant[BUS_MUL])
+			{
+				cpu->mulFuBusy=0;
+				cpu->mulFuClock=0;
+				robSelectedEntry->status=1;
+				writeOnFwdBus(cpu,robSelectedEntry->stage);
+			}
+		//}
+			
+		
+	}
+	
+	if (DEBUG_MESSAGES) {
+		print_stage_content("EX_MUL_FU",(entrySelected?(&robSelectedEntry->stage):dummyStage),cpu);
+	}
+	return 0;
+}
+
+int instAtRobHead(APEX_CPU* cpu)
+{
+	if(cpu->thread->robHead==-1)
+		return 0;
+	
+	// head == tail+1 means the rob is empty, dispatch never fills all ROB_SIZE entries
+	int robEntries=(cpu->thread->robTail-cpu->thread->robHead+ROB_SIZE+1)%ROB_SIZE;
+	if(robEntries==0)
+		return 0;
+	
+	CPU_ROB* headRob=(&cpu->thread->rob_list[cpu->thread->robHead]);
+	
+	int nextRobIndex=cpu->thread->robHead==ROB_SIZE-1 ? 0: cpu->thread->robHead+1;
+	
+	CPU_ROB* nextHeadRob=(&cpu->thread->rob_list[nextRobIndex]);
+	int committedReg=-1;
+	
+	if(headRob->status)
+	{
+		if(strcmp((&headRob->stage)->opcode,"HALT")==0)
+		{
+			cpu->thread->haltAtRobHead=1;
+			//if(robHead==31)
+			//	robHead=0;
+			//else 
+			//	robHead++;
+		
+			
+			flushInstruction_halt(cpu,(&headRob->stage)->cfidIndex,1);
+			(&cpu->thread->stage[F])->stalled=1;
+			(&cpu->thread->stage[DRF])->stalled=1;
+			(&cpu->thread->stage[IQ])->stalled=1;
+			cpu->thread->tempRobStage=headRob->stage;
+			cpu->thread->tempRobStage_1.stalled=1;
+			cpu->thread->instRetired=1;
+			cpu->ins_completed++;
+			cpu->thread->instructions++;
+			PROBE_EVENT(cpu,PROBE_COMMIT,cpu->thread->id,(&headRob->stage)->pc,-1,0);
+			INSN_TRACE_COMMIT(cpu,&headRob->stage);
+			COMMIT_LOG_RECORD(cpu,&headRob->stage);
+			STATE_DIGEST_COMMIT(cpu,&headRob->stage);
+			
+			cpu->thread->robHead=-1;
+			cpu->thread->robTail=-1;
+			
+			return 0;
+		}
+		
+		if(strcmp((&headRob->stage)->opcode,"STORE")!=0 && strcmp((&headRob->stage)->opcode,"")!=0 
+		&& strcmp((&headRob->stage)->opcode,"JUMP")!=0 && strcmp((&headRob->stage)->opcode,"BZ")!=0 
+		&& strcmp((&headRob->stage)->opcode,"BNZ")!=0 && strcmp((&headRob->stage)->opcode,"HALT")!=0)
+		{
+			(&cpu->urf_regs[(&headRob->stage)->urf_dest_reg])->value=(&headRob->stage)->buffer;
+			
+			
+			// a reused URF register must not keep the zero flag of its last instance
+			(&cpu->urf_regs[(&headRob->stage)->urf_dest_reg])->zFlag=(&headRob->stage)->buffer==0;
+			
+			// deallocate the previous urf instance of the architectural register
+			int oldUrfReg=(&headRob->stage)->last_saved_urf_reg;
+			if(oldUrfReg!=100)
+			//&& (&cpu->urf_regs[oldUrfReg])->valid)
+			{
+				(&cpu->urf_regs[oldUrfReg])->isFree=1;
+				//(&cpu->urf_regs[oldUrfReg])->valid=0;
+			}
+		
+			(&cpu->urf_regs[(&headRob->stage)->urf_dest_reg])->valid=1;
+			committedReg=(&headRob->stage)->urf_dest_reg;
+		}
+		//else
+		//{
+			if(strcmp((&headRob->stage)->opcode,"JUMP")==0 || strcmp((&headRob->stage)->opcode,"BZ")==0 
+			|| strcmp((&headRob->stage)->opcode,"BNZ")==0 || strcmp((&headRob->stage)->opcode,"JAL")==0)
+			{
+				//crossOver=1;
+			}
+		//}
+		
+		cpu->thread->tempRobStage=headRob->stage;
+		
+		// a retired entry must not look completed when the ROB wraps around to it empty
+		headRob->status=0;
+		
+		if(cpu->thread->robHead==ROB_SIZE-1)
+			cpu->thread->robHead=0;
+		else 
+			cpu->thread->robHead++;
+		
+		cpu->thread->instRetired=1;
+		cpu->ins_completed++;
+		cpu->thread->instructions++;
+		PROBE_EVENT(cpu,PROBE_COMMIT,cpu->thread->id,(&cpu->thread->tempRobStage)->pc,committedReg,(&cpu->thread->tempRobStage)->buffer);
+		INSN_TRACE_COMMIT(cpu,&cpu->thread->tempRobStage);
+		COMMIT_LOG_RECORD(cpu,&cpu->thread->tempRobStage);
+		STATE_DIGEST_COMMIT(cpu,&cpu->thread->tempRobStage);
+	}
+	else
+	{
+		cpu->thread->tempRobStage.stalled=1;
+		return 0;
+	}
+	
+	
+	
+	// inst commit for head + 1
+	if(robEntries>1 && nextHeadRob->status)
+	{
+		if(strcmp((&nextHeadRob->stage)->opcode,"HALT")==0)
+		{
+			
+			if(!cpu->thread->bTaken)
+			{
+				cpu->thread->haltAtRobHead=1;
+				//if(robHead==31)
+				//	robHead=0;
+				//else 
+				//	robHead++;
+			
+				flushInstruction_halt(cpu,(&nextHeadRob->stage)->cfidIndex,1);
+				(&cpu->thread->stage[F])->stalled=1;
+			(&cpu->thread->stage[DRF])->stalled=1;
+			(&cpu->thread->stage[IQ])->stalled=1;
+				
+				cpu->thread->tempRobStage_1=nextHeadRob->stage;
+				
+				cpu->thread->instRetired_1=1;
+				cpu->ins_completed++;
+				cpu->thread->instructions++;
+				PROBE_EVENT(cpu,PROBE_COMMIT,cpu->thread->id,(&nextHeadRob->stage)->pc,-1,0);
+				INSN_TRACE_COMMIT(cpu,&nextHeadRob->stage);
+				COMMIT_LOG_RECORD(cpu,&nextHeadRob->stage);
+				STATE_DIGEST_COMMIT(cpu,&nextHeadRob->stage);
+			}
+				return 0;
+			
+		}
+		
+		if(strcmp((&nextHeadRob->stage)->opcode,"STORE")!=0 && strcmp((&nextHeadRob->stage)->opcode,"")!=0 
+		&& strcmp((&nextHeadRob->stage)->opcode,"JUMP")!=0 && strcmp ((&nextHeadRob->stage)->opcode,"BZ")!=0 
+		&& strcmp((&nextHeadRob->stage)->opcode,"BNZ")!=0 && strcmp  ((&nextHeadRob->stage)->opcode,"HALT")!=0)
+		{
+			(&cpu->urf_regs[(&nextHeadRob->stage)->urf_dest_reg])->value=(&nextHeadRob->stage)->buffer;
+			
+			
+			// a reused URF register must not keep the zero flag of its last instance
+			(&cpu->urf_regs[(&nextHeadRob->stage)->urf_dest_reg])->zFlag=(&nextHeadRob->stage)->buffer==0;
+			
+			// deallocate the previous urf instance of the architectural register
+			int oldUrfReg=(&nextHeadRob->stage)->last_saved_urf_reg;
+			if(oldUrfReg!=100)
+			//&& (&cpu->urf_regs[oldUrfReg])->valid)
+			{
+				(&cpu->urf_regs[oldUrfReg])->isFree=1;
+				//(&cpu->urf_regs[oldUrfReg])->valid=0;
+			}
+		
+			(&cpu->urf_regs[(&nextHeadRob->stage)->urf_dest_reg])->valid=1;
+			committedReg=(&nextHeadRob->stage)->urf_dest_reg;
+		}
+		else
+			committedReg=-1;
+		
+		cpu->thread->tempRobStage_1=nextHeadRob->stage;
+		
+		nextHeadRob->status=0;
+		
+		if(cpu->thread->robHead==ROB_SIZE-1)
+			cpu->thread->robHead=0;
+		else 
+			cpu->thread->robHead++;
+		
+		cpu->thread->instRetired_1=1;
+		cpu->ins_completed++;
+		cpu->thread->instructions++;
+		PROBE_EVENT(cpu,PROBE_COMMIT,cpu->thread->id,(&cpu->thread->tempRobStage_1)->pc,committedReg,(&cpu->thread->tempRobStage_1)->buffer);
+		INSN_TRACE_COMMIT(cpu,&cpu->thread->tempRobStage_1);
+		COMMIT_LOG_RECORD(cpu,&cpu->thread->tempRobStage_1);
+		STATE_DIGEST_COMMIT(cpu,&cpu->thread->tempRobStage_1);
+	}
+	else
+		cpu->thread->tempRobStage_1.stalled=1;
+	
+	
+	return 0;
+}
+
+int commitToRrat(APEX_CPU* cpu)
+{
+	if(cpu->thread->instRetired)
+	{
+		if(strcmp(cpu->thread->tempRobStage.opcode,"STORE")!=0 && strcmp(cpu->thread->tempRobStage.opcode,"")!=0 
+		&& strcmp(cpu->thread->tempRobStage.opcode,"JUMP")!=0 && strcmp(cpu->thread->tempRobStage.opcode,"BZ")!=0 
+		&& strcmp(cpu->thread->tempRobStage.opcode,"BNZ")!=0 && strcmp(cpu->thread->tempRobStage.opcode,"HALT")!=0)
+		{
+			(&cpu->thread->rRat[cpu->thread->tempRobStage.rd])->urf_reg=cpu->thread->tempRobStage.urf_dest_reg;
+			(&cpu->thread->rRat[cpu->thread->tempRobStage.rd])->allocated=1;
+			
+			if(strcmp(cpu->thread->tempRobStage.opcode,"LOAD")!=0)
+			{
+				(&cpu->thread->rRat[RAT_ZERO_FLAG])->urf_reg=cpu->thread->tempRobStage.urf_dest_reg;
+				(&cpu->thread->rRat[RAT_ZERO_FLAG])->allocated=1;
+			}
+			//instRetired=0;
+		}
+		
+		cpu->thread->instRetired=0;
+	}
+	
+	//commitment for inst at rob head + 1
+	if(cpu->thread->instRetired_1)
+	{
+		if(strcmp(cpu->thread->tempRobStage_1.opcode,"STORE")!=0 && strcmp(cpu->thread->tempRobStage_1.opcode,"")!=0 
+		&& strcmp(cpu->thread->tempRobStage_1.opcode,"JUMP")!=0 && strcmp (cpu->thread->tempRobStage_1.opcode,"BZ")!=0 
+		&& strcmp(cpu->thread->tempRobStage_1.opcode,"BNZ")!=0 && strcmp  (cpu->thread->tempRobStage_1.opcode,"HALT")!=0)
+		{
+			(&cpu->thread->rRat[cpu->thread->tempRobStage_1.rd])->urf_reg=cpu->thread->tempRobStage_1.urf_dest_reg;
+			(&cpu->thread->rRat[cpu->thread->tempRobStage_1.rd])->allocated=1;
+			
+			if(strcmp(cpu->thread->tempRobStage_1.opcode,"LOAD")!=0)
+			{
+				(&cpu->thread->rRat[RAT_ZERO_FLAG])->urf_reg=cpu->thread->tempRobStage_1.urf_dest_reg;
+				(&cpu->thread->rRat[RAT_ZERO_FLAG])->allocated=1;
+			}
+			//instRetired=0;
+		}
+		
+		cpu->thread->instRetired_1=0;
+	}
+	
+	return 0;
+}
+
+/*
+ * Moves lsqHead past the entry just issued and any entries already issued
+ * out of order, an empty LSQ has its head one past the tail
+ */
+int advanceLsqHead(APEX_CPU* cpu)
+{
+	int end=cpu->lsqTail==LSQ_SIZE-1 ? 0 : cpu->lsqTail+1;
+	
+	do
+	{
+		cpu->lsqHead=cpu->lsqHead==LSQ_SIZE-1 ? 0 : cpu->lsqHead+1;
+	}
+	while(cpu->lsqHead!=end && !(&cpu->lsq_list[cpu->lsqHead])->allocated);
+	
+	return 0;
+}
+
+/*
+ * Selects the LSQ entry to send to memory. The head entry goes first, else
+ * the oldest LOAD whose older STOREs all have known addresses. A LOAD that
+ * matches an older STORE gets that store's data through fwdLsqIndex.
+ */
+int getReadyLSQIndex(APEX_CPU* cpu,int* fwdLsqIndex)
+{
+	*fwdLsqIndex=-1;
+	
+	if(cpu->lsqHead==-1 || cpu->lsqTail==-1)
+		return -1;
+	
+	CPU_LSQ *headEntry=(&cpu->lsq_list[cpu->lsqHead]);
+	if(headEntry->allocated && headEntry->src1_valid && headEntry->address_valid)
+		return cpu->lsqHead;
+	
+	if(!lsqOooLoads)
+		return -1;
+	
+	int end=cpu->lsqTail==LSQ_SIZE-1 ? 0 : cpu->lsqTail+1;
+	for(int i=cpu->lsqHead;i!=end;i=(i==LSQ_SIZE-1 ? 0 : i+1))
+	{
+		CPU_LSQ *lsqEntry=(&cpu->lsq_list[i]);
+		if(!lsqEntry->allocated || !lsqEntry->address_valid
+		|| strcmp((&lsqEntry->stage)->opcode,"LOAD")!=0)
+			continue;
+		
+		int conflict=0;
+		int matchIndex=-1;
+		for(int j=cpu->lsqHead;j!=i;j=(j==LSQ_SIZE-1 ? 0 : j+1))
+		{
+			CPU_LSQ *olderEntry=(&cpu->lsq_list[j]);
+			if(!olderEntry->allocated || strcmp((&olderEntry->stage)->opcode,"STORE")!=0)
+				continue;
+			
+			if(!olderEntry->address_valid)
+			{
+				conflict=1;
+				break;
+			}
+			if((&olderEntry->stage)->buffer==(&lsqEntry->stage)->buffer)
+				matchIndex=j;
+		}
+		
+		if(!conflict && matchIndex>-1 && !(&cpu->lsq_list[matchIndex])->src1_valid)
+			conflict=1;
+		
+		if(conflict)
+		{
+			cpu->lsqConflictStalls++;
+			continue;
+		}
+		
+		*fwdLsqIndex=matchIndex;
+		return i;
+	}
+	
+	return -1;
+}
+
+int memFuncUnit(APEX_CPU* cpu)
+{
+	int entrySelected=0;
+	int inflight=0;
+	CPU_LSQ *lsqSelectedEntry;
+	CPU_ROB *robSelectedEntry;
+	mem_access *memSlot=NULL;
+	
+	dcacheTick(cpu);
+	
+	// complete the accesses whose data is back this cycle, the unit puts one
+	// result on the bus per cycle if it was granted a bus, other load
+	// results wait for the next cycle
+	int resultWritten=!cpu->busGrant[BUS_MEM];
+	for(int i=0;i<MEM_MAX_INFLIGHT;i++)
+	{
+		mem_access *access=(&(&cpu->memFuncUnit)->inflight[i]);
+		if(!access->valid)
+			continue;
+		
+		// a STORE left the ROB at address generation, its entry may belong to
+		// a later instruction by now and gets neither status nor result
+		cpu->thread=&cpu->threads[access->thread];
+		robSelectedEntry=(&cpu->thread->rob_list[access->robIndex]);
+		int live=(&robSelectedEntry->stage)->seq==access->seq;
+		if(access->readyCycle<=cpu->clock && (access->store || !resultWritten))
+		{
+			access->valid=0;
+			if (!access->store && live)
+			{
+				robSelectedEntry->status=1;
+				writeOnFwdBus(cpu,robSelectedEntry->stage);
+				resultWritten=1;
+			}
+		}
+		else
+			inflight++;
+		
+		if (DEBUG_MESSAGES && live) {
+			print_stage_content("MEM_FU",(&robSelectedEntry->stage),cpu);
+		}
+	}
+	
+	for(int i=0;i<MEM_MAX_INFLIGHT && !memSlot;i++)
+	{
+		if(!(&(&cpu->memFuncUnit)->inflight[i])->valid)
+			memSlot=(&(&cpu->memFuncUnit)->inflight[i]);
+	}
+	
+	// issue one new access per cycle, misses wait for a free MSHR in the LSQ
+	if(memSlot)
+	{
+		// select an entry that satisfies all conditions for issue
+		int fwdLsqIndex=-1;
+		int readyLsqIndex=getReadyLSQIndex(cpu,&fwdLsqIndex);
+		if(readyLsqIndex>-1)
+		{
+			lsqSelectedEntry=(&cpu->lsq_list[readyLsqIndex]);
+			cpu->thread=&cpu->threads[(&lsqSelectedEntry->stage)->thread];
+			robSelectedEntry=(&cpu->thread->rob_list[lsqSelectedEntry->robIndex]);
+			
+			if(fwdLsqIndex>-1)
+			{
+				memSlot->readyCycle=cpu->clock+dcacheHitLatency-1;
+				entrySelected=1;
+			}
+			else if(dcacheAccess(cpu,(&lsqSelectedEntry->stage)->buffer,&memSlot->readyCycle)==0)
+				entrySelected=1;
+		}
+		
+		if(entrySelected)
+		{
+			PROBE_EVENT(cpu,PROBE_ISSUE,cpu->thread->id,(&lsqSelectedEntry->stage)->pc,-1,0);
+			memSlot->valid=1;
+			cpu->memAccesses++;
+			memSlot->robIndex=lsqSelectedEntry->robIndex;
+			memSlot->seq=(&lsqSelectedEntry->stage)->seq;
+			memSlot->store=strcmp((&lsqSelectedEntry->stage)->opcode, "STORE") == 0;
+			memSlot->thread=cpu->thread->id;
+			inflight++;
+			
+			if (memSlot->store) {
+				
+				STATE_DIGEST_STORE(cpu,(&lsqSelectedEntry->stage)->buffer,(&lsqSelectedEntry->stage)->rs1_value);
+				cpu->data_memory[(&lsqSelectedEntry->stage)->buffer]=(&lsqSelectedEntry->stage)->rs1_value;
+				
+				lsqSelectedEntry->allocated=0;
+			}
+			if (strcmp((&lsqSelectedEntry->stage)->opcode, "LOAD") == 0) {
+				
+				if(readyLsqIndex!=cpu->lsqHead)
+					cpu->loadsIssuedEarly++;
+				
+				// take the data of the youngest older store to the same address
+				if(fwdLsqIndex>-1)
+				{
+					(&lsqSelectedEntry->stage)->buffer=(&(&cpu->lsq_list[fwdLsqIndex])->stage)->rs1_value;
+					cpu->loadsForwarded++;
+				}
+				else
+					(&lsqSelectedEntry->stage)->buffer=cpu->data_memory[(&lsqSelectedEntry->stage)->buffer];
+				
+				robSelectedEntry->stage=lsqSelectedEntry->stage;
+				lsqSelectedEntry->allocated=0;
+			}
+			
+			if(readyLsqIndex==cpu->lsqHead)
+				advanceLsqHead(cpu);
+			
+			if (DEBUG_MESSAGES) {
+				print_stage_content("MEM_FU",(&lsqSelectedEntry->stage),cpu);
+			}
+		}
+	}
+	
+	cpu->memFuBusy=inflight>0;
+	
+	if (DEBUG_MESSAGES && !cpu->memFuBusy && !entrySelected) {
+		CPU_Stage dummyStage;
+		dummyStage.stalled=1;
+		print_stage_content("MEM_FU",&dummyStage,cpu);
+	}
+	return 0;
+}
+
+
+/* Whether an IQ or LSQ entry still waits on the result for a URF register */
+static int awaitsResult(APEX_CPU* cpu,int urf_reg)
+{
+	for(int i=0;i<IQ_SIZE;i++)
+	{
+		CPU_IQ *iqEntry=(&cpu->iq_list[i]);
+		if(iqEntry->allocated
+		&& ((!(&iqEntry->stage)->rs1_value_valid && (&iqEntry->stage)->urf_rs1_reg==urf_reg)
+		|| (!(&iqEntry->stage)->rs2_value_valid && (&iqEntry->stage)->urf_rs2_reg==urf_reg)))
+			return 1;
+	}
+	for(int i=0;i<LSQ_SIZE;i++)
+	{
+		CPU_LSQ *lsqEntry=(&cpu->lsq_list[i]);
+		if(lsqEntry->allocated && !(&lsqEntry->stage)->rs1_value_valid && (&lsqEntry->stage)->urf_rs1_reg==urf_reg)
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Grants the result buses of this cycle, every function unit puts at most
+ * one result on the bus per cycle. When more units have a result than
+ * there are buses, they are served round robin from busPriority and the
+ * others hold their result: the integer unit leaves its instruction in
+ * the IQ, the MUL and the LOAD wait in their units for the next cycle.
+ * A held result some IQ or LSQ entry waits on is a delayed wakeup. No
+ * wakeup is lost, every result of a cycle is read off the bus that cycle.
+ */
+int arbitrateResultBuses(APEX_CPU* cpu)
+{
+	int requests[BUS_UNITS];
+	int awaited[BUS_UNITS];		// an IQ or LSQ entry waits on the result
+	int granted=0;
+	int last=-1;
+	int conflict=0;
+	
+	for(int u=0;u<BUS_UNITS;u++)
+		cpu->busGrant[u]=1;
+	if(resultBuses>=BUS_UNITS)
+		return 0;
+	
+	CPU_IQ *iqEntry=cpu->intFuBusy ? NULL : selectIQEntry(cpu,FU_INT);
+	requests[BUS_INT]=iqEntry && writesResult(&iqEntry->stage);
+	awaited[BUS_INT]=requests[BUS_INT] && awaitsResult(cpu,(&iqEntry->stage)->urf_dest_reg);
+	
+	// the MUL completes in its second cycle
+	requests[BUS_MUL]=cpu->mulFuBusy;
+	awaited[BUS_MUL]=cpu->mulFuBusy && awaitsResult(cpu,
+		(&(&cpu->threads[cpu->mulFuncUnit.thread].rob_list[cpu->mulFuncUnit.robIndex])->stage)->urf_dest_reg);
+	
+	requests[BUS_MEM]=0;
+	awaited[BUS_MEM]=0;
+	for(int i=0;i<MEM_MAX_INFLIGHT;i++)
+	{
+		mem_access *access=(&(&cpu->memFuncUnit)->inflight[i]);
+		CPU_Stage *loadStage=(&(&cpu->threads[access->thread].rob_list[access->robIndex])->stage);
+		// a flushed LOAD completes without a result, as in memFuncUnit
+		if(access->valid && access->readyCycle<=cpu->clock && !access->store && loadStage->seq==access->seq)
+		{
+			requests[BUS_MEM]=1;
+			if(awaitsResult(cpu,loadStage->urf_dest_reg))
+				awaited[BUS_MEM]=1;
+		}
+	}
+	
+	for(int k=0;k<BUS_UNITS;k++)
+	{
+		int u=(cpu->busPriority+k)%BUS_UNITS;
+		if(!requests[u])
+			continue;
+		
+		if(granted<resultBuses)
+		{
+			granted++;
+			last=u;
+		}
+		else
+		{
+			cpu->busGrant[u]=0;
+			cpu->busConflicts[u]++;
+			cpu->delayedWakeups+=awaited[u];
+			conflict=1;
+		}
+	}
+	
+	// the unit after the last one served goes first on the next conflict
+	if(conflict)
+		cpu->busPriority=(last+1)%BUS_UNITS;
+	return 0;
+}
+
+int writeOnFwdBus(APEX_CPU* cpu, CPU_Stage stage)
+{
+	int fIndex=-1;
+	int regExist=checkFReg(cpu,stage.urf_dest_reg);
+	fIndex=regExist>-1?regExist:cpu->forwardIndex;
+	
+	(&cpu->fBus[fIndex])->rs=stage.urf_dest_reg;
+	(&cpu->fBus[fIndex])->rs_value=stage.buffer;
+	(&cpu->fBus[fIndex])->valid=1;
+	PROBE_EVENT(cpu,PROBE_FWD_BUS,stage.thread,stage.pc,stage.urf_dest_reg,stage.buffer);
+	
+		if(stage.buffer ==0)
+		{
+			(&cpu->fBus[fIndex])->zFlag=1;
+		}
+		else
+			(&cpu->fBus[fIndex])->zFlag=0;
+		
+		
+		cpu->forwardIndex= regExist==-1 ? (cpu->forwardIndex==resultBuses-1 ? 0 : cpu->forwardIndex+1) : (regExist==resultBuses-1 ? 0 : cpu->forwardIndex);
+		
+		return 0;
+}
+
+CPU_Forward_Bus readFrmFwdBus(APEX_CPU* cpu,int urf_reg)
+{
+	//int value;
+	CPU_Forward_Bus fwdEntry;
+	fwdEntry.valid=0;
+	
+	for(int i=0;i<resultBuses;i++)
+	{
+		if((&cpu->fBus[i])->rs==urf_reg)
+		{
+			//value=(&cpu->fBus[i])->rs_value;
+			fwdEntry=cpu->fBus[i];
+		}
+	}
+	return fwdEntry;
+}
+
+/*
+ *  Execute Stage of APEX Pipeline
+ */
+int
+execute(APEX_CPU* cpu)
+{
+  CPU_Stage* stage = &cpu->thread->stage[EX];
+  if (!stage->busy && !stage->stalled) {
+
+	stage->busy=1;	
+    /* Store */
+    if (strcmp(stage->opcode, "STORE") == 0) {
+				
+		for(int i=0;i<resultBuses;i++)
+			{
+				if((&cpu->fBus[i])->rs==stage->rs2)
+					stage->rs2_value=(&cpu->fBus[i])->rs_value;
+					
+			}
+			
+		stage->buffer = stage->rs2_value+stage->imm;
+		
+    }
+	/* Load */
+    if (strcmp(stage->opcode, "LOAD") == 0) {
+		stage->buffer = stage->rs1_value+stage->imm;
+    }	
+    /* MOVC */
+    if (strcmp(stage->opcode, "MOVC") == 0) {
+		stage->buffer=stage->imm+0;
+    }
+
+	if (strcmp(stage->opcode, "ADD") == 0) {
+		
+		for(int i=0;i<resultBuses;i++)
+		{
+			if((&cpu->fBus[i])->rs==stage->rs1)
+			{
+				stage->rs1_value=(&cpu->fBus[i])->rs_value;
+				
+					stage->zFlag=(&cpu->fBus[i])->zFlag;
+				
+			}
+			if((&cpu->fBus[i])->rs==stage->rs2)
+			{
+				stage->rs2_value=(&cpu->fBus[i])->rs_value;
+				
+					stage->zFlag=(&cpu->fBus[i])->zFlag;
+			}
+		}
+		
+		
+		stage->buffer = stage->rs1_value+stage->rs2_value;
+    }
+	
+	if (strcmp(stage->opcode, "SUB") == 0) {
+		
+		for(int i=0;i<resultBuses;i++)
+		{
+			if((&cpu->fBus[i])->rs==stage->rs1)
+			{
+				stage->rs1_value=(&cpu->fBus[i])->rs_value;
+				
+					stage->zFlag=(&cpu->fBus[i])->zFlag;
+				
+			}
+			if((&cpu->fBus[i])->rs==stage->rs2)
+			{
+				stage->rs2_value=(&cpu->fBus[i])->rs_value;
+				
+					stage->zFlag=(&cpu->fBus[i])->zFlag;
+			}
+		}
+		
+		stage->buffer = stage->rs1_value - stage->rs2_value;
+    }
+	if (strcmp(stage->opcode, "MUL") == 0) {
+		
+		if(cpu->mulClock==1)
+		{
+			for(int i=0;i<resultBuses;i++)
+			{
+				if((&cpu->fBus[i])->rs==stage->rs1)
+				{
+					stage->rs1_value=(&cpu->fBus[i])->rs_value;
+					
+						stage->zFlag=(&cpu->fBus[i])->zFlag;
+					
+				}
+				 if((&cpu->fBus[i])->rs==stage->rs2)
+				{
+					stage->rs2_value=(&cpu->fBus[i])->rs_value;
+					
+						stage->zFlag=(&cpu->fBus[i])->zFlag;
+				}
+			}
+			
+			stage->buffer = stage->rs1_value * stage->rs2_value;
+			
+		}
+		
+		
+    }
+	if (strcmp(stage->opcode, "AND") == 0) {
+		
+		for(int i=0;i<resultBuses;i++)
+		{
+			if((&cpu->fBus[i])->rs==stage->rs1)
+			{
+				stage->rs1_value=(&cpu->fBus[i])->rs_value;
+				
+					stage->zFlag=(&cpu->fBus[i])->zFlag;
+				
+			}
+			if((&cpu->fBus[i])->rs==stage->rs2)
+			{
+				stage->rs2_value=(&cpu->fBus[i])->rs_value;
+				
+					stage->zFlag=(&cpu->fBus[i])->zFlag;
+			}
+		}
+		
+		stage->buffer = stage->rs1_value & stage->rs2_value;
+    }
+	if (strcmp(stage->opcode, "OR") == 0) {
+		
+		for(int i=0;i<resultBuses;i++)
+		{
+			if((&cpu->fBus[i])->rs==stage->rs1)
+			{
+				stage->rs1_value=(&cpu->fBus[i])->rs_value;
+				
+					stage->zFlag=(&cpu->fBus[i])->zFlag;
+				
+			}
+			if((&cpu->fBus[i])->rs==stage->rs2)
+			{
+				stage->rs2_value=(&cpu->fBus[i])->rs_value;
+				
+					stage->zFlag=(&cpu->fBus[i])->zFlag;
+			}
+		}
+		
+		stage->buffer = stage->rs1_value | stage->rs2_value;
+    }
+	if (strcmp(stage->opcode, "EX-OR") == 0) {
+		
+		for(int i=0;i<resultBuses;i++)
+		{
+			if((&cpu->fBus[i])->rs==stage->rs1)
+			{
+				stage->rs1_value=(&cpu->fBus[i])->rs_value;
+				
+					stage->zFlag=(&cpu->fBus[i])->zFlag;
+				
+			}
+			if((&cpu->fBus[i])->rs==stage->rs2)
+			{
+				stage->rs2_value=(&cpu->fBus[i])->rs_value;
+				
+					stage->zFlag=(&cpu->fBus[i])->zFlag;
+			}
+		}
+		
+		int a=stage->rs1_value & stage->rs2_value;
+		int b=~stage->rs1_value & ~stage->rs2_value;
+		stage->buffer=~a & ~b;
+		
+    }
+	
+	// set the zero flag in forward bus if calculated value is zero
+	if(strcmp(stage->opcode, "BNZ") != 0 
+	   && strcmp(stage->opcode, "BZ") != 0 && strcmp(stage->opcode, "JUMP") != 0 
+	   && strcmp(stage->opcode, "LOAD") != 0 && strcmp(stage->opcode, "STORE") != 0)
+	{	
+	
+		int fIndex=-1;
+		int regExist=checkFReg(cpu,stage->rd);
+		fIndex=regExist>-1?regExist:cpu->forwardIndex;
+		
+		
+		(&cpu->fBus[fIndex])->rs=stage->rd;
+		(&cpu->fBus[fIndex])->rs_value=stage->buffer;
+		
+			if(stage->buffer ==0)
+			{
+				(&cpu->fBus[fIndex])->zFlag=1;
+			}
+			else
+				(&cpu->fBus[fIndex])->zFlag=0;
+			
+			
+			cpu->forwardIndex= regExist==-1 ? (cpu->forwardIndex==resultBuses-1 ? 0 : cpu->forwardIndex+1) : (regExist==resultBuses-1 ? 0 : cpu->forwardIndex);
+			
+		
+		
+	}
+	
+	if (strcmp(stage->opcode, "JUMP") == 0) {
+		stage->buffer = stage->rs1_value + stage->imm;
+		cpu->thread->old_pc=cpu->thread->pc;
+		cpu->thread->pc=stage->buffer;
+		
+	}
+	
+	if (strcmp(stage->opcode, "BZ") == 0) {
+		
+		if(stage->zFlag)
+		{
+			cpu->thread->bTaken=1;
+			stage->buffer = stage->pc + stage->imm;
+			cpu->thread->old_pc=cpu->thread->pc;
+			cpu->thread->pc=stage->buffer;
+			
+		}
+	}
+	
+	if (strcmp(stage->opcode, "BNZ") == 0) {
+		if(!stage->zFlag)
+		{
+			cpu->thread->bTaken=1;
+			stage->buffer = stage->pc + stage->imm;
+			cpu->thread->old_pc=cpu->thread->pc;
+			cpu->thread->pc=stage->buffer;
+		}
+	}
+	
+	if(cpu->mulClock==0)
+	{	
+			stage->busy=0;    
+					
+			/* Copy data from Execute latch to Memory latch*/
+			cpu->thread->stage[MEM] = cpu->thread->stage[EX];
+			(&cpu->thread->stage[MEM])->stalled=0;
+			(&cpu->thread->stage[MEM])->pc=stage->pc;
+	}
+	else
+		(&cpu->thread->stage[MEM])->stalled=1;
+    	
+  }
+  else
+  {
+	  /* Copy data from Execute latch to Memory latch*/
+			cpu->thread->stage[MEM] = cpu->thread->stage[EX];
+	(&cpu->thread->stage[MEM])->stalled=1;
+  }
+  
+  if (DEBUG_MESSAGES) {
+     // print_stage_content("Execute", stage);
+    }
+  return 0;
+}
+
+
+/*
+ *  Writeback Stage of APEX Pipeline
+ */
+int
+writeback(APEX_CPU* cpu)
+{
+  CPU_Stage* stage = &cpu->thread->stage[WB];
+  if (!stage->busy && !stage->stalled) {
+
+    /* Update register file */  
+	if (strcmp(stage->opcode, "STORE") != 0 && strcmp(stage->opcode, "BNZ") != 0 
+	    && strcmp(stage->opcode, "BZ") != 0 && strcmp(stage->opcode, "JUMP") != 0 && strcmp(stage->opcode, "HALT") != 0) {
+      cpu->thread->regs[stage->rd] = stage->buffer;
+	  cpu->thread->regs_valid[stage->rd]=1;
+	  	  
+	if(strcmp(stage->opcode, "BNZ") != 0 && strcmp(stage->opcode, "BZ") != 0)
+	{	
+		if(stage->buffer ==0)
+			cpu->thread->zeroFlag=1;
+		else
+			cpu->thread->zeroFlag=0;
+	}
+	
+    }
+	
+    cpu->ins_completed++;
+	   
+  }
+  
+  if (DEBUG_MESSAGES) {
+      //print_stage_content("Writeback", stage);
+    }
+  return 0;
+}
+
+/*
+ * Drops the memory access of a flushed instruction, its ROB entry goes
+ * back to the front end and the access must not complete into it
+ */
+static int cancelMemAccess(APEX_CPU* cpu,CPU_Stage* stage)
+{
+	for(int i=0;i<MEM_MAX_INFLIGHT;i++)
+	{
+		mem_access *access=(&(&cpu->memFuncUnit)->inflight[i]);
+		if(access->valid && access->seq==stage->seq)
+			access->valid=0;
+	}
+	return 0;
+}
+
+int flushInstruction(APEX_CPU* cpu,int cfidIndex,int isHalt)
+{
+	// control instructions issue in order, everything the thread left in the IQ is younger
+	for(int j=0;j<IQ_SIZE;j++)
+	{
+		if((&(&cpu->iq_list[j])->stage)->thread==cpu->thread->id)
+			(&cpu->iq_list[j])->allocated=0;
+	}
+	
+	
+	// handle renamed registers in previous decode stage, it is the youngest so undo it first
+	if(!(&cpu->thread->stage[IQ])->stalled && strcmp((&cpu->thread->stage[IQ])->opcode,"STORE")!=0 && strcmp((&cpu->thread->stage[IQ])->opcode,"")!=0 
+			&& strcmp((&cpu->thread->stage[IQ])->opcode,"JUMP")!=0 && strcmp((&cpu->thread->stage[IQ])->opcode,"BZ")!=0 
+			&& strcmp((&cpu->thread->stage[IQ])->opcode,"BNZ")!=0 && strcmp((&cpu->thread->stage[IQ])->opcode,"HALT")!=0)
+			{
+				
+				(&cpu->thread->rat[(&cpu->thread->stage[IQ])->rd])->urf_reg=(&cpu->thread->stage[IQ])->last_saved_urf_reg;
+				(&cpu->thread->rat[(&cpu->thread->stage[IQ])->rd])->allocated=(&cpu->thread->stage[IQ])->last_saved_urf_allocated;
+				
+				if((&cpu->thread->stage[IQ])->last_saved_urf_reg!=100)
+					(&cpu->urf_regs[(&cpu->thread->stage[IQ])->last_saved_urf_reg])->isFree=0;
+				//(&cpu->urf_regs[(&cpu->thread->stage[IQ])->last_saved_urf_reg])->valid=1;
+				
+				if((&cpu->thread->stage[IQ])->flag_renamed)
+					(&cpu->thread->rat[RAT_ZERO_FLAG])->urf_reg=(&cpu->thread->stage[IQ])->last_saved_flag_reg;
+				
+				//if(!isHalt)
+				//	(&cpu->urf_regs[(&cpu->thread->stage[IQ])->urf_dest_reg])->isFree=1;
+				
+				int present=checkInRat(cpu,(&cpu->thread->stage[IQ])->urf_dest_reg);
+				if(!present)
+					(&cpu->urf_regs[(&cpu->thread->stage[IQ])->urf_dest_reg])->isFree=1;
+				
+				(&cpu->urf_regs[(&cpu->thread->stage[IQ])->urf_dest_reg])->valid=1;
+				
+			}
+	
+	
+	// flush instructions from rob, walking back from the tail to the taken branch
+	while(cpu->thread->robHead!=-1 && cpu->thread->robTail!=cpu->thread->branchRobIndex)
+	{
+		int m=cpu->thread->robTail;
+		(&cpu->thread->rob_list[m])->status=0;
+		PROBE_EVENT(cpu,PROBE_SQUASH,cpu->thread->id,((&cpu->thread->rob_list[m])->stage).pc,-1,0);
+		
+		if(strcmp(((&cpu->thread->rob_list[m])->stage).opcode,"STORE")!=0 && strcmp(((&cpu->thread->rob_list[m])->stage).opcode,"")!=0 
+		&& strcmp(((&cpu->thread->rob_list[m])->stage).opcode,"JUMP")!=0 && strcmp(((&cpu->thread->rob_list[m])->stage).opcode,"BZ")!=0 
+		&& strcmp(((&cpu->thread->rob_list[m])->stage).opcode,"BNZ")!=0 && strcmp(((&cpu->thread->rob_list[m])->stage).opcode,"HALT")!=0)
+		{
+			(&cpu->thread->rat[((&cpu->thread->rob_list[m])->stage).rd])->urf_reg=((&cpu->thread->rob_list[m])->stage).last_saved_urf_reg;
+			(&cpu->thread->rat[((&cpu->thread->rob_list[m])->stage).rd])->allocated=((&cpu->thread->rob_list[m])->stage).last_saved_urf_allocated;
+			
+			if(((&cpu->thread->rob_list[m])->stage).last_saved_urf_reg!=100)
+				(&cpu->urf_regs[((&cpu->thread->rob_list[m])->stage).last_saved_urf_reg])->isFree=0;
+			
+			if(((&cpu->thread->rob_list[m])->stage).flag_renamed)
+				(&cpu->thread->rat[RAT_ZERO_FLAG])->urf_reg=((&cpu->thread->rob_list[m])->stage).last_saved_flag_reg;
+			
+			int present=checkInRat(cpu,((&cpu->thread->rob_list[m])->stage).urf_dest_reg);
+			if(!present)
+				(&cpu->urf_regs[((&cpu->thread->rob_list[m])->stage).urf_dest_reg])->isFree=1;
+			
+			(&cpu->urf_regs[((&cpu->thread->rob_list[m])->stage).urf_dest_reg])->valid=1;
+		}
+		
+		// a flushed LOAD or STORE may still have its access in the memory unit
+		cancelMemAccess(cpu,&(&cpu->thread->rob_list[m])->stage);
+		
+		// same for a flushed MUL, it would complete into a reused ROB entry
+		if(cpu->mulFuBusy && (&cpu->mulFuncUnit)->robIndex==m && (&cpu->mulFuncUnit)->thread==cpu->thread->id)
+		{
+			cpu->mulFuBusy=0;
+			cpu->mulFuClock=0;
+		}
+		
+		cpu->thread->robTail=cpu->thread->robTail==0 ? ROB_SIZE-1 : cpu->thread->robTail-1;
+	}
+	
+	
+	// flush instructions from lsq, entries past the tail of the rob are gone. Entries
+	// of other threads stay, the flushed ones behind them are left as holes.
+	int lsqEntries=cpu->lsqHead!=-1 && cpu->lsqTail!=-1 ? (cpu->lsqTail-cpu->lsqHead+LSQ_SIZE+1)%LSQ_SIZE : 0;
+	int trimTail=1;
+	for(int i=0,m=cpu->lsqTail;i<lsqEntries;i++,m=(m==0 ? LSQ_SIZE-1 : m-1))
+	{
+		CPU_LSQ *lsqEntry=(&cpu->lsq_list[m]);
+		if((&lsqEntry->stage)->thread!=cpu->thread->id)
+		{
+			trimTail=0;
+			continue;
+		}
+		
+		int age=(lsqEntry->robIndex-cpu->thread->robHead+ROB_SIZE)%ROB_SIZE;
+		int branchAge=(cpu->thread->branchRobIndex-cpu->thread->robHead+ROB_SIZE)%ROB_SIZE;
+		if(age<=branchAge)
+			break;
+		
+		lsqEntry->allocated=0;
+		if(trimTail)
+			cpu->lsqTail=cpu->lsqTail==0 ? LSQ_SIZE-1 : cpu->lsqTail-1;
+	}
+	
+	// a store only issues from the head, which must not be left on a hole
+	if(cpu->lsqHead!=-1 && cpu->lsqTail!=-1)
+	{
+		int end=cpu->lsqTail==LSQ_SIZE-1 ? 0 : cpu->lsqTail+1;
+		while(cpu->lsqHead!=end && !(&cpu->lsq_list[cpu->lsqHead])->allocated)
+			cpu->lsqHead=cpu->lsqHead==LSQ_SIZE-1 ? 0 : cpu->lsqHead+1;
+	}
+	
+	
+	if((cpu->thread->robHead-cpu->thread->robTail)==1)
+		cpu->thread->crossOver=2;
+	
+	
+	// the branch that caused the flush has executed, later ones see the flag again
+	(&cpu->thread->rat[RAT_ZERO_FLAG])->branch_available=0;
+	
+	// new code:  to reset the cfid index when all instruction after a taken branch are flushed
+	if(!isHalt)
+		cpu->thread->cfidTail=cfidIndex;
+	
+	
+	//intFuBusy=0;
+	//mulFuBusy=0;
+	//memFuBusy=0;
+	
+	return 0;
+}
+
+
+/*
+ * With SMT the other threads run on after a HALT commits. The halting
+ * thread's LSQ entries and accesses in flight, all younger than the HALT,
+ * are dropped so they can not complete into registers reused by another
+ * thread, and its committed registers stay allocated as its final state.
+ */
+static int flushHaltedThread(APEX_CPU* cpu)
+{
+	for(int i=0;i<MEM_MAX_INFLIGHT;i++)
+	{
+		if((&(&cpu->memFuncUnit)->inflight[i])->thread==cpu->thread->id)
+			(&(&cpu->memFuncUnit)->inflight[i])->valid=0;
+	}
+	if(cpu->mulFuBusy && (&cpu->mulFuncUnit)->thread==cpu->thread->id)
+	{
+		cpu->mulFuBusy=0;
+		cpu->mulFuClock=0;
+	}
+	
+	for(int i=0;i<RAT_SIZE;i++)
+	{
+		if((&cpu->thread->rRat[i])->allocated)
+			(&cpu->urf_regs[(&cpu->thread->rRat[i])->urf_reg])->isFree=0;
+	}
+	
+	if(cpu->lsqHead==-1 || cpu->lsqTail==-1)
+		return 0;
+	
+	for(int i=0;i<LSQ_SIZE;i++)
+	{
+		if((&(&cpu->lsq_list[i])->stage)->thread==cpu->thread->id)
+			(&cpu->lsq_list[i])->allocated=0;
+	}
+	
+	// shrink the queue past the holes at both ends
+	int end=cpu->lsqTail==LSQ_SIZE-1 ? 0 : cpu->lsqTail+1;
+	while(cpu->lsqHead!=end && !(&cpu->lsq_list[cpu->lsqHead])->allocated)
+		cpu->lsqHead=cpu->lsqHead==LSQ_SIZE-1 ? 0 : cpu->lsqHead+1;
+	while(cpu->lsqHead!=end && !(&cpu->lsq_list[cpu->lsqTail])->allocated)
+	{
+		cpu->lsqTail=cpu->lsqTail==0 ? LSQ_SIZE-1 : cpu->lsqTail-1;
+		end=cpu->lsqTail==LSQ_SIZE-1 ? 0 : cpu->lsqTail+1;
+	}
+	return 0;
+}
+
+int flushInstruction_halt(APEX_CPU* cpu,int cfidIndex,int isHalt)
+{
+		for(int j=0;j<IQ_SIZE;j++)
+		{
+			if((&(&cpu->iq_list[j])->stage)->thread==cpu->thread->id)
+				(&cpu->iq_list[j])->allocated=0;
+		}
+	
+	// flush instructions from lsq, with SMT the other threads keep theirs
+	if(cpu->threadCount==1)
+	{
+		cpu->lsqHead=-1;
+		cpu->lsqTail=-1;
+	}
+	
+	int flushDone=0;
+	
+	// flush instructions from rob
+	for(int m=cpu->thread->robTail;m>=cpu->thread->robHead;m--)
+	{
+		
+		//if(m==robHead && strcmp(((&cpu->thread->rob_list[m])->stage)->opcode,"HALT")==0)
+			
+		
+		//if(((&cpu->thread->rob_list[m])->stage).cfidIndex>=cfidIndex)
+		//{
+			flushDone=1;
+			(&cpu->thread->rob_list[m])->status=0;
+			cancelMemAccess(cpu,&(&cpu->thread->rob_list[m])->stage);
+			
+			if(strcmp(((&cpu->thread->rob_list[m])->stage).opcode,"STORE")!=0 && strcmp(((&cpu->thread->rob_list[m])->stage).opcode,"")!=0 
+			&& strcmp(((&cpu->thread->rob_list[m])->stage).opcode,"JUMP")!=0 && strcmp(((&cpu->thread->rob_list[m])->stage).opcode,"BZ")!=0 
+			&& strcmp(((&cpu->thread->rob_list[m])->stage).opcode,"BNZ")!=0 && strcmp(((&cpu->thread->rob_list[m])->stage).opcode,"HALT")!=0)
+			{
+				(&cpu->thread->rat[((&cpu->thread->rob_list[m])->stage).rd])->urf_reg=((&cpu->thread->rob_list[m])->stage).last_saved_urf_reg;
+				(&cpu->thread->rat[((&cpu->thread->rob_list[m])->stage).rd])->allocated=((&cpu->thread->rob_list[m])->stage).last_saved_urf_allocated;
+				
+				if(((&cpu->thread->rob_list[m])->stage).last_saved_urf_reg!=100)
+					(&cpu->urf_regs[((&cpu->thread->rob_list[m])->stage).last_saved_urf_reg])->isFree=0;
+				//(&cpu->urf_regs[((&cpu->thread->rob_list[m])->stage).last_saved_urf_reg])->valid=1;
+				
+				if(strcmp(((&cpu->thread->rob_list[m])->stage).opcode,"LOAD")!=0)
+				{
+					(&cpu->thread->rat[RAT_ZERO_FLAG])->urf_reg=((&cpu->thread->rob_list[m])->stage).last_saved_urf_reg;
+					(&cpu->thread->rat[RAT_ZERO_FLAG])->allocated=((&cpu->thread->rob_list[m])->stage).last_saved_urf_allocated;
+					(&cpu->thread->rat[RAT_ZERO_FLAG])->branch_available=0;
+				}
+				
+				//if(!isHalt)
+				//	(&cpu->urf_regs[((&cpu->thread->rob_list[m])->stage).urf_dest_reg])->isFree=1;
+			
+				int present=checkInRat(cpu,((&cpu->thread->rob_list[m])->stage).urf_dest_reg);
+				if(!present)
+					(&cpu->urf_regs[((&cpu->thread->rob_list[m])->stage).urf_dest_reg])->isFree=1;
+				
+				(&cpu->urf_regs[((&cpu->thread->rob_list[m])->stage).urf_dest_reg])->valid=1;
+				
+				
+			}
+			
+			cpu->thread->robTail--;
+		//}
+	}
+	
+	
+	/// new code added
+	if(!flushDone)
+	{
+		if(cpu->thread->robTail<cpu->thread->robHead)
+		{
+			for(int m=cpu->thread->robTail;m!=cpu->thread->robHead;)
+			{
+				
+				//if(((&cpu->thread->rob_list[m])->stage).cfidIndex>=cfidIndex)
+					
+			//{
+			//flushDone=1;
+			(&cpu->thread->rob_list[m])->status=0;
+			cancelMemAccess(cpu,&(&cpu->thread->rob_list[m])->stage);
+			
+			if(strcmp(((&cpu->thread->rob_list[m])->stage).opcode,"STORE")!=0 && strcmp(((&cpu->thread->rob_list[m])->stage).opcode,"")!=0 
+			&& strcmp(((&cpu->thread->rob_list[m])->stage).opcode,"JUMP")!=0 && strcmp(((&cpu->thread->rob_list[m])->stage).opcode,"BZ")!=0 
+			&& strcmp(((&cpu->thread->rob_list[m])->stage).opcode,"BNZ")!=0 && strcmp(((&cpu->thread->rob_list[m])->stage).opcode,"HALT")!=0)
+			{
+				(&cpu->thread->rat[((&cpu->thread->rob_list[m])->stage).rd])->urf_reg=((&cpu->thread->rob_list[m])->stage).last_saved_urf_reg;
+				(&cpu->thread->rat[((&cpu->thread->rob_list[m])->stage).rd])->allocated=((&cpu->thread->rob_list[m])->stage).last_saved_urf_allocated;
+				
+				if(((&cpu->thread->rob_list[m])->stage).last_saved_urf_reg!=100)
+					(&cpu->urf_regs[((&cpu->thread->rob_list[m])->stage).last_saved_urf_reg])->isFree=0;
+				//(&cpu->urf_regs[((&cpu->thread->rob_list[m])->stage).last_saved_urf_reg])->valid=1;
+				
+				if(strcmp(((&cpu->thread->rob_list[m])->stage).opcode,"LOAD")!=0)
+				{
+					(&cpu->thread->rat[RAT_ZERO_FLAG])->urf_reg=((&cpu->thread->rob_list[m])->stage).last_saved_urf_reg;
+					(&cpu->thread->rat[RAT_ZERO_FLAG])->allocated=((&cpu->thread->rob_list[m])->stage).last_saved_urf_allocated;
+					(&cpu->thread->rat[RAT_ZERO_FLAG])->branch_available=0;
+				}
+				
+				//if(!isHalt)
+				//	(&cpu->urf_regs[((&cpu->thread->rob_list[m])->stage).urf_dest_reg])->isFree=1;
+			
+				int present=checkInRat(cpu,((&cpu->thread->rob_list[m])->stage).urf_dest_reg);
+				if(!present)
+					(&cpu->urf_regs[((&cpu->thread->rob_list[m])->stage).urf_dest_reg])->isFree=1;
+				
+				(&cpu->urf_regs[((&cpu->thread->rob_list[m])->stage).urf_dest_reg])->valid=1;
+				
+				
+			}
+			
+			if(cpu->thread->robTail==0)
+				cpu->thread->robTail=ROB_SIZE-1;
+			else
+				cpu->thread->robTail--;
+						
+			m=cpu->thread->robTail;
+		//}
+		
+			}
+		}
+	}
+	
+	//
+	//if(crossOver==1)
+	//{
+		if((cpu->thread->robHead-cpu->thread->robTail)==1)
+			cpu->thread->crossOver=2;
+	//}
+	
+	
+	
+	// handle renamed registers in previous decode stage
+	if(strcmp((&cpu->thread->stage[IQ])->opcode,"STORE")!=0 && strcmp((&cpu->thread->stage[IQ])->opcode,"")!=0 
+			&& strcmp((&cpu->thread->stage[IQ])->opcode,"JUMP")!=0 && strcmp((&cpu->thread->stage[IQ])->opcode,"BZ")!=0 
+			&& strcmp((&cpu->thread->stage[IQ])->opcode,"BNZ")!=0 && strcmp((&cpu->thread->stage[IQ])->opcode,"HALT")!=0)
+			{
+				
+				(&cpu->thread->rat[(&cpu->thread->stage[IQ])->rd])->urf_reg=(&cpu->thread->stage[IQ])->last_saved_urf_reg;
+				(&cpu->thread->rat[(&cpu->thread->stage[IQ])->rd])->allocated=(&cpu->thread->stage[IQ])->last_saved_urf_allocated;
+				
+				if((&cpu->thread->stage[IQ])->last_saved_urf_reg!=100)
+					(&cpu->urf_regs[(&cpu->thread->stage[IQ])->last_saved_urf_reg])->isFree=0;
+				//(&cpu->urf_regs[(&cpu->thread->stage[IQ])->last_saved_urf_reg])->valid=1;
+				
+				if(strcmp((&cpu->thread->stage[IQ])->opcode,"LOAD")!=0)
+				{
+					(&cpu->thread->rat[RAT_ZERO_FLAG])->urf_reg=(&cpu->thread->stage[IQ])->last_saved_urf_reg;
+					(&cpu->thread->rat[RAT_ZERO_FLAG])->allocated=(&cpu->thread->stage[IQ])->last_saved_urf_allocated;
+					(&cpu->thread->rat[RAT_ZERO_FLAG])->branch_available=0;
+				}
+				
+				//if(!isHalt)
+				//	(&cpu->urf_regs[(&cpu->thread->stage[IQ])->urf_dest_reg])->isFree=1;
+				
+				int present=checkInRat(cpu,(&cpu->thread->stage[IQ])->urf_dest_reg);
+				if(!present)
+					(&cpu->urf_regs[(&cpu->thread->stage[IQ])->urf_dest_reg])->isFree=1;
+				
+				(&cpu->urf_regs[(&cpu->thread->stage[IQ])->urf_dest_reg])->valid=1;
+				
+			}
+	
+	
+	if(cpu->threadCount>1)
+		flushHaltedThread(cpu);
+	
+	//intFuBusy=0;
+	//mulFuBusy=0;
+	//memFuBusy=0;
+	
+	return 0;
+}
+
+int checkInRat(APEX_CPU* cpu,int urf_dest_reg)
+{
+	int alreadyPresent=0;
+	for(int i=0;i<ARCH_REGS;i++)
+	{
+		if((&cpu->thread->rat[i])->urf_reg==urf_dest_reg)
+		{
+			alreadyPresent=1;
+			break;
+		}
+		
+	}
+	
+	return alreadyPresent;
+}
+/*
+ * Whether display mode prints this cycle. Cycles outside the window run
+ * with the debug messages off, at simulate speed.
+ */
+static int displayWindowOpen(APEX_CPU* cpu)
+{
+	long long cycle=cpu->clock+1;
+	
+	if(displayPc && !displayTriggered)
+	{
+		int fetchPc=cpu->thread->old_pc>0 ? cpu->thread->old_pc : cpu->thread->pc;
+		if(fetchPc!=displayPc)
+			return 0;
+		displayTriggered=1;
+	}
+	return cycle>=displayFrom && (!displayTo || cycle<=displayTo);
+}
+
+/*
+ * The run ends at the cycle limit, or once every thread committed its HALT
+ * and the memory accesses in flight are done, or a replayed trace drained
+ */
+int APEX_cpu_finished(APEX_CPU* cpu)
+{
+	if(cpu->clock>=inputClockCycles || cpu->ins_completed>=maxInstructions || insnTraceDrained(cpu))
+		return 1;
+	return APEX_cpu_halted(cpu);
+}
+
+/*
+ * Every thread has committed its HALT and no store is still writing memory
+ */
+int APEX_cpu_halted(APEX_CPU* cpu)
+{
+	if(cpu->memFuBusy)
+		return 0;
+	
+	for(int i=0;i<cpu->threadCount;i++)
+	{
+		if(!cpu->threads[i].haltAtRobHead)
+			return 0;
+	}
+	return 1;
+}
+
+/*
+ * Simulates one clock cycle
+ */
+int APEX_cpu_step(APEX_CPU* cpu)
+{
+	if (displayMode) {
+		ENABLE_DEBUG_MESSAGES=displayWindowOpen(cpu);
+	}
+	if (DEBUG_MESSAGES) {
+		fprintf(cpu->out,"\n--------------------------------\n");
+		fprintf(cpu->out,"Clock Cycle #: %lld\n", cpu->clock+1);
+		fprintf(cpu->out,"--------------------------------\n");
+	}
+	
+	// flush and commit run for every thread, the function units switch
+	// cpu->thread to the thread of the instruction they work on
+	for(int t=0;t<cpu->threadCount;t++)
+	{
+		cpu->thread=&cpu->threads[t];
+		if(cpu->thread->ctrlOccur && cpu->thread->bTaken)
+		{
+			cpu->thread->bTaken=0;
+			cpu->thread->ctrlOccur=0;
+			FAST_FORWARD_FLUSH(cpu);
+			INSN_TRACE_FLUSH(cpu);
+			TIMED_STAGE(cpu,TIMING_FLUSH,flushInstruction(cpu,(&cpu->thread->stage[IQ])->cfidIndex,0));
+			cpu->flushes++;
+			cpu->thread->flushes++;
+			cpu->thread->old_pc=0;
+			CPU_Stage dummyStage;
+			dummyStage.stalled=1;
+			cpu->thread->stage[DRF]=dummyStage;
+			cpu->thread->stage[IQ]=dummyStage;
+		}
+	}
+	
+	for(int t=0;t<cpu->threadCount;t++)
+	{
+		cpu->thread=&cpu->threads[t];
+		TIMED_STAGE(cpu,TIMING_COMMIT_TO_RRAT,commitToRrat(cpu));
+		TIMED_STAGE(cpu,TIMING_INST_AT_ROB_HEAD,instAtRobHead(cpu));
+	}
+	
+	arbitrateResultBuses(cpu);
+	TIMED_STAGE(cpu,TIMING_MEM_FU,memFuncUnit(cpu));
+	TIMED_STAGE(cpu,TIMING_INT_FU,intFuncUnit(cpu));
+	TIMED_STAGE(cpu,TIMING_MUL_FU,mulFuncUnit(cpu));
+	
+	// one thread gets fetch, decode and dispatch this cycle
+	int frontEnd=smtSelectThread(cpu);
+	if(frontEnd>-1)
+	{
+		cpu->thread=&cpu->threads[frontEnd];
+		if (DEBUG_MESSAGES && cpu->threadCount>1) {
+			fprintf(cpu->out,"Front end thread: %d\n", frontEnd);
+		}
+		TIMED_STAGE(cpu,TIMING_IQ_STAGE,iqStage(cpu));
+	}
+	
+	TIMED_STAGE(cpu,TIMING_FWD_TO_IQ,FwdToIssueQueue(cpu));
+	TIMED_STAGE(cpu,TIMING_FWD_TO_LSQ,FwdToLSQ(cpu));
+	
+	if(frontEnd>-1)
+	{
+		TIMED_STAGE(cpu,TIMING_DECODE,decode(cpu));
+		TIMED_STAGE(cpu,TIMING_FETCH,fetch(cpu));
+	}
+	
+	if (DEBUG_MESSAGES) {
+		printIQ(cpu);
+		printRat(cpu);
+		printrRat(cpu);
+		printLsq(cpu);
+		printRob(cpu);
+		printRetiredInstruction(cpu);
+	}
+	
+	PROBE_END_CYCLE(cpu);
+	cpu->clock++;
+	INTERVAL_TICK(cpu);
+	return 0;
+}
+
+int
+APEX_cpu_run(APEX_CPU* cpu)
+{
+	STAGE_TIMING_BEGIN(cpu);
+	runControlBegin(cpu);
+	fastForwardBegin(cpu);
+	
+	while (!APEX_cpu_finished(cpu))
+	{
+		APEX_cpu_step(cpu);
+		FAST_FORWARD_POINT(cpu);
+		if (RUN_CONTROL_CHECK(cpu))
+			break;
+	}
+	
+	runControlEnd(cpu);
+	STAGE_TIMING_END(cpu);
+	
+	return 0;
+}
+
+/*
+ * Matches a "--name=value" command line option, value points past the '='
+ */
+int matchOption(const char* arg,const char* name,const char** value)
+{
+	int len=strlen(name);
+	
+	if(strncmp(arg,name,len)!=0 || arg[len]!='=')
+		return 0;
+	
+	*value=arg+len+1;
+	return 1;
+}
+
+int APEX_parse_option(const char* arg)
+{
+	const char* value;
+	
+	if(matchOption(arg,"--lsq-ooo-loads",&value))
+	{
+		lsqOooLoads=atoi(value);
+		return 0;
+	}
+	if(matchOption(arg,"--result-buses",&value))
+	{
+		resultBuses=atoi(value);
+		return resultBuses>=1 && resultBuses<=FWD_BUS_SIZE ? 0 : -1;
+	}
+	if(matchOption(arg,"--bench",&value))
+	{
+		benchOutput=atoi(value);
+		return 0;
+	}
+	if(matchOption(arg,"--display-from",&value))
+	{
+		displayFrom=atoll(value);
+		return 0;
+	}
+	if(matchOption(arg,"--display-to",&value))
+	{
+		displayTo=atoll(value);
+		return 0;
+	}
+	if(matchOption(arg,"--display-pc",&value))
+	{
+		displayPc=atoi(value);
+		return 0;
+	}
+	if(icacheParseOption(arg))
+		return 0;
+	if(dcacheParseOption(arg))
+		return 0;
+	if(prefetchParseOption(arg))
+		return 0;
+	if(stageTimingParseOption(arg))
+		return 0;
+	if(aotParseOption(arg))
+		return 0;
+	if(smtParseOption(arg))
+		return 0;
+	if(multicoreParseOption(arg))
+		return 0;
+	if(runControlParseOption(arg))
+		return 0;
+	if(probeParseOption(arg))
+		return 0;
+	if(intervalParseOption(arg))
+		return 0;
+	if(fastForwardParseOption(arg))
+		return 0;
+	if(insnTraceParseOption(arg))
+		return 0;
+	if(commitLogParseOption(arg))
+		return 0;
+	if(stateDigestParseOption(arg))
+		return 0;
+	
+	return -1;
+}
+
+/*
+ * Runs the cpu and records the host time the run took
+ */
+int APEX_cpu_timed_run(APEX_CPU* cpu)
+{
+	struct timespec start,end;
+	
+	clock_gettime(CLOCK_MONOTONIC,&start);
+	APEX_cpu_run(cpu);
+	clock_gettime(CLOCK_MONOTONIC,&end);
+	
+	cpu->hostSeconds=(end.tv_sec-start.tv_sec)+(end.tv_nsec-start.tv_nsec)/1e9;
+	return 0;
+}
+
+/*
+ * Prints the end of run state and statistics, or one CSV row of
+ * cycles,instructions,ipc,host_seconds,kips with --bench=1
+ */
+int printRunResults(APEX_CPU* cpu)
+{
+	double ipc=cpu->clock ? (double)cpu->ins_completed/cpu->clock : 0.0;
+	double kips=cpu->hostSeconds>0 ? cpu->ins_completed/cpu->hostSeconds/1000.0 : 0.0;
+	
+	if(benchOutput)
+	{
+		fprintf(cpu->out,"%lld,%lld,%.4f,%.6f,%.1f\n",cpu->clock,cpu->ins_completed,ipc,cpu->hostSeconds,kips);
+		return 0;
+	}
+	
+	printRegs(cpu);
+	// with SMT every thread prints its registers in its own section
+	if(cpu->threadCount==1)
+	{
+		readArchState(cpu);
+		printArchRegs(cpu);
+	}
+	printMemData(cpu);
+	printIcacheStats(cpu);
+	printDcacheStats(cpu);
+	printPrefetchStats(cpu);
+	printLsqStats(cpu);
+	printResultBusStats(cpu);
+	printSmtStats(cpu);
+	printFastForwardStats(cpu);
+	printInsnTraceStats(cpu);
+	printCommitLogStats(cpu);
+	printStateDigestStats(cpu);
+	printStageTiming(cpu);
+	
+	fprintf(cpu->out,"\n========== SIMULATION STATISTICS ==========\n");
+	fprintf(cpu->out,"|    Cycles\t\t|\t%lld\t|\n",cpu->clock);
+	fprintf(cpu->out,"|    Instructions\t|\t%lld\t|\n",cpu->ins_completed);
+	fprintf(cpu->out,"|    IPC\t\t|\t%.4f\t|\n",ipc);
+	fprintf(cpu->out,"|    Dispatch Stalls\t|\t%lld\t|\n",cpu->dispatchStalls);
+	fprintf(cpu->out,"|    Branch Flushes\t|\t%lld\t|\n",cpu->flushes);
+	fprintf(cpu->out,"|    Host Seconds\t|\t%.6f\t|\n",cpu->hostSeconds);
+	fprintf(cpu->out,"|    Simulated KIPS\t|\t%.1f\t|\n",kips);
+	
+	return 0;
+}
+
+/*
+ * Re-applies the configuration options to a cpu that has not run yet, a
+ * warm cpu of the serve operation takes the options of each run this way
+ */
+int APEX_cpu_configure(APEX_CPU* cpu,const char* filename)
+{
+	cpu->threadCount=1;
+	cpu->robPartition=ROB_SIZE;
+	
+	if(icacheInit(cpu)<0 || dcacheInit(cpu)<0 || prefetchInit(cpu)<0 || stageTimingInit(cpu)<0
+	|| probeInit(cpu)<0 || intervalInit(cpu)<0 || fastForwardInit(cpu)<0 || insnTraceInit(cpu)<0
+	|| commitLogInit(cpu)<0 || smtInit(cpu,filename)<0)
+		return -1;
+	return stateDigestInit(cpu);
+}
+
+/*
+ * The simulate operation on an initialized cpu, runs it for
+ * inputClockCycles and prints the results
+ */
+int APEX_cpu_simulate(APEX_CPU* cpu)
+{
+	// functional run only, the cycle count caps the instructions executed
+	if(aotEnabled)
+	{
+		if(cpu->threadCount>1)
+		{
+			fprintf(cpu->err, "APEX_Error : --aot runs a single hardware thread, drop --smt-threads\n");
+			return -1;
+		}
+		if(aotRun(cpu,inputClockCycles)<0)
+			return -1;
+		printAotResults(cpu);
+		return 0;
+	}
+	
+	APEX_cpu_timed_run(cpu);
+	printRunResults(cpu);
+	return 0;
+}
+
+int APEX_cpu_start(const char* filename,const char* operation,const char* cycles)
+{
+	APEX_CPU* cpu;
+	
+	if(strstr(operation, "initialize") != NULL)
+	{
+		 cpu=APEX_cpu_init(filename);
+		 
+		 if (!cpu) {
+			fprintf(stderr, "APEX_Error : Unable to initialize CPU\n");
+			exit(1);
+		}
+	}
+	if(strstr(operation, "display") != NULL)
+	{
+#ifdef APEX_QUIET_CORE
+		fprintf(stderr, "APEX_Error : display needs the debug build, use apex_sim\n");
+		exit(1);
+#endif
+		if(displayFrom<0 || displayTo<0 || (displayTo && displayTo<displayFrom))
+		{
+			fprintf(stderr, "APEX_Error : Invalid display window from=%lld to=%lld\n",displayFrom,displayTo);
+			exit(1);
+		}
+		
+		// a cycle is dozens of small printf calls, hand them to the terminal in bulk
+		setvbuf(stdout,NULL,_IOFBF,DISPLAY_BUFFER_SIZE);
+		ENABLE_DEBUG_MESSAGES=1;
+		displayMode=1;
+		
+		cpu=APEX_cpu_init(filename);
+		if (!cpu) {
+				fprintf(stderr, "APEX_Error : Unable to initialize CPU\n");
+				exit(1);
+			}
+		
+		inputClockCycles=runControlCycles(cycles);	
+		APEX_cpu_timed_run(cpu);
+		printRunResults(cpu);
+		APEX_cpu_stop(cpu);
+	}
+	if (strstr(operation, "debug") != NULL)
+	{
+		if(smtThreads>1)
+		{
+			fprintf(stderr, "APEX_Error : debug runs a single hardware thread, drop --smt-threads\n");
+			exit(1);
+		}
+		cpu=APEX_cpu_init(filename);
+		if (!cpu) {
+			fprintf(stderr, "APEX_Error : Unable to initialize CPU\n");
+			exit(1);
+		}
+		
+		inputClockCycles=runControlCycles(cycles);
+		debuggerRun(cpu);
+		APEX_cpu_stop(cpu);
+	}
+	if (strstr(operation, "simulate") != NULL) 
+	{
+		ENABLE_DEBUG_MESSAGES=0;
+		if(multicoreCores>1)
+		{
+			if(multicoreRun(filename,runControlCycles(cycles))<0)
+				exit(1);
+			return 0;
+		}
+			cpu=APEX_cpu_init(filename);
+			
+			if (!cpu) {
+				fprintf(stderr, "APEX_Error : Unable to initialize CPU\n");
+				exit(1);
+			}
+		
+		inputClockCycles=runControlCycles(cycles);
+		if(APEX_cpu_simulate(cpu)<0)
+			exit(1);
+		APEX_cpu_stop(cpu);
+	}
+	if (strstr(operation, "serve") != NULL)
+	{
+		ENABLE_DEBUG_MESSAGES=0;
+		if(serveRun(filename,cycles)<0)
+			exit(1);
+	}
+	
+	return 0;
+    
+}
+
+int printRegs(APEX_CPU* cpu)
+{
+	fprintf(cpu->out,"\n========== STATE OF ARCHITECTURAL REGISTER FILE ==========\n");
+	for(int i=0;i<URF_SIZE;i++)
+	{
+		if(!(cpu->urf_regs[i]).isFree)
+			fprintf(cpu->out,"|    URF[%d]\t|\tValue=%-9d|    Status=%-9s|\n",i,(cpu->urf_regs[i]).value,((cpu->urf_regs[i]).valid?"VALID":"INVALID"));
+	}
+	
+	return 0;
+}
+
+/*
+ * Committed architectural registers and zero flag, through the R-RAT,
+ * into cpu->thread->regs and cpu->thread->zeroFlag
+ */
+int readArchState(APEX_CPU* cpu)
+{
+	for(int i=0;i<RAT_SIZE;i++)
+	{
+		int value=0;
+		if((&cpu->thread->rRat[i])->allocated)
+		{
+			CPU_Register* reg=&cpu->urf_regs[(&cpu->thread->rRat[i])->urf_reg];
+			value=i==RAT_ZERO_FLAG ? reg->zFlag : reg->value;
+		}
+		
+		if(i==RAT_ZERO_FLAG)
+			cpu->thread->zeroFlag=value;
+		else
+			cpu->thread->regs[i]=value;
+	}
+	return 0;
+}
+
+int printArchRegs(APEX_CPU* cpu)
+{
+	fprintf(cpu->out,"\n========== STATE OF ARCHITECTURAL REGISTERS ==========\n");
+	for(int i=0;i<ARCH_REGS;i++)
+		fprintf(cpu->out,"|    R%d\t\t|\tValue=%-9d|\n",i,cpu->thread->regs[i]);
+	fprintf(cpu->out,"|    Z\t\t|\tValue=%-9d|\n",cpu->thread->zeroFlag);
+	
+	return 0;
+}
+
+int printMemData(APEX_CPU* cpu)
+{
+	fprintf(cpu->out,"\n========== STATE OF DATA MEMORY ==========\n");
+	for(int i=0;i<100;i++)
+	{
+		fprintf(cpu->out,"|    MEM[%d]\t|\tData Value=%d\t|\n",i,cpu->data_memory[i]);
+	}
+	
+	return 0;
+}
+
+int checkFReg(APEX_CPU* cpu,int stageRd)
+{
+	for(int i=0;i<resultBuses;i++)
+	{
+		if((&cpu->fBus[i])->rs==stageRd)
+			return i;
+	}
+	return -1;
+}
+
+int printIQ(APEX_CPU* cpu)
+{
+	fprintf(cpu->out,"\n========== Details of IQ (Issue Queue) State ==========\n");
+	
+	for(int i=0;i<IQ_SIZE;i++)
+	{
+		if((&cpu->iq_list[i])->allocated)
+		{
+			char name[10];
+			sprintf(name,"IQ[%d]",i);
+			print_stage_content(name,(&(&cpu->iq_list[i])->stage),cpu);
+		}
+	}
+	
+	fprintf(cpu->out,"\n=====================================================\n");
+	
+	return 0;
+}
+
+int printRat(APEX_CPU* cpu)
+{
+	fprintf(cpu->out,"\n========== Details of RENAME TABLE (RAT) State ==========\n");
+	for(int i=0;i<ARCH_REGS;i++)
+	{
+		if((&cpu->thread->rat[i])->allocated)
+			fprintf(cpu->out,"|    RAT[%d]\t-->\tU%d\t|\n",i,(&cpu->thread->rat[i])->urf_reg);
+	}
+	
+	
+	fprintf(cpu->out,"\n=====================================================\n");
+	return 0;
+}
+
+
+int printrRat(APEX_CPU* cpu)
+{
+	fprintf(cpu->out,"\n========== Details of RENAME TABLE (R-RAT) State ==========\n");
+	for(int i=0;i<ARCH_REGS;i++)
+	{
+		if((&cpu->thread->rRat[i])->allocated)
+			fprintf(cpu->out,"|    R-RAT[%d]\t-->\tU%d\t|\n",i,(&cpu->thread->rRat[i])->urf_reg);
+	}
+	
+	
+	fprintf(cpu->out,"\n=====================================================\n");
+	return 0;
+}
+
+
+int printRob(APEX_CPU* cpu)
+{
+	fprintf(cpu->out,"\n========== Details of ROB (Reorder Buffer) State ==========\n");
+	
+	
+	if(cpu->thread->robHead<=cpu->thread->robTail)
+	{
+		for(int i=cpu->thread->robHead;i<=cpu->thread->robTail;i++)
+		{
+			if(i!=-1)
+			{
+				char name[10];
+				sprintf(name,"ROB[%d]",i);
+				print_stage_content(name,(&(&cpu->thread->rob_list[i])->stage),cpu);
+			}
+		}
+	}
+	else
+	{
+		if(cpu->thread->crossOver==2)
+		{
+			if((cpu->thread->robHead-cpu->thread->robTail)==1)
+				cpu->thread->crossOver=2;
+			else
+				cpu->thread->crossOver=0;
+			fprintf(cpu->out,"\n=====================================================\n");
+			return 0;
+		}
+			
+		int i=cpu->thread->robHead;
+		for(;i<=ROB_SIZE-1;i++)
+		{
+				char name[10];
+				sprintf(name,"ROB[%d]",i);
+				print_stage_content(name,(&(&cpu->thread->rob_list[i])->stage),cpu);
+		}
+		
+		i--;
+		if(i==ROB_SIZE-1)
+			i=0;
+		for(;i<=cpu->thread->robTail;i++)
+		{
+				char name[10];
+				sprintf(name,"ROB[%d]",i);
+				print_stage_content(name,(&(&cpu->thread->rob_list[i])->stage),cpu);
+		}
+	}
+	
+	
+	fprintf(cpu->out,"\n=====================================================\n");
+	
+	return 0;
+}
+
+int printLsq(APEX_CPU* cpu)
+{
+	fprintf(cpu->out,"\n========== Details of LSQ (Load-Store Queue) State ==========\n");
+	for(int i=0;i<LSQ_SIZE;i++)
+	{
+		if((&cpu->lsq_list[i])->allocated)
+		{
+			char name[10];
+			sprintf(name,"LSQ[%d]",i);
+			print_stage_content(name,(&(&cpu->lsq_list[i])->stage),cpu);
+		}
+	}
+	
+	fprintf(cpu->out,"\n=====================================================\n");
+	
+	return 0;
+}
+
+int printLsqStats(APEX_CPU* cpu)
+{
+	fprintf(cpu->out,"\n========== LSQ STATISTICS ==========\n");
+	fprintf(cpu->out,"|    Loads Issued Early\t|\t%lld\t|\n",cpu->loadsIssuedEarly);
+	fprintf(cpu->out,"|    Loads Forwarded\t|\t%lld\t|\n",cpu->loadsForwarded);
+	fprintf(cpu->out,"|    Conflict Stalls\t|\t%lld\t|\n",cpu->lsqConflictStalls);
+	
+	return 0;
+}
+
+/* With fewer result buses than function units, how often they contended */
+int printResultBusStats(APEX_CPU* cpu)
+{
+	if(resultBuses>=BUS_UNITS)
+		return 0;
+	
+	fprintf(cpu->out,"\n========== RESULT BUS STATISTICS ==========\n");
+	fprintf(cpu->out,"|    Result Buses\t|\t%d\t|\n",resultBuses);
+	fprintf(cpu->out,"|    INT Bus Stalls\t|\t%lld\t|\n",cpu->busConflicts[BUS_INT]);
+	fprintf(cpu->out,"|    MUL Bus Stalls\t|\t%lld\t|\n",cpu->busConflicts[BUS_MUL]);
+	fprintf(cpu->out,"|    MEM Bus Stalls\t|\t%lld\t|\n",cpu->busConflicts[BUS_MEM]);
+	fprintf(cpu->out,"|    Delayed Wakeups\t|\t%lld\t|\n",cpu->delayedWakeups);
+	
+	return 0;
+}
+
+int printRetiredInstruction(APEX_CPU* cpu)
+{
+	fprintf(cpu->out,"\n========== Details of ROB Retired Instructions ==========\n");
+	print_stage_content("",&cpu->thread->tempRobStage,cpu);
+	print_stage_content("",&cpu->thread->tempRobStage_1,cpu);
+	fprintf(cpu->out,"\n=====================================================\n");
+	
+	return 0;
 }
\ No newline at end of file
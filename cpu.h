@@ -1,279 +1,501 @@
-#ifndef _APEX_CPU_H_
-#define _APEX_CPU_H_
-/**
- *  cpu.h
- *  Contains various CPU and Pipeline Data structures
- *
- *  Author :
- *  Gaurav Kothari (gkothar1@binghamton.edu)
- *  State University of New York, Binghamton
- */
-
-enum
-{
-  F,
-  DRF,
-  IQ,
-  EX,
-  MEM,
-  WB,
-  NUM_STAGES
-};
-
-/* Format of an APEX instruction  */
-typedef struct APEX_Instruction
-{
-  char opcode[128];	// Operation Code
-  int rd;		    // Destination Register Address
-  int rs1;		    // Source-1 Register Address
-  int rs2;		    // Source-2 Register Address
-  int imm;		    // Literal Value
-} APEX_Instruction;
-
-/* Model of CPU stage latch */
-typedef struct CPU_Stage
-{
-  int pc;		    // Program Counter
-  char opcode[128];	// Operation Code
-  int rs1;		    // Source-1 Register Address
-  int rs2;		    // Source-2 Register Address
-  int rd;		    // Destination Register Address
-  int imm;		    // Literal Value
-  int rs1_value;	// Source-1 Register Value
-  int rs2_value;	// Source-2 Register Value
-  int buffer;		// Latch to hold some value
-  int mem_address;	// Computed Memory Address
-  int busy;		    // Flag to indicate, stage is performing some action
-  int stalled;		// Flag to indicate, stage is stalled
-  int zFlag;
-  
-  int urf_dest_reg;
-  int urf_dest_valid;
-  int rs1_value_valid;
-  int rs2_value_valid;
-  int urf_rs1_reg;
-  int urf_rs2_reg;
-  int setIq;
-  int cfidIndex;
-  
-  int last_saved_urf_reg;
-  int last_saved_urf_allocated;
-  
-} CPU_Stage;
-
-/* Model of Forwarding Bus */
-typedef struct CPU_Forward_Bus
-{
-	int rs;
-	int rs_value;
-	int zFlag;
-	int valid;
-} CPU_Forward_Bus;
-
-typedef struct CPU_IQ
-{
-	int allocated;
-	int clockCycle;
-	CPU_Stage stage;
-	char fuType[50];
-	int src1_valid;
-	int src2_valid;
-	
-	int robIndex;
-	int lsqIndex;
-}CPU_IQ;
-
-typedef struct CPU_LSQ
-{
-	int allocated;
-	int clockCycle;
-	CPU_Stage stage;
-	
-	int src1_valid;
-	int address_valid;
-	int robIndex;
-	int iqIndex;
-}CPU_LSQ;
-
-typedef struct CPU_ROB
-{
-	CPU_Stage stage;
-	int status;  // status = 1 is valid
-	int lsqIndex;
-	int iqIndex;
-}CPU_ROB;
-
-typedef struct CPU_Register
-{
-	int isFree;
-	int value;
-	int renamed;
-	int firstUse;
-	int valid;
-	int zFlag;
-}CPU_Register;
-
-typedef struct front_rename_table
-{
-	int allocated;
-	int urf_reg;
-	int branch_available;
-}front_rename_table;
-
-
-typedef struct bak_rename_table
-{
-	int allocated;
-	int urf_reg;
-}bak_rename_table;
-
-typedef struct multiply_func_unit
-{
-	int robIndex;
-}multiply_func_unit;
-
-typedef struct mem_func_unit
-{
-	int robIndex;
-}mem_func_unit;
-
-
-typedef struct Branch_CFID_Map
-{
-	CPU_Stage stage;
-	int cfidIndex;
-}Branch_CFID_Map;
-
-/* Model of APEX CPU */
-typedef struct APEX_CPU
-{
-  /* Clock cycles elasped */
-  int clock;
-  
-  /* Clock counter for multiply instruction */
-  int mulClock;
-  
-  /* Current program counter */
-  int pc;
-  
-  int old_pc;
-
-  /* Integer register file */
-  int regs[16];
-  int regs_valid[16];
-  
-  /* Zero flag */
-  int zeroFlag;
-
-  /* Array of 5 CPU_stage */
-  CPU_Stage stage[5];
-
-  /* Code Memory where instructions are stored */
-  APEX_Instruction* code_memory;
-  int code_memory_size;
-
-  /* Data Memory */
-  int data_memory[4096];
-
-  /* Some stats */
-  int ins_completed;
-  
-  CPU_Forward_Bus fBus[3];
-  
-  CPU_Register urf_regs[40];
-  CPU_IQ iq_list[16];
-  CPU_LSQ lsq_list[20];
-  CPU_ROB rob_list[32];
-  front_rename_table rat[17];		// 17 entries (last one for zero flag, rest for 16 arch registers)
-  bak_rename_table rRat[17];		// 17 entries (last one for zero flag, rest for 16 arch registers)
-  multiply_func_unit mulFuncUnit;
-  mem_func_unit memFuncUnit;
-  
-  Branch_CFID_Map b_cfid_map[16];
-
-} APEX_CPU;
-
-
-
-
-APEX_Instruction*
-create_code_memory(const char* filename, int* size);
-
-APEX_CPU*
-APEX_cpu_init(const char* filename);
-
-int APEX_cpu_start(const char* filename,const char* operation,const char* cycles);
-
-int
-APEX_cpu_run(APEX_CPU* cpu);
-
-void
-APEX_cpu_stop(APEX_CPU* cpu);
-
-int
-fetch(APEX_CPU* cpu);
-
-int
-decode(APEX_CPU* cpu);
-
-int
-execute(APEX_CPU* cpu);
-
-int
-memory(APEX_CPU* cpu);
-
-int
-writeback(APEX_CPU* cpu);
-
-int printRegs(APEX_CPU* cpu);
-
-int printMemData(APEX_CPU* cpu);
-
-int checkFReg(APEX_CPU* cpu,int stageRd);
-
-int readRegValue(APEX_CPU* cpu);
-
-int regRename(APEX_CPU* cpu);
-
-int setIQEntry(APEX_CPU* cpu);
-
-int setLSQEntry(APEX_CPU* cpu,int iqIndex);
-
-int setRobEntry(APEX_CPU* cpu);
-
-char* getfuType(CPU_Stage decodeStage);
-
-int intFuncUnit(APEX_CPU* cpu);
-
-int printIQ(APEX_CPU* cpu);
-
-int printRat(APEX_CPU* cpu);
-
-int printRob(APEX_CPU* cpu);
-
-int instAtRobHead(APEX_CPU* cpu);
-
-int commitToRrat(APEX_CPU* cpu);
-
-int printLsq(APEX_CPU* cpu);
-
-int printrRat(APEX_CPU* cpu);
-
-int writeOnFwdBus(APEX_CPU* cpu, CPU_Stage stage);
-
-CPU_Forward_Bus readFrmFwdBus(APEX_CPU* cpu,int urf_reg);
-
-int FwdToLSQ(APEX_CPU* cpu);
-
-int FwdToIssueQueue(APEX_CPU* cpu);
-
-int getReadyIQIndex(APEX_CPU* cpu,char fuType[10]);
-
-int printRetiredInstruction(APEX_CPU* cpu);
-
-int flushInstruction(APEX_CPU* cpu,int cfidIndex,int isHalt);
-
-int checkInRat(APEX_CPU* cpu,int urf_dest_reg);
-
-int flushInstruction_halt(APEX_CPU* cpu,int cfidIndex,int isHalt);
-#endif
+#ifndef _APEX_CPU_H_
+#define _APEX_CPU_H_
+/**
+ *  cpu.h
+ *  Contains various CPU and Pipeline Data structures
+ *
+ *  Author :
+ *  Gaurav Kothari (gkothar1@binghamton.edu)
+ *  State University of New York, Binghamton
+ */
+
+#include <stdio.h>
+
+#include "icache.h"
+#include "dcache.h"
+#include "prefetch.h"
+#include "stage_timing.h"
+#include "aot.h"
+#include "debugger.h"
+#include "multicore.h"
+#include "smt.h"
+#include "serve.h"
+#include "probe.h"
+#include "interval.h"
+#include "run_control.h"
+#include "fastforward.h"
+#include "insn_trace.h"
+#include "commit_log.h"
+#include "state_digest.h"
+
+/* stdout buffer of display mode */
+#define DISPLAY_BUFFER_SIZE (1<<20)
+
+/* Memory accesses the memory function unit can have in flight */
+#define MEM_MAX_INFLIGHT 16
+
+/* Structure sizes, compile time constants so the loops over them unroll */
+#define ARCH_REGS 16				// R0-R15
+#define RAT_ZERO_FLAG ARCH_REGS		// RAT and R-RAT entry of the zero flag
+#define RAT_SIZE (ARCH_REGS+1)
+#define URF_SIZE 40
+#define IQ_SIZE 16
+#define LSQ_SIZE 20
+#define ROB_SIZE 32
+#define CFID_SIZE 8
+#define FWD_BUS_SIZE 8				// result buses at most, --result-buses sets how many are used
+#define RESULT_BUSES 3				// unless told otherwise, one per function unit so results never contend
+#define SMT_MAX_THREADS ((URF_SIZE-1)/ARCH_REGS)	// every thread's committed registers fit the URF with one to spare
+#define DATA_MEMORY_SIZE 4096		// words
+
+/*
+ * Debug messages of the stage functions. Builds with -DAPEX_QUIET_CORE
+ * (the release, lto and pgo targets) compile them out, such a core has
+ * no display mode.
+ */
+#ifdef APEX_QUIET_CORE
+#define DEBUG_MESSAGES 0
+#else
+#define DEBUG_MESSAGES ENABLE_DEBUG_MESSAGES
+#endif
+
+extern int ENABLE_DEBUG_MESSAGES;
+
+/* Function unit an IQ entry issues to */
+enum
+{
+  FU_INT,
+  FU_MUL
+};
+
+/* Function units that put results on the forward bus, arbitrated for it */
+enum
+{
+  BUS_INT,
+  BUS_MUL,
+  BUS_MEM,
+  BUS_UNITS
+};
+
+enum
+{
+  F,
+  DRF,
+  IQ,
+  EX,
+  MEM,
+  WB,
+  NUM_STAGES
+};
+
+/* Format of an APEX instruction  */
+typedef struct APEX_Instruction
+{
+  char opcode[128];	// Operation Code
+  int rd;		    // Destination Register Address
+  int rs1;		    // Source-1 Register Address
+  int rs2;		    // Source-2 Register Address
+  int imm;		    // Literal Value
+} APEX_Instruction;
+
+/* Model of CPU stage latch */
+typedef struct CPU_Stage
+{
+  int pc;		    // Program Counter
+  char opcode[128];	// Operation Code
+  int rs1;		    // Source-1 Register Address
+  int rs2;		    // Source-2 Register Address
+  int rd;		    // Destination Register Address
+  int imm;		    // Literal Value
+  int rs1_value;	// Source-1 Register Value
+  int rs2_value;	// Source-2 Register Value
+  int buffer;		// Latch to hold some value
+  int mem_address;	// Computed Memory Address
+  int busy;		    // Flag to indicate, stage is performing some action
+  int stalled;		// Flag to indicate, stage is stalled
+  int zFlag;
+  
+  int urf_dest_reg;
+  int urf_dest_valid;
+  int rs1_value_valid;
+  int rs2_value_valid;
+  int urf_rs1_reg;
+  int urf_rs2_reg;
+  int setIq;
+  int cfidIndex;
+  
+  int last_saved_urf_reg;
+  int last_saved_urf_allocated;
+  int flag_renamed;			// this instruction moved the zero flag entry of the RAT
+  int last_saved_flag_reg;
+  
+  long long seq;	// dispatch order, a ROB entry reused by a later instruction gets a new one
+  int thread;		// hardware thread the instruction belongs to
+  
+  int traced;		// on the correct path of a replayed --insn-trace
+  int traceValue;	// its recorded branch outcome, target or address
+  
+} CPU_Stage;
+
+/* Model of Forwarding Bus */
+typedef struct CPU_Forward_Bus
+{
+	int rs;
+	int rs_value;
+	int zFlag;
+	int valid;
+} CPU_Forward_Bus;
+
+typedef struct CPU_IQ
+{
+	int allocated;
+	long long clockCycle;
+	CPU_Stage stage;
+	int fuType;
+	int src1_valid;
+	int src2_valid;
+	
+	int robIndex;
+	int lsqIndex;
+}CPU_IQ;
+
+typedef struct CPU_LSQ
+{
+	int allocated;
+	long long clockCycle;
+	CPU_Stage stage;
+	
+	int src1_valid;
+	int address_valid;
+	int robIndex;
+	int iqIndex;
+}CPU_LSQ;
+
+typedef struct CPU_ROB
+{
+	CPU_Stage stage;
+	int status;  // status = 1 is valid
+	int lsqIndex;
+	int iqIndex;
+}CPU_ROB;
+
+typedef struct CPU_Register
+{
+	int isFree;
+	int value;
+	int renamed;
+	int firstUse;
+	int valid;
+	int zFlag;
+}CPU_Register;
+
+typedef struct front_rename_table
+{
+	int allocated;
+	int urf_reg;
+	int branch_available;
+}front_rename_table;
+
+
+typedef struct bak_rename_table
+{
+	int allocated;
+	int urf_reg;
+}bak_rename_table;
+
+typedef struct multiply_func_unit
+{
+	int robIndex;
+	int thread;
+}multiply_func_unit;
+
+typedef struct mem_access
+{
+	int valid;
+	int robIndex;
+	long long seq;			// of the LOAD or STORE, its ROB entry is still it while they match
+	int store;
+	int thread;
+	long long readyCycle;	// cycle the access completes and writes the forward bus
+}mem_access;
+
+typedef struct mem_func_unit
+{
+	mem_access inflight[MEM_MAX_INFLIGHT];
+}mem_func_unit;
+
+
+typedef struct Branch_CFID_Map
+{
+	CPU_Stage stage;
+	int cfidIndex;
+}Branch_CFID_Map;
+
+/* State of one hardware thread, the rest of APEX_CPU is shared by the threads */
+typedef struct CPU_Thread
+{
+  int id;
+  
+  /* Current program counter */
+  int pc;
+  
+  int old_pc;
+
+  /* Integer register file */
+  int regs[ARCH_REGS];
+  int regs_valid[ARCH_REGS];
+  
+  /* Zero flag */
+  int zeroFlag;
+
+  /* Array of 5 CPU_stage, the front end latches of this thread */
+  CPU_Stage stage[NUM_STAGES];
+
+  /* Code Memory where instructions are stored */
+  APEX_Instruction* code_memory;
+  int code_memory_size;
+  int program;				// code space, threads running the same program share it
+  APEX_Fetch_Block fetchBlock;
+  
+  CPU_ROB rob_list[ROB_SIZE];
+  front_rename_table rat[RAT_SIZE];		// last entry for zero flag, rest for the arch registers
+  bak_rename_table rRat[RAT_SIZE];		// last entry for zero flag, rest for the arch registers
+  
+  Branch_CFID_Map b_cfid_map[16];
+  
+  /* Pipeline control state */
+  int robHead;
+  int robTail;
+  int cfidHead;
+  int cfidTail;
+  int bTaken;			// a control instruction redirected fetch this cycle
+  int ctrlOccur;
+  int branchRobIndex;	// ROB entry of that control instruction, the flush keeps up to it
+  int crossOver;
+  int haltAtRobHead;
+  int haltExec;
+  int dispatchStall;
+  
+  /* Instructions retired this cycle, the R-RAT takes them next cycle */
+  CPU_Stage tempRobStage;
+  CPU_Stage tempRobStage_1;
+  int instRetired;
+  int instRetired_1;
+  
+  /* Some stats */
+  long long instructions;		// committed by this thread
+  long long flushes;
+  long long frontEndCycles;		// cycles the fetch policy gave the front end to this thread
+}CPU_Thread;
+
+/* Model of APEX CPU */
+typedef struct APEX_CPU
+{
+  /* Clock cycles elasped */
+  long long clock;
+  
+  /* Clock counter for multiply instruction */
+  int mulClock;
+  
+  /* Hardware threads, thread points at the one the stage functions work on */
+  CPU_Thread threads[SMT_MAX_THREADS];
+  CPU_Thread* thread;
+  int threadCount;
+  int robPartition;		// ROB entries each thread may hold
+  int fetchThread;		// thread the fetch policy picked last
+
+  /* Where the simulator prints its output and errors, stdout and stderr in apex_sim */
+  FILE* out;
+  FILE* err;
+
+  /* Data Memory */
+  int data_memory[DATA_MEMORY_SIZE];
+
+  /* Some stats */
+  long long ins_completed;
+  long long loadsIssuedEarly;	// LOADs sent to memory ahead of the LSQ head
+  long long loadsForwarded;		// LOADs that took their data from an older STORE
+  long long lsqConflictStalls;	// LOAD-cycles blocked by an older STORE
+  long long dispatchStalls;		// cycles decode waited on a full IQ, ROB, LSQ or URF
+  long long flushes;			// taken control transfers that squashed younger instructions
+  long long memAccesses;		// LOADs and STOREs sent to memory
+  long long busConflicts[BUS_UNITS];	// cycles a unit held a result for want of a result bus
+  long long delayedWakeups;		// held results an IQ or LSQ entry was waiting on, one per unit and cycle
+  double hostSeconds;			// host time spent in APEX_cpu_run
+  
+  CPU_Forward_Bus fBus[FWD_BUS_SIZE];
+  
+  CPU_Register urf_regs[URF_SIZE];
+  CPU_IQ iq_list[IQ_SIZE];
+  CPU_LSQ lsq_list[LSQ_SIZE];
+  multiply_func_unit mulFuncUnit;
+  mem_func_unit memFuncUnit;
+  long long dispatchSeq;	// instructions dispatched so far
+  
+  /* Pipeline control state */
+  int lsqHead;
+  int lsqTail;
+  int forwardIndex;		// next forward bus slot to write
+  int intFuBusy;
+  int memFuBusy;
+  int mulFuBusy;
+  int mulFuClock;		// cycles the MUL in the function unit has spent
+  int prevLoad;
+  int busGrant[BUS_UNITS];	// the unit may put a result on the bus this cycle
+  int busPriority;		// unit served first when results contend for the buses
+  
+  APEX_ICache icache;
+  APEX_DCache dcache;
+  APEX_Prefetcher prefetcher;
+  APEX_Stage_Timing timing;
+  APEX_Probe probe;
+  APEX_Interval interval;
+  APEX_Run_Control run;
+  APEX_Fast_Forward ff;
+  APEX_Insn_Trace insnTrace;
+  APEX_Commit_Log commitLog;
+  APEX_State_Digest digest;
+  APEX_AOT aot;
+
+} APEX_CPU;
+
+
+
+
+APEX_Instruction*
+create_code_memory(const char* filename, int* size);
+
+APEX_Instruction*
+create_code_memory_from_buffer(const char* text, int len, int* size);
+
+APEX_Instruction*
+create_code_memory_from_stream(FILE* fp, int* size);
+
+APEX_CPU*
+APEX_cpu_init(const char* filename);
+
+APEX_CPU*
+APEX_cpu_init_code(APEX_Instruction* code_memory, int size, const char* filename,
+                   FILE* out, FILE* err);
+
+int APEX_cpu_start(const char* filename,const char* operation,const char* cycles);
+
+int APEX_cpu_configure(APEX_CPU* cpu,const char* filename);
+
+int APEX_cpu_simulate(APEX_CPU* cpu);
+
+int
+APEX_cpu_run(APEX_CPU* cpu);
+
+int APEX_cpu_step(APEX_CPU* cpu);
+
+int APEX_cpu_finished(APEX_CPU* cpu);
+
+int APEX_cpu_halted(APEX_CPU* cpu);
+
+void
+APEX_cpu_stop(APEX_CPU* cpu);
+
+int
+fetch(APEX_CPU* cpu);
+
+int
+decode(APEX_CPU* cpu);
+
+int
+execute(APEX_CPU* cpu);
+
+int
+memory(APEX_CPU* cpu);
+
+int
+writeback(APEX_CPU* cpu);
+
+int printRegs(APEX_CPU* cpu);
+
+int printMemData(APEX_CPU* cpu);
+
+int readArchState(APEX_CPU* cpu);
+
+int printArchRegs(APEX_CPU* cpu);
+
+int checkFReg(APEX_CPU* cpu,int stageRd);
+
+int readRegValue(APEX_CPU* cpu);
+
+int readZeroFlag(APEX_CPU* cpu);
+
+int readCompletedRob(APEX_CPU* cpu,int urf_reg,int* value);
+
+int refreshSourceValues(APEX_CPU* cpu,CPU_Stage* stage);
+
+int regRename(APEX_CPU* cpu);
+
+int dispatchResourcesFree(APEX_CPU* cpu,CPU_Stage* stage);
+
+int setIQEntry(APEX_CPU* cpu);
+
+int setLSQEntry(APEX_CPU* cpu,int iqIndex);
+
+int setRobEntry(APEX_CPU* cpu);
+
+int getfuType(CPU_Stage* decodeStage);
+
+int intFuncUnit(APEX_CPU* cpu);
+
+int printIQ(APEX_CPU* cpu);
+
+int printRat(APEX_CPU* cpu);
+
+int printRob(APEX_CPU* cpu);
+
+int instAtRobHead(APEX_CPU* cpu);
+
+int commitToRrat(APEX_CPU* cpu);
+
+int printLsq(APEX_CPU* cpu);
+
+int printrRat(APEX_CPU* cpu);
+
+int writeOnFwdBus(APEX_CPU* cpu, CPU_Stage stage);
+
+CPU_Forward_Bus readFrmFwdBus(APEX_CPU* cpu,int urf_reg);
+
+int FwdToLSQ(APEX_CPU* cpu);
+
+int FwdToIssueQueue(APEX_CPU* cpu);
+
+int isControlInstruction(CPU_Stage* stage);
+
+int hasOlderIQEntry(APEX_CPU* cpu,long long clockCycle,int thread);
+
+int getReadyIQIndex(APEX_CPU* cpu,int fuType,int thread);
+
+CPU_IQ* selectIQEntry(APEX_CPU* cpu,int fuType);
+
+int printRetiredInstruction(APEX_CPU* cpu);
+
+int flushInstruction(APEX_CPU* cpu,int cfidIndex,int isHalt);
+
+int checkInRat(APEX_CPU* cpu,int urf_dest_reg);
+
+int flushInstruction_halt(APEX_CPU* cpu,int cfidIndex,int isHalt);
+
+int getReadyLSQIndex(APEX_CPU* cpu,int* fwdLsqIndex);
+
+int advanceLsqHead(APEX_CPU* cpu);
+
+int printLsqStats(APEX_CPU* cpu);
+
+int arbitrateResultBuses(APEX_CPU* cpu);
+
+int printResultBusStats(APEX_CPU* cpu);
+
+int APEX_cpu_timed_run(APEX_CPU* cpu);
+
+int printRunResults(APEX_CPU* cpu);
+
+int matchOption(const char* arg,const char* name,const char** value);
+
+int APEX_parse_option(const char* arg);
+#endif
@@ -0,0 +1,277 @@
+/*
+ *  dcache.c
+ *  Contains the data cache and MSHR model used by the memory function unit
+ *
+ *  Every access looks up the line presence table. A miss allocates an MSHR,
+ *  or merges with the MSHR already fetching the same line. When no MSHR is
+ *  free the access has to wait in the LSQ. Lines brought in by the
+ *  prefetcher carry the cycle they arrive.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+int dcacheEnabled=0;
+int dcacheSize=1024;		// bytes
+int dcacheAssoc=2;
+int dcacheLineSize=32;		// bytes
+int dcacheHitLatency=3;		// cycles, same as the memory unit without a cache
+int dcacheMissLatency=20;	// cycles
+int dcacheMshrs=4;
+
+int dcacheParseOption(const char* arg)
+{
+	const char* value;
+
+	if(matchOption(arg,"--dcache",&value))
+		dcacheEnabled=atoi(value);
+	else if(matchOption(arg,"--dcache-size",&value))
+		dcacheSize=atoi(value);
+	else if(matchOption(arg,"--dcache-assoc",&value))
+		dcacheAssoc=atoi(value);
+	else if(matchOption(arg,"--dcache-line",&value))
+		dcacheLineSize=atoi(value);
+	else if(matchOption(arg,"--dcache-hit-latency",&value))
+		dcacheHitLatency=atoi(value);
+	else if(matchOption(arg,"--dcache-miss-latency",&value))
+		dcacheMissLatency=atoi(value);
+	else if(matchOption(arg,"--mshrs",&value))
+		dcacheMshrs=atoi(value);
+	else
+		return 0;
+
+	return 1;
+}
+
+static int dcacheSets()
+{
+	return dcacheSize/(dcacheLineSize*dcacheAssoc);
+}
+
+int dcacheInit(APEX_CPU* cpu)
+{
+	if(dcacheHitLatency<1)
+		dcacheHitLatency=1;
+
+	if(!dcacheEnabled)
+		return 0;
+
+	if(dcacheLineSize<4 || (dcacheLineSize%4)!=0 || dcacheAssoc<1 || dcacheSets()<1
+	|| dcacheSets()*dcacheAssoc>DCACHE_MAX_LINES || dcacheMshrs<1 || dcacheMshrs>DCACHE_MAX_MSHRS
+	|| dcacheMissLatency<dcacheHitLatency)
+	{
+		fprintf(cpu->err,"APEX_Error : Invalid D-cache configuration size=%d assoc=%d line=%d mshrs=%d\n",
+				dcacheSize,dcacheAssoc,dcacheLineSize,dcacheMshrs);
+		return -1;
+	}
+
+	memset(&cpu->dcache,0,sizeof(cpu->dcache));
+	return 0;
+}
+
+/* Line address of a data memory word address */
+int dcacheLineAddr(int address)
+{
+	return (address*4)/dcacheLineSize;
+}
+
+static APEX_DCache_Line* dcacheLookup(APEX_CPU* cpu,int lineAddr)
+{
+	int set=(unsigned)lineAddr%dcacheSets();
+	APEX_DCache_Line* ways=&cpu->dcache.lines[set*dcacheAssoc];
+
+	for(int i=0;i<dcacheAssoc;i++)
+	{
+		if(ways[i].valid && ways[i].tag==lineAddr)
+			return &ways[i];
+	}
+	return NULL;
+}
+
+/* Installs a line, replacing the LRU way of its set */
+static APEX_DCache_Line* dcacheFill(APEX_CPU* cpu,int lineAddr)
+{
+	int set=(unsigned)lineAddr%dcacheSets();
+	APEX_DCache_Line* ways=&cpu->dcache.lines[set*dcacheAssoc];
+	APEX_DCache_Line* victim=&ways[0];
+
+	for(int i=0;i<dcacheAssoc;i++)
+	{
+		if(!ways[i].valid)
+		{
+			victim=&ways[i];
+			break;
+		}
+		if(ways[i].lastUse < victim->lastUse)
+			victim=&ways[i];
+	}
+
+	if(victim->valid && victim->prefetched)
+		cpu->prefetcher.useless++;
+
+	victim->valid=1;
+	victim->tag=lineAddr;
+	victim->lastUse=cpu->clock;
+	victim->readyCycle=cpu->clock;
+	victim->prefetched=0;
+	return victim;
+}
+
+/*
+ * Called once per cycle before the memory unit issues, retires completed
+ * line fills and samples the number of outstanding misses
+ */
+int dcacheTick(APEX_CPU* cpu)
+{
+	APEX_DCache* dc=&cpu->dcache;
+	int outstanding=0;
+
+	if(!dcacheEnabled)
+		return 0;
+
+	for(int i=0;i<dcacheMshrs;i++)
+	{
+		APEX_MSHR* mshr=&dc->mshr[i];
+		if(!mshr->valid)
+			continue;
+
+		if(mshr->readyCycle<=cpu->clock)
+		{
+			dcacheFill(cpu,mshr->lineAddr);
+			mshr->valid=0;
+		}
+		else
+			outstanding++;
+	}
+
+	if(outstanding)
+	{
+		dc->missCycles++;
+		dc->outstandingSum+=outstanding;
+		if(outstanding>dc->peakOutstanding)
+			dc->peakOutstanding=outstanding;
+	}
+	return 0;
+}
+
+/*
+ * Looks up a data memory word address. Returns 0 and the completion cycle
+ * in readyCycle, or -1 when the access misses and every MSHR is busy.
+ */
+int dcacheAccess(APEX_CPU* cpu,int address,long long* readyCycle)
+{
+	APEX_DCache* dc=&cpu->dcache;
+
+	if(!dcacheEnabled)
+	{
+		*readyCycle=cpu->clock+dcacheHitLatency-1;
+		return 0;
+	}
+
+	int lineAddr=dcacheLineAddr(address);
+	APEX_DCache_Line* line=dcacheLookup(cpu,lineAddr);
+	if(line)
+	{
+		dc->accesses++;
+		dc->hits++;
+		line->lastUse=cpu->clock;
+		*readyCycle=cpu->clock+dcacheHitLatency-1;
+		
+		// first demand use of a prefetched line, it may still be in flight
+		if(line->prefetched)
+		{
+			line->prefetched=0;
+			cpu->prefetcher.useful++;
+			if(line->readyCycle>cpu->clock)
+			{
+				cpu->prefetcher.late++;
+				if(line->readyCycle>*readyCycle)
+					*readyCycle=line->readyCycle;
+			}
+			prefetchObserveAccess(cpu,lineAddr,1);
+		}
+		return 0;
+	}
+
+	int freeMshr=-1;
+	for(int i=0;i<dcacheMshrs;i++)
+	{
+		APEX_MSHR* mshr=&dc->mshr[i];
+		if(mshr->valid && mshr->lineAddr==lineAddr)
+		{
+			dc->accesses++;
+			dc->mergedMisses++;
+			mshr->targets++;
+			*readyCycle=mshr->readyCycle;
+			return 0;
+		}
+		if(!mshr->valid && freeMshr==-1)
+			freeMshr=i;
+	}
+
+	if(freeMshr==-1)
+	{
+		dc->mshrFullStalls++;
+		return -1;
+	}
+
+	APEX_MSHR* mshr=&dc->mshr[freeMshr];
+	mshr->valid=1;
+	mshr->lineAddr=lineAddr;
+	mshr->readyCycle=cpu->clock+dcacheMissLatency-1;
+	mshr->targets=1;
+
+	dc->accesses++;
+	dc->misses++;
+	*readyCycle=mshr->readyCycle;
+	
+	prefetchObserveAccess(cpu,lineAddr,1);
+	return 0;
+}
+
+/*
+ * Brings a line into the presence table ahead of demand, it becomes usable
+ * after the miss latency. Returns 0 if the line is present or being fetched.
+ */
+int dcachePrefetch(APEX_CPU* cpu,int lineAddr)
+{
+	if(dcacheLookup(cpu,lineAddr))
+		return 0;
+
+	for(int i=0;i<dcacheMshrs;i++)
+	{
+		if(cpu->dcache.mshr[i].valid && cpu->dcache.mshr[i].lineAddr==lineAddr)
+			return 0;
+	}
+
+	APEX_DCache_Line* line=dcacheFill(cpu,lineAddr);
+	line->readyCycle=cpu->clock+dcacheMissLatency-1;
+	line->prefetched=1;
+	return 1;
+}
+
+int printDcacheStats(APEX_CPU* cpu)
+{
+	APEX_DCache* dc=&cpu->dcache;
+
+	if(!dcacheEnabled)
+		return 0;
+
+	fprintf(cpu->out,"\n========== D-CACHE STATISTICS ==========\n");
+	fprintf(cpu->out,"|    Geometry\t\t|\t%dB, %d-way, %dB lines, %d MSHRs\t|\n",
+			dcacheSize,dcacheAssoc,dcacheLineSize,dcacheMshrs);
+	fprintf(cpu->out,"|    Accesses\t\t|\t%lld\t|\n",dc->accesses);
+	fprintf(cpu->out,"|    Hits\t\t|\t%lld\t|\n",dc->hits);
+	fprintf(cpu->out,"|    Misses\t\t|\t%lld\t|\n",dc->misses);
+	fprintf(cpu->out,"|    Merged Misses\t|\t%lld\t|\n",dc->mergedMisses);
+	fprintf(cpu->out,"|    Miss Rate\t\t|\t%.2f%%\t|\n",
+			dc->accesses ? 100.0*(dc->misses+dc->mergedMisses)/dc->accesses : 0.0);
+	fprintf(cpu->out,"|    MSHR Full Stalls\t|\t%lld\t|\n",dc->mshrFullStalls);
+	fprintf(cpu->out,"|    Avg Outstanding\t|\t%.2f\t|\n",
+			dc->missCycles ? (double)dc->outstandingSum/dc->missCycles : 0.0);
+	fprintf(cpu->out,"|    Peak Outstanding\t|\t%d\t|\n",dc->peakOutstanding);
+
+	return 0;
+}
@@ -0,0 +1,75 @@
+#ifndef _APEX_DCACHE_H_
+#define _APEX_DCACHE_H_
+/**
+ *  dcache.h
+ *  Contains the data cache line presence table and MSHR data structures
+ */
+
+/* Upper bound on the number of lines (sets * ways) the model can hold */
+#define DCACHE_MAX_LINES 4096
+
+/* Upper bound on miss status holding registers */
+#define DCACHE_MAX_MSHRS 32
+
+struct APEX_CPU;
+
+/* One line of the data cache, only presence is modeled, data stays in data_memory */
+typedef struct APEX_DCache_Line
+{
+	int valid;
+	int tag;
+	long long lastUse;	// cycle of last access, used for LRU replacement
+	long long readyCycle;	// cycle a prefetched line arrives
+	int prefetched;		// brought in by the prefetcher and not used yet
+}APEX_DCache_Line;
+
+/* Miss status holding register, one outstanding line fill */
+typedef struct APEX_MSHR
+{
+	int valid;
+	int lineAddr;
+	long long readyCycle;	// cycle the line fill completes
+	int targets;			// accesses waiting on this fill
+}APEX_MSHR;
+
+/* Model of data cache */
+typedef struct APEX_DCache
+{
+	APEX_DCache_Line lines[DCACHE_MAX_LINES];
+	APEX_MSHR mshr[DCACHE_MAX_MSHRS];
+
+	/* Some stats */
+	long long accesses;
+	long long hits;
+	long long misses;			// primary misses, allocate an MSHR
+	long long mergedMisses;		// secondary misses to a line already in an MSHR
+	long long mshrFullStalls;	// cycles an access could not get an MSHR
+	long long missCycles;		// cycles with at least one outstanding miss
+	long long outstandingSum;	// sum of outstanding misses over those cycles
+	int peakOutstanding;
+}APEX_DCache;
+
+/* D-cache configuration, set from command line options */
+extern int dcacheEnabled;
+extern int dcacheSize;
+extern int dcacheAssoc;
+extern int dcacheLineSize;
+extern int dcacheHitLatency;
+extern int dcacheMissLatency;
+extern int dcacheMshrs;
+
+int dcacheParseOption(const char* arg);
+
+int dcacheInit(struct APEX_CPU* cpu);
+
+int dcacheTick(struct APEX_CPU* cpu);
+
+int dcacheAccess(struct APEX_CPU* cpu,int address,long long* readyCycle);
+
+int dcachePrefetch(struct APEX_CPU* cpu,int lineAddr);
+
+int dcacheLineAddr(int address);
+
+int printDcacheStats(struct APEX_CPU* cpu);
+
+#endif
@@ -0,0 +1,394 @@
+/*
+ *  debugger.c
+ *  Contains the interactive debugger of the debug operation
+ *
+ *  Commands are read from stdin, one per line, an empty line repeats the
+ *  last one. The run advances with APEX_cpu_step and the compiled stop
+ *  conditions are checked after every cycle:
+ *    commitBreak     code index to the breakpoint stopping on its commit
+ *    nextBreakCycle  earliest cycle breakpoint still ahead
+ *    flushBreak      breakpoint stopping on a branch flush
+ *    watchList       watchpoints, compared against their last value
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "cpu.h"
+
+
+static Debug_Point points[DEBUG_MAX_POINTS];
+
+static unsigned char* commitBreak;
+static int anyCommitBreak;
+static long long nextBreakCycle=LLONG_MAX;
+static int flushBreak;
+static int watchList[DEBUG_MAX_POINTS];
+static int watchCount;
+
+static const char* kindNames[DEBUG_POINT_KINDS]={"break pc","break opcode","break cycle","break flush","watch mem","watch reg"};
+
+static int archRegValue(APEX_CPU* cpu,int reg)
+{
+	if(!(&cpu->thread->rRat[reg])->allocated)
+		return 0;
+	return (&cpu->urf_regs[(&cpu->thread->rRat[reg])->urf_reg])->value;
+}
+
+static int watchedValue(APEX_CPU* cpu,Debug_Point* point)
+{
+	return point->kind==WATCH_MEM ? cpu->data_memory[point->arg] : archRegValue(cpu,point->arg);
+}
+
+/*
+ * Rebuilds the stop conditions from the point list, after every change
+ * to it and after a cycle breakpoint is passed
+ */
+static int compileConditions(APEX_CPU* cpu)
+{
+	memset(commitBreak,0,cpu->thread->code_memory_size);
+	anyCommitBreak=0;
+	nextBreakCycle=LLONG_MAX;
+	flushBreak=0;
+	watchCount=0;
+
+	for(int i=0;i<DEBUG_MAX_POINTS;i++)
+	{
+		Debug_Point* point=&points[i];
+		if(!point->valid)
+			continue;
+
+		switch(point->kind)
+		{
+		case BREAK_PC:
+			if(!commitBreak[(point->arg-4000)/4])
+				commitBreak[(point->arg-4000)/4]=i+1;
+			anyCommitBreak=1;
+			break;
+		case BREAK_OPCODE:
+			for(int j=0;j<cpu->thread->code_memory_size;j++)
+			{
+				if(!commitBreak[j] && strcmp(cpu->thread->code_memory[j].opcode,point->opcode)==0)
+					commitBreak[j]=i+1;
+			}
+			anyCommitBreak=1;
+			break;
+		case BREAK_CYCLE:
+			if(point->arg>cpu->clock && point->arg<nextBreakCycle)
+				nextBreakCycle=point->arg;
+			break;
+		case BREAK_FLUSH:
+			if(!flushBreak)
+				flushBreak=i+1;
+			break;
+		default:
+			watchList[watchCount++]=i;
+			break;
+		}
+	}
+	return 0;
+}
+
+static int checkCommit(APEX_CPU* cpu,CPU_Stage* stage)
+{
+	int index=(stage->pc-4000)/4;
+
+	if(stage->pc<4000 || index>=cpu->thread->code_memory_size || !commitBreak[index])
+		return 0;
+
+	Debug_Point* point=&points[commitBreak[index]-1];
+	point->hits++;
+	printf("Breakpoint %d, pc(%d) %s committed at cycle %lld\n",
+			commitBreak[index],stage->pc,stage->opcode,cpu->clock);
+	return 1;
+}
+
+/* Returns 1 if the cycle just simulated hit a breakpoint or watchpoint */
+static int checkStop(APEX_CPU* cpu,long long flushesBefore)
+{
+	int stop=0;
+
+	if(anyCommitBreak)
+	{
+		if(cpu->thread->instRetired)
+			stop|=checkCommit(cpu,&cpu->thread->tempRobStage);
+		if(cpu->thread->instRetired_1)
+			stop|=checkCommit(cpu,&cpu->thread->tempRobStage_1);
+	}
+
+	if(cpu->clock==nextBreakCycle)
+	{
+		for(int i=0;i<DEBUG_MAX_POINTS;i++)
+		{
+			if(points[i].valid && points[i].kind==BREAK_CYCLE && points[i].arg==cpu->clock)
+			{
+				points[i].hits++;
+				printf("Breakpoint %d, cycle %lld\n",i+1,cpu->clock);
+			}
+		}
+		compileConditions(cpu);
+		stop=1;
+	}
+
+	if(flushBreak && cpu->flushes!=flushesBefore)
+	{
+		points[flushBreak-1].hits++;
+		printf("Breakpoint %d, branch flush at cycle %lld\n",flushBreak,cpu->clock);
+		stop=1;
+	}
+
+	for(int i=0;i<watchCount;i++)
+	{
+		Debug_Point* point=&points[watchList[i]];
+		int value=watchedValue(cpu,point);
+
+		if(value!=point->lastValue)
+		{
+			point->hits++;
+			if(point->kind==WATCH_MEM)
+				printf("Watchpoint %d, MEM[%lld] %d -> %d at cycle %lld\n",
+						watchList[i]+1,point->arg,point->lastValue,value,cpu->clock);
+			else
+				printf("Watchpoint %d, R%lld %d -> %d at cycle %lld\n",
+						watchList[i]+1,point->arg,point->lastValue,value,cpu->clock);
+			point->lastValue=value;
+			stop=1;
+		}
+	}
+	return stop;
+}
+
+/*
+ * Steps until a stop condition, the cycle target or the committed
+ * instruction target, whichever comes first
+ */
+static int runUntil(APEX_CPU* cpu,long long cycleTarget,long long insTarget)
+{
+	while(!APEX_cpu_finished(cpu))
+	{
+		long long flushesBefore=cpu->flushes;
+
+		APEX_cpu_step(cpu);
+		if(checkStop(cpu,flushesBefore) || cpu->clock>=cycleTarget || cpu->ins_completed>=insTarget)
+			return 0;
+	}
+
+	printf("Program finished at cycle %lld, %lld instructions committed (%s)\n",cpu->clock,
+			cpu->ins_completed,cpu->thread->haltAtRobHead ? "HALT" : "cycle limit");
+	return 0;
+}
+
+static int addPoint(APEX_CPU* cpu,int kind,long long arg,const char* opcode)
+{
+	for(int i=0;i<DEBUG_MAX_POINTS;i++)
+	{
+		Debug_Point* point=&points[i];
+		if(point->valid)
+			continue;
+
+		memset(point,0,sizeof(*point));
+		point->valid=1;
+		point->kind=kind;
+		point->arg=arg;
+		if(opcode)
+			snprintf(point->opcode,sizeof(point->opcode),"%s",opcode);
+		if(kind==WATCH_MEM || kind==WATCH_REG)
+			point->lastValue=watchedValue(cpu,point);
+
+		compileConditions(cpu);
+		printf("%s %d set\n",kind<WATCH_MEM ? "Breakpoint" : "Watchpoint",i+1);
+		return i;
+	}
+	printf("No room for more than %d breakpoints and watchpoints\n",DEBUG_MAX_POINTS);
+	return -1;
+}
+
+static int parseReg(const char* text)
+{
+	int reg=atoi(text[0]=='R' || text[0]=='r' ? text+1 : text);
+	return reg>=0 && reg<ARCH_REGS ? reg : -1;
+}
+
+static int commandPoint(APEX_CPU* cpu,int watch,const char* what,const char* value)
+{
+	long long arg=atoll(value);
+
+	if(!watch && strcmp(what,"pc")==0)
+	{
+		if(arg<4000 || (arg-4000)%4!=0 || (arg-4000)/4>=cpu->thread->code_memory_size)
+			printf("No instruction at pc %lld\n",arg);
+		else
+			addPoint(cpu,BREAK_PC,arg,NULL);
+	}
+	else if(!watch && strcmp(what,"opcode")==0 && value[0])
+		addPoint(cpu,BREAK_OPCODE,0,value);
+	else if(!watch && strcmp(what,"cycle")==0)
+	{
+		if(arg<=cpu->clock)
+			printf("Cycle %lld has already passed\n",arg);
+		else
+			addPoint(cpu,BREAK_CYCLE,arg,NULL);
+	}
+	else if(!watch && strcmp(what,"flush")==0)
+		addPoint(cpu,BREAK_FLUSH,0,NULL);
+	else if(watch && strcmp(what,"mem")==0)
+	{
+		if(arg<0 || arg>=(int)(sizeof(cpu->data_memory)/sizeof(cpu->data_memory[0])))
+			printf("No data memory word %lld\n",arg);
+		else
+			addPoint(cpu,WATCH_MEM,arg,NULL);
+	}
+	else if(watch && strcmp(what,"reg")==0)
+	{
+		if(parseReg(value)<0)
+			printf("No register %s\n",value);
+		else
+			addPoint(cpu,WATCH_REG,parseReg(value),NULL);
+	}
+	else
+		printf("Usage: break pc|opcode|cycle|flush <value>, watch mem|reg <value>\n");
+	return 0;
+}
+
+static int printPoints()
+{
+	for(int i=0;i<DEBUG_MAX_POINTS;i++)
+	{
+		Debug_Point* point=&points[i];
+		if(!point->valid)
+			continue;
+
+		if(point->kind==BREAK_OPCODE)
+			printf("%d\t%s %s\thits=%lld\n",i+1,kindNames[point->kind],point->opcode,point->hits);
+		else if(point->kind==BREAK_FLUSH)
+			printf("%d\t%s\thits=%lld\n",i+1,kindNames[point->kind],point->hits);
+		else
+			printf("%d\t%s %lld\thits=%lld\n",i+1,kindNames[point->kind],point->arg,point->hits);
+	}
+	return 0;
+}
+
+static int commandPrint(APEX_CPU* cpu,const char* what,const char* value)
+{
+	if(strcmp(what,"iq")==0)
+		printIQ(cpu);
+	else if(strcmp(what,"rob")==0)
+		printRob(cpu);
+	else if(strcmp(what,"lsq")==0)
+		printLsq(cpu);
+	else if(strcmp(what,"rat")==0)
+		printRat(cpu);
+	else if(strcmp(what,"rrat")==0)
+		printrRat(cpu);
+	else if(strcmp(what,"urf")==0)
+		printRegs(cpu);
+	else if(strcmp(what,"retired")==0)
+		printRetiredInstruction(cpu);
+	else if(strcmp(what,"arch")==0)
+	{
+		readArchState(cpu);
+		printArchRegs(cpu);
+	}
+	else if(strcmp(what,"mem")==0 && value[0])
+	{
+		int address=atoi(value);
+		if(address<0 || address>=(int)(sizeof(cpu->data_memory)/sizeof(cpu->data_memory[0])))
+			printf("No data memory word %d\n",address);
+		else
+			printf("|    MEM[%d]\t|\tData Value=%d\t|\n",address,cpu->data_memory[address]);
+	}
+	else if(strcmp(what,"mem")==0)
+		printMemData(cpu);
+	else
+		printf("Usage: print iq|rob|lsq|rat|rrat|urf|retired|arch|mem [address]\n");
+	return 0;
+}
+
+static void printHelp()
+{
+	printf("step [n]              simulate n cycles (default 1)\n");
+	printf("stepi [n]             run until n more instructions commit (default 1)\n");
+	printf("continue              run until a breakpoint, watchpoint or the end\n");
+	printf("break pc <pc>         stop when the instruction at pc commits\n");
+	printf("break opcode <op>     stop when an instruction with this opcode commits\n");
+	printf("break cycle <n>       stop after cycle n\n");
+	printf("break flush           stop after a branch flush\n");
+	printf("watch mem <address>   stop when the data memory word changes\n");
+	printf("watch reg <Rn>        stop when the committed register changes\n");
+	printf("delete <id>           remove a breakpoint or watchpoint\n");
+	printf("info                  list breakpoints and watchpoints, show the cycle\n");
+	printf("print <what>          iq, rob, lsq, rat, rrat, urf, retired, arch, mem [address]\n");
+	printf("quit                  end the session\n");
+}
+
+/*
+ * Reads and runs debugger commands until quit or the end of stdin
+ */
+int debuggerRun(APEX_CPU* cpu)
+{
+	char line[256],last[256]="";
+
+	commitBreak=calloc(cpu->thread->code_memory_size+1,1);
+	if(!commitBreak)
+		return -1;
+
+	printf("APEX debugger, %d instructions loaded, type help for commands\n",cpu->thread->code_memory_size);
+	for(;;)
+	{
+		char command[32]="",what[32]="",value[64]="";
+
+		printf("(apex) ");
+		fflush(stdout);
+		if(!fgets(line,sizeof(line),stdin))
+			break;
+		if(strspn(line," \t\r\n")==strlen(line))
+			snprintf(line,sizeof(line),"%s",last);
+		else
+			snprintf(last,sizeof(last),"%s",line);
+
+		if(sscanf(line,"%31s %31s %63s",command,what,value)<1)
+			continue;
+
+		long long count=what[0] ? atoll(what) : 1;
+		if(strcmp(command,"step")==0 || strcmp(command,"s")==0)
+			runUntil(cpu,cpu->clock+count,LLONG_MAX);
+		else if(strcmp(command,"stepi")==0 || strcmp(command,"si")==0)
+			runUntil(cpu,LLONG_MAX,cpu->ins_completed+count);
+		else if(strcmp(command,"continue")==0 || strcmp(command,"c")==0)
+			runUntil(cpu,LLONG_MAX,LLONG_MAX);
+		else if(strcmp(command,"break")==0 || strcmp(command,"b")==0)
+			commandPoint(cpu,0,what,value);
+		else if(strcmp(command,"watch")==0 || strcmp(command,"w")==0)
+			commandPoint(cpu,1,what,value);
+		else if(strcmp(command,"delete")==0 || strcmp(command,"d")==0)
+		{
+			int id=atoi(what);
+			if(id<1 || id>DEBUG_MAX_POINTS || !points[id-1].valid)
+				printf("No breakpoint or watchpoint %s\n",what);
+			else
+			{
+				points[id-1].valid=0;
+				compileConditions(cpu);
+			}
+		}
+		else if(strcmp(command,"info")==0 || strcmp(command,"i")==0)
+		{
+			printf("Cycle %lld, %lld instructions committed, fetch at pc(%d)\n",
+					cpu->clock,cpu->ins_completed,cpu->thread->pc);
+			printPoints();
+		}
+		else if(strcmp(command,"print")==0 || strcmp(command,"p")==0)
+			commandPrint(cpu,what,value);
+		else if(strcmp(command,"help")==0 || strcmp(command,"h")==0)
+			printHelp();
+		else if(strcmp(command,"quit")==0 || strcmp(command,"q")==0)
+			break;
+		else
+			printf("Unknown command %s, type help for commands\n",command);
+	}
+
+	free(commitBreak);
+	commitBreak=NULL;
+	return 0;
+}
@@ -0,0 +1,42 @@
+#ifndef _APEX_DEBUGGER_H_
+#define _APEX_DEBUGGER_H_
+/**
+ *  debugger.h
+ *  Contains the interactive debugger of the debug operation
+ *
+ *  Breakpoints stop on the commit of a PC or opcode, on a cycle or on a
+ *  branch flush, watchpoints on a change of a data memory word or of a
+ *  committed architectural register. They are compiled into a lookup
+ *  table and a few scalars, checked once per cycle.
+ */
+
+struct APEX_CPU;
+
+/* Upper bound on breakpoints and watchpoints alive at once */
+#define DEBUG_MAX_POINTS 64
+
+enum
+{
+	BREAK_PC,
+	BREAK_OPCODE,
+	BREAK_CYCLE,
+	BREAK_FLUSH,
+	WATCH_MEM,
+	WATCH_REG,
+	DEBUG_POINT_KINDS
+};
+
+/* One breakpoint or watchpoint */
+typedef struct Debug_Point
+{
+	int kind;
+	int valid;
+	long long arg;		// PC, cycle, memory address or register
+	char opcode[16];
+	int lastValue;		// watched value at the last check
+	long long hits;
+}Debug_Point;
+
+int debuggerRun(struct APEX_CPU* cpu);
+
+#endif
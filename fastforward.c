@@ -0,0 +1,1100 @@
+/*
+ *  fastforward.c
+ *  Contains the periodic loop detection and the functional fast-forward
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+extern long long inputClockCycles;
+extern int displayMode;
+extern int resultBuses;
+
+int fastForwardEnabled=0;
+
+/* Positions of the functional model kept, a power of two over two periods and a ROB */
+#define FF_RING_SIZE (4*FF_MAX_PERIOD_INSTS)
+
+/* Older LOADs and STOREs an LSQ entry may meet, the pipeline compares their addresses only */
+#define FF_WINDOW (LSQ_SIZE-1)
+
+/* Slots of the signature table, a power of two */
+#define FF_TABLE_SIZE 4096
+
+/* Cycles a recorded period may take */
+#define FF_MAX_PERIOD_CYCLES (16*FF_MAX_PERIOD_INSTS)
+
+/* Timing state compared between back-edges, the values and counters left out */
+typedef struct FF_Image
+{
+	CPU_Thread thread;
+	CPU_Forward_Bus fBus[FWD_BUS_SIZE];
+	CPU_Register urf_regs[URF_SIZE];
+	CPU_IQ iq_list[IQ_SIZE];
+	CPU_LSQ lsq_list[LSQ_SIZE];
+	multiply_func_unit mulFuncUnit;
+	mem_func_unit memFuncUnit;
+	int control[12];
+}FF_Image;
+
+/* Cheap part of the image, looked up at every back-edge to find the lag */
+typedef struct FF_Signature
+{
+	int pc;
+	int robHead;
+	int robTail;
+	int lsqHead;
+	int lsqTail;
+	int forwardIndex;
+	int cfidHead;
+	int cfidTail;
+	int units;
+	int iqAllocated;
+	unsigned int urfFree[2];
+}FF_Signature;
+
+/* Last back-edge of a signature, a slot of an older generation is stale */
+typedef struct FF_Slot
+{
+	FF_Signature sig;
+	long long edge;
+	int generation;
+}FF_Slot;
+
+/* One instruction of the functional model */
+typedef struct FF_Entry
+{
+	int pc;
+	int source1;	// values read, rs1, rs2 and the zero flag
+	int source2;
+	int flag;
+	int result;		// value written to rd
+	int address;	// LOAD and STORE, -1 for the others
+	int store;
+	int data;		// value a STORE wrote
+	int old;		// memory word it overwrote
+}FF_Entry;
+
+/* Addresses of the last LOADs and STOREs executed by the functional model */
+typedef struct FF_Window
+{
+	int recent[FF_WINDOW];
+	int next;
+	int count;
+}FF_Window;
+
+/* Counters a skipped period advances */
+enum
+{
+	FF_CLOCK,
+	FF_INSTRUCTIONS,
+	FF_LOADS_EARLY,
+	FF_LOADS_FORWARDED,
+	FF_CONFLICT_STALLS,
+	FF_DISPATCH_STALLS,
+	FF_FLUSHES,
+	FF_MEM_ACCESSES,
+	FF_THREAD_INSTRUCTIONS,
+	FF_THREAD_FLUSHES,
+	FF_FRONT_END_CYCLES,
+	FF_INT_BUS_STALLS,
+	FF_MUL_BUS_STALLS,
+	FF_MEM_BUS_STALLS,
+	FF_DELAYED_WAKEUPS,
+	FF_COUNTERS
+};
+
+typedef struct FF_Work
+{
+	FF_Slot table[FF_TABLE_SIZE];
+	long long edges;
+	int generation;
+
+	FF_Image image[2];
+
+	/* Functional model, position counts instructions like ins_completed */
+	int regs[ARCH_REGS];
+	int zFlag;
+	int pc;
+	long long position;
+	int memory[DATA_MEMORY_SIZE];
+	int scratch[DATA_MEMORY_SIZE];
+	FF_Entry ring[FF_RING_SIZE];
+
+	/* Commits of the period being recorded, from the detailed run */
+	long long commitStart;
+	int commits;
+	int commitPc[FF_MAX_PERIOD_INSTS];
+	int commitValue[FF_MAX_PERIOD_INSTS];
+	int commitReg[FF_MAX_PERIOD_INSTS];
+
+	/* The two recorded periods */
+	long long base;				// ins_completed as the attempt started, the model starts after it
+	long long periodStart[2];	// model position before each
+	int pcs[2][FF_MAX_PERIOD_INSTS];
+	int distance[2][URF_SIZE];	// last commit to the URF register, counted back from the period end
+
+	/* Address matches of the LOADs and STOREs of the last one with the older ones in reach */
+	int memOps;
+	unsigned int considered[FF_MAX_PERIOD_INSTS];
+	unsigned int equal[FF_MAX_PERIOD_INSTS];
+	FF_Window window;
+}FF_Work;
+
+int fastForwardParseOption(const char* arg)
+{
+	const char* value;
+
+	if(matchOption(arg,"--fast-forward",&value))
+		fastForwardEnabled=atoi(value);
+	else
+		return 0;
+
+	return 1;
+}
+
+int fastForwardInit(APEX_CPU* cpu)
+{
+	free(cpu->ff.work);
+	memset(&cpu->ff,0,sizeof(cpu->ff));
+	return 0;
+}
+
+/*
+ * Called as the run starts, fast-forward only runs where the skipped
+ * cycles would have no effect but on the counters it advances
+ */
+int fastForwardBegin(APEX_CPU* cpu)
+{
+	APEX_Fast_Forward* ff=&cpu->ff;
+
+	ff->active=fastForwardEnabled && !displayMode && cpu->threadCount==1
+		&& !icacheEnabled && !dcacheEnabled && prefetcherType==PREFETCH_NONE
+		&& !cpu->probe.subscriberCount && !cpu->interval.file
+		&& !cpu->insnTrace.replaying && !cpu->insnTrace.recording && !cpu->commitLog.writer && !cpu->digest.file;
+#ifdef APEX_STAGE_TIMING
+	ff->active=0;
+#endif
+	ff->backEdge=0;
+	return 0;
+}
+
+int fastForwardFinish(APEX_CPU* cpu)
+{
+	free(cpu->ff.work);
+	cpu->ff.work=NULL;
+	return 0;
+}
+
+static int isDestWriter(const char* opcode)
+{
+	return strcmp(opcode,"STORE")!=0 && strcmp(opcode,"")!=0 && strcmp(opcode,"JUMP")!=0
+		&& strcmp(opcode,"BZ")!=0 && strcmp(opcode,"BNZ")!=0 && strcmp(opcode,"HALT")!=0;
+}
+
+static int isMemory(const char* opcode)
+{
+	return strcmp(opcode,"LOAD")==0 || strcmp(opcode,"STORE")==0;
+}
+
+static int robEntries(CPU_Thread* thread)
+{
+	if(thread->robHead==-1)
+		return 0;
+	return (thread->robTail-thread->robHead+ROB_SIZE+1)%ROB_SIZE;
+}
+
+/* A LOAD or STORE still waiting in the LSQ, it has not been sent to memory */
+static int lsqPending(APEX_CPU* cpu,int robIndex)
+{
+	CPU_LSQ* lsqEntry=&cpu->lsq_list[cpu->threads[0].rob_list[robIndex].lsqIndex];
+	return lsqEntry->allocated && lsqEntry->robIndex==robIndex;
+}
+
+/*
+ * A taken control instruction is about to flush, note a back-edge and any
+ * younger LOAD or STORE that computed its address on the wrong path
+ */
+int fastForwardFlush(APEX_CPU* cpu)
+{
+	APEX_Fast_Forward* ff=&cpu->ff;
+	CPU_Thread* thread=cpu->thread;
+	int branchPc=thread->rob_list[thread->branchRobIndex].stage.pc;
+
+	if(thread->robHead==-1)
+		return 0;
+
+	for(int m=thread->branchRobIndex;m!=thread->robTail;)
+	{
+		m=m==ROB_SIZE-1 ? 0 : m+1;
+		if(isMemory(thread->rob_list[m].stage.opcode)
+		&& (!lsqPending(cpu,m) || cpu->lsq_list[thread->rob_list[m].lsqIndex].address_valid))
+			ff->wrongPathAddress=1;
+	}
+
+	if(thread->pc<=branchPc)
+	{
+		ff->backEdge=1;
+		ff->branchPc=branchPc;
+		ff->branchTarget=thread->pc;
+	}
+	return 0;
+}
+
+static void readCounters(APEX_CPU* cpu,long long* counters)
+{
+	CPU_Thread* thread=&cpu->threads[0];
+
+	counters[FF_CLOCK]=cpu->clock;
+	counters[FF_INSTRUCTIONS]=cpu->ins_completed;
+	counters[FF_LOADS_EARLY]=cpu->loadsIssuedEarly;
+	counters[FF_LOADS_FORWARDED]=cpu->loadsForwarded;
+	counters[FF_CONFLICT_STALLS]=cpu->lsqConflictStalls;
+	counters[FF_DISPATCH_STALLS]=cpu->dispatchStalls;
+	counters[FF_FLUSHES]=cpu->flushes;
+	counters[FF_MEM_ACCESSES]=cpu->memAccesses;
+	counters[FF_THREAD_INSTRUCTIONS]=thread->instructions;
+	counters[FF_THREAD_FLUSHES]=thread->flushes;
+	counters[FF_FRONT_END_CYCLES]=thread->frontEndCycles;
+	counters[FF_INT_BUS_STALLS]=cpu->busConflicts[BUS_INT];
+	counters[FF_MUL_BUS_STALLS]=cpu->busConflicts[BUS_MUL];
+	counters[FF_MEM_BUS_STALLS]=cpu->busConflicts[BUS_MEM];
+	counters[FF_DELAYED_WAKEUPS]=cpu->delayedWakeups;
+}
+
+static void writeCounters(APEX_CPU* cpu,const long long* counters)
+{
+	CPU_Thread* thread=&cpu->threads[0];
+
+	cpu->clock=counters[FF_CLOCK];
+	cpu->ins_completed=counters[FF_INSTRUCTIONS];
+	cpu->loadsIssuedEarly=counters[FF_LOADS_EARLY];
+	cpu->loadsForwarded=counters[FF_LOADS_FORWARDED];
+	cpu->lsqConflictStalls=counters[FF_CONFLICT_STALLS];
+	cpu->dispatchStalls=counters[FF_DISPATCH_STALLS];
+	cpu->flushes=counters[FF_FLUSHES];
+	cpu->memAccesses=counters[FF_MEM_ACCESSES];
+	thread->instructions=counters[FF_THREAD_INSTRUCTIONS];
+	thread->flushes=counters[FF_THREAD_FLUSHES];
+	thread->frontEndCycles=counters[FF_FRONT_END_CYCLES];
+	cpu->busConflicts[BUS_INT]=counters[FF_INT_BUS_STALLS];
+	cpu->busConflicts[BUS_MUL]=counters[FF_MUL_BUS_STALLS];
+	cpu->busConflicts[BUS_MEM]=counters[FF_MEM_BUS_STALLS];
+	cpu->delayedWakeups=counters[FF_DELAYED_WAKEUPS];
+}
+
+static void maskValues(CPU_Stage* stage,long long seq)
+{
+	if(stage->seq)
+		stage->seq-=seq;
+	stage->rs1_value=0;
+	stage->rs2_value=0;
+	stage->buffer=0;
+	stage->mem_address=0;
+	stage->zFlag=0;
+}
+
+static void clearStage(CPU_Stage* stage)
+{
+	int stalled=stage->stalled;
+
+	memset(stage,0,sizeof(*stage));
+	stage->stalled=stalled;
+}
+
+/*
+ * Copies the state that decides the timing. Values, counters and entries
+ * nothing reads again are cleared, cycle stamps are taken relative to now
+ * and dispatch tags relative to the last one handed out.
+ */
+static void buildImage(APEX_CPU* cpu,FF_Image* image)
+{
+	CPU_Thread* thread=&image->thread;
+
+	memset(image,0,sizeof(*image));
+	*thread=cpu->threads[0];
+	memset(thread->regs,0,sizeof(thread->regs));
+	thread->zeroFlag=0;
+	thread->instructions=0;
+	thread->flushes=0;
+	thread->frontEndCycles=0;
+	memset(thread->b_cfid_map,0,sizeof(thread->b_cfid_map));
+
+	// a stalled latch is overwritten before it is read
+	for(int i=0;i<NUM_STAGES;i++)
+	{
+		if(i<=IQ && thread->stage[i].stalled)
+			clearStage(&thread->stage[i]);
+		else
+			maskValues(&thread->stage[i],cpu->dispatchSeq);
+	}
+	if(thread->instRetired)
+		maskValues(&thread->tempRobStage,cpu->dispatchSeq);
+	else
+		clearStage(&thread->tempRobStage);
+	if(thread->instRetired_1)
+		maskValues(&thread->tempRobStage_1,cpu->dispatchSeq);
+	else
+		clearStage(&thread->tempRobStage_1);
+
+	int count=robEntries(thread);
+	for(int i=0;i<ROB_SIZE;i++)
+	{
+		if((i-thread->robHead+ROB_SIZE)%ROB_SIZE<count)
+			maskValues(&thread->rob_list[i].stage,cpu->dispatchSeq);
+		else
+			memset(&thread->rob_list[i],0,sizeof(CPU_ROB));
+	}
+
+	for(int i=0;i<resultBuses;i++)
+	{
+		image->fBus[i]=cpu->fBus[i];
+		image->fBus[i].rs_value=0;
+		image->fBus[i].zFlag=0;
+	}
+	for(int i=0;i<URF_SIZE;i++)
+	{
+		image->urf_regs[i]=cpu->urf_regs[i];
+		image->urf_regs[i].value=0;
+		image->urf_regs[i].zFlag=0;
+	}
+	for(int i=0;i<IQ_SIZE;i++)
+	{
+		if(!cpu->iq_list[i].allocated)
+			continue;
+		image->iq_list[i]=cpu->iq_list[i];
+		image->iq_list[i].clockCycle-=cpu->clock;
+		maskValues(&image->iq_list[i].stage,cpu->dispatchSeq);
+	}
+	for(int i=0;i<LSQ_SIZE;i++)
+	{
+		if(!cpu->lsq_list[i].allocated)
+			continue;
+		image->lsq_list[i]=cpu->lsq_list[i];
+		maskValues(&image->lsq_list[i].stage,cpu->dispatchSeq);
+	}
+	image->mulFuncUnit=cpu->mulFuncUnit;
+	for(int i=0;i<MEM_MAX_INFLIGHT;i++)
+	{
+		if(!cpu->memFuncUnit.inflight[i].valid)
+			continue;
+		image->memFuncUnit.inflight[i]=cpu->memFuncUnit.inflight[i];
+		image->memFuncUnit.inflight[i].readyCycle-=cpu->clock;
+		image->memFuncUnit.inflight[i].seq-=cpu->dispatchSeq;
+	}
+
+	image->control[0]=cpu->lsqHead;
+	image->control[1]=cpu->lsqTail;
+	image->control[2]=cpu->forwardIndex;
+	image->control[3]=cpu->intFuBusy;
+	image->control[4]=cpu->memFuBusy;
+	image->control[5]=cpu->mulFuBusy;
+	image->control[6]=cpu->mulFuClock;
+	image->control[7]=cpu->prevLoad;
+	image->control[8]=cpu->mulClock;
+	image->control[9]=cpu->fetchThread;
+	image->control[10]=cpu->robPartition;
+	image->control[11]=cpu->busPriority;
+}
+
+static void buildSignature(APEX_CPU* cpu,FF_Signature* sig)
+{
+	CPU_Thread* thread=&cpu->threads[0];
+
+	memset(sig,0,sizeof(*sig));
+	sig->pc=cpu->ff.branchPc;
+	sig->robHead=thread->robHead;
+	sig->robTail=thread->robTail;
+	sig->lsqHead=cpu->lsqHead;
+	sig->lsqTail=cpu->lsqTail;
+	sig->forwardIndex=cpu->forwardIndex;
+	sig->cfidHead=thread->cfidHead;
+	sig->cfidTail=thread->cfidTail;
+	sig->units=cpu->intFuBusy | cpu->memFuBusy<<1 | cpu->mulFuBusy<<2 | cpu->mulFuClock<<3;
+	for(int i=0;i<IQ_SIZE;i++)
+		sig->iqAllocated|=(cpu->iq_list[i].allocated ? 1 : 0)<<i;
+	for(int i=0;i<URF_SIZE;i++)
+		sig->urfFree[i/32]|=(cpu->urf_regs[i].isFree ? 1u : 0u)<<(i%32);
+}
+
+/*
+ * Back-edges since the last one with the same signature, 0 if none within
+ * FF_MAX_LAG. Records this one.
+ */
+static int findLag(FF_Work* work,FF_Signature* sig)
+{
+	const unsigned int* words=(const unsigned int*)sig;
+	unsigned int hash=2166136261u;
+	int lag=0;
+
+	for(size_t i=0;i<sizeof(*sig)/sizeof(int);i++)
+		hash=(hash^words[i])*16777619u;
+
+	work->edges++;
+	FF_Slot* slot=&work->table[hash&(FF_TABLE_SIZE-1)];
+	if(slot->generation==work->generation && work->edges-slot->edge<=FF_MAX_LAG
+	&& memcmp(&slot->sig,sig,sizeof(*sig))==0)
+		lag=work->edges-slot->edge;
+
+	slot->sig=*sig;
+	slot->edge=work->edges;
+	slot->generation=work->generation;
+	return lag;
+}
+
+static FF_Entry* entryAt(FF_Work* work,long long position)
+{
+	return &work->ring[position&(FF_RING_SIZE-1)];
+}
+
+/*
+ * Executes the instruction at the model's PC with the semantics of the
+ * pipeline. loadValue, when given, is the data a LOAD already got from
+ * memory. Returns -1, changing nothing, where the model stops: HALT, a PC
+ * outside code memory or an address outside data memory.
+ */
+static int executeInstruction(APEX_CPU* cpu,FF_Work* work,const int* loadValue)
+{
+	CPU_Thread* thread=&cpu->threads[0];
+	int index=(work->pc-4000)/4;
+
+	if(work->pc<4000 || (work->pc-4000)%4!=0 || index>=thread->code_memory_size)
+		return -1;
+
+	APEX_Instruction* ins=&thread->code_memory[index];
+	const char* op=ins->opcode;
+	int rd=ins->rd,rs1=ins->rs1,rs2=ins->rs2,imm=ins->imm;
+	FF_Entry* entry=entryAt(work,work->position+1);
+	int nextPc=work->pc+4;
+	unsigned int a=0,b=0;
+
+	if(rd<0 || rd>=ARCH_REGS || rs1<0 || rs1>=ARCH_REGS || rs2<0 || rs2>=ARCH_REGS)
+		return -1;
+	a=work->regs[rs1];
+	b=work->regs[rs2];
+
+	entry->pc=work->pc;
+	entry->source1=(int)a;
+	entry->source2=(int)b;
+	entry->flag=work->zFlag;
+	entry->address=-1;
+	entry->store=0;
+
+	if(strcmp(op,"ADD")==0)
+		entry->result=(int)(a+b);
+	else if(strcmp(op,"SUB")==0)
+		entry->result=(int)(a-b);
+	else if(strcmp(op,"MUL")==0)
+		entry->result=(int)(a*b);
+	else if(strcmp(op,"AND")==0)
+		entry->result=(int)(a&b);
+	else if(strcmp(op,"OR")==0)
+		entry->result=(int)(a|b);
+	else if(strcmp(op,"EX-OR")==0)
+		entry->result=(int)(a^b);
+	else if(strcmp(op,"ADDL")==0)
+		entry->result=(int)(a+(unsigned int)imm);
+	else if(strcmp(op,"SUBL")==0)
+		entry->result=(int)(a-(unsigned int)imm);
+	else if(strcmp(op,"MOVC")==0)
+		entry->result=imm;
+	else if(strcmp(op,"LOAD")==0)
+	{
+		entry->address=(int)(a+(unsigned int)imm);
+		if(entry->address<0 || entry->address>=DATA_MEMORY_SIZE)
+			return -1;
+		entry->result=loadValue ? *loadValue : work->memory[entry->address];
+	}
+	else if(strcmp(op,"STORE")==0)
+	{
+		entry->address=(int)(b+(unsigned int)imm);
+		if(entry->address<0 || entry->address>=DATA_MEMORY_SIZE)
+			return -1;
+		entry->store=1;
+		entry->data=(int)a;
+		entry->old=work->memory[entry->address];
+		work->memory[entry->address]=entry->data;
+	}
+	else if(strcmp(op,"BZ")==0 || strcmp(op,"BNZ")==0)
+	{
+		if(work->zFlag==(op[1]=='Z'))
+			nextPc=work->pc+imm;
+	}
+	else if(strcmp(op,"JUMP")==0)
+		nextPc=(int)(a+(unsigned int)imm);
+	else if(strcmp(op,"JAL")==0)
+	{
+		entry->result=work->pc+4;
+		nextPc=(int)(a+(unsigned int)imm);
+	}
+	else
+		return -1;
+
+	if(isDestWriter(op))
+	{
+		work->regs[rd]=entry->result;
+		// LOAD leaves the zero flag alone
+		if(strcmp(op,"LOAD")!=0)
+			work->zFlag=entry->result==0;
+	}
+	work->pc=nextPc;
+	work->position++;
+	return 0;
+}
+
+/* Applies an instruction the R-RAT takes next cycle to the committed state */
+static void applyRetired(APEX_CPU* cpu,FF_Work* work,CPU_Stage* stage)
+{
+	if(!isDestWriter(stage->opcode))
+		return;
+	work->regs[stage->rd]=cpu->urf_regs[stage->urf_dest_reg].value;
+	if(strcmp(stage->opcode,"LOAD")!=0)
+		work->zFlag=cpu->urf_regs[stage->urf_dest_reg].zFlag;
+}
+
+/*
+ * Starts the functional model at the committed state and runs the
+ * instructions in flight, it ends past the back-edge like the fetch
+ */
+static int startModel(APEX_CPU* cpu,FF_Work* work)
+{
+	CPU_Thread* thread=&cpu->threads[0];
+	int count=robEntries(thread);
+
+	for(int i=0;i<RAT_SIZE;i++)
+	{
+		int value=0;
+		if(thread->rRat[i].allocated)
+		{
+			CPU_Register* reg=&cpu->urf_regs[thread->rRat[i].urf_reg];
+			value=i==RAT_ZERO_FLAG ? reg->zFlag : reg->value;
+		}
+		if(i==RAT_ZERO_FLAG)
+			work->zFlag=value;
+		else
+			work->regs[i]=value;
+	}
+	if(thread->instRetired)
+		applyRetired(cpu,work,&thread->tempRobStage);
+	if(thread->instRetired_1)
+		applyRetired(cpu,work,&thread->tempRobStage_1);
+
+	memcpy(work->memory,cpu->data_memory,sizeof(work->memory));
+	work->position=cpu->ins_completed;
+	work->pc=count ? thread->rob_list[thread->robHead].stage.pc : cpu->ff.branchTarget;
+
+	for(int i=0,m=thread->robHead;i<count;i++,m=(m==ROB_SIZE-1 ? 0 : m+1))
+	{
+		CPU_Stage* stage=&thread->rob_list[m].stage;
+		// a LOAD sent to memory has its data, a younger STORE may have overwritten it since
+		const int* loadValue=strcmp(stage->opcode,"LOAD")==0 && !lsqPending(cpu,m) ? &stage->buffer : NULL;
+
+		if(stage->pc!=work->pc || executeInstruction(cpu,work,loadValue)<0)
+			return -1;
+	}
+	return work->pc==cpu->ff.branchTarget ? 0 : -1;
+}
+
+/* Takes the instructions the last cycle committed */
+static int observeCommits(APEX_CPU* cpu,FF_Work* work)
+{
+	CPU_Thread* thread=&cpu->threads[0];
+	CPU_Stage* retired[2]={&thread->tempRobStage,&thread->tempRobStage_1};
+	long long count=cpu->ins_completed-(work->commitStart+work->commits);
+
+	if(count==0)
+		return 0;
+	if(count>2 || !thread->instRetired || (count==2)!=thread->instRetired_1)
+		return -1;
+
+	for(int i=0;i<count;i++)
+	{
+		if(work->commits==FF_MAX_PERIOD_INSTS)
+			return -1;
+		work->commitPc[work->commits]=retired[i]->pc;
+		work->commitReg[work->commits]=isDestWriter(retired[i]->opcode) ? retired[i]->urf_dest_reg : -1;
+		work->commitValue[work->commits]=retired[i]->buffer;
+		work->commits++;
+	}
+	return 0;
+}
+
+/* Simulates lag back-edges of the loop branch in detail, collecting the commits */
+static int recordPeriod(APEX_CPU* cpu,FF_Work* work,int lag)
+{
+	APEX_Fast_Forward* ff=&cpu->ff;
+	int loopPc=ff->branchPc;
+	long long start=cpu->clock;
+
+	work->commitStart=cpu->ins_completed;
+	work->commits=0;
+	ff->wrongPathAddress=0;
+
+	for(int seen=0;seen<lag;)
+	{
+		if(APEX_cpu_finished(cpu) || cpu->clock-start>FF_MAX_PERIOD_CYCLES)
+			return -1;
+		APEX_cpu_step(cpu);
+		if(observeCommits(cpu,work)<0)
+			return -1;
+		if(ff->backEdge)
+		{
+			ff->backEdge=0;
+			seen++;
+		}
+	}
+	return ff->branchPc!=loopPc || ff->wrongPathAddress ? -1 : 0;
+}
+
+/* Compares or, with write set, stores one value of the state */
+static int liveValue(int* slot,int expected,int write)
+{
+	if(write)
+	{
+		*slot=expected;
+		return 0;
+	}
+	return *slot!=expected;
+}
+
+/* Value the URF register holds at the end of a period */
+static int urfValue(APEX_CPU* cpu,FF_Work* work,const int* distance,int reg)
+{
+	if(distance[reg]<0)
+		return cpu->urf_regs[reg].value;
+	return entryAt(work,cpu->ins_completed-distance[reg])->result;
+}
+
+/* The operands a copy of the instruction has read */
+static int operandValues(CPU_Stage* stage,FF_Entry* entry,int write)
+{
+	const char* op=stage->opcode;
+	int differ=stage->pc!=entry->pc;
+
+	// BZ and BNZ mark the captured flag with rs1_value_valid
+	if(strcmp(op,"BZ")==0 || strcmp(op,"BNZ")==0)
+	{
+		if(stage->rs1_value_valid)
+			differ+=liveValue(&stage->zFlag,entry->flag,write);
+		return differ;
+	}
+	if(strcmp(op,"MOVC")==0 || strcmp(op,"HALT")==0 || strcmp(op,"")==0)
+		return differ;
+
+	if(stage->rs1_value_valid)
+		differ+=liveValue(&stage->rs1_value,entry->source1,write);
+	if(stage->rs2_value_valid && strcmp(op,"LOAD")!=0 && strcmp(op,"ADDL")!=0 && strcmp(op,"SUBL")!=0
+	&& strcmp(op,"JUMP")!=0 && strcmp(op,"JAL")!=0)
+		differ+=liveValue(&stage->rs2_value,entry->source2,write);
+	return differ;
+}
+
+/* The IQ still holds the ROB entry, it has not been issued */
+static int iqPending(APEX_CPU* cpu,int robIndex)
+{
+	CPU_IQ* iqEntry=&cpu->iq_list[cpu->threads[0].rob_list[robIndex].iqIndex];
+	return iqEntry->allocated && iqEntry->robIndex==robIndex;
+}
+
+/*
+ * The values of the state that are read again, at the end of a period:
+ * the URF registers it wrote, the operands, results and addresses of the
+ * instructions in flight, the forward bus and data memory without the
+ * STOREs still in the LSQ. They are stored from the functional model with
+ * write set, otherwise compared. Returns the number that differ.
+ */
+static int liveValues(APEX_CPU* cpu,FF_Work* work,const int* distance,int write)
+{
+	CPU_Thread* thread=&cpu->threads[0];
+	long long committed=cpu->ins_completed;
+	int count=robEntries(thread);
+	int differ=0;
+
+	if(work->position!=committed+count)
+		return 1;
+
+	// past the ROB tail only the fetched instruction, it has read nothing
+	if(!thread->stage[IQ].stalled || thread->stage[DRF].rs1_value_valid || thread->stage[DRF].rs2_value_valid)
+		return 1;
+
+	for(int i=0;i<URF_SIZE;i++)
+	{
+		if(distance[i]<0)
+			continue;
+		int value=urfValue(cpu,work,distance,i);
+		differ+=liveValue(&cpu->urf_regs[i].value,value,write);
+		differ+=liveValue(&cpu->urf_regs[i].zFlag,value==0,write);
+	}
+
+	// instructions retired last cycle, the R-RAT takes them next cycle
+	if(thread->instRetired)
+	{
+		FF_Entry* entry=entryAt(work,committed-thread->instRetired_1);
+		differ+=operandValues(&thread->tempRobStage,entry,write);
+		if(isDestWriter(thread->tempRobStage.opcode))
+			differ+=liveValue(&thread->tempRobStage.buffer,entry->result,write);
+	}
+	if(thread->instRetired_1)
+	{
+		FF_Entry* entry=entryAt(work,committed);
+		differ+=operandValues(&thread->tempRobStage_1,entry,write);
+		if(isDestWriter(thread->tempRobStage_1.opcode))
+			differ+=liveValue(&thread->tempRobStage_1.buffer,entry->result,write);
+	}
+
+	// the ROB copy takes the result at issue, a LOAD has its address until memory
+	for(int i=0,m=thread->robHead;i<count;i++,m=(m==ROB_SIZE-1 ? 0 : m+1))
+	{
+		CPU_Stage* stage=&thread->rob_list[m].stage;
+		FF_Entry* entry=entryAt(work,committed+1+i);
+
+		differ+=operandValues(stage,entry,write);
+		if(iqPending(cpu,m))
+			continue;
+		if(strcmp(stage->opcode,"STORE")==0 || (strcmp(stage->opcode,"LOAD")==0 && lsqPending(cpu,m)))
+			differ+=liveValue(&stage->buffer,entry->address,write);
+		else if(isDestWriter(stage->opcode))
+			differ+=liveValue(&stage->buffer,entry->result,write);
+	}
+
+	for(int i=0;i<IQ_SIZE;i++)
+	{
+		CPU_IQ* iqEntry=&cpu->iq_list[i];
+		if(iqEntry->allocated)
+			differ+=operandValues(&iqEntry->stage,entryAt(work,committed+1+(iqEntry->robIndex-thread->robHead+ROB_SIZE)%ROB_SIZE),write);
+	}
+
+	for(int i=0;i<LSQ_SIZE;i++)
+	{
+		CPU_LSQ* lsqEntry=&cpu->lsq_list[i];
+		if(!lsqEntry->allocated)
+			continue;
+		FF_Entry* entry=entryAt(work,committed+1+(lsqEntry->robIndex-thread->robHead+ROB_SIZE)%ROB_SIZE);
+
+		differ+=operandValues(&lsqEntry->stage,entry,write);
+		if(lsqEntry->address_valid)
+			differ+=liveValue(&lsqEntry->stage.buffer,entry->address,write);
+	}
+
+	// a valid slot of an allocated register holds the result of its current producer
+	for(int i=0;i<resultBuses;i++)
+	{
+		CPU_Forward_Bus* bus=&cpu->fBus[i];
+		if(!bus->valid || bus->rs<0 || bus->rs>=URF_SIZE || cpu->urf_regs[bus->rs].isFree)
+			continue;
+
+		int value=urfValue(cpu,work,distance,bus->rs);
+		for(int k=0,m=thread->robHead;k<count;k++,m=(m==ROB_SIZE-1 ? 0 : m+1))
+		{
+			CPU_Stage* stage=&thread->rob_list[m].stage;
+			if(isDestWriter(stage->opcode) && stage->urf_dest_reg==bus->rs)
+				value=entryAt(work,committed+1+k)->result;
+		}
+		differ+=liveValue(&bus->rs_value,value,write);
+		differ+=liveValue(&bus->zFlag,value==0,write);
+	}
+
+	int* memory=write ? cpu->data_memory : work->scratch;
+	memcpy(memory,work->memory,sizeof(work->memory));
+	for(int i=count-1,m=thread->robTail;i>=0;i--,m=(m==0 ? ROB_SIZE-1 : m-1))
+	{
+		FF_Entry* entry=entryAt(work,committed+1+i);
+		if(entry->store && lsqPending(cpu,m))
+			memory[entry->address]=entry->old;
+	}
+	if(!write)
+		differ+=memcmp(memory,cpu->data_memory,sizeof(work->memory))!=0;
+
+	return differ;
+}
+
+/*
+ * Runs the functional model through the period just simulated, its
+ * instructions must be the ones committed and the values in flight must
+ * match. Returns the period length in instructions, -1 if it does not.
+ */
+static int checkPeriod(APEX_CPU* cpu,FF_Work* work,int period)
+{
+	int length=work->commits;
+
+	work->periodStart[period]=work->position;
+	for(int i=0;i<length;i++)
+	{
+		work->pcs[period][i]=work->pc;
+		if(executeInstruction(cpu,work,NULL)<0)
+			return -1;
+	}
+	if(work->pc!=cpu->ff.branchTarget)
+		return -1;
+
+	for(int i=0;i<URF_SIZE;i++)
+		work->distance[period][i]=-1;
+	for(int i=0;i<length;i++)
+	{
+		FF_Entry* entry=entryAt(work,work->commitStart+1+i);
+		if(entry->pc!=work->commitPc[i])
+			return -1;
+		if(work->commitReg[i]<0)
+			continue;
+		if(entry->result!=work->commitValue[i])
+			return -1;
+		work->distance[period][work->commitReg[i]]=length-1-i;
+	}
+
+	return liveValues(cpu,work,work->distance[period],0) ? -1 : length;
+}
+
+/* Bit d-1 set where the d-th older LOAD or STORE in the window has the address */
+static unsigned int windowMatches(FF_Window* window,int address)
+{
+	unsigned int matches=0;
+
+	for(int d=1;d<=window->count;d++)
+	{
+		if(window->recent[(window->next-d+FF_WINDOW)%FF_WINDOW]==address)
+			matches|=1u<<(d-1);
+	}
+	return matches;
+}
+
+static void windowPush(FF_Window* window,int address)
+{
+	window->recent[window->next]=address;
+	window->next=(window->next+1)%FF_WINDOW;
+	if(window->count<FF_WINDOW)
+		window->count++;
+}
+
+/*
+ * The LSQ compares a LOAD's address only with the older STOREs in it, so a
+ * period times like the recorded one if every LOAD and STORE matches the
+ * same older ones in reach. Takes those matches of the last recorded period,
+ * older LOADs and STOREs committed before the attempt were never in reach.
+ */
+static int recordMatches(FF_Work* work,int length)
+{
+	long long position;
+
+	memset(&work->window,0,sizeof(work->window));
+	for(position=work->base+1;position<=work->periodStart[1];position++)
+	{
+		if(entryAt(work,position)->address>=0)
+			windowPush(&work->window,entryAt(work,position)->address);
+	}
+
+	work->memOps=0;
+	for(;position<=work->periodStart[1]+length;position++)
+	{
+		int address=entryAt(work,position)->address;
+		if(address<0)
+			continue;
+		work->considered[work->memOps]=(1u<<work->window.count)-1;
+		work->equal[work->memOps]=windowMatches(&work->window,address);
+		work->memOps++;
+		windowPush(&work->window,address);
+	}
+	return 0;
+}
+
+/*
+ * Executes whole periods functionally while they take the recorded path
+ * and their LOADs and STOREs match the same older ones. A period that does
+ * not is undone. Returns the periods executed.
+ */
+static long long skipPeriods(APEX_CPU* cpu,FF_Work* work,int length,const long long* delta)
+{
+	const int* pcs=work->pcs[1];
+	long long limit=(inputClockCycles-cpu->clock)/delta[FF_CLOCK];
+	long long periods;
+
+	// the detailed run stops once maxInstructions committed, stay below
+	if(maxInstructions!=LLONG_MAX)
+	{
+		long long left=maxInstructions-1-cpu->ins_completed;
+		if(left/length<limit)
+			limit=left<0 ? 0 : left/length;
+	}
+
+	for(periods=0;periods<limit;periods++)
+	{
+		int regs[ARCH_REGS];
+		int zFlag=work->zFlag;
+		long long start=work->position;
+		FF_Window window=work->window;
+		int memOp=0;
+		int i;
+
+		memcpy(regs,work->regs,sizeof(regs));
+		for(i=0;i<length;i++)
+		{
+			if(work->pc!=pcs[i] || executeInstruction(cpu,work,NULL)<0)
+				break;
+
+			int address=entryAt(work,work->position)->address;
+			if(address<0)
+				continue;
+			if((windowMatches(&work->window,address)&work->considered[memOp])!=work->equal[memOp])
+				break;
+			windowPush(&work->window,address);
+			memOp++;
+		}
+		// the last one is the back-edge, it must be taken again
+		if(i==length && work->pc==pcs[0])
+			continue;
+
+		// back to the end of the last full period
+		for(;work->position>start;work->position--)
+		{
+			FF_Entry* entry=entryAt(work,work->position);
+			if(entry->store)
+				work->memory[entry->address]=entry->old;
+		}
+		memcpy(work->regs,regs,sizeof(regs));
+		work->zFlag=zFlag;
+		work->pc=pcs[0];
+		work->window=window;
+		break;
+	}
+	return periods;
+}
+
+/* Moves the state periods periods ahead, the cpu is at the end of a recorded one */
+static int advanceState(APEX_CPU* cpu,FF_Work* work,const long long* delta,long long periods)
+{
+	long long counters[FF_COUNTERS];
+	long long cycles=periods*delta[FF_CLOCK];
+
+	readCounters(cpu,counters);
+	for(int i=0;i<FF_COUNTERS;i++)
+		counters[i]+=periods*delta[i];
+	writeCounters(cpu,counters);
+
+	for(int i=0;i<IQ_SIZE;i++)
+		cpu->iq_list[i].clockCycle+=cycles;
+	for(int i=0;i<MEM_MAX_INFLIGHT;i++)
+		cpu->memFuncUnit.inflight[i].readyCycle+=cycles;
+	// dispatch tags only have to stay distinct, the skipped ones are never handed out
+
+	liveValues(cpu,work,work->distance[1],1);
+	if(cpu->digest.enabled)
+		stateDigestSync(cpu);
+
+	cpu->ff.periods+=periods;
+	cpu->ff.cycles+=cycles;
+	cpu->ff.instructions+=periods*delta[FF_INSTRUCTIONS];
+	return 0;
+}
+
+/*
+ * The loop looked periodic at lag back-edges: records two periods, checks
+ * them against the functional model and skips as many as it can
+ */
+static int fastForwardLoop(APEX_CPU* cpu,int lag)
+{
+	FF_Work* work=cpu->ff.work;
+	long long counters[3][FF_COUNTERS];
+	long long delta[FF_COUNTERS];
+	int length[2];
+
+	buildImage(cpu,&work->image[0]);
+	readCounters(cpu,counters[0]);
+	work->base=cpu->ins_completed;
+	if(startModel(cpu,work)<0)
+		return -1;
+
+	for(int period=0;period<2;period++)
+	{
+		if(recordPeriod(cpu,work,lag)<0)
+			return -1;
+		buildImage(cpu,&work->image[1]);
+		if(memcmp(&work->image[0],&work->image[1],sizeof(FF_Image))!=0)
+			return -1;
+		length[period]=checkPeriod(cpu,work,period);
+		if(length[period]<2)
+			return -1;
+		readCounters(cpu,counters[period+1]);
+	}
+
+	if(length[0]!=length[1] || memcmp(work->pcs[0],work->pcs[1],length[0]*sizeof(int))!=0
+	|| memcmp(work->distance[0],work->distance[1],sizeof(work->distance[0]))!=0)
+		return -1;
+	for(int i=0;i<FF_COUNTERS;i++)
+	{
+		delta[i]=counters[2][i]-counters[1][i];
+		if(delta[i]!=counters[1][i]-counters[0][i])
+			return -1;
+	}
+
+	recordMatches(work,length[1]);
+	cpu->ff.loops++;
+	long long periods=skipPeriods(cpu,work,length[0],delta);
+	if(periods>0)
+		advanceState(cpu,work,delta,periods);
+	return 0;
+}
+
+/*
+ * Called after a cycle that flushed at a back-edge. Looks for the lag at
+ * which the state repeats and fast-forwards the loop from there.
+ */
+int fastForwardBackEdge(APEX_CPU* cpu)
+{
+	APEX_Fast_Forward* ff=&cpu->ff;
+	FF_Signature sig;
+
+	ff->backEdge=0;
+	if(ff->skip>0)
+	{
+		ff->skip--;
+		return 0;
+	}
+
+	if(!ff->work)
+	{
+		ff->work=malloc(sizeof(FF_Work));
+		if(!ff->work)
+		{
+			fprintf(cpu->err,"APEX_Error : No memory for --fast-forward\n");
+			ff->active=0;
+			return -1;
+		}
+		memset(ff->work->table,0,sizeof(ff->work->table));
+		ff->work->edges=0;
+		ff->work->generation=1;
+	}
+	FF_Work* work=ff->work;
+
+	buildSignature(cpu,&sig);
+	int lag=findLag(work,&sig);
+	if(!lag)
+		return 0;
+
+	// the back-edges simulated by the attempt are not in the table
+	work->generation++;
+	if(fastForwardLoop(cpu,lag)<0)
+	{
+		ff->failures++;
+		ff->skip=FF_MAX_SKIP;
+		if(ff->failures<12 && (1<<ff->failures)<FF_MAX_SKIP)
+			ff->skip=1<<ff->failures;
+	}
+	else
+		ff->failures=0;
+	return 0;
+}
+
+int printFastForwardStats(APEX_CPU* cpu)
+{
+	if(!fastForwardEnabled)
+		return 0;
+
+	fprintf(cpu->out,"\n========== FAST-FORWARD STATISTICS ==========\n");
+	fprintf(cpu->out,"|    Loops\t\t|\t%lld\t|\n",cpu->ff.loops);
+	fprintf(cpu->out,"|    Periods Skipped\t|\t%lld\t|\n",cpu->ff.periods);
+	fprintf(cpu->out,"|    Cycles Skipped\t|\t%lld\t|\n",cpu->ff.cycles);
+	fprintf(cpu->out,"|    Insts Skipped\t|\t%lld\t|\n",cpu->ff.instructions);
+
+	return 0;
+}
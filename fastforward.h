@@ -0,0 +1,87 @@
+#ifndef _APEX_FASTFORWARD_H_
+#define _APEX_FASTFORWARD_H_
+/**
+ *  fastforward.h
+ *  Contains the loop fast-forward of the simulate operation
+ *
+ *  With --fast-forward=1 the cpu looks at the timing state (IQ, LSQ, ROB,
+ *  URF allocation, function units, forward bus tags, CFIDs) at every taken
+ *  branch to a lower PC. Once it repeats after some back-edges of the same
+ *  branch, the loop is periodic: two more periods are simulated in detail
+ *  and checked against a functional model, commit by commit and for every
+ *  value still in flight. Further periods are then executed functionally
+ *  only. Cycles and counters advance by the per-period deltas and the in
+ *  flight values are rebuilt from the functional results, so the run ends
+ *  in the same state as a detailed run.
+ *
+ *  A period is skipped only while it takes the recorded path and every
+ *  LOAD and STORE matches the addresses of the same older ones in reach of
+ *  the LSQ. The first period that does not is simulated in detail. Runs
+ *  with caches, SMT, display, probes, interval statistics, stage timing,
+ *  instruction traces, a commit log or a digest stream never
+ *  fast-forward, their state is not periodic or they report every cycle
+ *  or commit. A state digest is computed again after each skip.
+ */
+
+struct APEX_CPU;
+struct FF_Work;
+
+/* Back-edges a period may span */
+#define FF_MAX_LAG 1024
+
+/* Largest period recorded, in committed instructions */
+#define FF_MAX_PERIOD_INSTS 32768
+
+/* Back-edges ignored after a failed attempt, doubled per failure up to this */
+#define FF_MAX_SKIP 4096
+
+typedef struct APEX_Fast_Forward
+{
+	int active;				// enabled and exact for this configuration
+	int backEdge;			// a taken branch to a lower PC flushed this cycle
+	int branchPc;			// that branch
+	int branchTarget;
+	int wrongPathAddress;	// a flushed LOAD or STORE had its address computed
+	int skip;				// back-edges to ignore before the next attempt
+	int failures;			// attempts failed in a row
+	struct FF_Work* work;	// signature table and the period buffers
+
+	/* Some stats */
+	long long loops;		// periodic loops verified
+	long long periods;		// periods executed functionally
+	long long cycles;		// cycles they stood for
+	long long instructions;
+}APEX_Fast_Forward;
+
+/* Fast-forward configuration, set from command line options */
+extern int fastForwardEnabled;
+
+/* Before the flush of a taken control instruction */
+#define FAST_FORWARD_FLUSH(cpu) \
+	do { \
+		if((cpu)->ff.active) \
+			fastForwardFlush(cpu); \
+	} while(0)
+
+/* After a cycle, one test unless a back-edge flushed */
+#define FAST_FORWARD_POINT(cpu) \
+	do { \
+		if((cpu)->ff.backEdge) \
+			fastForwardBackEdge(cpu); \
+	} while(0)
+
+int fastForwardParseOption(const char* arg);
+
+int fastForwardInit(struct APEX_CPU* cpu);
+
+int fastForwardBegin(struct APEX_CPU* cpu);
+
+int fastForwardFlush(struct APEX_CPU* cpu);
+
+int fastForwardBackEdge(struct APEX_CPU* cpu);
+
+int fastForwardFinish(struct APEX_CPU* cpu);
+
+int printFastForwardStats(struct APEX_CPU* cpu);
+
+#endif
@@ -0,0 +1,207 @@
+/*
+ *  icache.c
+ *  Contains the instruction cache and fetch block model used by fetch
+ *
+ *  A fetch block holds up to fetchWidth instructions that lie in the same
+ *  cache line. Fetch only accesses the I-cache when the PC leaves the
+ *  current block; a miss stalls the front end for icacheMissLatency cycles.
+ *
+ *  The pipeline decodes and dispatches one instruction a cycle, so fetch
+ *  still delivers one instruction a cycle out of the block. fetchWidth is
+ *  the granularity of the I-cache accesses, not the fetch bandwidth.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+int icacheEnabled=0;
+int icacheSize=1024;		// bytes
+int icacheAssoc=2;
+int icacheLineSize=32;		// bytes
+int icacheMissLatency=10;	// cycles
+int fetchWidth=1;			// instructions per fetch block, fetch still delivers one a cycle
+
+int icacheParseOption(const char* arg)
+{
+	const char* value;
+
+	if(matchOption(arg,"--icache",&value))
+		icacheEnabled=atoi(value);
+	else if(matchOption(arg,"--icache-size",&value))
+		icacheSize=atoi(value);
+	else if(matchOption(arg,"--icache-assoc",&value))
+		icacheAssoc=atoi(value);
+	else if(matchOption(arg,"--icache-line",&value))
+		icacheLineSize=atoi(value);
+	else if(matchOption(arg,"--icache-miss-latency",&value))
+		icacheMissLatency=atoi(value);
+	else if(matchOption(arg,"--fetch-width",&value))
+		fetchWidth=atoi(value);
+	else
+		return 0;
+
+	return 1;
+}
+
+static int icacheSets()
+{
+	return icacheSize/(icacheLineSize*icacheAssoc);
+}
+
+int icacheInit(APEX_CPU* cpu)
+{
+	APEX_ICache* ic=&cpu->icache;
+
+	if(!icacheEnabled)
+		return 0;
+
+	if(icacheLineSize<4 || (icacheLineSize%4)!=0 || icacheAssoc<1 || fetchWidth<1
+	|| icacheSets()<1 || icacheSets()*icacheAssoc>ICACHE_MAX_LINES)
+	{
+		fprintf(cpu->err,"APEX_Error : Invalid I-cache geometry size=%d assoc=%d line=%d\n",
+				icacheSize,icacheAssoc,icacheLineSize);
+		return -1;
+	}
+
+	memset(ic,0,sizeof(*ic));
+	for(int i=0;i<SMT_MAX_THREADS;i++)
+	{
+		APEX_Fetch_Block* fb=&cpu->threads[i].fetchBlock;
+
+		memset(fb,0,sizeof(*fb));
+		fb->blockStartPc=-1;
+		fb->blockEndPc=-1;
+	}
+	return 0;
+}
+
+/*
+ * Looks up the line holding pc in the code space of the current thread,
+ * returns the line or NULL on miss
+ */
+static APEX_ICache_Line* icacheLookup(APEX_CPU* cpu,int pc)
+{
+	int lineAddr=pc/icacheLineSize;
+	int set=lineAddr%icacheSets();
+	APEX_ICache_Line* ways=&cpu->icache.lines[set*icacheAssoc];
+
+	for(int i=0;i<icacheAssoc;i++)
+	{
+		if(ways[i].valid && ways[i].program==cpu->thread->program && ways[i].tag==lineAddr)
+			return &ways[i];
+	}
+	return NULL;
+}
+
+/* Installs the line holding pc, replacing the LRU way of its set */
+static void icacheFill(APEX_CPU* cpu,int pc)
+{
+	int lineAddr=pc/icacheLineSize;
+	int set=lineAddr%icacheSets();
+	APEX_ICache_Line* ways=&cpu->icache.lines[set*icacheAssoc];
+	APEX_ICache_Line* victim=&ways[0];
+
+	for(int i=0;i<icacheAssoc;i++)
+	{
+		if(!ways[i].valid)
+		{
+			victim=&ways[i];
+			break;
+		}
+		if(ways[i].lastUse < victim->lastUse)
+			victim=&ways[i];
+	}
+
+	victim->valid=1;
+	victim->program=cpu->thread->program;
+	victim->tag=lineAddr;
+	victim->lastUse=cpu->clock;
+}
+
+/* Starts a new fetch block at pc, limited by fetch width and the line end */
+static void icacheSetBlock(APEX_CPU* cpu,int pc)
+{
+	APEX_Fetch_Block* fb=&cpu->thread->fetchBlock;
+	int lineEnd=(pc/icacheLineSize+1)*icacheLineSize;
+
+	fb->blockStartPc=pc;
+	fb->blockEndPc=pc+fetchWidth*4;
+	if(fb->blockEndPc>lineEnd)
+		fb->blockEndPc=lineEnd;
+	cpu->icache.fetchBlocks++;
+}
+
+/*
+ * Called by fetch before reading code memory at pc for the current
+ * thread. Returns 1 when its front end has to stall this cycle, 0 when
+ * the instruction is available.
+ */
+int icacheFetchStall(APEX_CPU* cpu,int pc)
+{
+	APEX_ICache* ic=&cpu->icache;
+	APEX_Fetch_Block* fb=&cpu->thread->fetchBlock;
+
+	if(fb->missPending)
+	{
+		if(fb->missCyclesLeft>0)
+		{
+			fb->missCyclesLeft--;
+			ic->stallCycles++;
+			return 1;
+		}
+
+		// line fill done, fetch may have been redirected meanwhile
+		fb->missPending=0;
+		icacheFill(cpu,fb->missPc);
+	}
+
+	if(pc>=fb->blockStartPc && pc<fb->blockEndPc)
+		return 0;
+
+	ic->accesses++;
+	APEX_ICache_Line* line=icacheLookup(cpu,pc);
+	if(line)
+	{
+		ic->hits++;
+		line->lastUse=cpu->clock;
+		icacheSetBlock(cpu,pc);
+		return 0;
+	}
+
+	ic->misses++;
+	if(icacheMissLatency<1)
+	{
+		icacheFill(cpu,pc);
+		icacheSetBlock(cpu,pc);
+		return 0;
+	}
+
+	fb->missPending=1;
+	fb->missPc=pc;
+	fb->missCyclesLeft=icacheMissLatency-1;
+	ic->stallCycles++;
+	return 1;
+}
+
+int printIcacheStats(APEX_CPU* cpu)
+{
+	APEX_ICache* ic=&cpu->icache;
+
+	if(!icacheEnabled)
+		return 0;
+
+	fprintf(cpu->out,"\n========== I-CACHE STATISTICS ==========\n");
+	fprintf(cpu->out,"|    Geometry\t\t|\t%dB, %d-way, %dB lines, %d-instruction fetch blocks\t|\n",
+			icacheSize,icacheAssoc,icacheLineSize,fetchWidth);
+	fprintf(cpu->out,"|    Accesses\t\t|\t%lld\t|\n",ic->accesses);
+	fprintf(cpu->out,"|    Hits\t\t|\t%lld\t|\n",ic->hits);
+	fprintf(cpu->out,"|    Misses\t\t|\t%lld\t|\n",ic->misses);
+	fprintf(cpu->out,"|    Miss Rate\t\t|\t%.2f%%\t|\n",
+			ic->accesses ? 100.0*ic->misses/ic->accesses : 0.0);
+	fprintf(cpu->out,"|    Stall Cycles\t|\t%lld\t|\n",ic->stallCycles);
+	fprintf(cpu->out,"|    Fetch Blocks\t|\t%lld\t|\n",ic->fetchBlocks);
+
+	return 0;
+}
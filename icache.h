@@ -0,0 +1,62 @@
+#ifndef _APEX_ICACHE_H_
+#define _APEX_ICACHE_H_
+/**
+ *  icache.h
+ *  Contains the instruction cache and fetch block data structures
+ */
+
+/* Upper bound on the number of lines (sets * ways) the model can hold */
+#define ICACHE_MAX_LINES 4096
+
+struct APEX_CPU;
+
+/* One line of the instruction cache */
+typedef struct APEX_ICache_Line
+{
+	int valid;
+	int program;		// code space of the hardware threads that fetched it
+	int tag;
+	long long lastUse;	// cycle of last access, used for LRU replacement
+}APEX_ICache_Line;
+
+/* The fetch block and line fill of one hardware thread */
+typedef struct APEX_Fetch_Block
+{
+	int blockStartPc;	// fetch block is [blockStartPc, blockEndPc)
+	int blockEndPc;
+
+	int missPending;	// a line fill is in progress
+	int missPc;
+	int missCyclesLeft;
+}APEX_Fetch_Block;
+
+/* Model of the instruction cache shared by the hardware threads */
+typedef struct APEX_ICache
+{
+	APEX_ICache_Line lines[ICACHE_MAX_LINES];
+
+	/* Some stats */
+	long long accesses;
+	long long hits;
+	long long misses;
+	long long stallCycles;
+	long long fetchBlocks;
+}APEX_ICache;
+
+/* I-cache configuration, set from command line options */
+extern int icacheEnabled;
+extern int icacheSize;
+extern int icacheAssoc;
+extern int icacheLineSize;
+extern int icacheMissLatency;
+extern int fetchWidth;
+
+int icacheParseOption(const char* arg);
+
+int icacheInit(struct APEX_CPU* cpu);
+
+int icacheFetchStall(struct APEX_CPU* cpu,int pc);
+
+int printIcacheStats(struct APEX_CPU* cpu);
+
+#endif
@@ -0,0 +1,411 @@
+/*
+ *  insn_trace.c
+ *  Contains the recording and replay of dynamic instruction traces
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "cpu.h"
+
+const char* insnTraceFile=NULL;
+const char* insnTraceOutFile=NULL;
+
+/* Recorder output buffer */
+#define INSN_TRACE_BUFFER_SIZE (1<<20)
+
+typedef struct Insn_Trace_Header
+{
+	char magic[8];
+	int codeSize;
+	unsigned int codeHash;
+	long long records;
+	long long bytes;
+}Insn_Trace_Header;
+
+int insnTraceParseOption(const char* arg)
+{
+	const char* value;
+
+	if(matchOption(arg,"--insn-trace",&value))
+		insnTraceFile=value;
+	else if(matchOption(arg,"--insn-trace-out",&value))
+		insnTraceOutFile=value;
+	else
+		return 0;
+
+	return 1;
+}
+
+static int recordKind(const char* opcode)
+{
+	if(strcmp(opcode,"BZ")==0 || strcmp(opcode,"BNZ")==0)
+		return INSN_TRACE_BRANCH;
+	if(strcmp(opcode,"JUMP")==0 || strcmp(opcode,"JAL")==0)
+		return INSN_TRACE_TARGET;
+	if(strcmp(opcode,"LOAD")==0 || strcmp(opcode,"STORE")==0)
+		return INSN_TRACE_ADDRESS;
+	if(strcmp(opcode,"HALT")==0)
+		return INSN_TRACE_HALT;
+	return INSN_TRACE_NONE;
+}
+
+/* FNV-1a over the fields of every instruction, a trace replays only its own program */
+static unsigned int codeHash(APEX_CPU* cpu)
+{
+	unsigned int hash=2166136261u;
+
+	for(int i=0;i<cpu->thread->code_memory_size;i++)
+	{
+		APEX_Instruction* ins=&cpu->thread->code_memory[i];
+		int fields[4]={ins->rd,ins->rs1,ins->rs2,ins->imm};
+		const unsigned char* bytes=(const unsigned char*)fields;
+
+		for(const char* c=ins->opcode;*c;c++)
+			hash=(hash^(unsigned char)*c)*16777619u;
+		for(int b=0;b<(int)sizeof(fields);b++)
+			hash=(hash^bytes[b])*16777619u;
+	}
+	return hash;
+}
+
+static int writeVarint(APEX_Insn_Trace* trace,int delta)
+{
+	// zigzag keeps small negative deltas small
+	unsigned int value=((unsigned int)delta<<1)^(unsigned int)(delta>>31);
+
+	while(value>=0x80)
+	{
+		fputc((value&0x7f)|0x80,trace->file);
+		trace->bytes++;
+		value>>=7;
+	}
+	fputc(value,trace->file);
+	trace->bytes++;
+	return 0;
+}
+
+/* Returns -1 on a varint cut off by the end of the trace */
+static int readVarint(APEX_Insn_Trace* trace,int* delta)
+{
+	unsigned int value=0;
+
+	for(int shift=0;shift<35;shift+=7)
+	{
+		if(trace->next>=trace->end)
+			return -1;
+		unsigned char byte=*trace->next++;
+		value|=(unsigned int)(byte&0x7f)<<shift;
+		if(!(byte&0x80))
+		{
+			*delta=(int)(value>>1)^-(int)(value&1);
+			return 0;
+		}
+	}
+	return -1;
+}
+
+static int openReplay(APEX_CPU* cpu)
+{
+	APEX_Insn_Trace* trace=&cpu->insnTrace;
+	Insn_Trace_Header header;
+	struct stat st;
+	int fd=open(insnTraceFile,O_RDONLY);
+
+	if(fd<0 || fstat(fd,&st)<0)
+	{
+		fprintf(cpu->err,"APEX_Error : Cannot read %s\n",insnTraceFile);
+		if(fd>=0)
+			close(fd);
+		return -1;
+	}
+	if(st.st_size<(off_t)sizeof(header))
+	{
+		fprintf(cpu->err,"APEX_Error : %s is not an instruction trace\n",insnTraceFile);
+		close(fd);
+		return -1;
+	}
+
+	void* map=mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+	close(fd);
+	if(map==MAP_FAILED)
+	{
+		fprintf(cpu->err,"APEX_Error : Cannot map %s\n",insnTraceFile);
+		return -1;
+	}
+	madvise(map,st.st_size,MADV_SEQUENTIAL);
+	trace->map=map;
+	trace->mapSize=st.st_size;
+
+	memcpy(&header,map,sizeof(header));
+	if(memcmp(header.magic,"APEXDYN1",8)!=0 || header.bytes!=st.st_size-(long long)sizeof(header))
+	{
+		fprintf(cpu->err,"APEX_Error : %s is not an instruction trace\n",insnTraceFile);
+		return -1;
+	}
+	if(header.codeSize!=cpu->thread->code_memory_size || header.codeHash!=codeHash(cpu))
+	{
+		fprintf(cpu->err,"APEX_Error : %s was recorded from another program\n",insnTraceFile);
+		return -1;
+	}
+
+	trace->next=trace->map+sizeof(header);
+	trace->end=trace->map+trace->mapSize;
+	trace->remaining=header.records;
+	trace->pc=4000;
+	trace->replaying=1;
+	return 0;
+}
+
+static int openRecord(APEX_CPU* cpu)
+{
+	APEX_Insn_Trace* trace=&cpu->insnTrace;
+	Insn_Trace_Header header;
+
+	trace->file=fopen(insnTraceOutFile,"wb");
+	if(!trace->file)
+	{
+		fprintf(cpu->err,"APEX_Error : Cannot write %s\n",insnTraceOutFile);
+		return -1;
+	}
+	setvbuf(trace->file,NULL,_IOFBF,INSN_TRACE_BUFFER_SIZE);
+
+	// the counts are filled in once the run is over
+	memset(&header,0,sizeof(header));
+	fwrite(&header,sizeof(header),1,trace->file);
+	trace->pendingKind=INSN_TRACE_NONE;
+	trace->recording=1;
+	return 0;
+}
+
+int insnTraceInit(APEX_CPU* cpu)
+{
+	APEX_Insn_Trace* trace=&cpu->insnTrace;
+
+	memset(trace,0,sizeof(*trace));
+	if(!insnTraceFile && !insnTraceOutFile)
+		return 0;
+
+	if(insnTraceFile && insnTraceOutFile)
+	{
+		fprintf(cpu->err,"APEX_Error : Replay --insn-trace or record --insn-trace-out, not both\n");
+		return -1;
+	}
+	if(smtThreads>1 || multicoreCores>1 || aotEnabled)
+	{
+		fprintf(cpu->err,"APEX_Error : Instruction traces need a single thread on a single core, drop --smt-threads, --cores or --aot\n");
+		return -1;
+	}
+	if(insnTraceFile && openReplay(cpu)<0)
+	{
+		insnTraceFinish(cpu);
+		return -1;
+	}
+	if(insnTraceOutFile && openRecord(cpu)<0)
+	{
+		insnTraceFinish(cpu);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Fetch of pc while replaying. An instruction on the correct path takes
+ * the next record into the stage. Returns 0 when the trace is used up and
+ * fetch must send a bubble.
+ */
+int insnTraceFetch(APEX_CPU* cpu,int pc,CPU_Stage* stage)
+{
+	APEX_Insn_Trace* trace=&cpu->insnTrace;
+	APEX_Instruction* ins=&cpu->thread->code_memory[(pc-4000)/4];
+	int delta;
+
+	stage->traced=0;
+	if(trace->wrongPath)
+	{
+		trace->wrongPathFetches++;
+		return 1;
+	}
+	if(trace->remaining==0)
+		return 0;
+	if(pc!=trace->pc)
+	{
+		fprintf(cpu->err,"APEX_Error : Fetch at pc(%d) left the trace at pc(%d)\n",pc,trace->pc);
+		trace->remaining=0;
+		return 0;
+	}
+
+	switch(recordKind(ins->opcode))
+	{
+		case INSN_TRACE_BRANCH:
+			if(trace->next>=trace->end)
+				goto truncated;
+			stage->traceValue=*trace->next++;
+			trace->pc=stage->traceValue ? pc+ins->imm : pc+4;
+			trace->wrongPath=stage->traceValue;
+			break;
+		case INSN_TRACE_TARGET:
+			if(readVarint(trace,&delta)<0)
+				goto truncated;
+			stage->traceValue=pc+delta;
+			trace->pc=stage->traceValue;
+			trace->wrongPath=1;
+			break;
+		case INSN_TRACE_ADDRESS:
+			if(readVarint(trace,&delta)<0)
+				goto truncated;
+			trace->address+=delta;
+			stage->traceValue=trace->address;
+			trace->pc=pc+4;
+			break;
+		case INSN_TRACE_HALT:
+			// what follows the HALT never commits
+			trace->wrongPath=1;
+			break;
+		default:
+			trace->pc=pc+4;
+			break;
+	}
+
+	stage->traced=1;
+	trace->remaining--;
+	trace->records++;
+	return 1;
+
+truncated:
+	fprintf(cpu->err,"APEX_Error : %s ends inside a record\n",insnTraceFile);
+	trace->remaining=0;
+	return 0;
+}
+
+/*
+ * Sets the operands the integer unit reads, so it computes the recorded
+ * outcome or address whatever values the pipeline carried
+ */
+int insnTraceResolve(CPU_Stage* stage)
+{
+	switch(recordKind(stage->opcode))
+	{
+		case INSN_TRACE_BRANCH:
+			stage->zFlag=strcmp(stage->opcode,"BZ")==0 ? stage->traceValue : !stage->traceValue;
+			break;
+		case INSN_TRACE_TARGET:
+			stage->rs1_value=stage->traceValue-stage->imm;
+			break;
+		case INSN_TRACE_ADDRESS:
+			if(strcmp(stage->opcode,"LOAD")==0)
+				stage->rs1_value=stage->traceValue-stage->imm;
+			else
+				stage->rs2_value=stage->traceValue-stage->imm;
+			break;
+	}
+	return 0;
+}
+
+/* The flush of a taken transfer of the trace puts fetch back on the correct path */
+int insnTraceFlush(APEX_CPU* cpu)
+{
+	if((&cpu->thread->rob_list[cpu->thread->branchRobIndex].stage)->traced)
+		cpu->insnTrace.wrongPath=0;
+	return 0;
+}
+
+/*
+ * Records a committed instruction. A control instruction is written once
+ * the next commit shows where it went.
+ */
+int insnTraceCommit(APEX_CPU* cpu,CPU_Stage* stage)
+{
+	APEX_Insn_Trace* trace=&cpu->insnTrace;
+	int kind=recordKind(stage->opcode);
+
+	if(trace->halted)
+		return 0;
+
+	if(trace->pendingKind==INSN_TRACE_BRANCH)
+	{
+		fputc(stage->pc!=trace->pendingPc+4,trace->file);
+		trace->bytes++;
+		trace->records++;
+	}
+	else if(trace->pendingKind==INSN_TRACE_TARGET)
+	{
+		writeVarint(trace,stage->pc-trace->pendingPc);
+		trace->records++;
+	}
+	trace->pendingKind=INSN_TRACE_NONE;
+
+	if(kind==INSN_TRACE_BRANCH || kind==INSN_TRACE_TARGET)
+	{
+		trace->pendingPc=stage->pc;
+		trace->pendingKind=kind;
+		return 0;
+	}
+	if(kind==INSN_TRACE_ADDRESS)
+	{
+		writeVarint(trace,stage->mem_address-trace->lastAddress);
+		trace->lastAddress=stage->mem_address;
+	}
+	trace->halted=kind==INSN_TRACE_HALT;
+	trace->records++;
+	return 0;
+}
+
+/* The trace is used up and every instruction fetched from it has committed */
+int insnTraceDrained(APEX_CPU* cpu)
+{
+	APEX_Insn_Trace* trace=&cpu->insnTrace;
+
+	return trace->replaying && !trace->remaining && cpu->ins_completed>=trace->records && !cpu->memFuBusy;
+}
+
+int insnTraceFinish(APEX_CPU* cpu)
+{
+	APEX_Insn_Trace* trace=&cpu->insnTrace;
+
+	if(trace->map)
+	{
+		munmap((void*)trace->map,trace->mapSize);
+		trace->map=NULL;
+	}
+	if(trace->file)
+	{
+		// a control instruction still waiting for its successor is left out
+		Insn_Trace_Header header;
+
+		memcpy(header.magic,"APEXDYN1",8);
+		header.codeSize=cpu->thread->code_memory_size;
+		header.codeHash=codeHash(cpu);
+		header.records=trace->records;
+		header.bytes=trace->bytes;
+		fseek(trace->file,0,SEEK_SET);
+		fwrite(&header,sizeof(header),1,trace->file);
+		fclose(trace->file);
+		trace->file=NULL;
+	}
+	return 0;
+}
+
+int printInsnTraceStats(APEX_CPU* cpu)
+{
+	APEX_Insn_Trace* trace=&cpu->insnTrace;
+
+	if(!trace->replaying && !trace->recording)
+		return 0;
+
+	fprintf(cpu->out,"\n========== INSTRUCTION TRACE STATISTICS ==========\n");
+	fprintf(cpu->out,"|    Mode\t\t|\t%s\t|\n",trace->replaying ? "replay" : "record");
+	fprintf(cpu->out,"|    Records\t\t|\t%lld\t|\n",trace->records);
+	if(trace->recording)
+	{
+		fprintf(cpu->out,"|    Bytes\t\t|\t%lld\t|\n",trace->bytes);
+		fprintf(cpu->out,"|    Bytes/Instruction\t|\t%.3f\t|\n",trace->records ? (double)trace->bytes/trace->records : 0.0);
+	}
+	if(trace->replaying)
+		fprintf(cpu->out,"|    Wrong Path Fetches\t|\t%lld\t|\n",trace->wrongPathFetches);
+	return 0;
+}
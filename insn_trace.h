@@ -0,0 +1,113 @@
+#ifndef _APEX_INSN_TRACE_H_
+#define _APEX_INSN_TRACE_H_
+/**
+ *  insn_trace.h
+ *  Contains the dynamic instruction traces of the simulate operation
+ *
+ *  --insn-trace-out=path records the committed instruction stream of a
+ *  run. --insn-trace=path replays such a trace: the pipeline still fetches
+ *  from code memory, but every instruction on the correct path takes its
+ *  branch outcome, jump target or memory address from the trace rather
+ *  than from the values the pipeline computed. Fetch knows it is on the
+ *  wrong path after a taken transfer of the trace, until that transfer
+ *  flushes; wrong path instructions run on their own values as before.
+ *  The run ends at the HALT of the trace, or once every instruction of a
+ *  cut off trace has committed. A trace is read through a read-only
+ *  mapping, runs of many configurations share it in the page cache.
+ *
+ *  The file is the 8 bytes "APEXDYN1", an int32 instruction count and
+ *  uint32 FNV-1a hash of the program, an int64 record count and an int64
+ *  byte count, then the records in commit order, all in host byte order.
+ *  PCs are implicit from 4000 on. BZ and BNZ have one byte, 1 when taken.
+ *  JUMP and JAL have the target less their PC, LOAD and STORE the address
+ *  less the address of the previous LOAD or STORE, both as zigzag LEB128
+ *  varints. Other instructions have no bytes.
+ */
+
+#include <stdio.h>
+
+struct APEX_CPU;
+struct CPU_Stage;
+
+/* What the record of an instruction holds */
+enum
+{
+	INSN_TRACE_NONE,
+	INSN_TRACE_BRANCH,		// taken byte
+	INSN_TRACE_TARGET,		// target delta
+	INSN_TRACE_ADDRESS,		// address delta
+	INSN_TRACE_HALT
+};
+
+typedef struct APEX_Insn_Trace
+{
+	int replaying;				// --insn-trace drives the correct path
+	int recording;				// --insn-trace-out records the commits
+
+	/* Replay cursor over the mapped file */
+	const unsigned char* map;
+	long long mapSize;
+	const unsigned char* next;	// next record
+	const unsigned char* end;
+	long long remaining;		// records not fetched yet
+	int pc;						// next instruction on the correct path
+	int address;				// previous LOAD or STORE address
+	int wrongPath;				// a taken transfer of the trace has not flushed yet
+
+	/* Recorder */
+	FILE* file;
+	int pendingPc;				// committed control instruction, its record
+	int pendingKind;			// waits for the PC committed after it
+	int lastAddress;
+	int halted;
+
+	/* Some stats */
+	long long records;			// recorded, or fetched from the trace
+	long long bytes;
+	long long wrongPathFetches;
+}APEX_Insn_Trace;
+
+/* Trace configuration, set from command line options */
+extern const char* insnTraceFile;
+extern const char* insnTraceOutFile;
+
+/* At commit, one test unless recording */
+#define INSN_TRACE_COMMIT(cpu,stage) \
+	do { \
+		if((cpu)->insnTrace.recording) \
+			insnTraceCommit(cpu,stage); \
+	} while(0)
+
+/* Before an instruction issues to the integer unit */
+#define INSN_TRACE_RESOLVE(stage) \
+	do { \
+		if((stage)->traced) \
+			insnTraceResolve(stage); \
+	} while(0)
+
+/* Before the flush of a taken control instruction */
+#define INSN_TRACE_FLUSH(cpu) \
+	do { \
+		if((cpu)->insnTrace.replaying) \
+			insnTraceFlush(cpu); \
+	} while(0)
+
+int insnTraceParseOption(const char* arg);
+
+int insnTraceInit(struct APEX_CPU* cpu);
+
+int insnTraceFetch(struct APEX_CPU* cpu,int pc,struct CPU_Stage* stage);
+
+int insnTraceResolve(struct CPU_Stage* stage);
+
+int insnTraceFlush(struct APEX_CPU* cpu);
+
+int insnTraceCommit(struct APEX_CPU* cpu,struct CPU_Stage* stage);
+
+int insnTraceDrained(struct APEX_CPU* cpu);
+
+int insnTraceFinish(struct APEX_CPU* cpu);
+
+int printInsnTraceStats(struct APEX_CPU* cpu);
+
+#endif
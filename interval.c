@@ -0,0 +1,177 @@
+/*
+ *  interval.c
+ *  Contains the sampling and output of the interval statistics
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+const char* intervalFile=NULL;
+long long intervalCycles=0;
+long long intervalInstructions=0;
+int intervalFormat=INTERVAL_CSV;
+
+static const char* fieldNames[INTERVAL_FIELDS]=
+{
+	"cycle","instructions","interval_cycles","committed","iq","lsq","rob",
+	"free_urf","flushes","mem_ops","dispatch_stalls"
+};
+
+int intervalParseOption(const char* arg)
+{
+	const char* value;
+
+	if(matchOption(arg,"--interval-file",&value))
+		intervalFile=value;
+	else if(matchOption(arg,"--interval-cycles",&value))
+		intervalCycles=atoll(value);
+	else if(matchOption(arg,"--interval-insts",&value))
+		intervalInstructions=atoll(value);
+	else if(matchOption(arg,"--interval-format",&value))
+	{
+		if(strcmp(value,"csv")==0)
+			intervalFormat=INTERVAL_CSV;
+		else if(strcmp(value,"bin")==0)
+			intervalFormat=INTERVAL_BINARY;
+		else
+			return 0;
+	}
+	else
+		return 0;
+
+	return 1;
+}
+
+int intervalInit(APEX_CPU* cpu)
+{
+	APEX_Interval* interval=&cpu->interval;
+
+	memset(interval,0,sizeof(*interval));
+	if(!intervalFile)
+		return 0;
+
+	if(intervalCycles<0 || intervalInstructions<0)
+	{
+		fprintf(cpu->err,"APEX_Error : Invalid interval cycles=%lld insts=%lld\n",intervalCycles,intervalInstructions);
+		return -1;
+	}
+	// sample every 10000 cycles unless told otherwise
+	if(!intervalCycles && !intervalInstructions)
+		intervalCycles=10000;
+
+	interval->file=fopen(intervalFile,intervalFormat==INTERVAL_BINARY ? "wb" : "w");
+	if(!interval->file)
+	{
+		fprintf(cpu->err,"APEX_Error : Cannot write %s\n",intervalFile);
+		return -1;
+	}
+
+	if(intervalFormat==INTERVAL_BINARY)
+	{
+		int fields=INTERVAL_FIELDS;
+		fwrite("APEXIVL1",1,8,interval->file);
+		fwrite(&fields,sizeof(fields),1,interval->file);
+	}
+	else
+	{
+		for(int i=0;i<INTERVAL_FIELDS;i++)
+			fprintf(interval->file,"%s,",fieldNames[i]);
+		fprintf(interval->file,"ipc\n");
+	}
+
+	interval->nextCycle=intervalCycles ? intervalCycles : -1;
+	interval->nextInstructions=intervalInstructions ? intervalInstructions : -1;
+	return 0;
+}
+
+/* Entries between head and tail of a circular queue, -1 heads mean empty */
+static int queueEntries(int head,int tail,int size)
+{
+	if(head==-1 || tail==-1)
+		return 0;
+	return (tail-head+size+1)%size;
+}
+
+/* Takes and writes the sample that ends at the current cycle */
+static int writeSample(APEX_CPU* cpu)
+{
+	APEX_Interval* interval=&cpu->interval;
+	long long sample[INTERVAL_FIELDS];
+	long long counters[INTERVAL_FIELDS];
+
+	// running totals, the interval fields are their differences
+	counters[INTERVAL_FLUSHES]=cpu->flushes;
+	counters[INTERVAL_MEM_OPS]=cpu->memAccesses;
+	counters[INTERVAL_DISPATCH_STALLS]=cpu->dispatchStalls;
+
+	sample[INTERVAL_CYCLE]=cpu->clock;
+	sample[INTERVAL_INSTRUCTIONS]=cpu->ins_completed;
+	sample[INTERVAL_CYCLES]=cpu->clock-interval->last[INTERVAL_CYCLE];
+	sample[INTERVAL_COMMITTED]=cpu->ins_completed-interval->last[INTERVAL_INSTRUCTIONS];
+	for(int i=INTERVAL_FLUSHES;i<INTERVAL_FIELDS;i++)
+		sample[i]=counters[i]-interval->last[i];
+
+	sample[INTERVAL_IQ]=0;
+	for(int i=0;i<IQ_SIZE;i++)
+		sample[INTERVAL_IQ]+=cpu->iq_list[i].allocated;
+	sample[INTERVAL_LSQ]=queueEntries(cpu->lsqHead,cpu->lsqTail,LSQ_SIZE);
+	sample[INTERVAL_ROB]=0;
+	for(int t=0;t<cpu->threadCount;t++)
+		sample[INTERVAL_ROB]+=queueEntries(cpu->threads[t].robHead,cpu->threads[t].robTail,ROB_SIZE);
+	sample[INTERVAL_FREE_URF]=0;
+	for(int i=0;i<URF_SIZE;i++)
+		sample[INTERVAL_FREE_URF]+=cpu->urf_regs[i].isFree;
+
+	if(intervalFormat==INTERVAL_BINARY)
+		fwrite(sample,sizeof(sample[0]),INTERVAL_FIELDS,interval->file);
+	else
+	{
+		for(int i=0;i<INTERVAL_FIELDS;i++)
+			fprintf(interval->file,"%lld,",sample[i]);
+		fprintf(interval->file,"%.4f\n",sample[INTERVAL_CYCLES] ? (double)sample[INTERVAL_COMMITTED]/sample[INTERVAL_CYCLES] : 0.0);
+	}
+
+	interval->last[INTERVAL_CYCLE]=cpu->clock;
+	interval->last[INTERVAL_INSTRUCTIONS]=cpu->ins_completed;
+	for(int i=INTERVAL_FLUSHES;i<INTERVAL_FIELDS;i++)
+		interval->last[i]=counters[i];
+	interval->samples++;
+	return 0;
+}
+
+/*
+ * Called at the end of every cycle, samples when either bound is reached
+ * and starts the next interval from here
+ */
+int intervalTick(APEX_CPU* cpu)
+{
+	APEX_Interval* interval=&cpu->interval;
+
+	if((interval->nextCycle<0 || cpu->clock<interval->nextCycle)
+	&& (interval->nextInstructions<0 || cpu->ins_completed<interval->nextInstructions))
+		return 0;
+
+	writeSample(cpu);
+	if(intervalCycles)
+		interval->nextCycle=cpu->clock+intervalCycles;
+	if(intervalInstructions)
+		interval->nextInstructions=cpu->ins_completed+intervalInstructions;
+	return 0;
+}
+
+/* Writes the last partial interval and closes the file */
+int intervalFinish(APEX_CPU* cpu)
+{
+	APEX_Interval* interval=&cpu->interval;
+
+	if(!interval->file)
+		return 0;
+
+	if(cpu->clock>interval->last[INTERVAL_CYCLE])
+		writeSample(cpu);
+	fclose(interval->file);
+	interval->file=NULL;
+	return 0;
+}
@@ -0,0 +1,76 @@
+#ifndef _APEX_INTERVAL_H_
+#define _APEX_INTERVAL_H_
+/**
+ *  interval.h
+ *  Contains the interval statistics streamed during a run
+ *
+ *  With --interval-file=path the cpu writes one sample every
+ *  --interval-cycles cycles or --interval-insts committed instructions,
+ *  whichever comes first, and one for the last partial interval. A sample
+ *  holds the counters of its interval and the occupancy of the IQ, LSQ,
+ *  ROB and free URF registers at its end. Samples are written as they are
+ *  taken, memory use does not grow with the run.
+ *
+ *  --interval-format=csv writes a header line and a row per sample. bin
+ *  writes the 8 bytes "APEXIVL1", an int32 field count, then per sample
+ *  that many int64 fields in host byte order, in the order below (no ipc).
+ */
+
+#include <stdio.h>
+
+struct APEX_CPU;
+
+/* Fields of a sample, in file order */
+enum
+{
+	INTERVAL_CYCLE,				// cycles elapsed at the end of the interval
+	INTERVAL_INSTRUCTIONS,		// instructions committed by then
+	INTERVAL_CYCLES,			// length of the interval
+	INTERVAL_COMMITTED,			// instructions committed in the interval
+	INTERVAL_IQ,				// allocated IQ entries
+	INTERVAL_LSQ,				// allocated LSQ entries
+	INTERVAL_ROB,				// ROB entries of all threads
+	INTERVAL_FREE_URF,			// free URF registers
+	INTERVAL_FLUSHES,			// branch flushes in the interval
+	INTERVAL_MEM_OPS,			// LOADs and STOREs sent to memory in the interval
+	INTERVAL_DISPATCH_STALLS,	// dispatch stall cycles in the interval
+	INTERVAL_FIELDS
+};
+
+enum
+{
+	INTERVAL_CSV,
+	INTERVAL_BINARY
+};
+
+typedef struct APEX_Interval
+{
+	FILE* file;
+	long long nextCycle;		// sample when the clock gets here
+	long long nextInstructions;	// or when this many have committed
+	long long last[INTERVAL_FIELDS];	// the previous sample
+	long long samples;
+}APEX_Interval;
+
+/* Interval configuration, set from command line options */
+extern const char* intervalFile;
+extern long long intervalCycles;
+extern long long intervalInstructions;
+extern int intervalFormat;
+
+/* One test per cycle, and nothing more when no file is written */
+#define INTERVAL_TICK(cpu) \
+	do { \
+		if((cpu)->interval.file) \
+			intervalTick(cpu); \
+	} while(0)
+
+int intervalParseOption(const char* arg);
+
+int intervalInit(struct APEX_CPU* cpu);
+
+int intervalTick(struct APEX_CPU* cpu);
+
+int intervalFinish(struct APEX_CPU* cpu);
+
+#endif
@@ -0,0 +1,161 @@
+/*
+ *  libapex.c
+ *  Contains the embeddable simulator API, see apex.h
+ *
+ *  Every simulation prints to its own stream, which hands what is written
+ *  to the output callback of the simulation. The cpu gets it as both its
+ *  output and its error stream, stdout and stderr are never touched.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "apex.h"
+#include "cpu.h"
+
+/* Name of a program parsed from memory, other hardware threads copy its code */
+#define APEX_MEMORY_PROGRAM "<memory>"
+
+struct APEX_Sim
+{
+	APEX_CPU* cpu;
+	APEX_Output_Fn output;
+	void* ctx;
+	FILE* out;		// writes to output
+};
+
+static ssize_t writeOutput(void* cookie,const char* buf,size_t size)
+{
+	APEX_Sim* sim=cookie;
+
+	if(sim->output)
+		sim->output(sim->ctx,buf,size);
+	return size;
+}
+
+int apexSetOption(const char* option)
+{
+	// options may keep pointers into their value
+	char* copy=strdup(option);
+
+	if(!copy || APEX_parse_option(copy)<0)
+	{
+		free(copy);
+		return -1;
+	}
+	return 0;
+}
+
+APEX_Sim* apexCreate(const char* program,int len,APEX_Output_Fn output,void* ctx)
+{
+	cookie_io_functions_t io={NULL,writeOutput,NULL,NULL};
+	APEX_Instruction* code_memory;
+	int size;
+	APEX_Sim* sim=calloc(1,sizeof(*sim));
+
+	if(!sim)
+		return NULL;
+	sim->output=output;
+	sim->ctx=ctx;
+	sim->out=fopencookie(sim,"w",io);
+	if(!sim->out)
+	{
+		free(sim);
+		return NULL;
+	}
+
+	code_memory=create_code_memory_from_buffer(program,len,&size);
+	if(!code_memory)
+		fprintf(sim->out,"APEX_Error : Unable to parse the program\n");
+	else
+		sim->cpu=APEX_cpu_init_code(code_memory,size,APEX_MEMORY_PROGRAM,sim->out,sim->out);
+	fflush(sim->out);
+
+	if(!sim->cpu)
+	{
+		fclose(sim->out);
+		free(sim);
+		return NULL;
+	}
+	return sim;
+}
+
+long long apexStep(APEX_Sim* sim,long long cycles)
+{
+	long long stepped=0;
+
+	while(stepped<cycles && !APEX_cpu_halted(sim->cpu))
+	{
+		APEX_cpu_step(sim->cpu);
+		stepped++;
+	}
+	fflush(sim->out);
+	return stepped;
+}
+
+int apexRun(APEX_Sim* sim,long long maxCycles)
+{
+	apexStep(sim,maxCycles);
+	return apexHalted(sim);
+}
+
+int apexHalted(APEX_Sim* sim)
+{
+	return APEX_cpu_halted(sim->cpu);
+}
+
+int apexReadReg(APEX_Sim* sim,int thread,int reg,int* value)
+{
+	APEX_CPU* cpu=sim->cpu;
+	CPU_Thread* current=cpu->thread;
+
+	if(thread<0 || thread>=cpu->threadCount || reg<0 || reg>APEX_REGS)
+		return -1;
+
+	cpu->thread=&cpu->threads[thread];
+	readArchState(cpu);
+	*value=reg==APEX_REGS ? cpu->thread->zeroFlag : cpu->thread->regs[reg];
+	cpu->thread=current;
+	return 0;
+}
+
+int apexReadMemory(APEX_Sim* sim,int address,int* value)
+{
+	if(address<0 || address>=DATA_MEMORY_SIZE)
+		return -1;
+
+	*value=sim->cpu->data_memory[address];
+	return 0;
+}
+
+int apexReadCounters(APEX_Sim* sim,APEX_Counters* counters)
+{
+	APEX_CPU* cpu=sim->cpu;
+
+	counters->cycles=cpu->clock;
+	counters->instructions=cpu->ins_completed;
+	counters->dispatchStalls=cpu->dispatchStalls;
+	counters->flushes=cpu->flushes;
+	return 0;
+}
+
+int apexReport(APEX_Sim* sim)
+{
+	CPU_Thread* current=sim->cpu->thread;
+
+	printRunResults(sim->cpu);
+	fflush(sim->out);
+	sim->cpu->thread=current;
+	return 0;
+}
+
+void apexDestroy(APEX_Sim* sim)
+{
+	if(!sim)
+		return;
+
+	APEX_cpu_stop(sim->cpu);
+	fclose(sim->out);
+	free(sim);
+}
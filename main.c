@@ -1,24 +1,34 @@
-/*
- *  main.c
- *
- *  Author :
- *  Gaurav Kothari (gkothar1@binghamton.edu)
- *  State University of New York, Binghamton
- */
-#include <stdio.h>
-#include <stdlib.h>
-
-#include "cpu.h"
-
-int
-main(int argc, char const* argv[])
-{
-  if (argc <3) {
-    fprintf(stderr, "APEX_Help : Usage %s <input_file>\n", argv[0]);
-    exit(1);
-  }
-
-  APEX_cpu_start(argv[1],argv[2],argv[3]);
-  
-  return 0;
+/*
+ *  main.c
+ *
+ *  Author :
+ *  Gaurav Kothari (gkothar1@binghamton.edu)
+ *  State University of New York, Binghamton
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cpu.h"
+
+int
+main(int argc, char const* argv[])
+{
+  if (argc <3) {
+    fprintf(stderr, "APEX_Help : Usage %s <input_file> <operation> <cycles> [options]\n", argv[0]);
+    fprintf(stderr, "APEX_Help : Usage %s <input_file> serve <socket> [options]\n", argv[0]);
+    fprintf(stderr, "APEX_Help : --fetch-width=N sets the instructions per I-cache fetch block,\n");
+    fprintf(stderr, "APEX_Help :   fetch still delivers one instruction a cycle\n");
+    exit(1);
+  }
+
+  for (int i = 4; i < argc; i++) {
+    if (APEX_parse_option(argv[i]) < 0) {
+      fprintf(stderr, "APEX_Error : Unknown option %s\n", argv[i]);
+      exit(1);
+    }
+  }
+
+  APEX_cpu_start(argv[1],argv[2],argv[3]);
+  
+  return 0;
 }
\ No newline at end of file
@@ -0,0 +1,261 @@
+/*
+ *  multicore.c
+ *  Contains the multi-core simulation on host threads
+ *
+ *  Every core is a full APEX_CPU stepped by its own thread. The threads
+ *  meet at a barrier every --quantum cycles; the last one there merges
+ *  the data memory, so between barriers a core reads and writes only its
+ *  own memory and the threads share nothing. Stores of a quantum become
+ *  visible to the other cores at the next barrier; when two cores store
+ *  the same word in one quantum the higher numbered core wins.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "cpu.h"
+
+extern long long inputClockCycles;
+extern int benchOutput;
+
+int multicoreCores=1;
+int multicoreQuantum=1000;
+const char* multicoreFiles=NULL;
+
+/* One simulated core and the thread that steps it */
+typedef struct Multicore_Core
+{
+	APEX_CPU* cpu;
+	const char* filename;
+	pthread_t thread;
+	int finished;
+	long long wordsPublished;	// words merged into the shared memory
+}Multicore_Core;
+
+static Multicore_Core cores[MULTICORE_MAX_CORES];
+static int coreCount;
+static pthread_barrier_t quantumBarrier;
+static int sharedMemory[DATA_MEMORY_SIZE];
+static int mergedMemory[DATA_MEMORY_SIZE];
+static int allFinished;
+static long long quanta;
+static long long conflictingWords;	// words stored by more than one core in a quantum
+
+int multicoreParseOption(const char* arg)
+{
+	const char* value;
+
+	if(matchOption(arg,"--cores",&value))
+		multicoreCores=atoi(value);
+	else if(matchOption(arg,"--quantum",&value))
+		multicoreQuantum=atoi(value);
+	else if(matchOption(arg,"--core-files",&value))
+		multicoreFiles=value;
+	else
+		return 0;
+
+	return 1;
+}
+
+/*
+ * Publishes the stores of the quantum, called by one thread while the
+ * others wait at the barrier
+ */
+static int mergeMemory()
+{
+	memcpy(mergedMemory,sharedMemory,sizeof(mergedMemory));
+	allFinished=1;
+
+	for(int c=0;c<coreCount;c++)
+	{
+		Multicore_Core* core=&cores[c];
+		int* memory=core->cpu->data_memory;
+
+		for(int i=0;i<DATA_MEMORY_SIZE;i++)
+		{
+			if(memory[i]==sharedMemory[i])
+				continue;
+			if(mergedMemory[i]!=sharedMemory[i])
+				conflictingWords++;
+			mergedMemory[i]=memory[i];
+			core->wordsPublished++;
+		}
+		if(!core->finished)
+			allFinished=0;
+	}
+
+	memcpy(sharedMemory,mergedMemory,sizeof(sharedMemory));
+	quanta++;
+	return 0;
+}
+
+/*
+ * Steps one core a quantum at a time. A finished core keeps joining the
+ * barriers, its memory no longer changes, until all cores are done.
+ */
+static void* coreThread(void* arg)
+{
+	Multicore_Core* core=arg;
+	APEX_CPU* cpu=core->cpu;
+
+	while(1)
+	{
+		long long quantumEnd=cpu->clock+multicoreQuantum;
+
+		while(!APEX_cpu_finished(cpu) && cpu->clock<quantumEnd)
+			APEX_cpu_step(cpu);
+		core->finished=APEX_cpu_finished(cpu);
+
+		if(pthread_barrier_wait(&quantumBarrier)==PTHREAD_BARRIER_SERIAL_THREAD)
+			mergeMemory();
+		pthread_barrier_wait(&quantumBarrier);
+
+		// nothing writes the shared memory until the next barrier
+		memcpy(cpu->data_memory,sharedMemory,sizeof(sharedMemory));
+		if(allFinished)
+			break;
+	}
+	return NULL;
+}
+
+/*
+ * Core i runs the i-th --core-files program, cores past the list run filename
+ */
+static int assignPrograms(const char* filename)
+{
+	static char files[4096];
+	char* save;
+	int c=0;
+
+	for(int i=0;i<coreCount;i++)
+		cores[i].filename=filename;
+	if(!multicoreFiles)
+		return 0;
+
+	if(strlen(multicoreFiles)>=sizeof(files))
+	{
+		fprintf(stderr,"APEX_Error : --core-files list is too long\n");
+		return -1;
+	}
+	strcpy(files,multicoreFiles);
+	for(char* file=strtok_r(files,",",&save);file;file=strtok_r(NULL,",",&save))
+	{
+		if(c==coreCount)
+		{
+			fprintf(stderr,"APEX_Error : --core-files names more programs than %d cores\n",coreCount);
+			return -1;
+		}
+		cores[c++].filename=file;
+	}
+	return 0;
+}
+
+static int printMulticoreResults(double hostSeconds)
+{
+	long long maxClock=0;
+	long long instructions=0;
+
+	for(int c=0;c<coreCount;c++)
+	{
+		if(cores[c].cpu->clock>maxClock)
+			maxClock=cores[c].cpu->clock;
+		instructions+=cores[c].cpu->ins_completed;
+	}
+
+	double ipc=maxClock ? (double)instructions/maxClock : 0.0;
+	double kips=hostSeconds>0 ? instructions/hostSeconds/1000.0 : 0.0;
+
+	if(benchOutput)
+	{
+		printf("%lld,%lld,%.4f,%.6f,%.1f\n",maxClock,instructions,ipc,hostSeconds,kips);
+		return 0;
+	}
+
+	for(int c=0;c<coreCount;c++)
+	{
+		APEX_CPU* cpu=cores[c].cpu;
+
+		printf("\n========== CORE %d (%s) ==========\n",c,cores[c].filename);
+		readArchState(cpu);
+		printArchRegs(cpu);
+		printf("|    Cycles\t\t|\t%lld\t|\n",cpu->clock);
+		printf("|    Instructions\t|\t%lld\t|\n",cpu->ins_completed);
+		printf("|    IPC\t\t|\t%.4f\t|\n",cpu->clock ? (double)cpu->ins_completed/cpu->clock : 0.0);
+		printf("|    Dispatch Stalls\t|\t%lld\t|\n",cpu->dispatchStalls);
+		printf("|    Branch Flushes\t|\t%lld\t|\n",cpu->flushes);
+		printf("|    Words Published\t|\t%lld\t|\n",cores[c].wordsPublished);
+	}
+
+	// every core ends with a copy of the shared memory
+	printMemData(cores[0].cpu);
+
+	printf("\n========== MULTI-CORE STATISTICS ==========\n");
+	printf("|    Cores\t\t|\t%d\t|\n",coreCount);
+	printf("|    Quantum\t\t|\t%d\t|\n",multicoreQuantum);
+	printf("|    Quanta\t\t|\t%lld\t|\n",quanta);
+	printf("|    Conflicting Words\t|\t%lld\t|\n",conflictingWords);
+	printf("|    Cycles\t\t|\t%lld\t|\n",maxClock);
+	printf("|    Instructions\t|\t%lld\t|\n",instructions);
+	printf("|    System IPC\t\t|\t%.4f\t|\n",ipc);
+	printf("|    Host Seconds\t|\t%.6f\t|\n",hostSeconds);
+	printf("|    Simulated KIPS\t|\t%.1f\t|\n",kips);
+
+	return 0;
+}
+
+/*
+ * Runs the simulate operation on --cores cores, the shared memory starts
+ * as core 0's initial data memory
+ */
+int multicoreRun(const char* filename,long long cycles)
+{
+	struct timespec start,end;
+
+	coreCount=multicoreCores;
+	if(coreCount<1 || coreCount>MULTICORE_MAX_CORES || multicoreQuantum<1)
+	{
+		fprintf(stderr,"APEX_Error : Invalid multi-core setup cores=%d quantum=%d\n",coreCount,multicoreQuantum);
+		return -1;
+	}
+	if(assignPrograms(filename)<0)
+		return -1;
+
+	inputClockCycles=cycles;
+	for(int c=0;c<coreCount;c++)
+	{
+		cores[c].cpu=APEX_cpu_init(cores[c].filename);
+		if(!cores[c].cpu)
+		{
+			fprintf(stderr,"APEX_Error : Unable to initialize core %d with %s\n",c,cores[c].filename);
+			return -1;
+		}
+		cores[c].finished=0;
+		cores[c].wordsPublished=0;
+	}
+	memcpy(sharedMemory,cores[0].cpu->data_memory,sizeof(sharedMemory));
+	for(int c=1;c<coreCount;c++)
+		memcpy(cores[c].cpu->data_memory,sharedMemory,sizeof(sharedMemory));
+
+	pthread_barrier_init(&quantumBarrier,NULL,coreCount);
+	clock_gettime(CLOCK_MONOTONIC,&start);
+	for(int c=0;c<coreCount;c++)
+	{
+		if(pthread_create(&cores[c].thread,NULL,coreThread,&cores[c])!=0)
+		{
+			fprintf(stderr,"APEX_Error : Cannot start the thread of core %d\n",c);
+			exit(1);
+		}
+	}
+	for(int c=0;c<coreCount;c++)
+		pthread_join(cores[c].thread,NULL);
+	clock_gettime(CLOCK_MONOTONIC,&end);
+	pthread_barrier_destroy(&quantumBarrier);
+
+	printMulticoreResults((end.tv_sec-start.tv_sec)+(end.tv_nsec-start.tv_nsec)/1e9);
+
+	for(int c=0;c<coreCount;c++)
+		APEX_cpu_stop(cores[c].cpu);
+	return 0;
+}
@@ -0,0 +1,26 @@
+#ifndef _APEX_MULTICORE_H_
+#define _APEX_MULTICORE_H_
+/**
+ *  multicore.h
+ *  Contains the multi-core simulation of the simulate operation
+ *
+ *  With --cores=N the simulate operation runs N cores, each on its own
+ *  host thread, against one shared data memory. A core works on a private
+ *  copy of the memory for a quantum of cycles; at the barrier that ends
+ *  the quantum the words each core stored are merged into the shared
+ *  memory in core order, and every core starts the next quantum from it.
+ */
+
+/* Upper bound on --cores */
+#define MULTICORE_MAX_CORES 64
+
+/* Multi-core configuration, set from command line options */
+extern int multicoreCores;
+extern int multicoreQuantum;
+extern const char* multicoreFiles;
+
+int multicoreParseOption(const char* arg);
+
+int multicoreRun(const char* filename,long long cycles);
+
+#endif
@@ -0,0 +1,227 @@
+/*
+ *  prefetch.c
+ *  Contains the next-line, PC-indexed stride and stream data prefetchers
+ *
+ *  The stride prefetcher trains on LOAD addresses as intFuncUnit computes
+ *  them, next-line and stream train on the D-cache accesses made by
+ *  memFuncUnit. Prefetched lines go straight into the D-cache presence
+ *  table and become usable once the miss latency has elapsed.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+int prefetcherType=PREFETCH_NONE;
+int prefetchDegree=1;		// lines per trigger
+int prefetchDistance=4;		// lines a stream, or strides a stride entry, runs ahead
+
+int prefetchParseOption(const char* arg)
+{
+	const char* value;
+
+	if(matchOption(arg,"--prefetcher",&value))
+	{
+		if(strcmp(value,"none")==0)
+			prefetcherType=PREFETCH_NONE;
+		else if(strcmp(value,"nextline")==0)
+			prefetcherType=PREFETCH_NEXTLINE;
+		else if(strcmp(value,"stride")==0)
+			prefetcherType=PREFETCH_STRIDE;
+		else if(strcmp(value,"stream")==0)
+			prefetcherType=PREFETCH_STREAM;
+		else
+			return 0;
+	}
+	else if(matchOption(arg,"--prefetch-degree",&value))
+		prefetchDegree=atoi(value);
+	else if(matchOption(arg,"--prefetch-distance",&value))
+		prefetchDistance=atoi(value);
+	else
+		return 0;
+
+	return 1;
+}
+
+int prefetchInit(APEX_CPU* cpu)
+{
+	if(prefetcherType==PREFETCH_NONE)
+		return 0;
+
+	if(!dcacheEnabled)
+	{
+		fprintf(cpu->err,"APEX_Error : --prefetcher needs the D-cache, add --dcache=1\n");
+		return -1;
+	}
+	if(prefetchDegree<1)
+		prefetchDegree=1;
+	if(prefetchDistance<prefetchDegree)
+		prefetchDistance=prefetchDegree;
+
+	memset(&cpu->prefetcher,0,sizeof(cpu->prefetcher));
+	return 0;
+}
+
+static void prefetchLine(APEX_CPU* cpu,int lineAddr)
+{
+	if(lineAddr<0 || lineAddr>dcacheLineAddr(DATA_MEMORY_SIZE-1))
+		return;
+
+	if(dcachePrefetch(cpu,lineAddr))
+		cpu->prefetcher.issued++;
+	else
+		cpu->prefetcher.redundant++;
+}
+
+/*
+ * Trains the stride table on a LOAD address, called from intFuncUnit
+ */
+int prefetchObserveLoad(APEX_CPU* cpu,int pc,int address)
+{
+	if(prefetcherType!=PREFETCH_STRIDE)
+		return 0;
+
+	Prefetch_Stride_Entry* entry=&cpu->prefetcher.stride[((pc-4000)/4)%PREFETCH_STRIDE_ENTRIES];
+
+	if(!entry->valid || entry->pc!=pc)
+	{
+		entry->valid=1;
+		entry->pc=pc;
+		entry->lastAddress=address;
+		entry->stride=0;
+		entry->confidence=0;
+		return 0;
+	}
+
+	int stride=address-entry->lastAddress;
+	if(stride!=0 && stride==entry->stride)
+	{
+		if(entry->confidence<3)
+			entry->confidence++;
+	}
+	else
+	{
+		if(entry->confidence>0)
+			entry->confidence--;
+		else
+			entry->stride=stride;
+	}
+	entry->lastAddress=address;
+
+	if(entry->confidence>=2)
+	{
+		// run prefetchDistance strides ahead of the load stream
+		int lastLine=dcacheLineAddr(address);
+		for(int i=prefetchDistance;i<prefetchDistance+prefetchDegree;i++)
+		{
+			int lineAddr=dcacheLineAddr(address+i*entry->stride);
+			if(lineAddr!=lastLine)
+				prefetchLine(cpu,lineAddr);
+			lastLine=lineAddr;
+		}
+	}
+	return 0;
+}
+
+static void streamObserve(APEX_CPU* cpu,int lineAddr)
+{
+	Prefetch_Stream_Entry* streams=cpu->prefetcher.stream;
+	Prefetch_Stream_Entry* entry=NULL;
+	Prefetch_Stream_Entry* victim=&streams[0];
+
+	for(int i=0;i<PREFETCH_STREAM_ENTRIES;i++)
+	{
+		if(streams[i].valid && abs(lineAddr-streams[i].lastLine)<=2)
+		{
+			entry=&streams[i];
+			break;
+		}
+		if(!streams[i].valid)
+			victim=&streams[i];
+		else if(victim->valid && streams[i].lastUse<victim->lastUse)
+			victim=&streams[i];
+	}
+
+	if(!entry)
+	{
+		victim->valid=1;
+		victim->lastLine=lineAddr;
+		victim->direction=0;
+		victim->confidence=0;
+		victim->lastUse=cpu->clock;
+		return;
+	}
+
+	int direction=lineAddr>entry->lastLine ? 1 : (lineAddr<entry->lastLine ? -1 : 0);
+	if(direction==0)
+		return;
+
+	if(direction==entry->direction)
+	{
+		if(entry->confidence<3)
+			entry->confidence++;
+	}
+	else
+	{
+		entry->direction=direction;
+		entry->confidence=0;
+	}
+	entry->lastLine=lineAddr;
+	entry->lastUse=cpu->clock;
+
+	// run prefetchDistance lines ahead of the misses
+	if(entry->confidence>=1)
+	{
+		for(int i=prefetchDistance;i<prefetchDistance+prefetchDegree;i++)
+			prefetchLine(cpu,lineAddr+i*direction);
+	}
+}
+
+/*
+ * Trains next-line and stream prefetchers on a D-cache demand access.
+ * miss is set for misses and for the first use of a prefetched line.
+ */
+int prefetchObserveAccess(APEX_CPU* cpu,int lineAddr,int miss)
+{
+	if(!miss)
+		return 0;
+
+	if(prefetcherType==PREFETCH_NEXTLINE)
+	{
+		for(int i=1;i<=prefetchDegree;i++)
+			prefetchLine(cpu,lineAddr+i);
+	}
+	else if(prefetcherType==PREFETCH_STREAM)
+		streamObserve(cpu,lineAddr);
+
+	return 0;
+}
+
+int printPrefetchStats(APEX_CPU* cpu)
+{
+	APEX_Prefetcher* pf=&cpu->prefetcher;
+	const char* names[]={"none","nextline","stride","stream"};
+
+	if(prefetcherType==PREFETCH_NONE)
+		return 0;
+
+	long long demandMisses=cpu->dcache.misses+cpu->dcache.mergedMisses;
+
+	fprintf(cpu->out,"\n========== PREFETCHER STATISTICS ==========\n");
+	fprintf(cpu->out,"|    Prefetcher\t\t|\t%s, degree %d, distance %d\t|\n",
+			names[prefetcherType],prefetchDegree,prefetchDistance);
+	fprintf(cpu->out,"|    Issued\t\t|\t%lld\t|\n",pf->issued);
+	fprintf(cpu->out,"|    Redundant\t\t|\t%lld\t|\n",pf->redundant);
+	fprintf(cpu->out,"|    Useful\t\t|\t%lld\t|\n",pf->useful);
+	fprintf(cpu->out,"|    Late\t\t|\t%lld\t|\n",pf->late);
+	fprintf(cpu->out,"|    Useless\t\t|\t%lld\t|\n",pf->useless);
+	fprintf(cpu->out,"|    Accuracy\t\t|\t%.2f%%\t|\n",
+			pf->issued ? 100.0*pf->useful/pf->issued : 0.0);
+	fprintf(cpu->out,"|    Coverage\t\t|\t%.2f%%\t|\n",
+			(pf->useful+demandMisses) ? 100.0*pf->useful/(pf->useful+demandMisses) : 0.0);
+	fprintf(cpu->out,"|    Timeliness\t\t|\t%.2f%%\t|\n",
+			pf->useful ? 100.0*(pf->useful-pf->late)/pf->useful : 0.0);
+
+	return 0;
+}
@@ -0,0 +1,70 @@
+#ifndef _APEX_PREFETCH_H_
+#define _APEX_PREFETCH_H_
+/**
+ *  prefetch.h
+ *  Contains the hardware data prefetcher data structures
+ */
+
+#define PREFETCH_STRIDE_ENTRIES 16
+#define PREFETCH_STREAM_ENTRIES 8
+
+struct APEX_CPU;
+
+enum
+{
+	PREFETCH_NONE,
+	PREFETCH_NEXTLINE,
+	PREFETCH_STRIDE,
+	PREFETCH_STREAM
+};
+
+/* PC-indexed stride table entry */
+typedef struct Prefetch_Stride_Entry
+{
+	int valid;
+	int pc;
+	int lastAddress;
+	int stride;
+	int confidence;
+}Prefetch_Stride_Entry;
+
+/* Stream table entry, follows misses to consecutive lines */
+typedef struct Prefetch_Stream_Entry
+{
+	int valid;
+	int lastLine;
+	int direction;
+	int confidence;
+	long long lastUse;
+}Prefetch_Stream_Entry;
+
+/* Model of the data prefetcher */
+typedef struct APEX_Prefetcher
+{
+	Prefetch_Stride_Entry stride[PREFETCH_STRIDE_ENTRIES];
+	Prefetch_Stream_Entry stream[PREFETCH_STREAM_ENTRIES];
+
+	/* Some stats */
+	long long issued;		// prefetches that brought a line in
+	long long redundant;	// prefetches dropped, line present or already in flight
+	long long useful;		// prefetched lines hit by a demand access
+	long long late;			// useful prefetches whose line was still in flight
+	long long useless;		// prefetched lines evicted before any demand access
+}APEX_Prefetcher;
+
+/* Prefetcher configuration, set from command line options */
+extern int prefetcherType;
+extern int prefetchDegree;
+extern int prefetchDistance;
+
+int prefetchParseOption(const char* arg);
+
+int prefetchInit(struct APEX_CPU* cpu);
+
+int prefetchObserveLoad(struct APEX_CPU* cpu,int pc,int address);
+
+int prefetchObserveAccess(struct APEX_CPU* cpu,int lineAddr,int miss);
+
+int printPrefetchStats(struct APEX_CPU* cpu);
+
+#endif
@@ -0,0 +1,161 @@
+/*
+ *  probe.c
+ *  Contains the plugin loading and event delivery of the pipeline probes
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+
+#include "cpu.h"
+
+const char* probePlugins=NULL;
+
+int probeParseOption(const char* arg)
+{
+	const char* value;
+
+	if(matchOption(arg,"--probe-plugin",&value))
+		probePlugins=value;
+	else
+		return 0;
+
+	return 1;
+}
+
+#ifdef APEX_PROBES
+/* Loads one plugin and subscribes its apex_probe_subscriber */
+static int loadPlugin(APEX_CPU* cpu,const char* path)
+{
+	void* handle=dlopen(path,RTLD_NOW|RTLD_LOCAL);
+	if(!handle)
+	{
+		fprintf(cpu->err,"APEX_Error : Cannot load probe plugin %s : %s\n",path,dlerror());
+		return -1;
+	}
+
+	APEX_Probe_Subscriber* subscriber=dlsym(handle,"apex_probe_subscriber");
+	if(!subscriber)
+	{
+		fprintf(cpu->err,"APEX_Error : %s has no apex_probe_subscriber\n",path);
+		dlclose(handle);
+		return -1;
+	}
+	// the plugin stays loaded until exit, its finish runs at APEX_cpu_stop
+	return probeSubscribe(cpu,subscriber);
+}
+
+/* Loads every --probe-plugin */
+static int loadPlugins(APEX_CPU* cpu)
+{
+	static char paths[4096];
+	char* save;
+
+	if(strlen(probePlugins)>=sizeof(paths))
+	{
+		fprintf(cpu->err,"APEX_Error : --probe-plugin list is too long\n");
+		return -1;
+	}
+	strcpy(paths,probePlugins);
+	for(char* path=strtok_r(paths,",",&save);path;path=strtok_r(NULL,",",&save))
+	{
+		if(loadPlugin(cpu,path)<0)
+			return -1;
+	}
+	return 0;
+}
+#endif
+
+int probeInit(APEX_CPU* cpu)
+{
+	memset(&cpu->probe,0,sizeof(cpu->probe));
+	if(!probePlugins)
+		return 0;
+
+#ifndef APEX_PROBES
+	fprintf(cpu->err,"APEX_Error : --probe-plugin needs a simulator built with PROBES=1\n");
+	return -1;
+#else
+	return loadPlugins(cpu);
+#endif
+}
+
+int probeSubscribe(APEX_CPU* cpu,const APEX_Probe_Subscriber* subscriber)
+{
+	APEX_Probe* probe=&cpu->probe;
+
+	if(probe->subscriberCount==PROBE_MAX_SUBSCRIBERS)
+	{
+		fprintf(cpu->err,"APEX_Error : At most %d probe subscribers\n",PROBE_MAX_SUBSCRIBERS);
+		return -1;
+	}
+	probe->subscribers[probe->subscriberCount++]=*subscriber;
+	probe->mask|=subscriber->mask;
+	return 0;
+}
+
+int probeRecord(APEX_CPU* cpu,int type,int thread,int pc,int urfReg,int value)
+{
+	APEX_Probe* probe=&cpu->probe;
+
+	// a long flush can overflow the batch, hand over what is there first
+	if(probe->count==PROBE_BATCH_SIZE)
+		probeDeliver(cpu);
+
+	APEX_Probe_Event* event=&probe->events[probe->count++];
+	event->type=type;
+	event->cycle=cpu->clock;
+	event->thread=thread;
+	event->pc=pc;
+	event->urfReg=urfReg;
+	event->value=value;
+	return 0;
+}
+
+/*
+ * Hands the buffered events to every subscriber, each sees only the
+ * event types of its mask
+ */
+int probeDeliver(APEX_CPU* cpu)
+{
+	APEX_Probe* probe=&cpu->probe;
+	APEX_Probe_Event selected[PROBE_BATCH_SIZE];
+
+	for(int s=0;s<probe->subscriberCount;s++)
+	{
+		APEX_Probe_Subscriber* subscriber=&probe->subscribers[s];
+		const APEX_Probe_Event* events=probe->events;
+		int count=probe->count;
+
+		if(subscriber->mask!=probe->mask)
+		{
+			count=0;
+			for(int i=0;i<probe->count;i++)
+			{
+				if(subscriber->mask & (1<<probe->events[i].type))
+					selected[count++]=probe->events[i];
+			}
+			events=selected;
+		}
+		if(count)
+			subscriber->events(subscriber->ctx,events,count);
+	}
+	probe->count=0;
+	return 0;
+}
+
+int probeFinish(APEX_CPU* cpu)
+{
+	APEX_Probe* probe=&cpu->probe;
+
+	if(probe->count)
+		probeDeliver(cpu);
+	for(int s=0;s<probe->subscriberCount;s++)
+	{
+		if(probe->subscribers[s].finish)
+			probe->subscribers[s].finish(probe->subscribers[s].ctx);
+	}
+	probe->subscriberCount=0;
+	probe->mask=0;
+	return 0;
+}
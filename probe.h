@@ -0,0 +1,110 @@
+#ifndef _APEX_PROBE_H_
+#define _APEX_PROBE_H_
+/**
+ *  probe.h
+ *  Contains the event probes of the pipeline
+ *
+ *  Analysis plugins subscribe to pipeline events instead of adding printf
+ *  statistics to cpu.c. A plugin is a shared object exporting
+ *
+ *      APEX_Probe_Subscriber apex_probe_subscriber;
+ *
+ *  loaded with --probe-plugin=a.so,b.so. Events are collected in a
+ *  preallocated buffer and handed to the subscribers once per cycle.
+ *
+ *  Built in with PROBES=1 (-DAPEX_PROBES), otherwise the PROBE macros
+ *  compile to no code and the default build pays nothing for them. In a
+ *  PROBES=1 build every probe point costs one test of the event mask.
+ */
+
+struct APEX_CPU;
+
+/* Event types, a subscriber mask has bit (1<<type) set for each one it takes */
+enum
+{
+	PROBE_RENAME,		// regRename gave the instruction a URF register
+	PROBE_DISPATCH,		// iqStage put the instruction in the IQ and ROB
+	PROBE_ISSUE,		// a function unit started the instruction
+	PROBE_FWD_BUS,		// a result was written on the forward bus
+	PROBE_COMMIT,		// the instruction retired from the ROB head
+	PROBE_SQUASH,		// a branch flush removed the instruction from the ROB
+	PROBE_EVENTS
+};
+
+#define PROBE_ALL ((1<<PROBE_EVENTS)-1)
+
+/* Most subscribers, and events buffered before an early delivery */
+#define PROBE_MAX_SUBSCRIBERS 8
+#define PROBE_BATCH_SIZE 256
+
+typedef struct APEX_Probe_Event
+{
+	int type;
+	long long cycle;
+	int thread;
+	int pc;
+	int urfReg;			// destination or forward bus URF register, -1 for none
+	int value;			// forwarded or committed result
+}APEX_Probe_Event;
+
+/* Receives the events of one cycle in program order of the stages */
+typedef void (*APEX_Probe_Fn)(void* ctx,const APEX_Probe_Event* events,int count);
+
+typedef struct APEX_Probe_Subscriber
+{
+	int mask;
+	APEX_Probe_Fn events;
+	void (*finish)(void* ctx);		// end of run, may be NULL
+	void* ctx;
+}APEX_Probe_Subscriber;
+
+typedef struct APEX_Probe
+{
+	APEX_Probe_Subscriber subscribers[PROBE_MAX_SUBSCRIBERS];
+	int subscriberCount;
+	int mask;						// every event some subscriber takes
+	APEX_Probe_Event events[PROBE_BATCH_SIZE];
+	int count;
+}APEX_Probe;
+
+/* Plugins to load, set from the command line */
+extern const char* probePlugins;
+
+#ifdef APEX_PROBES
+
+#define PROBE_EVENT(cpu,type,thread,pc,urfReg,value) \
+	do { \
+		if((cpu)->probe.mask & (1<<(type))) \
+			probeRecord(cpu,type,thread,pc,urfReg,value); \
+	} while(0)
+#define PROBE_END_CYCLE(cpu) \
+	do { \
+		if((cpu)->probe.count) \
+			probeDeliver(cpu); \
+	} while(0)
+
+#else
+
+/* Never called, keeps the arguments type checked and used */
+#define PROBE_EVENT(cpu,type,thread,pc,urfReg,value) \
+	do { \
+		if(0) \
+			probeRecord(cpu,type,thread,pc,urfReg,value); \
+	} while(0)
+#define PROBE_END_CYCLE(cpu)
+
+#endif
+
+int probeParseOption(const char* arg);
+
+int probeInit(struct APEX_CPU* cpu);
+
+int probeSubscribe(struct APEX_CPU* cpu,const APEX_Probe_Subscriber* subscriber);
+
+int probeRecord(struct APEX_CPU* cpu,int type,int thread,int pc,int urfReg,int value);
+
+int probeDeliver(struct APEX_CPU* cpu);
+
+int probeFinish(struct APEX_CPU* cpu);
+
+#endif
@@ -0,0 +1,32 @@
+/*
+ *  probe_counts.c
+ *  Example probe plugin, counts the pipeline events of a run
+ *
+ *  make PROBES=1 apex_sim probe_counts.so
+ *  ./apex_sim prog.asm simulate 100000 --probe-plugin=./probe_counts.so
+ */
+#include <stdio.h>
+
+#include "probe.h"
+
+static long long counts[PROBE_EVENTS];
+static long long batches;
+
+static void countEvents(void* ctx,const APEX_Probe_Event* events,int count)
+{
+	for(int i=0;i<count;i++)
+		counts[events[i].type]++;
+	batches++;
+}
+
+static void printCounts(void* ctx)
+{
+	const char* names[PROBE_EVENTS]={"Renames","Dispatches","Issues","Bus Writes","Commits","Squashes"};
+
+	printf("\n========== PROBE EVENT COUNTS ==========\n");
+	for(int i=0;i<PROBE_EVENTS;i++)
+		printf("|    %-16s\t|\t%lld\t|\n",names[i],counts[i]);
+	printf("|    %-16s\t|\t%lld\t|\n","Batches",batches);
+}
+
+APEX_Probe_Subscriber apex_probe_subscriber={PROBE_ALL,countEvents,printCounts,NULL};
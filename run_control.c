@@ -0,0 +1,139 @@
+/*
+ *  run_control.c
+ *  Contains the run limits and the progress heartbeat
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+extern long long inputClockCycles;
+
+long long maxInstructions=LLONG_MAX;
+double maxSeconds=0;
+double heartbeatSeconds=0;
+
+int runControlParseOption(const char* arg)
+{
+	const char* value;
+
+	if(matchOption(arg,"--max-insts",&value))
+		maxInstructions=atoll(value)>0 ? atoll(value) : LLONG_MAX;
+	else if(matchOption(arg,"--max-seconds",&value))
+		maxSeconds=atof(value);
+	else if(matchOption(arg,"--heartbeat",&value))
+		heartbeatSeconds=atof(value);
+	else
+		return 0;
+
+	return 1;
+}
+
+/*
+ * Cycle limit of the cycles argument, "halt" runs until HALT or a limit
+ */
+long long runControlCycles(const char* cycles)
+{
+	if(strcmp(cycles,"halt")==0)
+		return APEX_RUN_TO_HALT;
+	return atoll(cycles);
+}
+
+static double elapsedSeconds(APEX_Run_Control* run)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	return (now.tv_sec-run->start.tv_sec)+(now.tv_nsec-run->start.tv_nsec)/1e9;
+}
+
+int runControlBegin(APEX_CPU* cpu)
+{
+	APEX_Run_Control* run=&cpu->run;
+
+	memset(run,0,sizeof(*run));
+	clock_gettime(CLOCK_MONOTONIC,&run->start);
+	run->lastBeatInstructions=cpu->ins_completed;
+	return 0;
+}
+
+/* Seconds to the nearest limit at the average rate so far, -1 when unbounded */
+static double secondsLeft(APEX_CPU* cpu,double elapsed)
+{
+	double left=-1;
+
+	if(elapsed<=0)
+		return -1;
+	if(inputClockCycles!=APEX_RUN_TO_HALT && cpu->clock>0)
+		left=(inputClockCycles-cpu->clock)*elapsed/cpu->clock;
+	if(maxInstructions!=LLONG_MAX && cpu->ins_completed>0)
+	{
+		double insLeft=(maxInstructions-cpu->ins_completed)*elapsed/cpu->ins_completed;
+		if(left<0 || insLeft<left)
+			left=insLeft;
+	}
+	if(maxSeconds>0 && (left<0 || maxSeconds-elapsed<left))
+		left=maxSeconds-elapsed;
+	return left;
+}
+
+static int heartbeat(APEX_CPU* cpu,double elapsed)
+{
+	APEX_Run_Control* run=&cpu->run;
+	double span=elapsed-run->lastBeat;
+	double kips=span>0 ? (cpu->ins_completed-run->lastBeatInstructions)/span/1000.0 : 0.0;
+	double left=secondsLeft(cpu,elapsed);
+
+	if(left<0)
+		fprintf(cpu->err,"APEX_Heartbeat : %.1fs cycle %lld, %lld instructions, %.1f KIPS, ETA unbounded\n",
+				elapsed,cpu->clock,cpu->ins_completed,kips);
+	else
+		fprintf(cpu->err,"APEX_Heartbeat : %.1fs cycle %lld, %lld instructions, %.1f KIPS, ETA %.0fs\n",
+				elapsed,cpu->clock,cpu->ins_completed,kips,left);
+
+	run->lastBeat=elapsed;
+	run->lastBeatInstructions=cpu->ins_completed;
+	return 0;
+}
+
+/*
+ * Called every RUN_CONTROL_PERIOD cycles, prints the heartbeat when due.
+ * Returns 1 when the time limit stops the run.
+ */
+int runControlCheck(APEX_CPU* cpu)
+{
+	double elapsed;
+
+	if(maxSeconds<=0 && heartbeatSeconds<=0)
+		return 0;
+
+	elapsed=elapsedSeconds(&cpu->run);
+	if(heartbeatSeconds>0 && elapsed-cpu->run.lastBeat>=heartbeatSeconds)
+		heartbeat(cpu,elapsed);
+	if(maxSeconds>0 && elapsed>=maxSeconds)
+	{
+		cpu->run.stopReason=RUN_TIME_LIMIT;
+		return 1;
+	}
+	return 0;
+}
+
+/* Records why the run ended, a limit other than the cycles is reported */
+int runControlEnd(APEX_CPU* cpu)
+{
+	APEX_Run_Control* run=&cpu->run;
+
+	if(run->stopReason==RUN_TIME_LIMIT)
+		fprintf(cpu->err,"APEX_Limit : --max-seconds stopped the run at cycle %lld\n",cpu->clock);
+	else if(APEX_cpu_halted(cpu))
+		run->stopReason=RUN_HALT;
+	else if(cpu->ins_completed>=maxInstructions)
+	{
+		run->stopReason=RUN_INSTRUCTION_LIMIT;
+		fprintf(cpu->err,"APEX_Limit : --max-insts stopped the run at cycle %lld\n",cpu->clock);
+	}
+	else
+		run->stopReason=RUN_CYCLE_LIMIT;
+	return 0;
+}
@@ -0,0 +1,61 @@
+#ifndef _APEX_RUN_CONTROL_H_
+#define _APEX_RUN_CONTROL_H_
+/**
+ *  run_control.h
+ *  Contains the limits and the progress heartbeat of a run
+ *
+ *  The cycles argument of simulate and display may be "halt", the run then
+ *  ends only at HALT or at a limit. --max-insts=N stops it once N
+ *  instructions committed, --max-seconds=S after S seconds of host time.
+ *  --heartbeat=S prints the progress, simulated KIPS and the time left to
+ *  the nearest limit on stderr every S seconds.
+ */
+
+#include <limits.h>
+#include <time.h>
+
+struct APEX_CPU;
+
+/* Cycle limit of a run to HALT */
+#define APEX_RUN_TO_HALT LLONG_MAX
+
+/* Cycles between two reads of the host clock, a power of two */
+#define RUN_CONTROL_PERIOD 65536
+
+/* Why APEX_cpu_run returned */
+enum
+{
+	RUN_HALT,
+	RUN_CYCLE_LIMIT,
+	RUN_INSTRUCTION_LIMIT,
+	RUN_TIME_LIMIT
+};
+
+typedef struct APEX_Run_Control
+{
+	struct timespec start;
+	double lastBeat;				// host seconds at the last heartbeat
+	long long lastBeatInstructions;
+	int stopReason;
+}APEX_Run_Control;
+
+/* Limits, set from command line options */
+extern long long maxInstructions;
+extern double maxSeconds;
+extern double heartbeatSeconds;
+
+/* The host clock is read only every RUN_CONTROL_PERIOD cycles */
+#define RUN_CONTROL_CHECK(cpu) \
+	(!((cpu)->clock & (RUN_CONTROL_PERIOD-1)) && runControlCheck(cpu))
+
+int runControlParseOption(const char* arg);
+
+long long runControlCycles(const char* cycles);
+
+int runControlBegin(struct APEX_CPU* cpu);
+
+int runControlCheck(struct APEX_CPU* cpu);
+
+int runControlEnd(struct APEX_CPU* cpu);
+
+#endif
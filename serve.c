@@ -0,0 +1,231 @@
+/*
+ *  serve.c
+ *  Contains the fork-server operation
+ *
+ *  The server never runs a cpu itself. Its warm cpus stay exactly as
+ *  APEX_cpu_init left them, every run happens in a child on a copy-on-write
+ *  copy, so a run costs a fork() instead of parsing and initialization.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "cpu.h"
+
+extern long long inputClockCycles;
+
+/* A parsed and initialized program */
+typedef struct Serve_Program
+{
+	char* filename;
+	APEX_CPU* cpu;
+}Serve_Program;
+
+static Serve_Program programs[SERVE_MAX_PROGRAMS];
+static int programCount;
+static long long runs;
+
+/* Warm cpu of filename, parsed and initialized on first use */
+static APEX_CPU* warmProgram(const char* filename)
+{
+	APEX_CPU* cpu;
+
+	for(int i=0;i<programCount;i++)
+	{
+		if(strcmp(programs[i].filename,filename)==0)
+			return programs[i].cpu;
+	}
+	if(programCount==SERVE_MAX_PROGRAMS)
+	{
+		fprintf(stderr,"APEX_Error : The server keeps at most %d programs\n",SERVE_MAX_PROGRAMS);
+		return NULL;
+	}
+
+	cpu=APEX_cpu_init(filename);
+	if(!cpu)
+		return NULL;
+	programs[programCount].filename=strdup(filename);
+	programs[programCount].cpu=cpu;
+	programCount++;
+	return cpu;
+}
+
+/*
+ * Reads the request line of a connection, anything after the first
+ * newline is ignored. Returns the length of the line.
+ */
+static int readRequest(int fd,char* line)
+{
+	int len=0;
+	char* end=NULL;
+
+	while(!end && len<SERVE_REQUEST_SIZE-1)
+	{
+		ssize_t n=read(fd,line+len,SERVE_REQUEST_SIZE-1-len);
+		if(n<0 && errno==EINTR)
+			continue;
+		if(n<=0)
+			break;
+		end=memchr(line+len,'\n',n);
+		len+=n;
+	}
+	if(end)
+		len=end-line;
+	line[len]='\0';
+	if(len>0 && line[len-1]=='\r')
+		line[--len]='\0';
+	return len;
+}
+
+/*
+ * The child side of a run, the connection becomes stdout and stderr.
+ * options holds the rest of the request line. Never returns.
+ */
+static void runChild(int fd,APEX_CPU* cpu,const char* filename,const char* cycles,char* options)
+{
+	char* save;
+	int status=0;
+
+	// --aot waits for the compiler
+	signal(SIGCHLD,SIG_DFL);
+	signal(SIGPIPE,SIG_DFL);
+	dup2(fd,STDOUT_FILENO);
+	dup2(fd,STDERR_FILENO);
+	close(fd);
+
+	for(char* option=strtok_r(options," \t",&save);option;option=strtok_r(NULL," \t",&save))
+	{
+		if(APEX_parse_option(option)<0)
+		{
+			fprintf(stderr,"APEX_Error : Unknown option %s\n",option);
+			_exit(1);
+		}
+	}
+
+	inputClockCycles=runControlCycles(cycles);
+	if(multicoreCores>1)
+		status=multicoreRun(filename,inputClockCycles);
+	else if(APEX_cpu_configure(cpu,filename)<0)
+		status=-1;
+	else
+	{
+		status=APEX_cpu_simulate(cpu);
+		APEX_cpu_stop(cpu);
+	}
+
+	fflush(stdout);
+	fflush(stderr);
+	_exit(status<0 ? 1 : 0);
+}
+
+/*
+ * Serves one connection, returns 1 when the request stops the server
+ */
+static int serveRequest(int fd)
+{
+	char line[SERVE_REQUEST_SIZE];
+	char* save;
+	char* filename;
+	char* cycles;
+	APEX_CPU* cpu;
+
+	readRequest(fd,line);
+	filename=strtok_r(line," \t",&save);
+	if(filename && strcmp(filename,"shutdown")==0)
+	{
+		dprintf(fd,"APEX_Serve : Shutting down after %lld runs\n",runs);
+		return 1;
+	}
+
+	cycles=strtok_r(NULL," \t",&save);
+	if(!cycles)
+	{
+		dprintf(fd,"APEX_Error : Requests are <file> <cycles> [options]\n");
+		return 0;
+	}
+	cpu=warmProgram(filename);
+	if(!cpu)
+	{
+		dprintf(fd,"APEX_Error : Unable to initialize CPU with %s\n",filename);
+		return 0;
+	}
+
+	// the child must not repeat output still buffered in the server
+	fflush(stdout);
+	fflush(stderr);
+	pid_t pid=fork();
+	if(pid==0)
+		runChild(fd,cpu,filename,cycles,save);
+	if(pid<0)
+		dprintf(fd,"APEX_Error : Cannot fork a run\n");
+	else
+		runs++;
+	return 0;
+}
+
+/*
+ * Runs the server on socketPath until a shutdown request, filename is
+ * warmed before the first connection
+ */
+int serveRun(const char* filename,const char* socketPath)
+{
+	struct sockaddr_un addr;
+	int server;
+
+	if(!warmProgram(filename))
+	{
+		fprintf(stderr,"APEX_Error : Unable to initialize CPU\n");
+		return -1;
+	}
+	if(strlen(socketPath)>=sizeof(addr.sun_path))
+	{
+		fprintf(stderr,"APEX_Error : Socket path %s is too long\n",socketPath);
+		return -1;
+	}
+
+	memset(&addr,0,sizeof(addr));
+	addr.sun_family=AF_UNIX;
+	strcpy(addr.sun_path,socketPath);
+	server=socket(AF_UNIX,SOCK_STREAM,0);
+	unlink(socketPath);
+	if(server<0 || bind(server,(struct sockaddr*)&addr,sizeof(addr))<0 || listen(server,SOMAXCONN)<0)
+	{
+		fprintf(stderr,"APEX_Error : Cannot listen on %s : %s\n",socketPath,strerror(errno));
+		return -1;
+	}
+
+	// children exit on their own, nobody waits for them
+	signal(SIGCHLD,SIG_IGN);
+	signal(SIGPIPE,SIG_IGN);
+	fprintf(stderr,"APEX_Serve : Listening on %s\n",socketPath);
+
+	while(1)
+	{
+		int fd=accept(server,NULL,NULL);
+		if(fd<0)
+		{
+			if(errno==EINTR)
+				continue;
+			fprintf(stderr,"APEX_Error : accept failed : %s\n",strerror(errno));
+			break;
+		}
+		int stop=serveRequest(fd);
+		close(fd);
+		if(stop)
+			break;
+	}
+
+	close(server);
+	unlink(socketPath);
+	for(int i=0;i<programCount;i++)
+	{
+		APEX_cpu_stop(programs[i].cpu);
+		free(programs[i].filename);
+	}
+	return 0;
+}
@@ -0,0 +1,30 @@
+#ifndef _APEX_SERVE_H_
+#define _APEX_SERVE_H_
+/**
+ *  serve.h
+ *  Contains the fork-server operation
+ *
+ *  apex_sim <file> serve <socket> [options] parses and initializes the
+ *  program once, then listens on a unix socket. Every request line
+ *
+ *      <file> <cycles> [--opt=value ...]
+ *
+ *  is run by a fork()ed child on a copy-on-write copy of the warm cpu of
+ *  <file>, with the options of the request on top of the server's. The
+ *  child writes the simulate output to the connection and exits. A file
+ *  first named by a request is parsed then and kept warm for later runs.
+ *  The request "shutdown" stops the server.
+ */
+
+/* Programs the server keeps warm */
+#define SERVE_MAX_PROGRAMS 32
+
+/* Longest request line */
+#define SERVE_REQUEST_SIZE 4096
+
+/* Most options on one request line */
+#define SERVE_MAX_OPTIONS 64
+
+int serveRun(const char* filename,const char* socketPath);
+
+#endif
@@ -0,0 +1,227 @@
+/*
+ *  smt.c
+ *  Contains the hardware thread setup, fetch policies and SMT statistics
+ *
+ *  Thread i runs the i-th --smt-files program, threads past the list run
+ *  the input file. All programs start at PC 4000 and share the data
+ *  memory. Each program has its own code space in the I-cache: threads
+ *  running the same program hit on each other's lines, threads running
+ *  different programs compete for the sets. Every thread keeps its own
+ *  fetch block and line fill.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+int smtThreads=1;
+int fetchPolicy=FETCH_ROUND_ROBIN;
+const char* smtFiles=NULL;
+
+static const char* programs[SMT_MAX_THREADS];
+static char programNames[4096];
+
+int smtParseOption(const char* arg)
+{
+	const char* value;
+
+	if(matchOption(arg,"--smt-threads",&value))
+		smtThreads=atoi(value);
+	else if(matchOption(arg,"--smt-files",&value))
+		smtFiles=value;
+	else if(matchOption(arg,"--fetch-policy",&value))
+	{
+		if(strcmp(value,"rr")==0)
+			fetchPolicy=FETCH_ROUND_ROBIN;
+		else if(strcmp(value,"icount")==0)
+			fetchPolicy=FETCH_ICOUNT;
+		else
+			return 0;
+	}
+	else
+		return 0;
+
+	return 1;
+}
+
+/* Splits --smt-files into programs[], threads past the list run filename */
+static int assignPrograms(APEX_CPU* cpu,const char* filename)
+{
+	char* save;
+	int t=0;
+
+	for(int i=0;i<smtThreads;i++)
+		programs[i]=filename;
+	if(!smtFiles)
+		return 0;
+
+	if(strlen(smtFiles)>=sizeof(programNames))
+	{
+		fprintf(cpu->err,"APEX_Error : --smt-files list is too long\n");
+		return -1;
+	}
+	strcpy(programNames,smtFiles);
+	for(char* file=strtok_r(programNames,",",&save);file;file=strtok_r(NULL,",",&save))
+	{
+		if(t==smtThreads)
+		{
+			fprintf(cpu->err,"APEX_Error : --smt-files names more programs than %d threads\n",smtThreads);
+			return -1;
+		}
+		programs[t++]=file;
+	}
+	return 0;
+}
+
+/*
+ * Loads the programs of the hardware threads, thread 0 already holds
+ * filename unless --smt-files gives it another one. filename may name
+ * a program parsed from memory, it is never read again.
+ */
+int smtInit(APEX_CPU* cpu,const char* filename)
+{
+	if(smtThreads==1 && !smtFiles)
+		return 0;
+
+	if(smtThreads<1 || smtThreads>SMT_MAX_THREADS)
+	{
+		fprintf(cpu->err,"APEX_Error : --smt-threads must be 1 to %d, the URF holds %d registers\n",
+				SMT_MAX_THREADS,URF_SIZE);
+		return -1;
+	}
+	if(assignPrograms(cpu,filename)<0)
+		return -1;
+
+	cpu->threadCount=smtThreads;
+	cpu->robPartition=ROB_SIZE/smtThreads;
+	cpu->fetchThread=smtThreads-1;
+
+	// thread 0 goes last, threads running filename copy its code
+	for(int i=smtThreads-1;i>=0;i--)
+	{
+		CPU_Thread* thread=&cpu->threads[i];
+		CPU_Thread* first=&cpu->threads[0];
+
+		// the code space of the first thread running the same program
+		for(int j=0;j<=i;j++)
+		{
+			if(strcmp(programs[j],programs[i])==0)
+			{
+				thread->program=j;
+				break;
+			}
+		}
+		
+		if(i==0 && strcmp(programs[0],filename)==0)
+			continue;
+
+		free(thread->code_memory);
+		if(strcmp(programs[i],filename)==0)
+		{
+			thread->code_memory_size=first->code_memory_size;
+			thread->code_memory=malloc(first->code_memory_size*sizeof(APEX_Instruction));
+			if(thread->code_memory)
+				memcpy(thread->code_memory,first->code_memory,first->code_memory_size*sizeof(APEX_Instruction));
+		}
+		else
+			thread->code_memory=create_code_memory(programs[i],&thread->code_memory_size);
+		if(!thread->code_memory)
+		{
+			fprintf(cpu->err,"APEX_Error : Unable to load %s for thread %d\n",programs[i],i);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* Instructions of a thread that were fetched and have not issued yet */
+static int frontEndCount(APEX_CPU* cpu,CPU_Thread* thread)
+{
+	int count=0;
+
+	if(!thread->stage[DRF].stalled && thread->stage[DRF].pc>0)
+		count++;
+	if(!thread->stage[IQ].stalled && thread->stage[IQ].pc>0)
+		count++;
+	for(int i=0;i<IQ_SIZE;i++)
+	{
+		if(cpu->iq_list[i].allocated && cpu->iq_list[i].stage.thread==thread->id)
+			count++;
+	}
+	return count;
+}
+
+/*
+ * Picks the thread whose fetch, decode and dispatch run this cycle, -1
+ * when every thread has halted. Ties go round-robin from the last pick.
+ */
+int smtSelectThread(APEX_CPU* cpu)
+{
+	int selected=-1;
+	int bestCount=0;
+
+	if(cpu->threadCount==1)
+		return 0;
+
+	for(int k=1;k<=cpu->threadCount;k++)
+	{
+		int t=(cpu->fetchThread+k)%cpu->threadCount;
+		CPU_Thread* thread=&cpu->threads[t];
+
+		if(thread->haltAtRobHead)
+			continue;
+		if(fetchPolicy==FETCH_ROUND_ROBIN)
+		{
+			selected=t;
+			break;
+		}
+
+		int count=frontEndCount(cpu,thread);
+		if(selected==-1 || count<bestCount)
+		{
+			selected=t;
+			bestCount=count;
+		}
+	}
+
+	if(selected>-1)
+	{
+		cpu->fetchThread=selected;
+		cpu->threads[selected].frontEndCycles++;
+	}
+	return selected;
+}
+
+int printSmtStats(APEX_CPU* cpu)
+{
+	const char* names[]={"rr","icount"};
+	long long cycles=cpu->clock>0 ? cpu->clock : 1;
+
+	if(cpu->threadCount==1)
+		return 0;
+
+	for(int i=0;i<cpu->threadCount;i++)
+	{
+		CPU_Thread* thread=&cpu->threads[i];
+
+		cpu->thread=thread;
+		readArchState(cpu);
+		fprintf(cpu->out,"\n========== THREAD %d (%s) ==========\n",i,programs[i]);
+		printArchRegs(cpu);
+		fprintf(cpu->out,"|    Instructions\t|\t%lld\t|\n",thread->instructions);
+		fprintf(cpu->out,"|    IPC\t\t|\t%.4f\t|\n",(double)thread->instructions/cycles);
+		fprintf(cpu->out,"|    Front End Cycles\t|\t%lld\t|\n",thread->frontEndCycles);
+		fprintf(cpu->out,"|    Branch Flushes\t|\t%lld\t|\n",thread->flushes);
+		fprintf(cpu->out,"|    Halted\t\t|\t%s\t|\n",thread->haltAtRobHead ? "yes" : "no");
+	}
+	cpu->thread=&cpu->threads[0];
+
+	fprintf(cpu->out,"\n========== SMT STATISTICS ==========\n");
+	fprintf(cpu->out,"|    Threads\t\t|\t%d\t|\n",cpu->threadCount);
+	fprintf(cpu->out,"|    Fetch Policy\t|\t%s\t|\n",names[fetchPolicy]);
+	fprintf(cpu->out,"|    ROB Partition\t|\t%d\t|\n",cpu->robPartition);
+	fprintf(cpu->out,"|    Throughput IPC\t|\t%.4f\t|\n",(double)cpu->ins_completed/cycles);
+
+	return 0;
+}
@@ -0,0 +1,36 @@
+#ifndef _APEX_SMT_H_
+#define _APEX_SMT_H_
+/**
+ *  smt.h
+ *  Contains the simultaneous multithreading configuration and fetch policies
+ *
+ *  With --smt-threads=N the core runs N hardware threads. Each thread has
+ *  its own PC, front end latches, RAT and R-RAT, CFID space and ROB; the
+ *  IQ, LSQ, URF, function units, forward bus and data memory are shared.
+ *  Fetch, decode and dispatch serve one thread per cycle, picked by the
+ *  fetch policy, and every thread commits from its own ROB each cycle.
+ */
+
+struct APEX_CPU;
+
+/* Fetch policies */
+enum
+{
+	FETCH_ROUND_ROBIN,		// next thread that has not halted
+	FETCH_ICOUNT			// thread with the fewest instructions before issue
+};
+
+/* SMT configuration, set from command line options */
+extern int smtThreads;
+extern int fetchPolicy;
+extern const char* smtFiles;
+
+int smtParseOption(const char* arg);
+
+int smtInit(struct APEX_CPU* cpu,const char* filename);
+
+int smtSelectThread(struct APEX_CPU* cpu);
+
+int printSmtStats(struct APEX_CPU* cpu);
+
+#endif
@@ -0,0 +1,240 @@
+/*
+ *  stage_timing.c
+ *  Contains the host-side per-stage timing of the cycle loop
+ *
+ *  TIMED_STAGE reads the TSC (clock_gettime off x86) around every stage
+ *  call in APEX_cpu_run and adds the span to that stage. The whole loop is
+ *  also timed with clock_gettime, which converts ticks to ns. Stage calls
+ *  inside the --trace-start/--trace-cycles window are kept and written to
+ *  --trace-file as Chrome trace-event JSON (chrome://tracing, Perfetto).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cpu.h"
+
+const char* traceFile=NULL;
+long long traceStart=0;
+long long traceCycles=1000;
+
+static const char* stageNames[TIMING_STAGES]=
+{
+	"flushInstruction",
+	"commitToRrat",
+	"instAtRobHead",
+	"memFuncUnit",
+	"intFuncUnit",
+	"mulFuncUnit",
+	"iqStage",
+	"FwdToIssueQueue",
+	"FwdToLSQ",
+	"decode",
+	"fetch"
+};
+
+int stageTimingParseOption(const char* arg)
+{
+	const char* value;
+
+	if(matchOption(arg,"--trace-file",&value))
+		traceFile=value;
+	else if(matchOption(arg,"--trace-start",&value))
+		traceStart=atoll(value);
+	else if(matchOption(arg,"--trace-cycles",&value))
+		traceCycles=atoll(value);
+	else
+		return 0;
+
+	return 1;
+}
+
+int stageTimingInit(APEX_CPU* cpu)
+{
+	APEX_Stage_Timing* timing=&cpu->timing;
+
+	memset(timing,0,sizeof(*timing));
+	if(!traceFile)
+		return 0;
+
+#ifndef APEX_STAGE_TIMING
+	fprintf(cpu->err,"APEX_Error : --trace-file needs a simulator built with TIMING=1\n");
+	return -1;
+#else
+	if(traceStart<0 || traceCycles<1)
+	{
+		fprintf(cpu->err,"APEX_Error : Invalid trace window start=%lld cycles=%lld\n",traceStart,traceCycles);
+		return -1;
+	}
+
+	timing->eventCapacity=traceCycles*TIMING_STAGES;
+	timing->events=malloc(timing->eventCapacity*sizeof(*timing->events));
+	if(!timing->events)
+	{
+		fprintf(cpu->err,"APEX_Error : Cannot allocate a trace of %lld cycles\n",traceCycles);
+		return -1;
+	}
+	return 0;
+#endif
+}
+
+#ifdef APEX_STAGE_TIMING
+
+static long long monotonicNs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec*1000000000LL+ts.tv_nsec;
+}
+
+static long long runStartNs;
+
+int stageTimingBegin(APEX_CPU* cpu)
+{
+	runStartNs=monotonicNs();
+	cpu->timing.runStart=stageTimingNow();
+	return 0;
+}
+
+int stageTimingRecord(APEX_CPU* cpu,int stage,unsigned long long start,unsigned long long end)
+{
+	APEX_Stage_Timing* timing=&cpu->timing;
+
+	timing->ticks[stage]+=end-start;
+	timing->calls[stage]++;
+
+	if(timing->events && cpu->clock>=traceStart && cpu->clock<traceStart+traceCycles
+	&& timing->eventCount<timing->eventCapacity)
+	{
+		Stage_Trace_Event* event=&timing->events[timing->eventCount++];
+		event->stage=stage;
+		event->cycle=cpu->clock;
+		event->start=start;
+		event->end=end;
+	}
+	return 0;
+}
+
+int stageTimingEnd(APEX_CPU* cpu)
+{
+	cpu->timing.runTicks+=stageTimingNow()-cpu->timing.runStart;
+	cpu->timing.runNs+=monotonicNs()-runStartNs;
+	return 0;
+}
+
+#else
+
+int stageTimingBegin(APEX_CPU* cpu)
+{
+	return 0;
+}
+
+int stageTimingRecord(APEX_CPU* cpu,int stage,unsigned long long start,unsigned long long end)
+{
+	return 0;
+}
+
+int stageTimingEnd(APEX_CPU* cpu)
+{
+	return 0;
+}
+
+#endif
+
+static double ticksPerNs(APEX_Stage_Timing* timing)
+{
+	if(!timing->runNs || !timing->runTicks)
+		return 1.0;
+	return (double)timing->runTicks/timing->runNs;
+}
+
+/* Writes the trace window as complete ("X") events, one row per cycle and one per stage */
+static int writeTrace(APEX_CPU* cpu)
+{
+	APEX_Stage_Timing* timing=&cpu->timing;
+	double scale=1.0/(ticksPerNs(timing)*1000.0);	// ticks to us
+	FILE* fp=fopen(traceFile,"w");
+
+	if(!fp)
+	{
+		fprintf(cpu->err,"APEX_Error : Cannot open trace file %s\n",traceFile);
+		return -1;
+	}
+
+	fprintf(fp,"{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	fprintf(fp,"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"cycles\"}},\n");
+	fprintf(fp,"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"stages\"}}");
+
+	for(long long i=0;i<timing->eventCount;)
+	{
+		// events of one cycle are consecutive, the cycle spans all of them
+		long long cycle=timing->events[i].cycle;
+		unsigned long long cycleStart=timing->events[i].start;
+		unsigned long long cycleEnd=timing->events[i].end;
+		long long first=i;
+
+		for(;i<timing->eventCount && timing->events[i].cycle==cycle;i++)
+		{
+			if(timing->events[i].end>cycleEnd)
+				cycleEnd=timing->events[i].end;
+		}
+		fprintf(fp,",\n{\"name\":\"cycle %lld\",\"cat\":\"cycle\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+				"\"ts\":%.3f,\"dur\":%.3f}",
+				cycle+1,(cycleStart-timing->runStart)*scale,(cycleEnd-cycleStart)*scale);
+
+		for(long long j=first;j<i;j++)
+		{
+			Stage_Trace_Event* event=&timing->events[j];
+			fprintf(fp,",\n{\"name\":\"%s\",\"cat\":\"stage\",\"ph\":\"X\",\"pid\":1,\"tid\":2,"
+					"\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"cycle\":%lld}}",
+					stageNames[event->stage],(event->start-timing->runStart)*scale,
+					(event->end-event->start)*scale,event->cycle+1);
+		}
+	}
+	fprintf(fp,"\n]}\n");
+	fclose(fp);
+	return 0;
+}
+
+/* Writes the trace file, if one was asked for, and releases the trace buffer */
+int stageTimingFinish(APEX_CPU* cpu)
+{
+	APEX_Stage_Timing* timing=&cpu->timing;
+
+	if(timing->events)
+	{
+		writeTrace(cpu);
+		free(timing->events);
+		timing->events=NULL;
+	}
+	return 0;
+}
+
+int printStageTiming(APEX_CPU* cpu)
+{
+#ifdef APEX_STAGE_TIMING
+	APEX_Stage_Timing* timing=&cpu->timing;
+	double scale=1.0/ticksPerNs(timing);
+	unsigned long long stageTicks=0;
+	long long cycles=cpu->clock>0 ? cpu->clock : 1;
+
+	for(int i=0;i<TIMING_STAGES;i++)
+		stageTicks+=timing->ticks[i];
+
+	fprintf(cpu->out,"\n========== HOST TIME PER STAGE ==========\n");
+	fprintf(cpu->out,"|    Stage\t\t|\tms\t|\tns/cycle\t|\tshare\t|\n");
+	for(int i=0;i<TIMING_STAGES;i++)
+	{
+		fprintf(cpu->out,"|    %-16s\t|\t%.3f\t|\t%.1f\t\t|\t%.1f%%\t|\n",stageNames[i],
+				timing->ticks[i]*scale/1e6,timing->ticks[i]*scale/cycles,
+				timing->runTicks ? 100.0*timing->ticks[i]/timing->runTicks : 0.0);
+	}
+
+	unsigned long long otherTicks=timing->runTicks>stageTicks ? timing->runTicks-stageTicks : 0;
+	fprintf(cpu->out,"|    %-16s\t|\t%.3f\t|\t%.1f\t\t|\t%.1f%%\t|\n","loop and timing",
+			otherTicks*scale/1e6,otherTicks*scale/cycles,
+			timing->runTicks ? 100.0*otherTicks/timing->runTicks : 0.0);
+#endif
+	return 0;
+}
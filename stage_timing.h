@@ -0,0 +1,107 @@
+#ifndef _APEX_STAGE_TIMING_H_
+#define _APEX_STAGE_TIMING_H_
+/**
+ *  stage_timing.h
+ *  Contains the host-side per-stage timing of the cycle loop
+ *
+ *  Built in with TIMING=1 (-DAPEX_STAGE_TIMING), otherwise the TIMED_STAGE
+ *  macros expand to the plain stage call and nothing is measured.
+ */
+
+struct APEX_CPU;
+
+enum
+{
+	TIMING_FLUSH,
+	TIMING_COMMIT_TO_RRAT,
+	TIMING_INST_AT_ROB_HEAD,
+	TIMING_MEM_FU,
+	TIMING_INT_FU,
+	TIMING_MUL_FU,
+	TIMING_IQ_STAGE,
+	TIMING_FWD_TO_IQ,
+	TIMING_FWD_TO_LSQ,
+	TIMING_DECODE,
+	TIMING_FETCH,
+	TIMING_STAGES
+};
+
+/* One stage call inside the trace window */
+typedef struct Stage_Trace_Event
+{
+	int stage;
+	long long cycle;
+	unsigned long long start;
+	unsigned long long end;
+}Stage_Trace_Event;
+
+/* Host time spent in each stage function */
+typedef struct APEX_Stage_Timing
+{
+	unsigned long long ticks[TIMING_STAGES];
+	long long calls[TIMING_STAGES];
+
+	unsigned long long runTicks;	// whole cycle loop, stages and loop overhead
+	unsigned long long runStart;
+	long long runNs;				// same span in ns, calibrates ticks to ns
+
+	Stage_Trace_Event* events;
+	long long eventCount;
+	long long eventCapacity;
+}APEX_Stage_Timing;
+
+/* Trace window configuration, set from command line options */
+extern const char* traceFile;
+extern long long traceStart;
+extern long long traceCycles;
+
+#ifdef APEX_STAGE_TIMING
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline unsigned long long stageTimingNow(void)
+{
+	return __rdtsc();
+}
+#else
+#include <time.h>
+static inline unsigned long long stageTimingNow(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec*1000000000ULL+ts.tv_nsec;
+}
+#endif
+
+#define TIMED_STAGE(cpu,stage,call) \
+	do { \
+		unsigned long long timingStart=stageTimingNow(); \
+		call; \
+		stageTimingRecord(cpu,stage,timingStart,stageTimingNow()); \
+	} while(0)
+#define STAGE_TIMING_BEGIN(cpu) stageTimingBegin(cpu)
+#define STAGE_TIMING_END(cpu) stageTimingEnd(cpu)
+
+#else
+
+#define TIMED_STAGE(cpu,stage,call) call
+#define STAGE_TIMING_BEGIN(cpu)
+#define STAGE_TIMING_END(cpu)
+
+#endif
+
+int stageTimingParseOption(const char* arg);
+
+int stageTimingInit(struct APEX_CPU* cpu);
+
+int stageTimingBegin(struct APEX_CPU* cpu);
+
+int stageTimingRecord(struct APEX_CPU* cpu,int stage,unsigned long long start,unsigned long long end);
+
+int stageTimingEnd(struct APEX_CPU* cpu);
+
+int stageTimingFinish(struct APEX_CPU* cpu);
+
+int printStageTiming(struct APEX_CPU* cpu);
+
+#endif
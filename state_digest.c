@@ -0,0 +1,284 @@
+/*
+ *  state_digest.c
+ *  Contains the incremental digest of the architectural state and its stream
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+int stateDigestEnabled=0;
+const char* stateDigestFile=NULL;
+int stateDigestInstructions=STATE_DIGEST_INSTS;
+
+int stateDigestParseOption(const char* arg)
+{
+	const char* value;
+
+	if(matchOption(arg,"--state-digest",&value))
+		stateDigestEnabled=atoi(value);
+	else if(matchOption(arg,"--state-digest-file",&value))
+		stateDigestFile=value;
+	else if(matchOption(arg,"--state-digest-insts",&value))
+		stateDigestInstructions=atoi(value);
+	else
+		return 0;
+
+	return 1;
+}
+
+/*
+ * Term of one location, memory words are keys 0 to DATA_MEMORY_SIZE-1 and
+ * the registers of thread t follow from DATA_MEMORY_SIZE+t*RAT_SIZE
+ */
+static unsigned long long digestTerm(int key,int value)
+{
+	unsigned long long x=((unsigned long long)(unsigned int)key<<32)|(unsigned int)value;
+
+	// splitmix64 finalizer, every input bit reaches every output bit
+	x+=0x9e3779b97f4a7c15ULL;
+	x=(x^(x>>30))*0xbf58476d1ce4e5b9ULL;
+	x=(x^(x>>27))*0x94d049bb133111ebULL;
+	return x^(x>>31);
+}
+
+/* Committed value of R-RAT entry i of a thread, 0 until it is first written */
+static int committedValue(APEX_CPU* cpu,CPU_Thread* thread,int i)
+{
+	if(!(&thread->rRat[i])->allocated)
+		return 0;
+
+	CPU_Register* reg=&cpu->urf_regs[(&thread->rRat[i])->urf_reg];
+	return i==RAT_ZERO_FLAG ? reg->zFlag : reg->value;
+}
+
+/* Sums the terms of the whole state, the committed values from the R-RAT */
+static int computeDigest(APEX_CPU* cpu,unsigned long long* regs,unsigned long long* memory,int* committed)
+{
+	*memory=0;
+	for(int i=0;i<DATA_MEMORY_SIZE;i++)
+		*memory+=digestTerm(i,cpu->data_memory[i]);
+
+	*regs=0;
+	for(int t=0;t<cpu->threadCount;t++)
+	{
+		for(int i=0;i<RAT_SIZE;i++)
+		{
+			int value=committedValue(cpu,&cpu->threads[t],i);
+			if(committed)
+				committed[t*RAT_SIZE+i]=value;
+			*regs+=digestTerm(DATA_MEMORY_SIZE+t*RAT_SIZE+i,value);
+		}
+	}
+	return 0;
+}
+
+int stateDigestInit(APEX_CPU* cpu)
+{
+	APEX_State_Digest* digest=&cpu->digest;
+
+	// a warm cpu of the serve operation is configured again for each run
+	free(digest->committed);
+	free(digest->pending);
+	memset(digest,0,sizeof(*digest));
+	if(!stateDigestEnabled && !stateDigestFile)
+		return 0;
+
+	if(aotEnabled || multicoreCores>1)
+	{
+		fprintf(cpu->err,"APEX_Error : The state digest follows a single simulated core, drop --aot or --cores\n");
+		return -1;
+	}
+	if(stateDigestFile && (cpu->threadCount>1 || stateDigestInstructions<1))
+	{
+		fprintf(cpu->err,"APEX_Error : The digest stream needs a single thread and --state-digest-insts of 1 or more\n");
+		return -1;
+	}
+
+	digest->committed=calloc(cpu->threadCount*RAT_SIZE,sizeof(int));
+	if(!digest->committed)
+		return -1;
+	if(stateDigestFile)
+	{
+		digest->file=fopen(stateDigestFile,"w");
+		if(!digest->file)
+		{
+			fprintf(cpu->err,"APEX_Error : Cannot write %s\n",stateDigestFile);
+			free(digest->committed);
+			digest->committed=NULL;
+			return -1;
+		}
+		fprintf(digest->file,"instructions,digest\n");
+	}
+
+	computeDigest(cpu,&digest->regs,&digest->memory,digest->committed);
+	digest->memoryAfter[0]=digest->memory;
+	digest->nextSample=stateDigestInstructions;
+	digest->enabled=1;
+	return 0;
+}
+
+static int writeSample(APEX_State_Digest* digest,long long instructions,unsigned long long value)
+{
+	fprintf(digest->file,"%lld,%016llx\n",instructions,value);
+	digest->samples++;
+	return 0;
+}
+
+/* Writes the rows whose STOREs have all been written */
+static int writeReadySamples(APEX_State_Digest* digest)
+{
+	while(digest->pendingCount)
+	{
+		Digest_Sample* sample=&digest->pending[digest->pendingHead];
+		if(sample->stores>digest->storesWritten)
+			break;
+
+		writeSample(digest,sample->instructions,sample->regs+digest->memoryAfter[sample->stores&(STATE_DIGEST_STORES-1)]);
+		digest->pendingHead++;
+		digest->pendingCount--;
+	}
+	if(!digest->pendingCount)
+		digest->pendingHead=0;
+	return 0;
+}
+
+/* Takes the row of the instruction just committed */
+static int takeSample(APEX_State_Digest* digest)
+{
+	if(digest->pendingHead+digest->pendingCount==digest->pendingSize)
+	{
+		int size=digest->pendingSize ? digest->pendingSize*2 : 16;
+		Digest_Sample* pending=realloc(digest->pending,size*sizeof(*pending));
+		if(!pending)
+			return -1;
+		digest->pending=pending;
+		digest->pendingSize=size;
+	}
+
+	Digest_Sample* sample=&digest->pending[digest->pendingHead+digest->pendingCount++];
+	sample->instructions=digest->instructions;
+	sample->regs=digest->regs;
+	sample->stores=digest->storesCommitted;
+	return writeReadySamples(digest);
+}
+
+/*
+ * Called for every committed instruction, swaps the terms of the register
+ * and zero flag it writes
+ */
+int stateDigestCommit(APEX_CPU* cpu,CPU_Stage* stage)
+{
+	APEX_State_Digest* digest=&cpu->digest;
+	int* committed=&digest->committed[stage->thread*RAT_SIZE];
+
+	if(strcmp(stage->opcode,"STORE")==0)
+		digest->storesCommitted++;
+	else if(strcmp(stage->opcode,"JUMP")!=0 && strcmp(stage->opcode,"BZ")!=0
+	&& strcmp(stage->opcode,"BNZ")!=0 && strcmp(stage->opcode,"HALT")!=0 && strcmp(stage->opcode,"")!=0)
+	{
+		int key=DATA_MEMORY_SIZE+stage->thread*RAT_SIZE;
+
+		if(committed[stage->rd]!=stage->buffer)
+		{
+			digest->regs+=digestTerm(key+stage->rd,stage->buffer)-digestTerm(key+stage->rd,committed[stage->rd]);
+			committed[stage->rd]=stage->buffer;
+		}
+		// every writer but a LOAD sets the zero flag from its result
+		if(strcmp(stage->opcode,"LOAD")!=0 && committed[RAT_ZERO_FLAG]!=(stage->buffer==0))
+		{
+			digest->regs+=digestTerm(key+RAT_ZERO_FLAG,stage->buffer==0)-digestTerm(key+RAT_ZERO_FLAG,committed[RAT_ZERO_FLAG]);
+			committed[RAT_ZERO_FLAG]=stage->buffer==0;
+		}
+	}
+
+	digest->instructions++;
+	if(digest->file && digest->instructions==digest->nextSample)
+	{
+		takeSample(digest);
+		digest->nextSample+=stateDigestInstructions;
+	}
+	return 0;
+}
+
+/* Called before a STORE writes value at address */
+int stateDigestStore(APEX_CPU* cpu,int address,int value)
+{
+	APEX_State_Digest* digest=&cpu->digest;
+
+	digest->memory+=digestTerm(address,value)-digestTerm(address,cpu->data_memory[address]);
+	digest->storesWritten++;
+	digest->memoryAfter[digest->storesWritten&(STATE_DIGEST_STORES-1)]=digest->memory;
+	if(digest->pendingCount)
+		writeReadySamples(digest);
+	return 0;
+}
+
+/*
+ * Computes the digest again from the state, after fast-forward rebuilt
+ * the registers and memory without committing. Never with a stream, whose
+ * rows need every commit and STORE.
+ */
+int stateDigestSync(APEX_CPU* cpu)
+{
+	APEX_State_Digest* digest=&cpu->digest;
+
+	computeDigest(cpu,&digest->regs,&digest->memory,digest->committed);
+	return 0;
+}
+
+/*
+ * Writes the rows still waiting on STOREs and the one of the end of the
+ * run, and checks the digest against the state it ended in
+ */
+int stateDigestFinish(APEX_CPU* cpu)
+{
+	APEX_State_Digest* digest=&cpu->digest;
+	unsigned long long regs,memory;
+
+	if(!digest->enabled)
+		return 0;
+
+	if(digest->file)
+	{
+		for(int i=0;i<digest->pendingCount;i++)
+		{
+			Digest_Sample* sample=&digest->pending[digest->pendingHead+i];
+			writeSample(digest,sample->instructions,sample->regs+digest->memory);
+		}
+		if(digest->instructions!=digest->nextSample-stateDigestInstructions)
+			writeSample(digest,digest->instructions,digest->regs+digest->memory);
+		if(fclose(digest->file)!=0)
+			fprintf(cpu->err,"APEX_Error : Writing %s failed\n",stateDigestFile);
+		digest->file=NULL;
+	}
+
+	computeDigest(cpu,&regs,&memory,NULL);
+	if(regs+memory!=digest->regs+digest->memory)
+		fprintf(cpu->err,"APEX_Error : State digest %016llx does not match the final state, %016llx\n",
+			digest->regs+digest->memory,regs+memory);
+
+	free(digest->committed);
+	free(digest->pending);
+	digest->committed=NULL;
+	digest->pending=NULL;
+	digest->pendingCount=0;
+	digest->enabled=0;
+	return 0;
+}
+
+int printStateDigestStats(APEX_CPU* cpu)
+{
+	APEX_State_Digest* digest=&cpu->digest;
+
+	if(!digest->enabled)
+		return 0;
+
+	fprintf(cpu->out,"\n========== STATE DIGEST ==========\n");
+	fprintf(cpu->out,"|    Digest\t\t|\t%016llx\t|\n",digest->regs+digest->memory);
+	if(digest->file)
+		fprintf(cpu->out,"|    Digest Rows\t|\t%lld\t|\n",digest->samples+digest->pendingCount
+			+(digest->instructions!=digest->nextSample-stateDigestInstructions));
+	return 0;
+}
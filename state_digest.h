@@ -0,0 +1,98 @@
+#ifndef _APEX_STATE_DIGEST_H_
+#define _APEX_STATE_DIGEST_H_
+/**
+ *  state_digest.h
+ *  Contains the digest of the architectural state
+ *
+ *  With --state-digest=1 the cpu keeps a 64-bit digest of its committed
+ *  registers and zero flag, as the R-RAT maps them, and of the whole data
+ *  memory. The digest is the sum of one hashed term per register and per
+ *  memory word, a commit or a STORE only swaps the term of what it wrote.
+ *  Two runs that end in the same state print the same digest, whatever
+ *  their timing configuration.
+ *
+ *  --state-digest-file=path also writes the digest every
+ *  --state-digest-insts committed instructions and at the end of the run,
+ *  as a CSV of instructions,digest. A STORE commits before it writes
+ *  memory, so each row holds the memory as of the STOREs committed up to
+ *  its instruction and is written once they have all been written. The
+ *  first row two files differ in brackets the first divergent interval.
+ */
+
+#include <stdio.h>
+
+struct APEX_CPU;
+struct CPU_Stage;
+
+/* Instructions per digest row unless --state-digest-insts says otherwise */
+#define STATE_DIGEST_INSTS 100000
+
+/* Memory digests kept after the last STOREs, more than a ROB of them can
+ * be written ahead of their commit. A power of two. */
+#define STATE_DIGEST_STORES 64
+
+/* A row waiting for the STOREs committed before it to write memory */
+typedef struct Digest_Sample
+{
+	long long instructions;
+	unsigned long long regs;	// register terms at that commit
+	long long stores;			// STOREs committed by then
+}Digest_Sample;
+
+typedef struct APEX_State_Digest
+{
+	int enabled;
+	unsigned long long regs;	// sum of the register and zero flag terms
+	unsigned long long memory;	// sum of the memory word terms
+	int* committed;				// R0-R15 and Z of each thread, as digested
+
+	/* Digest stream */
+	FILE* file;
+	long long instructions;		// committed since the start of the run
+	long long nextSample;
+	long long storesCommitted;
+	long long storesWritten;
+	unsigned long long memoryAfter[STATE_DIGEST_STORES];	// by STOREs written
+	Digest_Sample* pending;
+	int pendingHead;
+	int pendingCount;
+	int pendingSize;
+
+	/* Some stats */
+	long long samples;
+}APEX_State_Digest;
+
+/* State digest configuration, set from command line options */
+extern int stateDigestEnabled;
+extern const char* stateDigestFile;
+extern int stateDigestInstructions;
+
+/* At commit, one test unless digesting */
+#define STATE_DIGEST_COMMIT(cpu,stage) \
+	do { \
+		if((cpu)->digest.enabled) \
+			stateDigestCommit(cpu,stage); \
+	} while(0)
+
+/* Before a STORE writes memory */
+#define STATE_DIGEST_STORE(cpu,address,value) \
+	do { \
+		if((cpu)->digest.enabled) \
+			stateDigestStore(cpu,address,value); \
+	} while(0)
+
+int stateDigestParseOption(const char* arg);
+
+int stateDigestInit(struct APEX_CPU* cpu);
+
+int stateDigestCommit(struct APEX_CPU* cpu,struct CPU_Stage* stage);
+
+int stateDigestStore(struct APEX_CPU* cpu,int address,int value);
+
+int stateDigestSync(struct APEX_CPU* cpu);
+
+int stateDigestFinish(struct APEX_CPU* cpu);
+
+int printStateDigestStats(struct APEX_CPU* cpu);
+
+#endif